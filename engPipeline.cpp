@@ -1,25 +1,144 @@
 #include "engPipeline.h"
 #include "engineModel.h"
+#include "engineUtils.h"
 
 #include <fstream>
 #include <stdexcept>
 #include <iostream>
 #include <cassert>
+#include <functional>
 
 namespace gameEngine
 {
 
+	ShaderVariant& ShaderVariant::set(uint32_t constantId, uint32_t value)
+	{
+		auto it = constants.begin();
+
+		while (it != constants.end() && it->first < constantId)
+		{
+			++it;
+		}
+
+		if (it != constants.end() && it->first == constantId)
+		{
+			it->second = value;
+		}
+		else
+		{
+			constants.insert(it, { constantId, value });
+		}
+
+		return *this;
+	}
+
+	ShaderVariant& ShaderVariant::define(const std::string& name, const std::string& value)
+	{
+		auto it = defines.begin();
+
+		while (it != defines.end() && it->first < name)
+		{
+			++it;
+		}
+
+		if (it != defines.end() && it->first == name)
+		{
+			it->second = value;
+		}
+		else
+		{
+			defines.insert(it, { name, value });
+		}
+
+		return *this;
+	}
+
+	size_t ShaderVariant::hash() const
+	{
+		size_t seed = 0;
+
+		for (auto& constant : constants)
+		{
+			hashCombine(seed, constant.first, constant.second);
+		}
+
+		for (auto& define : defines)
+		{
+			hashCombine(seed, define.first, define.second);
+		}
+
+		return seed;
+	}
+
+	// Shared by every pipeline, the same constants go to all stages
+	struct SpecializationData
+	{
+		std::vector<VkSpecializationMapEntry> entries{};
+		std::vector<uint32_t> data{};
+		VkSpecializationInfo info{};
+
+		explicit SpecializationData(const ShaderVariant& variant)
+		{
+			for (auto& constant : variant.constants)
+			{
+				uint32_t offset = static_cast<uint32_t>(data.size() * sizeof(uint32_t));
+				entries.push_back({ constant.first, offset, sizeof(uint32_t) });
+				data.push_back(constant.second);
+			}
+
+			info.mapEntryCount = static_cast<uint32_t>(entries.size());
+			info.pMapEntries = entries.data();
+			info.dataSize = data.size() * sizeof(uint32_t);
+			info.pData = data.data();
+		}
+
+		const VkSpecializationInfo* get() const { return entries.empty() ? nullptr : &info; }
+	};
+
 	EngPipeline::EngPipeline(EngineDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo)
 		: engDevice{ device }
 	{
-		createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+		auto vertCode = readFile(vertFilepath);
+		auto fragCode = readFile(fragFilepath);
+
+		createGraphicsPipeline({
+			{ VK_SHADER_STAGE_VERTEX_BIT, reinterpret_cast<const uint32_t*>(vertCode.data()), vertCode.size() },
+			{ VK_SHADER_STAGE_FRAGMENT_BIT, reinterpret_cast<const uint32_t*>(fragCode.data()), fragCode.size() } }, configInfo);
+	}
+
+	EngPipeline::EngPipeline(EngineDevice& device, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv, const PipelineConfigInfo& configInfo)
+		: engDevice{ device }
+	{
+		createGraphicsPipeline({
+			{ VK_SHADER_STAGE_VERTEX_BIT, vertSpirv.data(), vertSpirv.size() * sizeof(uint32_t) },
+			{ VK_SHADER_STAGE_FRAGMENT_BIT, fragSpirv.data(), fragSpirv.size() * sizeof(uint32_t) } }, configInfo);
+	}
+
+	EngPipeline::EngPipeline(EngineDevice& device, const std::vector<ShaderStageSpirv>& stages, const PipelineConfigInfo& configInfo)
+		: engDevice{ device }
+	{
+		std::vector<StageCode> stageCode{};
+
+		for (auto& stage : stages)
+		{
+			stageCode.push_back({ stage.stage, stage.spirv.data(), stage.spirv.size() * sizeof(uint32_t) });
+		}
+
+		createGraphicsPipeline(stageCode, configInfo);
 	}
 
 	EngPipeline::~EngPipeline()
 	{
-		vkDestroyShaderModule(engDevice.getDevice(), vertShaderModule, nullptr);
-		vkDestroyShaderModule(engDevice.getDevice(), fragShaderModule, nullptr);
-		vkDestroyPipeline(engDevice.getDevice(), graphicsPipeline, nullptr);
+		// Hot reloads replace pipelines that frames in flight are still drawing with
+		engDevice.deferDestruction([&device = engDevice, shaderModules = std::move(shaderModules), pipeline = graphicsPipeline]()
+			{
+				for (auto shaderModule : shaderModules)
+				{
+					vkDestroyShaderModule(device.getDevice(), shaderModule, nullptr);
+				}
+
+				vkDestroyPipeline(device.getDevice(), pipeline, nullptr);
+			});
 	}
 
 	std::vector<char> EngPipeline::readFile(const std::string& filepath)
@@ -47,32 +166,32 @@ namespace gameEngine
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 	}
 
-	void EngPipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo)
+	void EngPipeline::createGraphicsPipeline(const std::vector<StageCode>& stages, const PipelineConfigInfo& configInfo)
 	{
 		assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no pipelineLayout provided in configInfo");
-		assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline:: no renderPass provided in configInfo");
+		assert((configInfo.attachments.renderPass != VK_NULL_HANDLE || engDevice.supportsDynamicRendering()) &&
+			"Cannot create graphics pipeline:: no renderPass provided in configInfo");
 
-		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
+		SpecializationData specialization{ configInfo.variant };
+
+		std::vector<VkPipelineShaderStageCreateInfo> shaderStages(stages.size());
+		shaderModules.resize(stages.size());
+		bool meshPipeline = false;
 
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
-
-		VkPipelineShaderStageCreateInfo shaderStages[2];
-		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStages[0].module = vertShaderModule;
-		shaderStages[0].pName = "main";
-		shaderStages[0].flags = 0;
-		shaderStages[0].pNext = nullptr;
-		shaderStages[0].pSpecializationInfo = nullptr;
-		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStages[1].module = fragShaderModule;
-		shaderStages[1].pName = "main";
-		shaderStages[1].flags = 0;
-		shaderStages[1].pNext = nullptr;
-		shaderStages[1].pSpecializationInfo = nullptr;
+		for (size_t i = 0; i < stages.size(); i++)
+		{
+			createShaderModule(stages[i].code, stages[i].codeSize, &shaderModules[i]);
+
+			shaderStages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			shaderStages[i].stage = stages[i].stage;
+			shaderStages[i].module = shaderModules[i];
+			shaderStages[i].pName = "main";
+			shaderStages[i].flags = 0;
+			shaderStages[i].pNext = nullptr;
+			shaderStages[i].pSpecializationInfo = specialization.get();
+
+			meshPipeline |= stages[i].stage == VK_SHADER_STAGE_MESH_BIT_EXT;
+		}
 
 		auto& bindingDescriptions = configInfo.bindingDescriptions;
 		auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -86,10 +205,10 @@ namespace gameEngine
 
 		VkGraphicsPipelineCreateInfo pipelineInfo{};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
-		pipelineInfo.pStages = shaderStages;
-		pipelineInfo.pVertexInputState = &vertexInputInfo;
-		pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+		pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineInfo.pStages = shaderStages.data();
+		pipelineInfo.pVertexInputState = meshPipeline ? nullptr : &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = meshPipeline ? nullptr : &configInfo.inputAssemblyInfo;
 		pipelineInfo.pViewportState = &configInfo.viewportInfo;
 		pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
 		pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
@@ -98,9 +217,22 @@ namespace gameEngine
 		pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
 
 		pipelineInfo.layout = configInfo.pipelineLayout;
-		pipelineInfo.renderPass = configInfo.renderPass;
+		pipelineInfo.renderPass = configInfo.attachments.renderPass;
 		pipelineInfo.subpass = configInfo.subpass;
 
+		// Without a render pass the pipeline is only tied to attachment formats, so it outlives swap chains
+		VkPipelineRenderingCreateInfoKHR renderingInfo{};
+
+		if (configInfo.attachments.renderPass == VK_NULL_HANDLE)
+		{
+			renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+			renderingInfo.colorAttachmentCount = static_cast<uint32_t>(configInfo.attachments.colorFormats.size());
+			renderingInfo.pColorAttachmentFormats = configInfo.attachments.colorFormats.data();
+			renderingInfo.depthAttachmentFormat = configInfo.attachments.depthFormat;
+			renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+			pipelineInfo.pNext = &renderingInfo;
+		}
+
 		pipelineInfo.basePipelineIndex = -1;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
@@ -110,12 +242,12 @@ namespace gameEngine
 		}
 	}
 
-	void EngPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
+	void EngPipeline::createShaderModule(const uint32_t* code, size_t codeSize, VkShaderModule* shaderModule)
 	{
 		VkShaderModuleCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		createInfo.codeSize = codeSize;
+		createInfo.pCode = code;
 
 		if (vkCreateShaderModule(engDevice.getDevice(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
 		{
@@ -123,6 +255,52 @@ namespace gameEngine
 		}
 	}
 
+	EngComputePipeline::EngComputePipeline(EngineDevice& device, const std::vector<uint32_t>& spirv, VkPipelineLayout pipelineLayout, const ShaderVariant& variant)
+		: engDevice{ device }
+	{
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.codeSize = spirv.size() * sizeof(uint32_t);
+		moduleInfo.pCode = spirv.data();
+
+		if (vkCreateShaderModule(engDevice.getDevice(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create shader module!");
+		}
+
+		SpecializationData specialization{ variant };
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = shaderModule;
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.stage.pSpecializationInfo = specialization.get();
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(engDevice.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create compute pipeline!");
+		}
+	}
+
+	EngComputePipeline::~EngComputePipeline()
+	{
+		engDevice.deferDestruction([&device = engDevice, shaderModule = shaderModule, pipeline = computePipeline]()
+			{
+				vkDestroyShaderModule(device.getDevice(), shaderModule, nullptr);
+				vkDestroyPipeline(device.getDevice(), pipeline, nullptr);
+			});
+	}
+
+	void EngComputePipeline::bind(VkCommandBuffer commandBuffer)
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+	}
+
 	void EngPipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
 	{
 		configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -3,11 +3,47 @@
 #include "engineDevice.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace gameEngine
 {
 
+	// Specialization constant values for one pipeline variant. The same constants are handed to every
+	// stage, a stage simply ignores constant ids it doesn't declare
+	struct ShaderVariant
+	{
+		ShaderVariant& set(uint32_t constantId, uint32_t value);
+		ShaderVariant& set(uint32_t constantId, int32_t value) { return set(constantId, static_cast<uint32_t>(value)); }
+		ShaderVariant& set(uint32_t constantId, bool value) { return set(constantId, static_cast<uint32_t>(value ? VK_TRUE : VK_FALSE)); }
+
+		// Preprocessor defines, only honoured when the pipeline is built from GLSL source
+		ShaderVariant& define(const std::string& name, const std::string& value = "1");
+
+		size_t hash() const;
+
+		bool operator==(const ShaderVariant& other) const { return constants == other.constants && defines == other.defines; }
+
+		// {constant_id, value}, kept sorted by id so equal variants compare and hash equal
+		std::vector<std::pair<uint32_t, uint32_t>> constants{};
+		// {name, value}, kept sorted by name for the same reason
+		std::vector<std::pair<std::string, std::string>> defines{};
+	};
+
+	struct ShaderVariantHash
+	{
+		size_t operator()(const ShaderVariant& variant) const { return variant.hash(); }
+	};
+
+	// What a graphics pipeline renders into. With dynamic rendering the formats are all that matters,
+	// without it renderPass has to be compatible with the render passes the pipeline is used in
+	struct PipelineAttachments
+	{
+		std::vector<VkFormat> colorFormats{};
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+	};
+
 	struct PipelineConfigInfo
 	{
 		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
@@ -25,15 +61,27 @@ namespace gameEngine
 		std::vector<VkDynamicState> dynamicStateEnables{};
 		VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
 		VkPipelineLayout pipelineLayout = nullptr;
-		VkRenderPass renderPass = nullptr;
+		PipelineAttachments attachments{};
 		uint32_t subpass = 0;
+		ShaderVariant variant{};
 	};
 
 
+	struct ShaderStageSpirv
+	{
+		VkShaderStageFlagBits stage;
+		std::vector<uint32_t> spirv;
+	};
+
 	class EngPipeline
 	{
 	public:
 		EngPipeline(EngineDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+		EngPipeline(EngineDevice& device, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv, const PipelineConfigInfo& configInfo);
+
+		// Any set of graphics stages, eg task + mesh + fragment. Pipelines with a mesh stage ignore the
+		// vertex input and input assembly state of configInfo
+		EngPipeline(EngineDevice& device, const std::vector<ShaderStageSpirv>& stages, const PipelineConfigInfo& configInfo);
 
 		~EngPipeline();
 
@@ -45,14 +93,37 @@ namespace gameEngine
 		void bind(VkCommandBuffer commandBuffer);
 
 	private:
+		struct StageCode
+		{
+			VkShaderStageFlagBits stage;
+			const uint32_t* code;
+			size_t codeSize;
+		};
+
 		static std::vector<char> readFile(const std::string& filepath);
 		EngineDevice& engDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
+		std::vector<VkShaderModule> shaderModules;
+
+		void createGraphicsPipeline(const std::vector<StageCode>& stages, const PipelineConfigInfo& configInfo);
+
+		void createShaderModule(const uint32_t* code, size_t codeSize, VkShaderModule* shaderModule);
+	};
 
-		void createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
+	class EngComputePipeline
+	{
+	public:
+		EngComputePipeline(EngineDevice& device, const std::vector<uint32_t>& spirv, VkPipelineLayout pipelineLayout, const ShaderVariant& variant = {});
+		~EngComputePipeline();
 
-		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+		EngComputePipeline(const EngComputePipeline&) = delete;
+		EngComputePipeline& operator=(const EngComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+
+	private:
+		EngineDevice& engDevice;
+		VkPipeline computePipeline;
+		VkShaderModule shaderModule;
 	};
 } // namespace
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "engineAssetManager.h"
+
+#include "engineSwapchain.h"
+#include "engineUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	EngineAssetManager::EngineAssetManager(EngineDevice& device, uint32_t workerCount) : engDevice{ device }
+	{
+		if (workerCount == 0)
+		{
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back([this]() { workerLoop(); });
+		}
+
+		// Assets give up what the heap is over the threshold by, recomputed every frame it stays over
+		memoryBudgetListenerId = engDevice.addMemoryBudgetListener(MEMORY_PRESSURE_THRESHOLD,
+			[this](uint32_t heapIndex, const MemoryHeapReport& heap, bool exceeded)
+			{
+				if (!heap.deviceLocal) return;
+
+				if (!exceeded)
+				{
+					pressureBudget = UNLIMITED_BUDGET;
+					return;
+				}
+
+				VkDeviceSize overshoot = heap.usage - static_cast<VkDeviceSize>(heap.budget * MEMORY_PRESSURE_THRESHOLD);
+				pressureBudget = memoryUsage - std::min(memoryUsage, overshoot);
+			});
+	}
+
+	EngineAssetManager::~EngineAssetManager()
+	{
+		engDevice.removeMemoryBudgetListener(memoryBudgetListenerId);
+
+		{
+			std::lock_guard<std::mutex> lock{ jobMutex };
+			stopping = true;
+			jobs.clear();
+		}
+
+		jobCondition.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		finishUploads(true);
+	}
+
+	std::shared_ptr<EngineModel> EngineAssetManager::loadModel(const std::string& filepath, EngineModel::VertexLayout layout, uint32_t lodCount, bool meshlets)
+	{
+		std::string key = filepath + "|" + std::to_string(static_cast<uint32_t>(layout)) + "|" + std::to_string(lodCount) + "|" + (meshlets ? "1" : "0");
+
+		auto found = assets.find(key);
+
+		if (found != assets.end())
+		{
+			return found->second.model;
+		}
+
+		Asset& asset = assets[key];
+		asset.model = std::make_shared<EngineModel>(engDevice, layout);
+		asset.filepath = filepath;
+		asset.lodCount = lodCount;
+		asset.meshlets = meshlets;
+
+		requestDecode(key, asset);
+		return asset.model;
+	}
+
+	std::shared_ptr<EngineTexture> EngineAssetManager::loadTexture(const std::string& filepath, bool srgb)
+	{
+		std::string key = filepath + (srgb ? "|srgb" : "|unorm");
+
+		auto found = assets.find(key);
+
+		if (found != assets.end())
+		{
+			return found->second.texture;
+		}
+
+		Asset& asset = assets[key];
+		asset.texture = std::make_shared<EngineTexture>(engDevice);
+		asset.filepath = filepath;
+		asset.srgb = srgb;
+
+		requestDecode(key, asset);
+		return asset.texture;
+	}
+
+	void EngineAssetManager::update(uint64_t frameNumber)
+	{
+		finishUploads(false);
+		collectDecoded();
+
+		// Evicted models that were visible last frame stream in again, assets only the manager still holds
+		// are dropped once no frame in flight can use them
+		for (auto it = assets.begin(); it != assets.end();)
+		{
+			Asset& asset = it->second;
+
+			// Textures have no visibility of their own, they are dropped a full set of frames in flight
+			// after their last reference went away
+			uint64_t lastUsedFrame = asset.model ? asset.model->getLastVisibleFrame() : asset.lastReferencedFrame;
+			bool idle = lastUsedFrame + EngineSwapChain::MAX_FRAMES_IN_FLIGHT < frameNumber;
+
+			if (asset.useCount() > 1)
+			{
+				asset.lastReferencedFrame = frameNumber;
+			}
+
+			if (asset.state == State::Evicted && asset.model->getLastVisibleFrame() + 1 >= frameNumber)
+			{
+				requestDecode(it->first, asset);
+			}
+
+			if (asset.useCount() == 1 && idle && (asset.state == State::Resident || asset.state == State::Evicted || asset.state == State::Decoded ||
+				asset.state == State::Failed))
+			{
+				evict(asset);
+				it = assets.erase(it);
+				continue;
+			}
+
+			++it;
+		}
+
+		while (memoryUsage > getEffectiveMemoryBudget() && evictLeastRecentlyVisible(frameNumber)) {}
+
+		startUploads(frameNumber);
+
+		pendingCount = 0;
+
+		for (auto& kv : assets)
+		{
+			State state = kv.second.state;
+			if (state == State::Loading || state == State::Decoded || state == State::Uploading) pendingCount++;
+		}
+	}
+
+	void EngineAssetManager::workerLoop()
+	{
+		while (true)
+		{
+			Job job;
+
+			{
+				std::unique_lock<std::mutex> lock{ jobMutex };
+				jobCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+				if (stopping)
+				{
+					return;
+				}
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			Decoded result{ job.key, nullptr, nullptr, nullptr };
+
+			try
+			{
+				if (job.texture)
+				{
+					result.pixels = std::make_unique<EngineTexture::Pixels>(EngineTexture::Pixels::loadFromFile(job.filepath, job.srgb));
+					result.pixels->decompressIfUnsupported(engDevice);
+				}
+				else
+				{
+					EngineModel::Builder builder{};
+					builder.layout = job.layout;
+					builder.lodCount = job.lodCount;
+					builder.meshlets = job.meshlets;
+					builder.loadModel(job.filepath);
+
+					result.payload = std::make_unique<EngineModel::Payload>(EngineModel::createPayload(builder));
+				}
+			}
+			catch (...)
+			{
+				result.error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock{ jobMutex };
+			decoded.push_back(std::move(result));
+		}
+	}
+
+	void EngineAssetManager::requestDecode(const std::string& key, Asset& asset)
+	{
+		asset.state = State::Loading;
+		asset.requestTime = std::chrono::steady_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock{ jobMutex };
+			EngineModel::VertexLayout layout = asset.model ? asset.model->getVertexLayout() : EngineModel::VertexLayout::Full;
+			jobs.push_back({ key, asset.filepath, asset.texture != nullptr, layout, asset.lodCount, asset.meshlets, asset.srgb });
+		}
+
+		jobCondition.notify_one();
+	}
+
+	void EngineAssetManager::collectDecoded()
+	{
+		std::vector<Decoded> finished;
+
+		{
+			std::lock_guard<std::mutex> lock{ jobMutex };
+			finished.swap(decoded);
+		}
+
+		for (auto& result : finished)
+		{
+			auto found = assets.find(result.key);
+			if (found == assets.end() || found->second.state != State::Loading) continue;
+
+			// One bad file must not stop the frame loop or the other loads
+			if (result.error)
+			{
+				try
+				{
+					std::rethrow_exception(result.error);
+				}
+				catch (const std::exception& e)
+				{
+					std::cerr << "Failed to load " << found->second.filepath << ": " << e.what() << std::endl;
+				}
+				catch (...)
+				{
+					std::cerr << "Failed to load " << found->second.filepath << std::endl;
+				}
+
+				found->second.state = State::Failed;
+				continue;
+			}
+
+			found->second.state = State::Decoded;
+			found->second.payload = std::move(result.payload);
+			found->second.pixels = std::move(result.pixels);
+			uploadQueue.push_back(result.key);
+		}
+	}
+
+	void EngineAssetManager::finishUploads(bool wait)
+	{
+		for (auto it = uploadBatches.begin(); it != uploadBatches.end();)
+		{
+			if (wait)
+			{
+				engDevice.getGraphicsTimeline().wait(it->timelineValue);
+			}
+			else if (!engDevice.getGraphicsTimeline().isComplete(it->timelineValue))
+			{
+				++it;
+				continue;
+			}
+
+			for (auto& key : it->keys)
+			{
+				auto found = assets.find(key);
+
+				if (found != assets.end() && found->second.state == State::Uploading)
+				{
+					Asset& asset = found->second;
+					asset.state = State::Resident;
+
+					if (asset.model)
+					{
+						asset.model->setResident();
+					}
+					else
+					{
+						asset.texture->setResident();
+
+						if (verboseOutput)
+						{
+							float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+								std::chrono::steady_clock::now() - asset.requestTime).count();
+							std::cout << asset.filepath << ": " << asset.texture->describe() << ", loaded in " << milliseconds << " ms" << std::endl;
+						}
+					}
+				}
+			}
+
+			vkFreeCommandBuffers(engDevice.getDevice(), engDevice.getCommandPool(), 1, &it->commandBuffer);
+			it = uploadBatches.erase(it);
+		}
+	}
+
+	bool EngineAssetManager::evictLeastRecentlyVisible(uint64_t frameNumber)
+	{
+		Asset* victim = nullptr;
+
+		for (auto& kv : assets)
+		{
+			Asset& asset = kv.second;
+			if (asset.state != State::Resident || !asset.model) continue;
+
+			// Evicting what is on screen would only stream it right back in
+			uint64_t lastVisible = asset.model->getLastVisibleFrame();
+			if (lastVisible + EngineSwapChain::MAX_FRAMES_IN_FLIGHT >= frameNumber) continue;
+
+			if (victim == nullptr || lastVisible < victim->model->getLastVisibleFrame())
+			{
+				victim = &asset;
+			}
+		}
+
+		if (victim == nullptr)
+		{
+			return false;
+		}
+
+		evict(*victim);
+		evictionCount++;
+		return true;
+	}
+
+	void EngineAssetManager::startUploads(uint64_t frameNumber)
+	{
+		UploadBatch batch{};
+		VkDeviceSize submitted = 0;
+
+		while (!uploadQueue.empty() && (batch.keys.empty() || submitted < uploadBudget))
+		{
+			auto found = assets.find(uploadQueue.front());
+
+			if (found == assets.end() || found->second.state != State::Decoded)
+			{
+				uploadQueue.pop_front();
+				continue;
+			}
+
+			Asset& asset = found->second;
+			VkDeviceSize size = asset.model ? asset.payload->getUploadSize() : asset.pixels->getUploadSize();
+
+			// A model larger than the whole budget still loads once nothing else is resident
+			while (memoryUsage + size > getEffectiveMemoryBudget() && evictLeastRecentlyVisible(frameNumber)) {}
+
+			if (memoryUsage + size > getEffectiveMemoryBudget() && memoryUsage > 0)
+			{
+				break;
+			}
+
+			if (batch.commandBuffer == VK_NULL_HANDLE)
+			{
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = engDevice.getCommandPool();
+				allocInfo.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(engDevice.getDevice(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate upload command buffer!");
+				}
+
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+				vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+			}
+
+			if (asset.model)
+			{
+				asset.model->recordUpload(*asset.payload, batch.commandBuffer, batch.stagingBuffers);
+				asset.memorySize = asset.model->getMemorySize();
+			}
+			else
+			{
+				asset.texture->recordUpload(*asset.pixels, batch.commandBuffer, batch.stagingBuffers);
+				asset.memorySize = asset.texture->getMemorySize();
+			}
+
+			asset.payload.reset();
+			asset.pixels.reset();
+			asset.state = State::Uploading;
+
+			memoryUsage += asset.memorySize;
+			submitted += size;
+			batch.keys.push_back(uploadQueue.front());
+			uploadQueue.pop_front();
+		}
+
+		if (batch.commandBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		// Frames are submitted to the same queue after this, the barrier orders their reads behind the copies
+		VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		if (engDevice.supportsMeshShaders())
+		{
+			dstStages |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+		}
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(batch.commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+		batch.timelineValue = engDevice.getGraphicsTimeline().submit(submitInfo);
+
+		uploadBatches.push_back(std::move(batch));
+	}
+
+	void EngineAssetManager::evict(Asset& asset)
+	{
+		assert(asset.state != State::Uploading && "Cannot evict an asset while it uploads");
+
+		if (asset.model)
+		{
+			asset.model->evict();
+		}
+
+		asset.payload.reset();
+		asset.pixels.reset();
+		asset.state = State::Evicted;
+
+		memoryUsage -= asset.memorySize;
+		asset.memorySize = 0;
+	}
+} // namespace
\ No newline at end of file
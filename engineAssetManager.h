@@ -0,0 +1,161 @@
+#pragma once
+
+#include "engineDevice.h"
+#include "engineBuffer.h"
+#include "engineModel.h"
+#include "engineTexture.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Streams models and textures in the background. loadModel and loadTexture hand out the asset right
+	// away, empty and not resident; worker threads parse and pack the file, and update uploads the result
+	// through staging buffers with its own submissions on the graphics timeline, a few megabytes per frame. Render systems
+	// skip assets until they are resident. Loads are deduplicated, asking for the same file with the same
+	// settings returns the same asset.
+	//
+	// Residency is bounded by a GPU memory budget: once over it, the models that were visible least
+	// recently are evicted (their buffers freed, their bounds kept for culling) and streamed in again
+	// when they become visible. Textures count towards the budget but stay resident while referenced
+	class EngineAssetManager
+	{
+	public:
+		static constexpr VkDeviceSize UNLIMITED_BUDGET = ~VkDeviceSize{ 0 };
+		static constexpr VkDeviceSize DEFAULT_UPLOAD_BUDGET = 16 * 1024 * 1024;
+
+		// Share of a device local heap's budget past which the manager evicts on its own, see
+		// EngineDevice::addMemoryBudgetListener
+		static constexpr float MEMORY_PRESSURE_THRESHOLD = .9f;
+
+		// workerCount 0 uses every hardware thread but the main one
+		EngineAssetManager(EngineDevice& device, uint32_t workerCount = 0);
+		~EngineAssetManager();
+
+		EngineAssetManager(const EngineAssetManager&) = delete;
+		EngineAssetManager& operator=(const EngineAssetManager&) = delete;
+
+		std::shared_ptr<EngineModel> loadModel(const std::string& filepath, EngineModel::VertexLayout layout = EngineModel::VertexLayout::Full,
+			uint32_t lodCount = 1, bool meshlets = false);
+
+		std::shared_ptr<EngineTexture> loadTexture(const std::string& filepath, bool srgb = true);
+
+		// Call once per frame from the main thread before recording it. Finishes completed uploads, evicts
+		// down to the memory budget, starts new uploads and forgets assets nobody else holds any more.
+		// Loads that fail are logged, their asset is never resident and render systems keep skipping it
+		void update(uint64_t frameNumber);
+
+		// Bytes of GPU memory resident assets may occupy, uploads in flight included. Memory pressure
+		// reported by the device lowers it further until the heap recovers
+		void setMemoryBudget(VkDeviceSize bytes) { memoryBudget = bytes; }
+		VkDeviceSize getEffectiveMemoryBudget() const { return std::min(memoryBudget, pressureBudget); }
+
+		// Staging bytes submitted per update, at least one asset always goes
+		void setUploadBudget(VkDeviceSize bytesPerFrame) { uploadBudget = bytesPerFrame; }
+
+		VkDeviceSize getMemoryUsage() const { return memoryUsage; }
+		uint32_t getPendingCount() const { return pendingCount; }
+		uint64_t getEvictionCount() const { return evictionCount; }
+
+	private:
+		enum class State
+		{
+			Loading,	// queued or being decoded by a worker
+			Decoded,	// payload waiting for upload budget
+			Uploading,
+			Resident,
+			Evicted,
+			Failed,		// decoding threw, not retried
+		};
+
+		// Either model or texture is set
+		struct Asset
+		{
+			std::shared_ptr<EngineModel> model;
+			std::shared_ptr<EngineTexture> texture;
+			std::string filepath;
+			uint32_t lodCount = 1;
+			bool meshlets = false;
+			bool srgb = true;
+
+			State state = State::Loading;
+			std::unique_ptr<EngineModel::Payload> payload;
+			std::unique_ptr<EngineTexture::Pixels> pixels;
+			VkDeviceSize memorySize = 0;
+			uint64_t lastReferencedFrame = 0;
+			std::chrono::steady_clock::time_point requestTime{};
+
+			long useCount() const { return model ? model.use_count() : texture.use_count(); }
+		};
+
+		struct Job
+		{
+			std::string key;
+			std::string filepath;
+			bool texture;
+			EngineModel::VertexLayout layout;
+			uint32_t lodCount;
+			bool meshlets;
+			bool srgb;
+		};
+
+		struct Decoded
+		{
+			std::string key;
+			std::unique_ptr<EngineModel::Payload> payload;
+			std::unique_ptr<EngineTexture::Pixels> pixels;
+			std::exception_ptr error;
+		};
+
+		// One submission of copies, its staging buffers live until its timeline value completes
+		struct UploadBatch
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			uint64_t timelineValue = 0;
+			std::vector<std::unique_ptr<EngineBuffer>> stagingBuffers;
+			std::vector<std::string> keys;
+		};
+
+		EngineDevice& engDevice;
+
+		std::unordered_map<std::string, Asset> assets;
+		std::deque<std::string> uploadQueue;
+		std::vector<UploadBatch> uploadBatches;
+
+		VkDeviceSize memoryBudget = UNLIMITED_BUDGET;
+		VkDeviceSize pressureBudget = UNLIMITED_BUDGET;
+		uint32_t memoryBudgetListenerId = 0;
+		VkDeviceSize uploadBudget = DEFAULT_UPLOAD_BUDGET;
+		VkDeviceSize memoryUsage = 0;
+		uint32_t pendingCount = 0;
+		uint64_t evictionCount = 0;
+
+		std::vector<std::thread> workers;
+		std::mutex jobMutex;
+		std::condition_variable jobCondition;
+		std::deque<Job> jobs;
+		std::vector<Decoded> decoded;
+		bool stopping = false;
+
+		void workerLoop();
+		void requestDecode(const std::string& key, Asset& asset);
+
+		void finishUploads(bool wait);
+		void collectDecoded();
+		bool evictLeastRecentlyVisible(uint64_t frameNumber);
+		void startUploads(uint64_t frameNumber);
+		void evict(Asset& asset);
+	};
+} // namespace
\ No newline at end of file
@@ -42,14 +42,37 @@ namespace gameEngine
 	{
 		alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
 		bufferSize = alignmentSize * instanceCount;
-		device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+		device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
 	}
 
 	EngineBuffer::~EngineBuffer()
 	{
+		engDevice.notifyBufferDestroyed(buffer);
 		unmap();
-		vkDestroyBuffer(engDevice.getDevice(), buffer, nullptr);
-		vkFreeMemory(engDevice.getDevice(), memory, nullptr);
+
+		// Frames in flight may still read it, the handle and memory go through the device's deletion queue
+		if (allocation.block != nullptr)
+		{
+			engDevice.getBufferAllocator().setOwner(allocation, nullptr);
+		}
+
+		engDevice.deferDestruction([&device = engDevice, buffer = buffer, allocation = allocation, usage = usageFlags]()
+			{
+				device.destroyBuffer(buffer, allocation, usage);
+			});
+	}
+
+	/**
+	 * Registers the buffer with the allocator as one that may be moved, see EngineDefragmenter
+	 *
+	 * @param relocatable Whether getBuffer may change from one frame to the next
+	 */
+	void EngineBuffer::setRelocatable(bool relocatable)
+	{
+		if (allocation.block != nullptr)
+		{
+			engDevice.getBufferAllocator().setOwner(allocation, relocatable ? this : nullptr);
+		}
 	}
 
 	/**
@@ -63,8 +86,8 @@ namespace gameEngine
 	 */
 	VkResult EngineBuffer::map(VkDeviceSize size, VkDeviceSize offset)
 	{
-		assert(buffer && memory && "Called map on buffer before create");
-		return vkMapMemory(engDevice.getDevice(), memory, offset, size, 0, &mapped);
+		assert(buffer && allocation.memory && "Called map on buffer before create");
+		return vkMapMemory(engDevice.getDevice(), allocation.memory, allocation.offset + offset, size, 0, &mapped);
 	}
 
 	/**
@@ -76,7 +99,7 @@ namespace gameEngine
 	{
 		if (mapped)
 		{
-			vkUnmapMemory(engDevice.getDevice(), memory);
+			vkUnmapMemory(engDevice.getDevice(), allocation.memory);
 			mapped = nullptr;
 		}
 	}
@@ -120,8 +143,8 @@ namespace gameEngine
 	{
 		VkMappedMemoryRange mappedRange{};
 		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
+		mappedRange.memory = allocation.memory;
+		mappedRange.offset = allocation.offset + offset;
 		mappedRange.size = size;
 
 		return vkFlushMappedMemoryRanges(engDevice.getDevice(), 1, &mappedRange);
@@ -142,8 +165,8 @@ namespace gameEngine
 	{
 		VkMappedMemoryRange mappedRange{};
 		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
+		mappedRange.memory = allocation.memory;
+		mappedRange.offset = allocation.offset + offset;
 		mappedRange.size = size;
 
 		return vkInvalidateMappedMemoryRanges(engDevice.getDevice(), 1, &mappedRange);
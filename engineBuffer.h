@@ -42,13 +42,19 @@ namespace gameEngine
 		VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
 		VkDeviceSize getBufferSize() const { return bufferSize; }
 
+		// Lets EngineDefragmenter move the buffer to other memory, which changes getBuffer. Only for
+		// buffers the GPU doesn't write after their upload and whose users fetch the handle when recording
+		void setRelocatable(bool relocatable);
+
 	private:
+		friend class EngineDefragmenter;
+
 		static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
 
 		EngineDevice& engDevice;
 		void* mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		EngineMemoryAllocator::Allocation allocation{};
 
 		VkDeviceSize bufferSize;
 		uint32_t instanceCount;
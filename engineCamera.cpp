@@ -51,6 +51,20 @@ namespace gameEngine
 		viewMatrix[3][0] = -glm::dot(u, position);
 		viewMatrix[3][1] = -glm::dot(v, position);
 		viewMatrix[3][2] = -glm::dot(w, position);
+
+		inverseViewMatrix = glm::mat4{ 1.f };
+		inverseViewMatrix[0][0] = u.x;
+		inverseViewMatrix[0][1] = u.y;
+		inverseViewMatrix[0][2] = u.z;
+		inverseViewMatrix[1][0] = v.x;
+		inverseViewMatrix[1][1] = v.y;
+		inverseViewMatrix[1][2] = v.z;
+		inverseViewMatrix[2][0] = w.x;
+		inverseViewMatrix[2][1] = w.y;
+		inverseViewMatrix[2][2] = w.z;
+		inverseViewMatrix[3][0] = position.x;
+		inverseViewMatrix[3][1] = position.y;
+		inverseViewMatrix[3][2] = position.z;
 	}
 
 	void EngineCamera::setViewTarget(glm::vec3 position, glm::vec3 target, glm::vec3 up)
@@ -82,5 +96,19 @@ namespace gameEngine
 		viewMatrix[3][0] = -glm::dot(u, position);
 		viewMatrix[3][1] = -glm::dot(v, position);
 		viewMatrix[3][2] = -glm::dot(w, position);
+
+		inverseViewMatrix = glm::mat4{ 1.f };
+		inverseViewMatrix[0][0] = u.x;
+		inverseViewMatrix[0][1] = u.y;
+		inverseViewMatrix[0][2] = u.z;
+		inverseViewMatrix[1][0] = v.x;
+		inverseViewMatrix[1][1] = v.y;
+		inverseViewMatrix[1][2] = v.z;
+		inverseViewMatrix[2][0] = w.x;
+		inverseViewMatrix[2][1] = w.y;
+		inverseViewMatrix[2][2] = w.z;
+		inverseViewMatrix[3][0] = position.x;
+		inverseViewMatrix[3][1] = position.y;
+		inverseViewMatrix[3][2] = position.z;
 	}
 } // namespace
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "engineDefragmenter.h"
+#include "engineUtils.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	EngineDefragmenter::EngineDefragmenter(EngineDevice& device) : engDevice{ device }
+	{
+	}
+
+	EngineDefragmenter::~EngineDefragmenter()
+	{
+		finishMoves(true);
+		destroyRetired(true);
+
+		if (active)
+		{
+			engDevice.getBufferAllocator().endDefragmentation();
+		}
+	}
+
+	void EngineDefragmenter::update(uint64_t frameNumber)
+	{
+		frameBytesMoved = 0;
+
+		finishMoves(false);
+		destroyRetired(false);
+
+		if (!active)
+		{
+			if (frameNumber < nextPassFrame) return;
+
+			passStartStats = engDevice.getBufferAllocator().getStats();
+
+			if (!engDevice.getBufferAllocator().beginDefragmentation(fragmentationThreshold))
+			{
+				nextPassFrame = frameNumber + PASS_COOLDOWN_FRAMES;
+				return;
+			}
+
+			active = true;
+			relocationsLeft = true;
+			passFrames = 0;
+			passBytesMoved = 0;
+		}
+
+		passFrames++;
+
+		if (relocationsLeft)
+		{
+			startMoves();
+		}
+
+		// Old copies of the moved buffers live in the blocks being emptied until they are retired
+		if (!relocationsLeft && batches.empty() && retired.empty())
+		{
+			endPass(frameNumber);
+		}
+	}
+
+	void EngineDefragmenter::startMoves()
+	{
+		EngineMemoryAllocator& allocator = engDevice.getBufferAllocator();
+		MoveBatch batch{};
+
+		while (frameBytesMoved < moveBudget)
+		{
+			EngineMemoryAllocator::Relocation relocation;
+
+			if (!allocator.nextRelocation(relocation))
+			{
+				relocationsLeft = false;
+				break;
+			}
+
+			if (batch.commandBuffer == VK_NULL_HANDLE)
+			{
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = engDevice.getCommandPool();
+				allocInfo.commandBufferCount = 1;
+
+				if (vkAllocateCommandBuffers(engDevice.getDevice(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to allocate defragmentation command buffer!");
+				}
+
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+				vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+				// Uploads submitted earlier may still be writing the buffers about to be read
+				VkMemoryBarrier barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+				vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+					1, &barrier, 0, nullptr, 0, nullptr);
+			}
+
+			EngineBuffer& owner = *relocation.owner;
+
+			Move move{};
+			move.relocation = relocation;
+			move.usage = owner.getUsageFlags();
+
+			// The source block is excluded from allocation, so this lands in a compact one
+			engDevice.createBuffer(owner.getBufferSize(), move.usage, owner.getMemoryPropertyFlags(), move.destination, move.destinationAllocation);
+
+			VkBufferCopy copyRegion{};
+			copyRegion.size = owner.getBufferSize();
+			vkCmdCopyBuffer(batch.commandBuffer, owner.getBuffer(), move.destination, 1, &copyRegion);
+
+			frameBytesMoved += copyRegion.size;
+			batch.moves.push_back(move);
+		}
+
+		if (batch.commandBuffer == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		// Frames submitted after this read the new copies once they are patched in
+		VkPipelineStageFlags dstStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+		if (engDevice.supportsMeshShaders())
+		{
+			dstStages |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+		}
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(batch.commandBuffer);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+
+		batch.timelineValue = engDevice.getGraphicsTimeline().submit(submitInfo);
+
+		passBytesMoved += frameBytesMoved;
+		totalBytesMoved += frameBytesMoved;
+		batches.push_back(std::move(batch));
+	}
+
+	void EngineDefragmenter::finishMoves(bool wait)
+	{
+		EngineMemoryAllocator& allocator = engDevice.getBufferAllocator();
+
+		for (auto it = batches.begin(); it != batches.end();)
+		{
+			if (wait)
+			{
+				engDevice.getGraphicsTimeline().wait(it->timelineValue);
+			}
+			else if (!engDevice.getGraphicsTimeline().isComplete(it->timelineValue))
+			{
+				++it;
+				continue;
+			}
+
+			for (auto& move : it->moves)
+			{
+				// The buffer was destroyed or pinned while its copy was in flight
+				if (allocator.getOwner(move.relocation.source) != move.relocation.owner)
+				{
+					engDevice.destroyBuffer(move.destination, move.destinationAllocation, move.usage);
+					continue;
+				}
+
+				EngineBuffer& owner = *move.relocation.owner;
+				VkBuffer oldBuffer = owner.buffer;
+
+				owner.buffer = move.destination;
+				owner.allocation = move.destinationAllocation;
+				allocator.setOwner(move.destinationAllocation, &owner);
+				allocator.setOwner(move.relocation.source, nullptr);
+
+				// Descriptor sets naming the old handle are rebuilt with the new one. Frames submitted so far
+				// may still read the old copy, later ones only see the new
+				engDevice.notifyBufferDestroyed(oldBuffer);
+				retired.push_back({ oldBuffer, move.relocation.source, move.usage, engDevice.getGraphicsTimeline().getSubmittedValue() });
+			}
+
+			vkFreeCommandBuffers(engDevice.getDevice(), engDevice.getCommandPool(), 1, &it->commandBuffer);
+			it = batches.erase(it);
+		}
+	}
+
+	void EngineDefragmenter::destroyRetired(bool all)
+	{
+		for (auto it = retired.begin(); it != retired.end();)
+		{
+			if (all)
+			{
+				engDevice.getGraphicsTimeline().wait(it->timelineValue);
+			}
+			else if (!engDevice.getGraphicsTimeline().isComplete(it->timelineValue))
+			{
+				++it;
+				continue;
+			}
+
+			engDevice.destroyBuffer(it->buffer, it->allocation, it->usage);
+			it = retired.erase(it);
+		}
+	}
+
+	void EngineDefragmenter::endPass(uint64_t frameNumber)
+	{
+		EngineMemoryAllocator& allocator = engDevice.getBufferAllocator();
+		allocator.endDefragmentation();
+
+		active = false;
+		nextPassFrame = frameNumber + PASS_COOLDOWN_FRAMES;
+
+		if (passBytesMoved == 0)
+		{
+			return;
+		}
+
+		EngineMemoryAllocator::Stats after = allocator.getStats();
+
+		if (verboseOutput)
+		{
+			std::cout << "Defragmented buffer memory: fragmentation " << passStartStats.getFragmentation() * 100.f << "% -> "
+				<< after.getFragmentation() * 100.f << "%, " << passStartStats.blockCount << " -> " << after.blockCount << " blocks, moved "
+				<< passBytesMoved / 1024 << " KB over " << passFrames << " frames (" << passBytesMoved / passFrames / 1024 << " KB/frame)" << std::endl;
+		}
+	}
+} // namespace
\ No newline at end of file
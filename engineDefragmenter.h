@@ -0,0 +1,89 @@
+#pragma once
+
+#include "engineDevice.h"
+#include "engineBuffer.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Compacts the device's buffer blocks a little every frame. A pass starts when fragmentation is above
+	// the threshold: the allocator picks the sparsest blocks and their relocatable buffers are copied
+	// into the others on the GPU, a budget of bytes per frame. Once a copy completed the buffer is
+	// patched to the new handle, the old one is destroyed once the graphics timeline passed the last
+	// submission that may still use it and emptied blocks are released when the pass ends. Fragmentation
+	// before and after and the bytes moved are printed per pass
+	class EngineDefragmenter
+	{
+	public:
+		static constexpr VkDeviceSize DEFAULT_MOVE_BUDGET = 8 * 1024 * 1024;
+		static constexpr float DEFAULT_FRAGMENTATION_THRESHOLD = .3f;
+
+		// Frames between the end of a pass and the next fragmentation check
+		static constexpr uint32_t PASS_COOLDOWN_FRAMES = 120;
+
+		EngineDefragmenter(EngineDevice& device);
+		~EngineDefragmenter();
+
+		EngineDefragmenter(const EngineDefragmenter&) = delete;
+		EngineDefragmenter& operator=(const EngineDefragmenter&) = delete;
+
+		// Call once per frame from the main thread before recording it
+		void update(uint64_t frameNumber);
+
+		void setMoveBudget(VkDeviceSize bytesPerFrame) { moveBudget = bytesPerFrame; }
+		void setFragmentationThreshold(float threshold) { fragmentationThreshold = threshold; }
+
+		bool isActive() const { return active; }
+		VkDeviceSize getFrameBytesMoved() const { return frameBytesMoved; }
+		VkDeviceSize getTotalBytesMoved() const { return totalBytesMoved; }
+
+	private:
+		struct Move
+		{
+			EngineMemoryAllocator::Relocation relocation;
+			VkBuffer destination;
+			EngineMemoryAllocator::Allocation destinationAllocation;
+			VkBufferUsageFlags usage;
+		};
+
+		struct MoveBatch
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			uint64_t timelineValue = 0;
+			std::vector<Move> moves;
+		};
+
+		struct RetiredBuffer
+		{
+			VkBuffer buffer;
+			EngineMemoryAllocator::Allocation allocation;
+			VkBufferUsageFlags usage;
+			uint64_t timelineValue;	// last submission that may use it
+		};
+
+		EngineDevice& engDevice;
+
+		VkDeviceSize moveBudget = DEFAULT_MOVE_BUDGET;
+		float fragmentationThreshold = DEFAULT_FRAGMENTATION_THRESHOLD;
+
+		bool active = false;
+		bool relocationsLeft = false;
+		uint64_t nextPassFrame = 0;
+		EngineMemoryAllocator::Stats passStartStats{};
+		uint32_t passFrames = 0;
+		VkDeviceSize passBytesMoved = 0;
+		VkDeviceSize frameBytesMoved = 0;
+		VkDeviceSize totalBytesMoved = 0;
+
+		std::vector<MoveBatch> batches;
+		std::vector<RetiredBuffer> retired;
+
+		void finishMoves(bool wait);
+		void destroyRetired(bool all);
+		void startMoves();
+		void endPass(uint64_t frameNumber);
+	};
+} // namespace
\ No newline at end of file
@@ -1,6 +1,10 @@
 #include "engineDescriptors.h"
 
+#include "engineUtils.h"
+
+#include <algorithm>
 #include <cassert>
+#include <functional>
 #include <stdexcept>
 
 namespace gameEngine
@@ -85,7 +89,7 @@ namespace gameEngine
 		uint32_t maxSets,
 		VkDescriptorPoolCreateFlags poolFlags,
 		const std::vector<VkDescriptorPoolSize>& poolSizes)
-		: device{ device }
+		: device{ device }, poolFlags{ poolFlags }
 	{
 		VkDescriptorPoolCreateInfo descriptorPoolInfo{};
 		descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -102,7 +106,11 @@ namespace gameEngine
 
 	EngineDescriptorPool::~EngineDescriptorPool()
 	{
-		vkDestroyDescriptorPool(device.getDevice(), descriptorPool, nullptr);
+		// Queued after the frees of its sets, so those still find it
+		device.deferDestruction([&device = device, pool = descriptorPool]()
+			{
+				vkDestroyDescriptorPool(device.getDevice(), pool, nullptr);
+			});
 	}
 
 	bool EngineDescriptorPool::allocateDescriptor(
@@ -124,11 +132,15 @@ namespace gameEngine
 
 	void EngineDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const
 	{
-		vkFreeDescriptorSets(
-			device.getDevice(),
-			descriptorPool,
-			static_cast<uint32_t>(descriptors.size()),
-			descriptors.data());
+		// Frames in flight may still have them bound
+		device.deferDestruction([&device = device, pool = descriptorPool, sets = descriptors]()
+			{
+				vkFreeDescriptorSets(
+					device.getDevice(),
+					pool,
+					static_cast<uint32_t>(sets.size()),
+					sets.data());
+			});
 	}
 
 	void EngineDescriptorPool::resetPool()
@@ -200,4 +212,153 @@ namespace gameEngine
 
 		vkUpdateDescriptorSets(pool.device.getDevice(), writes.size(), writes.data(), 0, nullptr);
 	}
+
+	bool EngineDescriptorWriter::build(VkDescriptorSet& set, EngineDescriptorSetCache& cache)
+	{
+		DescriptorSetKey key = makeKey();
+
+		if (cache.lookup(key, set))
+		{
+			return true;
+		}
+
+		if (!build(set))
+		{
+			return false;
+		}
+
+		cache.insert(std::move(key), set, pool);
+		return true;
+	}
+
+	DescriptorSetKey EngineDescriptorWriter::makeKey() const
+	{
+		DescriptorSetKey key{};
+		key.layout = setLayout.getDescriptorSetLayout();
+		key.bindings.reserve(writes.size());
+
+		for (auto& write : writes)
+		{
+			DescriptorSetKey::Binding binding{};
+			binding.binding = write.dstBinding;
+			binding.descriptorType = write.descriptorType;
+
+			if (write.pBufferInfo != nullptr)
+			{
+				binding.buffer = write.pBufferInfo->buffer;
+				binding.offset = write.pBufferInfo->offset;
+				binding.range = write.pBufferInfo->range;
+			}
+
+			if (write.pImageInfo != nullptr)
+			{
+				binding.sampler = write.pImageInfo->sampler;
+				binding.imageView = write.pImageInfo->imageView;
+				binding.imageLayout = write.pImageInfo->imageLayout;
+			}
+
+			key.bindings.push_back(binding);
+		}
+
+		// Write order doesn't change the resulting set, so don't let it change the key either
+		std::sort(key.bindings.begin(), key.bindings.end(),
+			[](const DescriptorSetKey::Binding& a, const DescriptorSetKey::Binding& b) { return a.binding < b.binding; });
+
+		return key;
+	}
+
+	// ****** Descriptor Set Cache ******
+	size_t DescriptorSetKeyHash::operator()(const DescriptorSetKey& key) const
+	{
+		size_t seed = 0;
+		hashCombine(seed, key.layout);
+
+		for (auto& binding : key.bindings)
+		{
+			hashCombine(seed, binding.binding, binding.descriptorType, binding.buffer, binding.offset, binding.range,
+				binding.sampler, binding.imageView, binding.imageLayout);
+		}
+
+		// EngineFlatHashMap indexes with the low bits and tags with the high ones, mix both well
+		return static_cast<size_t>(hashBytes(&seed, sizeof(seed)));
+	}
+
+	EngineDescriptorSetCache::EngineDescriptorSetCache(EngineDevice& device) : device{ device }
+	{
+		listenerId = device.addResourceListener(
+			[this](VkBuffer buffer) { invalidate(buffer); },
+			[this](VkImageView imageView) { invalidate(imageView); });
+	}
+
+	EngineDescriptorSetCache::~EngineDescriptorSetCache()
+	{
+		device.removeResourceListener(listenerId);
+	}
+
+	bool EngineDescriptorSetCache::lookup(const DescriptorSetKey& key, VkDescriptorSet& set)
+	{
+		auto* entry = entries.find(key);
+
+		if (entry == nullptr)
+		{
+			missCount++;
+			return false;
+		}
+
+		hitCount++;
+		set = entry->set;
+		return true;
+	}
+
+	void EngineDescriptorSetCache::insert(DescriptorSetKey key, VkDescriptorSet set, EngineDescriptorPool& pool)
+	{
+		*entries.insert(key, {}).first = { set, &pool };
+	}
+
+	template<typename Predicate>
+	void EngineDescriptorSetCache::eraseIf(Predicate predicate)
+	{
+		entries.eraseIf([&predicate](const DescriptorSetKey& key, Entry& entry)
+			{
+				if (!predicate(key, entry)) return false;
+
+				// Sets from pools without the free flag stay allocated until the pool is reset
+				if (entry.pool->canFreeDescriptors())
+				{
+					std::vector<VkDescriptorSet> sets{ entry.set };
+					entry.pool->freeDescriptors(sets);
+				}
+
+				return true;
+			});
+	}
+
+	void EngineDescriptorSetCache::invalidate(VkBuffer buffer)
+	{
+		eraseIf([buffer](const DescriptorSetKey& key, const Entry&)
+			{
+				return std::any_of(key.bindings.begin(), key.bindings.end(),
+					[buffer](const DescriptorSetKey::Binding& binding) { return binding.buffer == buffer; });
+			});
+	}
+
+	void EngineDescriptorSetCache::invalidate(VkImageView imageView)
+	{
+		eraseIf([imageView](const DescriptorSetKey& key, const Entry&)
+			{
+				return std::any_of(key.bindings.begin(), key.bindings.end(),
+					[imageView](const DescriptorSetKey::Binding& binding) { return binding.imageView == imageView; });
+			});
+	}
+
+	void EngineDescriptorSetCache::invalidatePool(const EngineDescriptorPool& pool)
+	{
+		// Resetting a pool already released its sets, so just forget them
+		entries.eraseIf([&pool](const DescriptorSetKey&, Entry& entry) { return entry.pool == &pool; });
+	}
+
+	void EngineDescriptorSetCache::clear()
+	{
+		eraseIf([](const DescriptorSetKey&, const Entry&) { return true; });
+	}
 } // namespace
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "engineDevice.h"
+#include "engineFlatHashMap.h"
 
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -77,13 +79,95 @@ namespace gameEngine
 
 		void resetPool();
 
+		bool canFreeDescriptors() const { return (poolFlags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) != 0; }
+
 	private:
 		EngineDevice& device;
 		VkDescriptorPool descriptorPool;
+		VkDescriptorPoolCreateFlags poolFlags;
 
 		friend class EngineDescriptorWriter;
 	};
 
+	// Identifies a descriptor set by its layout and the contents written to each binding
+	struct DescriptorSetKey
+	{
+		struct Binding
+		{
+			uint32_t binding;
+			VkDescriptorType descriptorType;
+			VkBuffer buffer;
+			VkDeviceSize offset;
+			VkDeviceSize range;
+			VkSampler sampler;
+			VkImageView imageView;
+			VkImageLayout imageLayout;
+
+			bool operator==(const Binding& other) const
+			{
+				return binding == other.binding && descriptorType == other.descriptorType &&
+					buffer == other.buffer && offset == other.offset && range == other.range &&
+					sampler == other.sampler && imageView == other.imageView && imageLayout == other.imageLayout;
+			}
+		};
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		std::vector<Binding> bindings{};
+
+		bool operator==(const DescriptorSetKey& other) const
+		{
+			return layout == other.layout && bindings == other.bindings;
+		}
+	};
+
+	struct DescriptorSetKeyHash
+	{
+		size_t operator()(const DescriptorSetKey& key) const;
+	};
+
+	// Content addressed cache of built descriptor sets. Building the same layout with the same buffer and
+	// image infos returns the existing set instead of allocating and writing a new one. Entries are dropped
+	// when a buffer or image view they reference is destroyed
+	class EngineDescriptorSetCache
+	{
+	public:
+		EngineDescriptorSetCache(EngineDevice& device);
+		~EngineDescriptorSetCache();
+
+		EngineDescriptorSetCache(const EngineDescriptorSetCache&) = delete;
+		EngineDescriptorSetCache& operator=(const EngineDescriptorSetCache&) = delete;
+
+		bool lookup(const DescriptorSetKey& key, VkDescriptorSet& set);
+		void insert(DescriptorSetKey key, VkDescriptorSet set, EngineDescriptorPool& pool);
+
+		void invalidate(VkBuffer buffer);
+		void invalidate(VkImageView imageView);
+		void invalidatePool(const EngineDescriptorPool& pool);
+		void clear();
+
+		uint64_t getHitCount() const { return hitCount; }
+		uint64_t getMissCount() const { return missCount; }
+		size_t size() const { return entries.size(); }
+		void resetCounters() { hitCount = 0; missCount = 0; }
+
+	private:
+		struct Entry
+		{
+			VkDescriptorSet set = VK_NULL_HANDLE;
+			EngineDescriptorPool* pool = nullptr;
+		};
+
+		template<typename Predicate>
+		void eraseIf(Predicate predicate);
+
+		EngineDevice& device;
+		uint32_t listenerId;
+		EngineFlatHashMap<DescriptorSetKey, Entry, DescriptorSetKeyHash> entries;
+
+		uint64_t hitCount = 0;
+		uint64_t missCount = 0;
+	};
+
 	class EngineDescriptorWriter
 	{
 	public:
@@ -93,9 +177,12 @@ namespace gameEngine
 		EngineDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
 
 		bool build(VkDescriptorSet& set);
+		bool build(VkDescriptorSet& set, EngineDescriptorSetCache& cache);
 		void overwrite(VkDescriptorSet& set);
 
 	private:
+		DescriptorSetKey makeKey() const;
+
 		EngineDescriptorSetLayout& setLayout;
 		EngineDescriptorPool& pool;
 		std::vector<VkWriteDescriptorSet> writes;
@@ -1,8 +1,12 @@
 #include "engineDevice.h"
+#include "engineUtils.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <unordered_set>
 
 
@@ -51,11 +55,22 @@ namespace gameEngine
 		pickPhysicalDevice();
 		createLogicalDevice();
 		createCommandPool();
+
+		bufferAllocator = std::make_unique<EngineMemoryAllocator>(engDevice, memoryProperties);
+		imageAllocator = std::make_unique<EngineMemoryAllocator>(engDevice, memoryProperties);
+		graphicsTimeline = std::make_unique<EngineTimeline>(engDevice, graphicsQueue);
 	}
 
 	EngineDevice::~EngineDevice()
 	{
+		// Whatever is still queued was last used by work the timeline waits for first
+		graphicsTimeline->wait(graphicsTimeline->getSubmittedValue());
+		collectGarbage();
+
+		graphicsTimeline.reset();
 		vkDestroyCommandPool(engDevice, commandPool, nullptr);
+		bufferAllocator.reset();
+		imageAllocator.reset();
 		vkDestroyDevice(engDevice, nullptr);
 
 		if (enableValidationLayers)
@@ -80,7 +95,7 @@ namespace gameEngine
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_2;
 
 		VkInstanceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -126,7 +141,7 @@ namespace gameEngine
 			throw std::runtime_error("failed to find GPUs with Vulkan support!");
 		}
 
-		std::cout << "Device count: " << deviceCount << std::endl;
+		if (verboseOutput) std::cout << "Device count: " << deviceCount << std::endl;
 
 		std::vector<VkPhysicalDevice> devices(deviceCount);
 		vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
@@ -146,7 +161,22 @@ namespace gameEngine
 		}
 
 		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-		std::cout << "physical device: " << properties.deviceName << std::endl;
+		if (verboseOutput) std::cout << "physical device: " << properties.deviceName << std::endl;
+
+		meshShadersEnabled = checkMeshShaderSupport(physicalDevice);
+		if (verboseOutput) std::cout << "mesh shaders: " << (meshShadersEnabled ? "supported" : "unsupported, using the vertex pipeline") << std::endl;
+
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+		heapTrackedBytes.assign(memoryProperties.memoryHeapCount, 0);
+
+		memoryBudgetEnabled = checkExtensionSupport(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		if (verboseOutput) std::cout << "memory budget: " << (memoryBudgetEnabled ? "supported" : "unsupported, tracking engine allocations only") << std::endl;
+
+		presentWaitEnabled = checkPresentWaitSupport(physicalDevice);
+		if (verboseOutput) std::cout << "present wait: " << (presentWaitEnabled ? "supported" : "unsupported, estimating latency from GPU completion") << std::endl;
+
+		dynamicRenderingEnabled = checkDynamicRenderingSupport(physicalDevice);
+		if (verboseOutput) std::cout << "dynamic rendering: " << (dynamicRenderingEnabled ? "supported" : "unsupported, using render passes") << std::endl;
 	}
 
 	void EngineDevice::createLogicalDevice()
@@ -168,16 +198,89 @@ namespace gameEngine
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+		// Block compressed textures are sampled directly where the device can, see EngineTexture
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+		// Only used to measure, eg fragment shader invocations against overdraw
+		deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+		pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+
+		std::vector<const char*> enabledExtensions = deviceExtensions;
+
+		if (memoryBudgetEnabled)
+		{
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+		// Timeline semaphores (see EngineTimeline) are core in Vulkan 1.2 but still a feature to enable
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+
+		// Features beyond Vulkan 1.0 have to be chained through VkPhysicalDeviceFeatures2
+		VkPhysicalDeviceFeatures2 deviceFeatures2{};
+		deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures2.features = deviceFeatures;
+		deviceFeatures2.pNext = &vulkan12Features;
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
-		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.pNext = &deviceFeatures2;
+
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+		// Optional features are appended to the chain
+		void** chainEnd = &vulkan12Features.pNext;
+
+		if (meshShadersEnabled)
+		{
+			enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+			meshShaderFeatures.taskShader = VK_TRUE;
+			meshShaderFeatures.meshShader = VK_TRUE;
+			*chainEnd = &meshShaderFeatures;
+			chainEnd = &meshShaderFeatures.pNext;
+		}
+
+		if (presentWaitEnabled)
+		{
+			enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+			enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+			presentIdFeatures.presentId = VK_TRUE;
+			presentWaitFeatures.presentWait = VK_TRUE;
+			presentIdFeatures.pNext = &presentWaitFeatures;
+			*chainEnd = &presentIdFeatures;
+			chainEnd = &presentWaitFeatures.pNext;
+		}
+
+		// Its dependencies, VK_KHR_create_renderpass2 and VK_KHR_depth_stencil_resolve, are core in 1.2
+		if (dynamicRenderingEnabled)
+		{
+			enabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+			*chainEnd = &dynamicRenderingFeatures;
+			chainEnd = &dynamicRenderingFeatures.pNext;
+		}
+
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		// might not really be necessary anymore because device specific validation layers
 		// have been deprecated
@@ -198,6 +301,49 @@ namespace gameEngine
 
 		vkGetDeviceQueue(engDevice, indices.graphicsFamily, 0, &graphicsQueue);
 		vkGetDeviceQueue(engDevice, indices.presentFamily, 0, &presentQueue);
+
+		if (meshShadersEnabled)
+		{
+			pfnCmdDrawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(engDevice, "vkCmdDrawMeshTasksEXT"));
+			meshShadersEnabled = pfnCmdDrawMeshTasks != nullptr;
+		}
+
+		if (presentWaitEnabled)
+		{
+			pfnWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(engDevice, "vkWaitForPresentKHR"));
+			presentWaitEnabled = pfnWaitForPresent != nullptr;
+		}
+
+		if (dynamicRenderingEnabled)
+		{
+			pfnCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(engDevice, "vkCmdBeginRenderingKHR"));
+			pfnCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(engDevice, "vkCmdEndRenderingKHR"));
+			dynamicRenderingEnabled = pfnCmdBeginRendering != nullptr && pfnCmdEndRendering != nullptr;
+		}
+	}
+
+	void EngineDevice::cmdDrawMeshTasks(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+	{
+		assert(meshShadersEnabled && "Mesh shaders are not enabled on this device");
+		pfnCmdDrawMeshTasks(commandBuffer, groupCountX, groupCountY, groupCountZ);
+	}
+
+	VkResult EngineDevice::waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout)
+	{
+		assert(presentWaitEnabled && "Present wait is not enabled on this device");
+		return pfnWaitForPresent(engDevice, swapChain, presentId, timeout);
+	}
+
+	void EngineDevice::cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo)
+	{
+		assert(dynamicRenderingEnabled && "Dynamic rendering is not enabled on this device");
+		pfnCmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+
+	void EngineDevice::cmdEndRendering(VkCommandBuffer commandBuffer)
+	{
+		assert(dynamicRenderingEnabled && "Dynamic rendering is not enabled on this device");
+		pfnCmdEndRendering(commandBuffer);
 	}
 
 	void EngineDevice::createCommandPool()
@@ -233,10 +379,19 @@ namespace gameEngine
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
 
-		VkPhysicalDeviceFeatures supportedFeatures;
-		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 
-		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+		VkPhysicalDeviceFeatures2 supportedFeatures{};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures.pNext = &vulkan12Features;
+		vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
+
+		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.features.samplerAnisotropy &&
+			deviceProperties.apiVersion >= VK_API_VERSION_1_2 && vulkan12Features.timelineSemaphore;
 	}
 
 	void EngineDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo)
@@ -321,23 +476,23 @@ namespace gameEngine
 		std::vector<VkExtensionProperties> extensions(extensionCount);
 		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
 
-		std::cout << "available extensions:" << std::endl;
+		if (verboseOutput) std::cout << "available extensions:" << std::endl;
 
 		std::unordered_set<std::string> available;
 
 		for (const auto& extension : extensions)
 		{
-			std::cout << "\t" << extension.extensionName << std::endl;
+			if (verboseOutput) std::cout << "\t" << extension.extensionName << std::endl;
 			available.insert(extension.extensionName);
 		}
 
-		std::cout << "required extensions:" << std::endl;
+		if (verboseOutput) std::cout << "required extensions:" << std::endl;
 
 		auto requiredExtensions = getRequiredExtensions();
 
 		for (const auto& required : requiredExtensions)
 		{
-			std::cout << "\t" << required << std::endl;
+			if (verboseOutput) std::cout << "\t" << required << std::endl;
 
 			if (available.find(required) == available.end())
 			{
@@ -364,6 +519,78 @@ namespace gameEngine
 		return requiredExtensions.empty();
 	}
 
+	bool EngineDevice::checkMeshShaderSupport(VkPhysicalDevice device)
+	{
+		if (!checkExtensionSupport(device, VK_EXT_MESH_SHADER_EXTENSION_NAME))
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &meshShaderFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features);
+
+		return meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+	}
+
+	bool EngineDevice::checkPresentWaitSupport(VkPhysicalDevice device)
+	{
+		if (!checkExtensionSupport(device, VK_KHR_PRESENT_ID_EXTENSION_NAME) || !checkExtensionSupport(device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+		{
+			return false;
+		}
+
+		VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+		presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+
+		VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+		presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		presentIdFeatures.pNext = &presentWaitFeatures;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &presentIdFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features);
+
+		return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+	}
+
+	bool EngineDevice::checkDynamicRenderingSupport(VkPhysicalDevice device)
+	{
+		if (!checkExtensionSupport(device, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		{
+			return false;
+		}
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &dynamicRenderingFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features);
+
+		return dynamicRenderingFeatures.dynamicRendering;
+	}
+
+	bool EngineDevice::checkExtensionSupport(VkPhysicalDevice device, const char* extensionName)
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		return std::any_of(availableExtensions.begin(), availableExtensions.end(), [extensionName](const VkExtensionProperties& extension)
+			{
+				return strcmp(extension.extensionName, extensionName) == 0;
+			});
+	}
+
 	QueueFamilyIndices EngineDevice::findQueueFamilies(VkPhysicalDevice device)
 	{
 		QueueFamilyIndices indices;
@@ -450,6 +677,13 @@ namespace gameEngine
 		throw std::runtime_error("failed to find supported format!");
 	}
 
+	VkFormatProperties EngineDevice::getFormatProperties(VkFormat format)
+	{
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+		return props;
+	}
+
 	uint32_t EngineDevice::findMemoryType(uint32_t typeFilters, VkMemoryPropertyFlags properties)
 	{
 		VkPhysicalDeviceMemoryProperties memProperties;
@@ -467,12 +701,14 @@ namespace gameEngine
 	}
 
 	void EngineDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
-		VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+		VkMemoryPropertyFlags properties, VkBuffer& buffer, EngineMemoryAllocator::Allocation& allocation)
 	{
+		bool shared = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0;
+
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
-		bufferInfo.usage = usage;
+		bufferInfo.usage = shared ? usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT : usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
 		if (vkCreateBuffer(engDevice, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
@@ -483,17 +719,58 @@ namespace gameEngine
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(engDevice, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		MemoryCategory category = getBufferCategory(usage);
 
-		if (vkAllocateMemory(engDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+		if (shared && bufferAllocator->allocate(memRequirements, memoryTypeIndex, allocation))
 		{
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
+			trackCategory(category, static_cast<int64_t>(allocation.size));
 		}
+		else
+		{
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = memRequirements.size;
+			allocInfo.memoryTypeIndex = memoryTypeIndex;
 
-		vkBindBufferMemory(engDevice, buffer, bufferMemory, 0);
+			allocation = {};
+			allocation.size = memRequirements.size;
+
+			if (vkAllocateMemory(engDevice, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to allocate vertex buffer memory!");
+			}
+
+			trackAllocation(allocation.memory, category, allocInfo.allocationSize, allocInfo.memoryTypeIndex);
+		}
+
+		vkBindBufferMemory(engDevice, buffer, allocation.memory, allocation.offset);
+	}
+
+	void EngineDevice::destroyBuffer(VkBuffer buffer, const EngineMemoryAllocator::Allocation& allocation, VkBufferUsageFlags usage)
+	{
+		vkDestroyBuffer(engDevice, buffer, nullptr);
+
+		if (allocation.block != nullptr)
+		{
+			trackCategory(getBufferCategory(usage), -static_cast<int64_t>(allocation.size));
+			bufferAllocator->free(allocation);
+		}
+		else
+		{
+			freeMemory(allocation.memory);
+		}
+	}
+
+	MemoryCategory EngineDevice::getBufferCategory(VkBufferUsageFlags usage)
+	{
+		// Staging buffers are only ever copied from, the first matching usage names the rest
+		if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) return MemoryCategory::Staging;
+		if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return MemoryCategory::Uniform;
+		if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return MemoryCategory::Index;
+		if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return MemoryCategory::Vertex;
+		if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) return MemoryCategory::Storage;
+		return MemoryCategory::Other;
 	}
 
 	VkCommandBuffer EngineDevice::beginSingleTimeCommands()
@@ -525,8 +802,8 @@ namespace gameEngine
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffer;
 
-		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue);
+		// Only this submission and what came before it is waited for, not later frames
+		graphicsTimeline->wait(graphicsTimeline->submit(submitInfo));
 
 		vkFreeCommandBuffers(engDevice, commandPool, 1, &commandBuffer);
 	}
@@ -588,9 +865,300 @@ namespace gameEngine
 			throw std::runtime_error("failed to allocate image memory!");
 		}
 
+		trackAllocation(imageMemory, getImageCategory(imageInfo.usage), allocInfo.allocationSize, allocInfo.memoryTypeIndex);
+
 		if (vkBindImageMemory(engDevice, image, imageMemory, 0) != VK_SUCCESS)
 		{
 			throw std::runtime_error("failed to bind image memory!");
 		}
 	}
+
+	void EngineDevice::createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image,
+		EngineMemoryAllocator::Allocation& allocation)
+	{
+		if (vkCreateImage(engDevice, &imageInfo, nullptr, &image) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create image!");
+		}
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(engDevice, image, &memRequirements);
+
+		allocateImageMemory(memRequirements, properties, getImageCategory(imageInfo.usage), allocation);
+
+		if (vkBindImageMemory(engDevice, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to bind image memory!");
+		}
+	}
+
+	void EngineDevice::destroyImage(VkImage image, const EngineMemoryAllocator::Allocation& allocation, VkImageUsageFlags usage)
+	{
+		vkDestroyImage(engDevice, image, nullptr);
+		freeImageMemory(allocation, getImageCategory(usage));
+	}
+
+	void EngineDevice::allocateImageMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category,
+		EngineMemoryAllocator::Allocation& allocation)
+	{
+		uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+		bool shared = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0;
+
+		if (shared && imageAllocator->allocate(requirements, memoryTypeIndex, allocation))
+		{
+			trackCategory(category, static_cast<int64_t>(allocation.size));
+			return;
+		}
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = requirements.size;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		allocation = {};
+		allocation.size = requirements.size;
+
+		if (vkAllocateMemory(engDevice, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate image memory!");
+		}
+
+		trackAllocation(allocation.memory, category, allocInfo.allocationSize, allocInfo.memoryTypeIndex);
+	}
+
+	void EngineDevice::freeImageMemory(const EngineMemoryAllocator::Allocation& allocation, MemoryCategory category)
+	{
+		if (allocation.block != nullptr)
+		{
+			trackCategory(category, -static_cast<int64_t>(allocation.size));
+			imageAllocator->free(allocation);
+		}
+		else
+		{
+			freeMemory(allocation.memory);
+		}
+	}
+
+	MemoryCategory EngineDevice::getImageCategory(VkImageUsageFlags usage)
+	{
+		return (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ? MemoryCategory::Depth : MemoryCategory::Image;
+	}
+
+	void EngineDevice::trackAllocation(VkDeviceMemory memory, MemoryCategory category, VkDeviceSize size, uint32_t memoryTypeIndex)
+	{
+		uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+		allocations[memory] = { category, size, heapIndex };
+
+		trackCategory(category, static_cast<int64_t>(size));
+		heapTrackedBytes[heapIndex] += size;
+	}
+
+	void EngineDevice::trackCategory(MemoryCategory category, int64_t delta)
+	{
+		size_t index = static_cast<size_t>(category);
+		categoryBytes[index] += delta;
+		categoryPeakBytes[index] = std::max(categoryPeakBytes[index], categoryBytes[index]);
+
+		if (delta > 0) categoryAllocations[index]++;
+		else categoryAllocations[index]--;
+	}
+
+	void EngineDevice::freeMemory(VkDeviceMemory memory)
+	{
+		if (memory == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		auto found = allocations.find(memory);
+		assert(found != allocations.end() && "Memory was not allocated through EngineDevice");
+
+		trackCategory(found->second.category, -static_cast<int64_t>(found->second.size));
+		heapTrackedBytes[found->second.heapIndex] -= found->second.size;
+		allocations.erase(found);
+
+		vkFreeMemory(engDevice, memory, nullptr);
+	}
+
+	MemoryReport EngineDevice::getMemoryReport()
+	{
+		MemoryReport report{};
+		report.budgetExtension = memoryBudgetEnabled;
+		report.categoryBytes = categoryBytes;
+		report.categoryPeakBytes = categoryPeakBytes;
+		report.categoryAllocations = categoryAllocations;
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		if (memoryBudgetEnabled)
+		{
+			VkPhysicalDeviceMemoryProperties2 properties2{};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+			properties2.pNext = &budgetProperties;
+			vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+		}
+
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			MemoryHeapReport heap{};
+			heap.size = memoryProperties.memoryHeaps[i].size;
+			heap.tracked = heapTrackedBytes[i] + bufferAllocator->getBlockBytes(i) + imageAllocator->getBlockBytes(i);
+			heap.deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+
+			if (memoryBudgetEnabled)
+			{
+				heap.budget = budgetProperties.heapBudget[i];
+				heap.usage = budgetProperties.heapUsage[i];
+			}
+			else
+			{
+				heap.budget = static_cast<VkDeviceSize>(heap.size * FALLBACK_BUDGET_SHARE);
+				heap.usage = heap.tracked;
+			}
+
+			report.heaps.push_back(heap);
+		}
+
+		return report;
+	}
+
+	uint32_t EngineDevice::addMemoryBudgetListener(float threshold, std::function<void(uint32_t heapIndex, const MemoryHeapReport& heap, bool exceeded)> callback)
+	{
+		uint32_t listenerId = nextMemoryBudgetListenerId++;
+		memoryBudgetListeners[listenerId] = { threshold, std::move(callback), std::vector<bool>(memoryProperties.memoryHeapCount, false) };
+		return listenerId;
+	}
+
+	void EngineDevice::removeMemoryBudgetListener(uint32_t listenerId)
+	{
+		memoryBudgetListeners.erase(listenerId);
+	}
+
+	void EngineDevice::updateMemoryBudget()
+	{
+		if (memoryBudgetListeners.empty())
+		{
+			return;
+		}
+
+		MemoryReport report = getMemoryReport();
+
+		for (auto& kv : memoryBudgetListeners)
+		{
+			MemoryBudgetListener& listener = kv.second;
+
+			for (uint32_t i = 0; i < report.heaps.size(); i++)
+			{
+				const MemoryHeapReport& heap = report.heaps[i];
+				bool exceeded = heap.usage > heap.budget * listener.threshold;
+
+				if (exceeded || listener.exceeded[i])
+				{
+					listener.callback(i, heap, exceeded);
+				}
+
+				listener.exceeded[i] = exceeded;
+			}
+		}
+	}
+
+	const char* MemoryReport::getCategoryName(MemoryCategory category)
+	{
+		static const char* names[CATEGORY_COUNT] = { "vertex", "index", "uniform", "storage", "staging", "image", "depth", "other" };
+		return names[static_cast<size_t>(category)];
+	}
+
+	std::string MemoryReport::toJson() const
+	{
+		std::ostringstream json;
+		json << "{\n\t\"budgetExtension\": " << (budgetExtension ? "true" : "false") << ",\n\t\"categories\": {";
+
+		for (size_t i = 0; i < CATEGORY_COUNT; i++)
+		{
+			json << (i > 0 ? "," : "") << "\n\t\t\"" << getCategoryName(static_cast<MemoryCategory>(i)) << "\": { \"bytes\": " << categoryBytes[i]
+				<< ", \"peakBytes\": " << categoryPeakBytes[i] << ", \"allocations\": " << categoryAllocations[i] << " }";
+		}
+
+		json << "\n\t},\n\t\"heaps\": [";
+
+		for (size_t i = 0; i < heaps.size(); i++)
+		{
+			json << (i > 0 ? "," : "") << "\n\t\t{ \"index\": " << i << ", \"deviceLocal\": " << (heaps[i].deviceLocal ? "true" : "false")
+				<< ", \"size\": " << heaps[i].size << ", \"budget\": " << heaps[i].budget << ", \"usage\": " << heaps[i].usage
+				<< ", \"tracked\": " << heaps[i].tracked << " }";
+		}
+
+		json << "\n\t]\n}\n";
+		return json.str();
+	}
+
+	uint32_t EngineDevice::addResourceListener(std::function<void(VkBuffer)> onBufferDestroyed, std::function<void(VkImageView)> onImageViewDestroyed)
+	{
+		uint32_t listenerId = nextResourceListenerId++;
+		resourceListeners[listenerId] = { std::move(onBufferDestroyed), std::move(onImageViewDestroyed) };
+		return listenerId;
+	}
+
+	void EngineDevice::removeResourceListener(uint32_t listenerId)
+	{
+		resourceListeners.erase(listenerId);
+	}
+
+	void EngineDevice::notifyBufferDestroyed(VkBuffer buffer)
+	{
+		for (auto& kv : resourceListeners)
+		{
+			if (kv.second.onBufferDestroyed) kv.second.onBufferDestroyed(buffer);
+		}
+	}
+
+	void EngineDevice::notifyImageViewDestroyed(VkImageView imageView)
+	{
+		for (auto& kv : resourceListeners)
+		{
+			if (kv.second.onImageViewDestroyed) kv.second.onImageViewDestroyed(imageView);
+		}
+	}
+
+	void EngineDevice::deferDestruction(std::function<void()> destroy)
+	{
+		deferDestruction(graphicsTimeline->getSubmittedValue(), std::move(destroy));
+	}
+
+	void EngineDevice::deferDestruction(uint64_t timelineValue, std::function<void()> destroy)
+	{
+		// Nothing in flight can use it
+		if (graphicsTimeline->isComplete(timelineValue))
+		{
+			destroy();
+			return;
+		}
+
+		pendingDestructions.push_back({ timelineValue, std::move(destroy) });
+	}
+
+	void EngineDevice::collectGarbage()
+	{
+		// Taken out first, a destruction may queue others. Order is kept so sets are freed before their pool
+		std::vector<PendingDestruction> ready{};
+
+		for (auto it = pendingDestructions.begin(); it != pendingDestructions.end();)
+		{
+			if (graphicsTimeline->isComplete(it->timelineValue))
+			{
+				ready.push_back(std::move(*it));
+				it = pendingDestructions.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		for (auto& pending : ready)
+		{
+			pending.destroy();
+		}
+	}
 } // namespace
\ No newline at end of file
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "engineWindow.h"
+#include "engineMemoryAllocator.h"
+#include "engineTimeline.h"
 
+#include <array>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
  
 namespace gameEngine
@@ -27,6 +33,48 @@ namespace gameEngine
 		}
 	};
 
+	// What device memory is spent on. Buffers are sorted by their usage flags, images by whether they are
+	// depth attachments
+	enum class MemoryCategory
+	{
+		Vertex,
+		Index,
+		Uniform,
+		Storage,
+		Staging,
+		Image,
+		Depth,
+		Other,
+		Count,
+	};
+
+	// One memory heap against its budget. With VK_EXT_memory_budget both come from the driver and usage
+	// includes what was allocated outside the engine, without it the budget is a fixed share of the heap
+	// and usage is what the engine allocated
+	struct MemoryHeapReport
+	{
+		VkDeviceSize size = 0;
+		VkDeviceSize budget = 0;
+		VkDeviceSize usage = 0;
+		VkDeviceSize tracked = 0;
+		bool deviceLocal = false;
+	};
+
+	struct MemoryReport
+	{
+		static constexpr size_t CATEGORY_COUNT = static_cast<size_t>(MemoryCategory::Count);
+
+		bool budgetExtension = false;
+		std::array<VkDeviceSize, CATEGORY_COUNT> categoryBytes{};
+		std::array<VkDeviceSize, CATEGORY_COUNT> categoryPeakBytes{};
+		std::array<uint32_t, CATEGORY_COUNT> categoryAllocations{};
+		std::vector<MemoryHeapReport> heaps{};
+
+		static const char* getCategoryName(MemoryCategory category);
+
+		std::string toJson() const;
+	};
+
 	class EngineDevice
 	{
 	public:
@@ -51,14 +99,23 @@ namespace gameEngine
 		VkQueue getGraphicsQueue() { return graphicsQueue; }
 		VkQueue getPresentQueue() { return presentQueue; }
 
+		// Every submission to the graphics queue goes through its timeline
+		EngineTimeline& getGraphicsTimeline() { return *graphicsTimeline; }
+
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
 		QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
 
 		VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+		VkFormatProperties getFormatProperties(VkFormat format);
 
 		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
-		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+		// Buffers that aren't host visible share blocks of memory (see EngineMemoryAllocator) and can be
+		// copied from and to for relocation, the others get memory of their own
+		void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer,
+			EngineMemoryAllocator::Allocation& allocation);
+		void destroyBuffer(VkBuffer buffer, const EngineMemoryAllocator::Allocation& allocation, VkBufferUsageFlags usage);
+		EngineMemoryAllocator& getBufferAllocator() { return *bufferAllocator; }
 
 		VkCommandBuffer beginSingleTimeCommands();
 
@@ -70,6 +127,68 @@ namespace gameEngine
 
 		void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
 
+		// Device local images share blocks of their own, apart from buffers so bufferImageGranularity never
+		// applies. Images larger than half a block get memory of their own
+		void createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image,
+			EngineMemoryAllocator::Allocation& allocation);
+		void destroyImage(VkImage image, const EngineMemoryAllocator::Allocation& allocation, VkImageUsageFlags usage);
+
+		// Image memory that isn't bound yet, for several images to alias (see EngineRenderGraph)
+		void allocateImageMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryCategory category,
+			EngineMemoryAllocator::Allocation& allocation);
+		void freeImageMemory(const EngineMemoryAllocator::Allocation& allocation, MemoryCategory category);
+
+		// Frees memory from createBuffer or createImageWithInfo and stops tracking it, null is ignored
+		void freeMemory(VkDeviceMemory memory);
+
+		// Budget fraction the heaps are assumed to have without VK_EXT_memory_budget
+		static constexpr float FALLBACK_BUDGET_SHARE = .8f;
+
+		bool supportsMemoryBudget() const { return memoryBudgetEnabled; }
+		MemoryReport getMemoryReport();
+
+		// Listeners are called from updateMemoryBudget for every heap whose usage is above threshold (a
+		// fraction of its budget), each time, and once more with exceeded false when it drops back under
+		uint32_t addMemoryBudgetListener(float threshold, std::function<void(uint32_t heapIndex, const MemoryHeapReport& heap, bool exceeded)> callback);
+		void removeMemoryBudgetListener(uint32_t listenerId);
+
+		// Queries the budget and raises the listeners, call once per frame
+		void updateMemoryBudget();
+
+		// Listeners are told about handles that are about to be destroyed, so caches holding raw
+		// handles (eg descriptor sets) can drop their stale entries
+		uint32_t addResourceListener(std::function<void(VkBuffer)> onBufferDestroyed, std::function<void(VkImageView)> onImageViewDestroyed);
+		void removeResourceListener(uint32_t listenerId);
+		void notifyBufferDestroyed(VkBuffer buffer);
+		void notifyImageViewDestroyed(VkImageView imageView);
+
+		// Objects the GPU may still be reading are handed over here instead of being destroyed. destroy runs
+		// from collectGarbage once the graphics timeline reached timelineValue, by default the latest
+		// submission. Main thread only, and not while a command buffer using the object is being recorded
+		void deferDestruction(std::function<void()> destroy);
+		void deferDestruction(uint64_t timelineValue, std::function<void()> destroy);
+
+		// Runs the destructions whose work completed, call once per frame
+		void collectGarbage();
+		size_t getPendingDestructionCount() const { return pendingDestructions.size(); }
+
+		// VK_KHR_present_id and VK_KHR_present_wait are optional, without them latency is estimated from
+		// GPU completion. waitForPresent returns VK_TIMEOUT while presentId isn't on screen yet
+		bool supportsPresentWait() const { return presentWaitEnabled; }
+		VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout);
+
+		// The pipelineStatisticsQuery feature is optional, see EnginePipelineStatistics
+		bool supportsPipelineStatistics() const { return pipelineStatisticsEnabled; }
+
+		// VK_KHR_dynamic_rendering is optional, without it passes run in render passes and framebuffers
+		bool supportsDynamicRendering() const { return dynamicRenderingEnabled; }
+		void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR& renderingInfo);
+		void cmdEndRendering(VkCommandBuffer commandBuffer);
+
+		// VK_EXT_mesh_shader is optional, renderers keep a vertex pipeline fallback
+		bool supportsMeshShaders() const { return meshShadersEnabled; }
+		void cmdDrawMeshTasks(VkCommandBuffer commandBuffer, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+
 		VkPhysicalDeviceProperties properties;
 
 	private:
@@ -84,6 +203,60 @@ namespace gameEngine
 		VkQueue graphicsQueue;
 		VkQueue presentQueue;
 
+		struct ResourceListener
+		{
+			std::function<void(VkBuffer)> onBufferDestroyed;
+			std::function<void(VkImageView)> onImageViewDestroyed;
+		};
+
+		struct Allocation
+		{
+			MemoryCategory category;
+			VkDeviceSize size;
+			uint32_t heapIndex;
+		};
+
+		struct PendingDestruction
+		{
+			uint64_t timelineValue;
+			std::function<void()> destroy;
+		};
+
+		struct MemoryBudgetListener
+		{
+			float threshold;
+			std::function<void(uint32_t, const MemoryHeapReport&, bool)> callback;
+			std::vector<bool> exceeded;
+		};
+
+		bool meshShadersEnabled = false;
+		bool memoryBudgetEnabled = false;
+		bool presentWaitEnabled = false;
+		bool dynamicRenderingEnabled = false;
+		bool pipelineStatisticsEnabled = false;
+		PFN_vkCmdDrawMeshTasksEXT pfnCmdDrawMeshTasks = nullptr;
+		PFN_vkWaitForPresentKHR pfnWaitForPresent = nullptr;
+		PFN_vkCmdBeginRenderingKHR pfnCmdBeginRendering = nullptr;
+		PFN_vkCmdEndRenderingKHR pfnCmdEndRendering = nullptr;
+
+		std::unordered_map<uint32_t, ResourceListener> resourceListeners;
+		uint32_t nextResourceListenerId = 0;
+
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		std::unique_ptr<EngineMemoryAllocator> bufferAllocator;
+		std::unique_ptr<EngineMemoryAllocator> imageAllocator;
+		std::unique_ptr<EngineTimeline> graphicsTimeline;
+		std::unordered_map<VkDeviceMemory, Allocation> allocations;
+		std::array<VkDeviceSize, MemoryReport::CATEGORY_COUNT> categoryBytes{};
+		std::array<VkDeviceSize, MemoryReport::CATEGORY_COUNT> categoryPeakBytes{};
+		std::array<uint32_t, MemoryReport::CATEGORY_COUNT> categoryAllocations{};
+		std::vector<VkDeviceSize> heapTrackedBytes;
+
+		std::unordered_map<uint32_t, MemoryBudgetListener> memoryBudgetListeners;
+		uint32_t nextMemoryBudgetListenerId = 0;
+
+		std::vector<PendingDestruction> pendingDestructions;
+
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
@@ -107,6 +280,15 @@ namespace gameEngine
 		void hasGlfwRequiredInstanceExtensions();
 
 		bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+		bool checkMeshShaderSupport(VkPhysicalDevice device);
+		bool checkPresentWaitSupport(VkPhysicalDevice device);
+		bool checkDynamicRenderingSupport(VkPhysicalDevice device);
+		bool checkExtensionSupport(VkPhysicalDevice device, const char* extensionName);
+
+		static MemoryCategory getBufferCategory(VkBufferUsageFlags usage);
+		static MemoryCategory getImageCategory(VkImageUsageFlags usage);
+		void trackAllocation(VkDeviceMemory memory, MemoryCategory category, VkDeviceSize size, uint32_t memoryTypeIndex);
+		void trackCategory(MemoryCategory category, int64_t delta);
 
 		SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 	};
@@ -0,0 +1,122 @@
+#include "engineFlatHashMap.h"
+#include "engineUtils.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace gameEngine
+{
+
+	// Eight consecutive keys share a home slot and every key the same tag, so runs are long and equal
+	// tags are common
+	struct ClusteringHash
+	{
+		size_t operator()(uint32_t key) const { return key >> 3; }
+	};
+
+	struct MixedHash
+	{
+		size_t operator()(uint32_t key) const { return static_cast<size_t>(hashBytes(&key, sizeof(key))); }
+	};
+
+	template<typename Hash>
+	static bool testAgainstReference(const std::string& name, uint32_t operationCount, uint32_t seed)
+	{
+		constexpr uint32_t KEY_RANGE = 4096;	// small enough that inserts, erases and finds often hit
+		constexpr uint32_t CHECK_INTERVAL = 1000;
+
+		EngineFlatHashMap<uint32_t, uint32_t, Hash> map{};
+		std::unordered_map<uint32_t, uint32_t> reference{};
+
+		std::mt19937 rng{ seed };
+		std::uniform_int_distribution<uint32_t> key{ 0, KEY_RANGE - 1 };
+		std::uniform_int_distribution<uint32_t> operation{ 0, 999 };
+
+		auto fail = [&](uint32_t index, const std::string& what)
+		{
+			std::cout << "  " << name << ": FAILED at operation " << index << ", " << what << std::endl;
+			return false;
+		};
+
+		for (uint32_t i = 0; i < operationCount; i++)
+		{
+			uint32_t k = key(rng);
+			uint32_t op = operation(rng);
+
+			if (op < 450)
+			{
+				uint32_t value = rng();
+				auto result = map.insert(k, value);
+				auto expected = reference.emplace(k, value);
+
+				if (result.second != expected.second || *result.first != expected.first->second) return fail(i, "insert");
+
+				// Writes through the returned pointer must land in the map
+				if (op < 100)
+				{
+					*result.first = value ^ 1;
+					expected.first->second = value ^ 1;
+				}
+			}
+			else if (op < 700)
+			{
+				if (map.erase(k) != (reference.erase(k) == 1)) return fail(i, "erase");
+			}
+			else if (op < 995)
+			{
+				const uint32_t* value = map.find(k);
+				auto expected = reference.find(k);
+
+				if ((value == nullptr) != (expected == reference.end())) return fail(i, "find presence");
+				if (value != nullptr && *value != expected->second) return fail(i, "find value");
+			}
+			else if (op < 999)
+			{
+				uint32_t divisor = 2 + k % 7;
+				map.eraseIf([divisor](const uint32_t& entryKey, uint32_t&) { return entryKey % divisor == 0; });
+
+				for (auto it = reference.begin(); it != reference.end();)
+				{
+					it = it->first % divisor == 0 ? reference.erase(it) : std::next(it);
+				}
+			}
+			else
+			{
+				map.clear();
+				reference.clear();
+			}
+
+			if (map.size() != reference.size()) return fail(i, "size");
+
+			if (i % CHECK_INTERVAL == 0)
+			{
+				size_t visited = 0;
+				bool matches = true;
+
+				map.forEach([&](const uint32_t& entryKey, uint32_t& value)
+					{
+						auto expected = reference.find(entryKey);
+						matches = matches && expected != reference.end() && expected->second == value;
+						visited++;
+					});
+
+				if (!matches || visited != reference.size()) return fail(i, "contents");
+			}
+		}
+
+		std::cout << "  " << name << ": " << operationCount << " operations, passed" << std::endl;
+		return true;
+	}
+
+	bool testFlatHashMap(uint32_t operationCount, uint32_t seed)
+	{
+		std::cout << "Flat hash map against std::unordered_map, seed " << seed << std::endl;
+
+		bool clustering = testAgainstReference<ClusteringHash>("clustering hash", operationCount, seed);
+		bool mixed = testAgainstReference<MixedHash>("mixed hash", operationCount, seed);
+
+		return clustering && mixed;
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Open addressing hash map with linear probing. Entries live inline in one array next to a byte per
+	// slot holding seven bits of their hash, so a probe mostly touches the control bytes and a lookup or
+	// insert walks a single short run. Erasing shifts the rest of the run back instead of leaving
+	// tombstones. Key and Value must be default constructible, and pointers returned by insert or find are
+	// invalidated by the next insert or erase. Both ends of the hash are used, identity hashes of integers
+	// or pointers need mixing first (see hashBytes)
+	template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+	class EngineFlatHashMap
+	{
+	public:
+		EngineFlatHashMap(size_t expectedSize = 0, const Hash& hash = Hash{}, const Equal& equal = Equal{})
+			: hasher{ hash }, equal{ equal }
+		{
+			reserve(expectedSize);
+		}
+
+		size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		// Grows so expectedSize entries fit without rehashing
+		void reserve(size_t expectedSize)
+		{
+			size_t capacity = MIN_CAPACITY;
+			while (capacity * MAX_LOAD_NUMERATOR < expectedSize * MAX_LOAD_DENOMINATOR) capacity *= 2;
+
+			if (capacity > control.size())
+			{
+				rehash(capacity);
+			}
+		}
+
+		// Returns the entry for key and true when it was just added with value, or the existing entry and
+		// false. hash must equal Hash{}(key), for callers that already computed it
+		std::pair<Value*, bool> insert(const Key& key, const Value& value, size_t hash)
+		{
+			if ((count + 1) * MAX_LOAD_DENOMINATOR > control.size() * MAX_LOAD_NUMERATOR)
+			{
+				rehash(control.size() * 2);
+			}
+
+			const size_t mask = control.size() - 1;
+			const uint8_t tag = tagOf(hash);
+
+			for (size_t i = hash & mask;; i = (i + 1) & mask)
+			{
+				if (control[i] == EMPTY)
+				{
+					control[i] = tag;
+					slots[i] = { key, value };
+					count++;
+					return { &slots[i].second, true };
+				}
+
+				if (control[i] == tag && equal(slots[i].first, key))
+				{
+					return { &slots[i].second, false };
+				}
+			}
+		}
+
+		std::pair<Value*, bool> insert(const Key& key, const Value& value) { return insert(key, value, hasher(key)); }
+
+		Value* find(const Key& key) { return const_cast<Value*>(static_cast<const EngineFlatHashMap*>(this)->find(key)); }
+
+		const Value* find(const Key& key) const
+		{
+			size_t slot = findSlot(key);
+			return slot == NOT_FOUND ? nullptr : &slots[slot].second;
+		}
+
+		bool erase(const Key& key)
+		{
+			size_t slot = findSlot(key);
+			if (slot == NOT_FOUND) return false;
+
+			eraseSlot(slot);
+			return true;
+		}
+
+		// Erases every entry predicate(const Key&, Value&) returns true for. Entries shifted back over an
+		// erased one may be tested twice, so the predicate should be stable
+		template<typename Predicate>
+		void eraseIf(Predicate predicate)
+		{
+			for (size_t i = 0; i < control.size(); i++)
+			{
+				while (control[i] != EMPTY && predicate(static_cast<const Key&>(slots[i].first), slots[i].second))
+				{
+					eraseSlot(i);
+				}
+			}
+		}
+
+		// function(const Key&, Value&) for every entry, in no particular order
+		template<typename Function>
+		void forEach(Function function)
+		{
+			for (size_t i = 0; i < control.size(); i++)
+			{
+				if (control[i] != EMPTY) function(static_cast<const Key&>(slots[i].first), slots[i].second);
+			}
+		}
+
+		void clear()
+		{
+			std::fill(control.begin(), control.end(), EMPTY);
+			std::fill(slots.begin(), slots.end(), std::pair<Key, Value>{});
+			count = 0;
+		}
+
+	private:
+		static constexpr uint8_t EMPTY = 0;
+		static constexpr size_t MIN_CAPACITY = 16;
+		static constexpr size_t NOT_FOUND = ~size_t{ 0 };
+
+		// Linear probing runs grow quickly past this
+		static constexpr size_t MAX_LOAD_NUMERATOR = 3;
+		static constexpr size_t MAX_LOAD_DENOMINATOR = 4;
+
+		std::vector<uint8_t> control{};
+		std::vector<std::pair<Key, Value>> slots{};
+		size_t count = 0;
+
+		Hash hasher;
+		Equal equal;
+
+		// The slot index comes from the low bits, the tag from the top seven with the high bit marking use
+		static uint8_t tagOf(size_t hash) { return static_cast<uint8_t>(0x80 | (hash >> (sizeof(size_t) * 8 - 7))); }
+
+		size_t findSlot(const Key& key) const
+		{
+			if (count == 0) return NOT_FOUND;
+
+			const size_t hash = hasher(key);
+			const size_t mask = control.size() - 1;
+			const uint8_t tag = tagOf(hash);
+
+			for (size_t i = hash & mask;; i = (i + 1) & mask)
+			{
+				if (control[i] == EMPTY) return NOT_FOUND;
+				if (control[i] == tag && equal(slots[i].first, key)) return i;
+			}
+		}
+
+		// Backward shift deletion, moves later entries of the run into the hole unless that would put them
+		// before their home slot
+		void eraseSlot(size_t hole)
+		{
+			const size_t mask = control.size() - 1;
+
+			for (size_t next = (hole + 1) & mask; control[next] != EMPTY; next = (next + 1) & mask)
+			{
+				size_t home = hasher(slots[next].first) & mask;
+
+				// Distance from home to next must cover the hole for the entry to move into it
+				if (((next - home) & mask) >= ((next - hole) & mask))
+				{
+					control[hole] = control[next];
+					slots[hole] = std::move(slots[next]);
+					hole = next;
+				}
+			}
+
+			control[hole] = EMPTY;
+			slots[hole] = {};
+			count--;
+		}
+
+		void rehash(size_t capacity)
+		{
+			std::vector<uint8_t> oldControl(capacity, EMPTY);
+			std::vector<std::pair<Key, Value>> oldSlots(capacity);
+			control.swap(oldControl);
+			slots.swap(oldSlots);
+
+			const size_t mask = capacity - 1;
+
+			for (size_t i = 0; i < oldControl.size(); i++)
+			{
+				if (oldControl[i] == EMPTY) continue;
+
+				size_t slot = hasher(oldSlots[i].first) & mask;
+				while (control[slot] != EMPTY) slot = (slot + 1) & mask;
+
+				control[slot] = oldControl[i];
+				slots[slot] = std::move(oldSlots[i]);
+			}
+		}
+	};
+
+	// Runs operationCount random inserts, erases, eraseIfs, finds and clears against std::unordered_map,
+	// once with a hash that clusters keys into long probe runs sharing one tag and once with a well mixed
+	// one. Prints the outcome and returns whether every operation agreed
+	bool testFlatHashMap(uint32_t operationCount, uint32_t seed);
+} // namespace
\ No newline at end of file
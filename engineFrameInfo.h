@@ -2,6 +2,7 @@
 
 #include "engineCamera.h"
 #include "engineGameObject.h"
+#include "engineRingBuffer.h"
 
 #include <vulkan/vulkan.h>
 
@@ -22,6 +23,13 @@ namespace gameEngine
 		glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .01f};
 		PointLight pointLights[MAX_LIGHTS];
 		int numLights;
+		// Appended after numLights so shaders that don't read it keep their std140 offsets
+		alignas(16) glm::mat4 inverseView{1.f};
+		// Per point light, see ShadowSystem::update. x: first atlas tile or -1, y: near plane, z: radius
+		glm::vec4 shadowParams[MAX_LIGHTS];
+		// Per point light, where its shadow map was rendered from. Maps wait their turn while lights move,
+		// so they are looked up from there rather than from the light's current position
+		glm::vec4 shadowOrigins[MAX_LIGHTS];
 	};
 
 	struct FrameInfo
@@ -32,5 +40,10 @@ namespace gameEngine
 		EngineCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
 		GameObject::Map& gameObject;
+		uint32_t globalUboOffset;			// dynamic offset of this frame's GlobalUbo
+		EngineRingBuffer& frameAllocator;	// transient per-frame data, rewound every frame
+		VkExtent2D extent;					// render target size, for screen space metrics
+		uint64_t frameNumber;				// counts up from 1, for residency and eviction
+		const EngineTransformHierarchy& transforms;	// updated before the systems run, see GameObject::worldMatrix
 	};
 } // namespace
\ No newline at end of file
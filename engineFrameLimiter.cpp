@@ -0,0 +1,46 @@
+#include "engineFrameLimiter.h"
+
+#include <thread>
+
+namespace gameEngine
+{
+
+	void EngineFrameLimiter::setTargetFrameRate(double framesPerSecond)
+	{
+		targetFrameRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+		period = Clock::duration::zero();
+		deadline = Clock::now();
+
+		if (targetFrameRate > 0.0)
+		{
+			period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFrameRate));
+		}
+	}
+
+	void EngineFrameLimiter::wait()
+	{
+		if (period == Clock::duration::zero())
+		{
+			return;
+		}
+
+		deadline += period;
+		Clock::time_point now = Clock::now();
+
+		if (deadline <= now)
+		{
+			deadline = now;
+			return;
+		}
+
+		if (deadline - now > SPIN_MARGIN)
+		{
+			std::this_thread::sleep_until(deadline - SPIN_MARGIN);
+		}
+
+		while (Clock::now() < deadline)
+		{
+			std::this_thread::yield();
+		}
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+
+namespace gameEngine
+{
+
+	// Caps the frame rate on the CPU, for when the present mode doesn't (Mailbox, Immediate) or to save
+	// power below the refresh rate. Sleeps are only accurate to a millisecond or two, so wait sleeps until
+	// SPIN_MARGIN before the deadline and spins the rest. A late frame restarts the schedule rather than
+	// letting the next ones catch up
+	class EngineFrameLimiter
+	{
+	public:
+		static constexpr std::chrono::microseconds SPIN_MARGIN{ 2000 };
+
+		// 0 turns the limiter off
+		void setTargetFrameRate(double framesPerSecond);
+		double getTargetFrameRate() const { return targetFrameRate; }
+
+		// Blocks until the next frame is due, call once per frame before sampling input
+		void wait();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		double targetFrameRate = 0.0;
+		Clock::duration period{};
+		Clock::time_point deadline{};
+	};
+} // namespace
\ No newline at end of file
@@ -58,13 +58,29 @@ namespace gameEngine
 		};
 	}
 
-	GameObject GameObject::makePointLight(float intensity, float radius, glm::vec3 color)
+	glm::mat4 GameObject::worldMatrix(const EngineTransformHierarchy& transforms)
+	{
+		return transformNode == EngineTransformHierarchy::INVALID_NODE ? transform.mat4() : transforms.getWorld(transformNode);
+	}
+
+	glm::mat3 GameObject::worldNormalMatrix(const EngineTransformHierarchy& transforms)
+	{
+		if (transformNode == EngineTransformHierarchy::INVALID_NODE)
+		{
+			return transform.normalMatrix();
+		}
+
+		return glm::transpose(glm::inverse(glm::mat3(transforms.getWorld(transformNode))));
+	}
+
+	GameObject GameObject::makePointLight(float intensity, float billboardRadius, glm::vec3 color, float shadowRadius)
 	{
 		GameObject gameObj = GameObject::createGameObject();
 		gameObj.color = color;
-		gameObj.transform.scale.x = radius;
+		gameObj.transform.scale.x = billboardRadius;
 		gameObj.pointLight = std::make_unique<PointLightComponent>();
 		gameObj.pointLight->lightIntensity = intensity;
+		gameObj.pointLight->shadowRadius = shadowRadius;
 		return gameObj;
 	}
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "engineModel.h"
+#include "engineTexture.h"
+#include "engineTransformHierarchy.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -41,6 +43,7 @@ namespace gameEngine
 	struct PointLightComponent
 	{
 		float lightIntensity = 1.f;
+		float shadowRadius = 10.f;	// reach of its shadows, casters farther away are ignored
 	};
 
 	class GameObject
@@ -51,11 +54,22 @@ namespace gameEngine
 
 		glm::vec3 color{};
 		TransformComponent transform{};
+
+		// Node in the scene's transform hierarchy. With one, transform is relative to the parent node and
+		// has to be handed to the hierarchy with setLocal after every change
+		EngineTransformHierarchy::NodeId transformNode = EngineTransformHierarchy::INVALID_NODE;
 		
 		// Optional
 		std::shared_ptr<EngineModel> model{};
+		std::shared_ptr<EngineTexture> texture{};	// diffuse, multiplied with the vertex color
 		std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
+		// Level of detail drawn last frame, LOD selection starts from it for hysteresis
+		uint32_t lod = 0;
+
+		// Whether the model's bounds intersected the view frustum this frame
+		bool visible = true;
+
 		GameObject(const GameObject&) = delete;
 		GameObject& operator=(const GameObject&) = delete;
 		GameObject(GameObject&&) = default;
@@ -67,10 +81,16 @@ namespace gameEngine
 			return GameObject(currentId++);
 		}
 
-		static GameObject makePointLight(float intensity = 5.f, float radius = .1f, glm::vec3 color = glm::vec3{ 1.f });
+		// billboardRadius is the size it is drawn at, shadowRadius how far it casts shadows
+		static GameObject makePointLight(float intensity = 5.f, float billboardRadius = .1f, glm::vec3 color = glm::vec3{ 1.f },
+			float shadowRadius = 10.f);
 
 		id_t getId() { return id; }
 
+		// World space placement, as of the hierarchy's last update for objects with a node
+		glm::mat4 worldMatrix(const EngineTransformHierarchy& transforms);
+		glm::mat3 worldNormalMatrix(const EngineTransformHierarchy& transforms);
+
 	private:
 		GameObject(id_t objId) : id{ objId } {};
 
@@ -0,0 +1,273 @@
+#include "engineKtx2.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	static constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	// Identifier, the 9 header words and the index of dfd, kvd and sgd
+	static constexpr size_t KTX2_HEADER_SIZE = 80;
+	static constexpr size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+	// Khronos data format descriptor values
+	static constexpr uint8_t KDF_MODEL_RGBSDA = 1;
+	static constexpr uint8_t KDF_MODEL_BC1A = 128;
+	static constexpr uint8_t KDF_MODEL_BC5 = 131;
+	static constexpr uint8_t KDF_MODEL_BC7 = 134;
+	static constexpr uint8_t KDF_MODEL_ASTC = 162;
+	static constexpr uint8_t KDF_PRIMARIES_BT709 = 1;
+	static constexpr uint8_t KDF_TRANSFER_LINEAR = 1;
+	static constexpr uint8_t KDF_TRANSFER_SRGB = 2;
+	static constexpr uint8_t KDF_SAMPLE_LINEAR = 0x10;
+	static constexpr uint8_t KDF_CHANNEL_ALPHA = 15;
+
+	template<typename T>
+	static T readValue(const std::vector<uint8_t>& file, size_t offset)
+	{
+		if (offset + sizeof(T) > file.size())
+		{
+			throw std::runtime_error("truncated KTX2 file");
+		}
+
+		T value;
+		std::memcpy(&value, file.data() + offset, sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	static void writeValue(std::vector<uint8_t>& file, size_t offset, T value)
+	{
+		std::memcpy(file.data() + offset, &value, sizeof(T));
+	}
+
+	struct DfdSample
+	{
+		uint16_t bitOffset;
+		uint8_t bitLength;
+		uint8_t channelType;
+		uint32_t upper;
+	};
+
+	// Basic descriptor block of format, preceded by the total size as KTX2 stores it
+	static std::vector<uint8_t> createDfd(VkFormat format)
+	{
+		bool srgb = EngineTexture::isSrgb(format);
+		uint8_t colorModel = KDF_MODEL_RGBSDA;
+		std::vector<DfdSample> samples;
+
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+			samples = { { 0, 7, 0, 255 }, { 8, 7, 1, 255 }, { 16, 7, 2, 255 },
+				{ 24, 7, static_cast<uint8_t>(KDF_CHANNEL_ALPHA | (srgb ? KDF_SAMPLE_LINEAR : 0)), 255 } };
+			break;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			colorModel = KDF_MODEL_BC1A;
+			samples = { { 0, 63, 0, UINT32_MAX } };
+			break;
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			colorModel = KDF_MODEL_BC1A;
+			samples = { { 0, 63, 0, UINT32_MAX }, { 0, 63, KDF_CHANNEL_ALPHA, UINT32_MAX } };
+			break;
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+			colorModel = KDF_MODEL_BC5;
+			samples = { { 0, 63, 0, UINT32_MAX }, { 64, 63, 1, UINT32_MAX } };
+			break;
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			colorModel = KDF_MODEL_BC7;
+			samples = { { 0, 127, 0, UINT32_MAX } };
+			break;
+		default:
+			colorModel = KDF_MODEL_ASTC;
+			samples = { { 0, 127, 0, UINT32_MAX } };
+			break;
+		}
+
+		uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+		uint32_t blockDimension = EngineTexture::getBlockDimension(format) - 1;
+
+		std::vector<uint8_t> dfd(4 + blockSize, 0);
+		writeValue<uint32_t>(dfd, 0, static_cast<uint32_t>(dfd.size()));
+		writeValue<uint32_t>(dfd, 4, 0);	// Khronos vendor, basic descriptor type
+		writeValue<uint32_t>(dfd, 8, 2 | (blockSize << 16));
+		dfd[12] = colorModel;
+		dfd[13] = KDF_PRIMARIES_BT709;
+		dfd[14] = srgb ? KDF_TRANSFER_SRGB : KDF_TRANSFER_LINEAR;
+		dfd[15] = 0;
+		dfd[16] = static_cast<uint8_t>(blockDimension);
+		dfd[17] = static_cast<uint8_t>(blockDimension);
+		dfd[20] = static_cast<uint8_t>(EngineTexture::getBlockBytes(format));
+
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			size_t offset = 28 + i * 16;
+			writeValue<uint16_t>(dfd, offset, samples[i].bitOffset);
+			dfd[offset + 2] = samples[i].bitLength;
+			dfd[offset + 3] = samples[i].channelType;
+			writeValue<uint32_t>(dfd, offset + 12, samples[i].upper);
+		}
+
+		return dfd;
+	}
+
+	EngineTexture::Pixels EngineKtx2::read(const std::string& filepath)
+	{
+		std::ifstream stream{ filepath, std::ios::binary };
+
+		if (!stream.is_open())
+		{
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		std::vector<uint8_t> file{ std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+
+		if (file.size() < KTX2_HEADER_SIZE || std::memcmp(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		{
+			throw std::runtime_error(filepath + " is not a KTX2 file");
+		}
+
+		uint32_t vkFormat = readValue<uint32_t>(file, 12);
+		uint32_t pixelWidth = readValue<uint32_t>(file, 20);
+		uint32_t pixelHeight = readValue<uint32_t>(file, 24);
+		uint32_t pixelDepth = readValue<uint32_t>(file, 28);
+		uint32_t layerCount = readValue<uint32_t>(file, 32);
+		uint32_t faceCount = readValue<uint32_t>(file, 36);
+		uint32_t levelCount = std::max(readValue<uint32_t>(file, 40), 1u);
+		uint32_t supercompressionScheme = readValue<uint32_t>(file, 44);
+
+		if (supercompressionScheme != 0 || vkFormat == VK_FORMAT_UNDEFINED)
+		{
+			throw std::runtime_error(filepath + ": supercompressed KTX2 files aren't supported, import the source image instead");
+		}
+
+		if (pixelWidth == 0 || pixelHeight == 0 || pixelDepth > 1 || layerCount > 1 || faceCount != 1)
+		{
+			throw std::runtime_error(filepath + ": only 2D KTX2 textures are supported");
+		}
+
+		EngineTexture::Pixels pixels{};
+		pixels.width = pixelWidth;
+		pixels.height = pixelHeight;
+		pixels.format = static_cast<VkFormat>(vkFormat);
+
+		if (levelCount > EngineTexture::getMipLevelCount(pixelWidth, pixelHeight))
+		{
+			throw std::runtime_error(filepath + ": too many mip levels");
+		}
+
+		// Levels are packed largest first, whatever order the file stores them in
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+			uint64_t byteOffset = readValue<uint64_t>(file, entry);
+			uint64_t byteLength = readValue<uint64_t>(file, entry + 8);
+
+			size_t expected = EngineTexture::getLevelSize(pixels.format, pixels.getLevelWidth(level), pixels.getLevelHeight(level));
+
+			if (byteLength != expected || byteOffset > file.size() || byteLength > file.size() - byteOffset)
+			{
+				throw std::runtime_error(filepath + ": bad level " + std::to_string(level));
+			}
+
+			pixels.levels.push_back({ pixels.data.size(), expected });
+			pixels.data.insert(pixels.data.end(), file.begin() + byteOffset, file.begin() + byteOffset + expected);
+		}
+
+		return pixels;
+	}
+
+	void EngineKtx2::write(const std::string& filepath, const EngineTexture::Pixels& pixels)
+	{
+		std::vector<uint8_t> dfd = createDfd(pixels.format);
+		uint32_t levelCount = static_cast<uint32_t>(pixels.levels.size());
+
+		size_t dfdOffset = KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+		size_t alignment = std::lcm<size_t>(EngineTexture::getBlockBytes(pixels.format), 4);
+
+		// The smallest level comes first in the file, every level aligned to whole blocks
+		std::vector<size_t> levelOffsets(levelCount);
+		size_t size = dfdOffset + dfd.size();
+
+		for (uint32_t level = levelCount; level-- > 0;)
+		{
+			size = (size + alignment - 1) / alignment * alignment;
+			levelOffsets[level] = size;
+			size += pixels.levels[level].size;
+		}
+
+		std::vector<uint8_t> file(size, 0);
+		std::memcpy(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+		writeValue<uint32_t>(file, 12, static_cast<uint32_t>(pixels.format));
+		writeValue<uint32_t>(file, 16, 1);	// typeSize
+		writeValue<uint32_t>(file, 20, pixels.width);
+		writeValue<uint32_t>(file, 24, pixels.height);
+		writeValue<uint32_t>(file, 28, 0);
+		writeValue<uint32_t>(file, 32, 0);
+		writeValue<uint32_t>(file, 36, 1);
+		writeValue<uint32_t>(file, 40, levelCount);
+		writeValue<uint32_t>(file, 44, 0);
+		writeValue<uint32_t>(file, 48, static_cast<uint32_t>(dfdOffset));
+		writeValue<uint32_t>(file, 52, static_cast<uint32_t>(dfd.size()));
+
+		std::memcpy(file.data() + dfdOffset, dfd.data(), dfd.size());
+
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+			writeValue<uint64_t>(file, entry, levelOffsets[level]);
+			writeValue<uint64_t>(file, entry + 8, pixels.levels[level].size);
+			writeValue<uint64_t>(file, entry + 16, pixels.levels[level].size);
+
+			std::memcpy(file.data() + levelOffsets[level], pixels.data.data() + pixels.levels[level].offset, pixels.levels[level].size);
+		}
+
+		std::ofstream stream{ filepath, std::ios::binary };
+		stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+		if (!stream)
+		{
+			throw std::runtime_error("failed to write file: " + filepath);
+		}
+	}
+
+	void EngineKtx2::import(const std::string& sourcePath, const std::string& destinationPath, VkFormat format)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		EngineTexture::Pixels source = EngineTexture::Pixels::loadFromFile(sourcePath, EngineTexture::isSrgb(format));
+		EngineTexture::Pixels encoded = source.encode(format);
+		write(destinationPath, encoded);
+
+		float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - start).count();
+
+		size_t rgbaSize = 0;
+
+		for (uint32_t level = 0; level < encoded.levels.size(); level++)
+		{
+			rgbaSize += EngineTexture::getLevelSize(VK_FORMAT_R8G8B8A8_UNORM, encoded.getLevelWidth(level), encoded.getLevelHeight(level));
+		}
+
+		std::ifstream sourceFile{ sourcePath, std::ios::binary | std::ios::ate };
+		std::ifstream destinationFile{ destinationPath, std::ios::binary | std::ios::ate };
+
+		std::cout << "Imported " << sourcePath << " as " << EngineTexture::getFormatName(format) << " in " << milliseconds << " ms: "
+			<< encoded.width << "x" << encoded.height << ", " << encoded.levels.size() << " mips" << std::endl;
+		std::cout << "\tfile " << static_cast<std::streamoff>(sourceFile.tellg()) / 1024 << " KB -> " << static_cast<std::streamoff>(destinationFile.tellg()) / 1024 << " KB" << std::endl;
+		std::cout << "\ttexture memory " << encoded.getUploadSize() / 1024 << " KB, " << rgbaSize / 1024 << " KB as RGBA8" << std::endl;
+	}
+} // namespace
\ No newline at end of file
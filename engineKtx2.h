@@ -0,0 +1,23 @@
+#pragma once
+
+#include "engineTexture.h"
+
+#include <string>
+
+namespace gameEngine
+{
+
+	// Reads and writes KTX2 containers of 2D textures with their mip levels. Only files whose levels are
+	// stored as plain texel blocks of a format EngineTexture knows are read; supercompressed (Basis
+	// Universal, Zstandard) files, arrays, cube maps and 3D images are rejected
+	class EngineKtx2
+	{
+	public:
+		static EngineTexture::Pixels read(const std::string& filepath);
+		static void write(const std::string& filepath, const EngineTexture::Pixels& pixels);
+
+		// Converts a source image (anything stb_image loads) into a mipmapped KTX2 file in format and
+		// prints the time it took, both file sizes and the memory of the texture against RGBA8
+		static void import(const std::string& sourcePath, const std::string& destinationPath, VkFormat format);
+	};
+} // namespace
\ No newline at end of file
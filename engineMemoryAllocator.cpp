@@ -0,0 +1,304 @@
+#include "engineMemoryAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	struct EngineMemoryAllocator::Block
+	{
+		struct Live
+		{
+			VkDeviceSize size;
+			EngineBuffer* owner = nullptr;
+			bool relocating = false;
+		};
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		uint32_t memoryTypeIndex = 0;
+		VkDeviceSize usedBytes = 0;
+		bool defragmentSource = false;
+
+		// Both keyed by offset, free ranges never touch each other
+		std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+		std::map<VkDeviceSize, Live> allocations;
+	};
+
+	float EngineMemoryAllocator::Stats::getFragmentation() const
+	{
+		VkDeviceSize freeBytes = blockBytes - usedBytes;
+		return freeBytes > 0 ? 1.f - static_cast<float>(largestFreeRange) / freeBytes : 0.f;
+	}
+
+	EngineMemoryAllocator::EngineMemoryAllocator(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties)
+		: device{ device }, memoryProperties{ memoryProperties }
+	{
+	}
+
+	EngineMemoryAllocator::~EngineMemoryAllocator()
+	{
+		for (auto& block : blocks)
+		{
+			assert(block->allocations.empty() && "Buffers outlived the allocator");
+			vkFreeMemory(device, block->memory, nullptr);
+		}
+	}
+
+	bool EngineMemoryAllocator::allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, Allocation& allocation)
+	{
+		if (requirements.size > BLOCK_SIZE / 2)
+		{
+			return false;
+		}
+
+		// Filling the fullest blocks first leaves the sparse ones to drain
+		std::vector<Block*> candidates;
+
+		for (auto& block : blocks)
+		{
+			if (block->memoryTypeIndex == memoryTypeIndex && !block->defragmentSource) candidates.push_back(block.get());
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Block* a, const Block* b) { return a->usedBytes > b->usedBytes; });
+
+		for (Block* block : candidates)
+		{
+			if (allocateFromBlock(*block, requirements, allocation)) return true;
+		}
+
+		Block* block = createBlock(memoryTypeIndex);
+		return allocateFromBlock(*block, requirements, allocation);
+	}
+
+	bool EngineMemoryAllocator::allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, Allocation& allocation)
+	{
+		for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it)
+		{
+			VkDeviceSize rangeOffset = it->first;
+			VkDeviceSize rangeEnd = it->first + it->second;
+			VkDeviceSize offset = (rangeOffset + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+
+			if (offset + requirements.size > rangeEnd) continue;
+
+			block.freeRanges.erase(it);
+
+			if (offset > rangeOffset) block.freeRanges[rangeOffset] = offset - rangeOffset;
+			if (offset + requirements.size < rangeEnd) block.freeRanges[offset + requirements.size] = rangeEnd - offset - requirements.size;
+
+			block.allocations[offset] = { requirements.size };
+			block.usedBytes += requirements.size;
+
+			allocation = { block.memory, offset, requirements.size, &block };
+			return true;
+		}
+
+		return false;
+	}
+
+	void EngineMemoryAllocator::free(const Allocation& allocation)
+	{
+		Block* block = allocation.block;
+		assert(block != nullptr && "Allocation has memory of its own");
+
+		block->allocations.erase(allocation.offset);
+		block->usedBytes -= allocation.size;
+
+		// Merge with the free ranges on either side
+		VkDeviceSize offset = allocation.offset;
+		VkDeviceSize size = allocation.size;
+		auto next = block->freeRanges.lower_bound(offset);
+
+		if (next != block->freeRanges.end() && next->first == offset + size)
+		{
+			size += next->second;
+			next = block->freeRanges.erase(next);
+		}
+
+		if (next != block->freeRanges.begin())
+		{
+			auto previous = std::prev(next);
+
+			if (previous->first + previous->second == offset)
+			{
+				offset = previous->first;
+				size += previous->second;
+				block->freeRanges.erase(previous);
+			}
+		}
+
+		block->freeRanges[offset] = size;
+
+		// Blocks being emptied stay until the defragmentation pass ends, moves still refer to them
+		if (block->allocations.empty() && !block->defragmentSource && countBlocks(block->memoryTypeIndex) > 1)
+		{
+			releaseBlock(block);
+		}
+	}
+
+	void EngineMemoryAllocator::setOwner(const Allocation& allocation, EngineBuffer* owner)
+	{
+		auto found = allocation.block->allocations.find(allocation.offset);
+		assert(found != allocation.block->allocations.end() && "Allocation is not live");
+
+		found->second.owner = owner;
+		found->second.relocating = false;
+	}
+
+	EngineBuffer* EngineMemoryAllocator::getOwner(const Allocation& allocation) const
+	{
+		auto found = allocation.block->allocations.find(allocation.offset);
+		return found != allocation.block->allocations.end() ? found->second.owner : nullptr;
+	}
+
+	EngineMemoryAllocator::Stats EngineMemoryAllocator::getStats() const
+	{
+		Stats stats{};
+
+		for (auto& block : blocks)
+		{
+			stats.blockCount++;
+			stats.blockBytes += BLOCK_SIZE;
+			stats.usedBytes += block->usedBytes;
+
+			for (auto& range : block->freeRanges)
+			{
+				stats.largestFreeRange = std::max(stats.largestFreeRange, range.second);
+			}
+		}
+
+		return stats;
+	}
+
+	VkDeviceSize EngineMemoryAllocator::getBlockBytes(uint32_t heapIndex) const
+	{
+		VkDeviceSize bytes = 0;
+
+		for (auto& block : blocks)
+		{
+			if (memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex == heapIndex) bytes += BLOCK_SIZE;
+		}
+
+		return bytes;
+	}
+
+	bool EngineMemoryAllocator::beginDefragmentation(float threshold)
+	{
+		if (getStats().getFragmentation() <= threshold)
+		{
+			return false;
+		}
+
+		bool chosen = false;
+
+		for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+		{
+			std::vector<Block*> typeBlocks;
+
+			for (auto& block : blocks)
+			{
+				if (block->memoryTypeIndex == type) typeBlocks.push_back(block.get());
+			}
+
+			std::sort(typeBlocks.begin(), typeBlocks.end(), [](const Block* a, const Block* b) { return a->usedBytes < b->usedBytes; });
+
+			// Sparsest first, as long as what they hold fits into the blocks left over. Alignment can
+			// still make a move spill into a new block, which is compact all the same
+			VkDeviceSize freeElsewhere = 0;
+
+			for (Block* block : typeBlocks)
+			{
+				freeElsewhere += BLOCK_SIZE - block->usedBytes;
+			}
+
+			VkDeviceSize moving = 0;
+
+			for (Block* block : typeBlocks)
+			{
+				if (block->usedBytes >= BLOCK_SIZE * SPARSE_BLOCK_USAGE) break;
+
+				freeElsewhere -= BLOCK_SIZE - block->usedBytes;
+				if (moving + block->usedBytes > freeElsewhere) break;
+
+				moving += block->usedBytes;
+				block->defragmentSource = true;
+				chosen = true;
+			}
+		}
+
+		return chosen;
+	}
+
+	bool EngineMemoryAllocator::nextRelocation(Relocation& relocation)
+	{
+		for (auto& block : blocks)
+		{
+			if (!block->defragmentSource) continue;
+
+			for (auto& kv : block->allocations)
+			{
+				Block::Live& live = kv.second;
+				if (live.owner == nullptr || live.relocating) continue;
+
+				live.relocating = true;
+				relocation = { { block->memory, kv.first, live.size, block.get() }, live.owner };
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void EngineMemoryAllocator::endDefragmentation()
+	{
+		std::vector<Block*> emptied;
+
+		for (auto& block : blocks)
+		{
+			if (!block->defragmentSource) continue;
+
+			block->defragmentSource = false;
+			if (block->allocations.empty()) emptied.push_back(block.get());
+		}
+
+		for (Block* block : emptied)
+		{
+			if (countBlocks(block->memoryTypeIndex) > 1) releaseBlock(block);
+		}
+	}
+
+	EngineMemoryAllocator::Block* EngineMemoryAllocator::createBlock(uint32_t memoryTypeIndex)
+	{
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = BLOCK_SIZE;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		auto block = std::make_unique<Block>();
+		block->memoryTypeIndex = memoryTypeIndex;
+		block->freeRanges[0] = BLOCK_SIZE;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate buffer memory block!");
+		}
+
+		blocks.push_back(std::move(block));
+		return blocks.back().get();
+	}
+
+	void EngineMemoryAllocator::releaseBlock(Block* block)
+	{
+		vkFreeMemory(device, block->memory, nullptr);
+
+		blocks.erase(std::find_if(blocks.begin(), blocks.end(), [block](const std::unique_ptr<Block>& candidate) { return candidate.get() == block; }));
+	}
+
+	uint32_t EngineMemoryAllocator::countBlocks(uint32_t memoryTypeIndex) const
+	{
+		return static_cast<uint32_t>(std::count_if(blocks.begin(), blocks.end(),
+			[memoryTypeIndex](const std::unique_ptr<Block>& block) { return block->memoryTypeIndex == memoryTypeIndex; }));
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gameEngine
+{
+
+	class EngineBuffer;
+
+	// Places device local buffers (or images, EngineDevice keeps one allocator for each) in large blocks
+	// of memory instead of one allocation each. Blocks are per memory type, an allocation goes into the
+	// fullest block it fits in (first fit within the block) and a block is released once it is empty,
+	// unless it is the last one of its type. Requests larger than half a block get memory of their own
+	// from EngineDevice.
+	//
+	// Buffers that are never written by the GPU after their upload can be marked relocatable, which lets
+	// EngineDefragmenter move them out of sparse blocks. All of it is used from the main thread only
+	class EngineMemoryAllocator
+	{
+	public:
+		static constexpr VkDeviceSize BLOCK_SIZE = 64 * 1024 * 1024;
+
+		// A block is worth emptying while less than this share of it is used
+		static constexpr float SPARSE_BLOCK_USAGE = .5f;
+
+		struct Block;
+
+		struct Allocation
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			Block* block = nullptr;	// null for memory of its own
+		};
+
+		struct Stats
+		{
+			uint32_t blockCount = 0;
+			VkDeviceSize blockBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			VkDeviceSize largestFreeRange = 0;
+
+			// 0 when all free space is one range, towards 1 the more it is split up
+			float getFragmentation() const;
+		};
+
+		// A relocatable buffer in a block being emptied
+		struct Relocation
+		{
+			Allocation source;
+			EngineBuffer* owner;
+		};
+
+		EngineMemoryAllocator(VkDevice device, const VkPhysicalDeviceMemoryProperties& memoryProperties);
+		~EngineMemoryAllocator();
+
+		EngineMemoryAllocator(const EngineMemoryAllocator&) = delete;
+		EngineMemoryAllocator& operator=(const EngineMemoryAllocator&) = delete;
+
+		// Returns false when the request is too large to share a block
+		bool allocate(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, Allocation& allocation);
+		void free(const Allocation& allocation);
+
+		// owner is patched when the allocation is relocated, null pins it where it is
+		void setOwner(const Allocation& allocation, EngineBuffer* owner);
+
+		// Null once the allocation is pinned or freed
+		EngineBuffer* getOwner(const Allocation& allocation) const;
+
+		Stats getStats() const;
+		VkDeviceSize getBlockBytes(uint32_t heapIndex) const;
+
+		// Picks the sparsest blocks whose relocatable buffers fit into the free space of the others, when
+		// fragmentation is above threshold. New allocations avoid them until endDefragmentation
+		bool beginDefragmentation(float threshold);
+
+		// Hands out each relocatable allocation of the chosen blocks once, false when none are left
+		bool nextRelocation(Relocation& relocation);
+
+		// Releases the chosen blocks that are empty now and makes the rest available again
+		void endDefragmentation();
+
+	private:
+		VkDevice device;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		std::vector<std::unique_ptr<Block>> blocks;
+
+		Block* createBlock(uint32_t memoryTypeIndex);
+		void releaseBlock(Block* block);
+		bool allocateFromBlock(Block& block, const VkMemoryRequirements& requirements, Allocation& allocation);
+		uint32_t countBlocks(uint32_t memoryTypeIndex) const;
+	};
+} // namespace
\ No newline at end of file
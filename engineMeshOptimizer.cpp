@@ -0,0 +1,339 @@
+#include "engineMeshOptimizer.h"
+#include "engineUtils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <numeric>
+
+namespace gameEngine
+{
+
+	MeshCacheStatistics EngineMeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+	{
+		MeshCacheStatistics statistics{};
+		statistics.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+		// FIFO cache, a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+		std::vector<uint32_t> loadedAt(vertexCount, 0);
+		std::vector<bool> referenced(vertexCount, false);
+
+		for (uint32_t index : indices)
+		{
+			if (!referenced[index])
+			{
+				referenced[index] = true;
+				statistics.vertexCount++;
+			}
+
+			if (loadedAt[index] == 0 || statistics.transformCount + 1 - loadedAt[index] > cacheSize)
+			{
+				statistics.transformCount++;
+				loadedAt[index] = statistics.transformCount;
+			}
+		}
+
+		if (statistics.triangleCount > 0)
+		{
+			statistics.acmr = static_cast<float>(statistics.transformCount) / statistics.triangleCount;
+		}
+
+		if (statistics.vertexCount > 0)
+		{
+			statistics.atvr = static_cast<float>(statistics.transformCount) / statistics.vertexCount;
+		}
+
+		return statistics;
+	}
+
+	// Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander et al. 2007)
+	void EngineMeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>* clusters, uint32_t cacheSize)
+	{
+		assert(indices.size() % 3 == 0 && "Index count must be a multiple of 3");
+
+		const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+		if (clusters != nullptr)
+		{
+			clusters->clear();
+		}
+
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		// Vertex to triangle adjacency, stored compressed
+		std::vector<uint32_t> liveTriangles(vertexCount, 0);
+
+		for (uint32_t index : indices)
+		{
+			liveTriangles[index]++;
+		}
+
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+		}
+
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+		for (uint32_t t = 0; t < triangleCount; t++)
+		{
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				uint32_t v = indices[t * 3 + corner];
+				adjacency[fill[v]++] = t;
+			}
+		}
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnd;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		uint32_t timeStamp = cacheSize + 1;
+		uint32_t cursor = 0;
+		int64_t fanning = 0;
+
+		auto skipDeadEnd = [&]() -> int64_t
+		{
+			while (!deadEnd.empty())
+			{
+				uint32_t d = deadEnd.back();
+				deadEnd.pop_back();
+
+				if (liveTriangles[d] > 0)
+				{
+					return d;
+				}
+			}
+
+			while (cursor < vertexCount)
+			{
+				if (liveTriangles[cursor] > 0)
+				{
+					return cursor;
+				}
+
+				cursor++;
+			}
+
+			return -1;
+		};
+
+		if (clusters != nullptr)
+		{
+			clusters->push_back(0);
+		}
+
+		while (fanning >= 0)
+		{
+			candidates.clear();
+
+			for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+			{
+				uint32_t t = adjacency[a];
+
+				if (emitted[t])
+				{
+					continue;
+				}
+
+				for (uint32_t corner = 0; corner < 3; corner++)
+				{
+					uint32_t v = indices[t * 3 + corner];
+					output.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					liveTriangles[v]--;
+
+					if (timeStamp - cacheTime[v] > cacheSize)
+					{
+						cacheTime[v] = timeStamp++;
+					}
+				}
+
+				emitted[t] = true;
+			}
+
+			// Prefer the candidate that will still be in the cache after its remaining triangles are emitted,
+			// and among those the oldest one
+			int64_t next = -1;
+			int64_t bestPriority = -1;
+
+			for (uint32_t v : candidates)
+			{
+				if (liveTriangles[v] == 0)
+				{
+					continue;
+				}
+
+				int64_t priority = 0;
+
+				if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+				{
+					priority = timeStamp - cacheTime[v];
+				}
+
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = v;
+				}
+			}
+
+			if (next == -1)
+			{
+				next = skipDeadEnd();
+
+				// Jumping away from the fan flushes the cache, a natural place for a cluster boundary
+				uint32_t emittedTriangles = static_cast<uint32_t>(output.size() / 3);
+
+				if (clusters != nullptr && next >= 0 && clusters->back() != emittedTriangles)
+				{
+					clusters->push_back(emittedTriangles);
+				}
+			}
+
+			fanning = next;
+		}
+
+		assert(output.size() == indices.size() && "Tipsify did not emit every triangle");
+		indices.swap(output);
+	}
+
+	void EngineMeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& clusters)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+		if (clusters.size() < 2)
+		{
+			return;
+		}
+
+		struct ClusterInfo
+		{
+			uint32_t firstTriangle;
+			uint32_t triangleCount;
+			float sortKey;
+		};
+
+		glm::vec3 meshCentroid{ 0.f };
+		float meshArea = 0.f;
+		std::vector<ClusterInfo> clusterInfos(clusters.size());
+
+		std::vector<glm::vec3> clusterCentroids(clusters.size(), glm::vec3{ 0.f });
+		std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3{ 0.f });
+		std::vector<float> clusterAreas(clusters.size(), 0.f);
+
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			uint32_t begin = clusters[c];
+			uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+			clusterInfos[c].firstTriangle = begin;
+			clusterInfos[c].triangleCount = end - begin;
+
+			for (uint32_t t = begin; t < end; t++)
+			{
+				const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+
+				glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);	// length is twice the area
+				float area = glm::length(normal) * .5f;
+				glm::vec3 centroid = (p0 + p1 + p2) / 3.f;
+
+				clusterCentroids[c] += centroid * area;
+				clusterNormals[c] += normal;
+				clusterAreas[c] += area;
+			}
+
+			meshCentroid += clusterCentroids[c];
+			meshArea += clusterAreas[c];
+		}
+
+		if (meshArea <= 0.f)
+		{
+			return;
+		}
+
+		meshCentroid /= meshArea;
+
+		// Clusters that face away from the mesh center occlude the rest, so draw them first
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			glm::vec3 centroid = clusterAreas[c] > 0.f ? clusterCentroids[c] / clusterAreas[c] : meshCentroid;
+			float normalLength = glm::length(clusterNormals[c]);
+			glm::vec3 normal = normalLength > 0.f ? clusterNormals[c] / normalLength : glm::vec3{ 0.f };
+
+			clusterInfos[c].sortKey = glm::dot(centroid - meshCentroid, normal);
+		}
+
+		std::stable_sort(clusterInfos.begin(), clusterInfos.end(),
+			[](const ClusterInfo& a, const ClusterInfo& b) { return a.sortKey > b.sortKey; });
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		for (auto& cluster : clusterInfos)
+		{
+			auto first = indices.begin() + cluster.firstTriangle * 3;
+			output.insert(output.end(), first, first + cluster.triangleCount * 3);
+		}
+
+		indices.swap(output);
+	}
+
+	void EngineMeshOptimizer::optimizeVertexFetch(std::vector<EngineModel::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		constexpr uint32_t UNASSIGNED = ~0u;
+
+		std::vector<uint32_t> remap(vertices.size(), UNASSIGNED);
+		std::vector<EngineModel::Vertex> output;
+		output.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == UNASSIGNED)
+			{
+				remap[index] = static_cast<uint32_t>(output.size());
+				output.push_back(vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		vertices.swap(output);
+	}
+
+	void EngineMeshOptimizer::optimize(std::vector<EngineModel::Vertex>& vertices, std::vector<uint32_t>& indices, const std::string& name)
+	{
+		if (indices.empty())
+		{
+			return;
+		}
+
+		MeshCacheStatistics before = analyzeVertexCache(indices, vertices.size());
+
+		std::vector<uint32_t> clusters;
+		optimizeVertexCache(indices, vertices.size(), &clusters);
+		optimizeOverdraw(indices, vertices, clusters);
+		optimizeVertexFetch(vertices, indices);
+
+		MeshCacheStatistics after = analyzeVertexCache(indices, vertices.size());
+
+		if (verboseOutput)
+		{
+			std::cout << "Optimized " << name << ": " << after.triangleCount << " triangles, " << clusters.size() << " clusters, "
+				<< "ACMR " << before.acmr << " -> " << after.acmr << ", "
+				<< "ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+		}
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "engineModel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gameEngine
+{
+
+	struct MeshCacheStatistics
+	{
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0;
+		uint32_t transformCount = 0;	// post-transform cache misses
+		float acmr = 0.f;				// average cache miss ratio, transforms per triangle (0.5 is ideal)
+		float atvr = 0.f;				// average transform to vertex ratio (1.0 is ideal)
+	};
+
+	// Import time reordering of indexed triangle lists for the GPU: Tipsify triangle ordering for the
+	// post-transform cache, cluster ordering to reduce overdraw, then vertex remapping so vertex fetch
+	// walks memory linearly
+	class EngineMeshOptimizer
+	{
+	public:
+		static constexpr uint32_t CACHE_SIZE = 16;
+
+		static MeshCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+		// Reorders triangles in place, optionally returning the first triangle of every cluster (cache flush)
+		static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>* clusters = nullptr, uint32_t cacheSize = CACHE_SIZE);
+
+		// Sorts the clusters from optimizeVertexCache so outward facing ones are drawn first
+		static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& clusters);
+
+		// Renumbers vertices in first use order and drops unreferenced ones
+		static void optimizeVertexFetch(std::vector<EngineModel::Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		// All of the above, logging cache statistics before and after under the given name
+		static void optimize(std::vector<EngineModel::Vertex>& vertices, std::vector<uint32_t>& indices, const std::string& name);
+	};
+} // namespace
\ No newline at end of file
@@ -0,0 +1,551 @@
+#include "engineMeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace gameEngine
+{
+	// Stiffness of the planes keeping open borders from collapsing inwards
+	static constexpr double BORDER_WEIGHT = 10.0;
+
+	// Collapses that turn a neighbouring triangle further than this (cosine) are rejected
+	static constexpr float MIN_FLIP_COSINE = 0.25f;
+
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		void addPlane(const glm::vec3& normal, double distance, double planeWeight)
+		{
+			double x = normal.x, y = normal.y, z = normal.z;
+
+			a00 += planeWeight * x * x; a01 += planeWeight * x * y; a02 += planeWeight * x * z;
+			a11 += planeWeight * y * y; a12 += planeWeight * y * z; a22 += planeWeight * z * z;
+			b0 += planeWeight * x * distance; b1 += planeWeight * y * distance; b2 += planeWeight * z * distance;
+			c += planeWeight * distance * distance;
+			weight += planeWeight;
+		}
+
+		void add(const Quadric& other)
+		{
+			a00 += other.a00; a01 += other.a01; a02 += other.a02;
+			a11 += other.a11; a12 += other.a12; a22 += other.a22;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// Weighted mean squared distance of p to the accumulated planes
+		double evaluate(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+
+			double result = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z
+				+ a11 * y * y + 2 * a12 * y * z + a22 * z * z
+				+ 2 * (b0 * x + b1 * y + b2 * z) + c;
+
+			return weight > 0 ? std::abs(result) / weight : 0;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	static glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+
+	static bool samePosition(const glm::vec3& a, const glm::vec3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	static float distanceSquaredToTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		// Closest point by Voronoi region of the triangle (Ericson, Real-Time Collision Detection 5.1.5)
+		glm::vec3 ab = b - a;
+		glm::vec3 ac = c - a;
+		glm::vec3 ap = p - a;
+		float d1 = glm::dot(ab, ap);
+		float d2 = glm::dot(ac, ap);
+		if (d1 <= 0.f && d2 <= 0.f) return glm::dot(ap, ap);
+
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp);
+		float d4 = glm::dot(ac, bp);
+		if (d3 >= 0.f && d4 <= d3) return glm::dot(bp, bp);
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f)
+		{
+			glm::vec3 offset = ap - ab * (d1 / (d1 - d3));
+			return glm::dot(offset, offset);
+		}
+
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp);
+		float d6 = glm::dot(ac, cp);
+		if (d6 >= 0.f && d5 <= d6) return glm::dot(cp, cp);
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f)
+		{
+			glm::vec3 offset = ap - ac * (d2 / (d2 - d6));
+			return glm::dot(offset, offset);
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f)
+		{
+			glm::vec3 offset = bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			return glm::dot(offset, offset);
+		}
+
+		float denominator = 1.f / (va + vb + vc);
+		glm::vec3 offset = ap - ab * (vb * denominator) - ac * (vc * denominator);
+		return glm::dot(offset, offset);
+	}
+
+	// The vertex of the target position that best stands in for a collapsed one, keeps seams intact
+	static uint32_t closestAttributes(const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& candidates, uint32_t vertex)
+	{
+		auto& source = vertices[vertex];
+		uint32_t best = candidates[0];
+		float bestScore = -std::numeric_limits<float>::max();
+
+		for (uint32_t candidate : candidates)
+		{
+			auto& target = vertices[candidate];
+			glm::vec2 uvDelta{ target.uv.x - source.uv.x, target.uv.y - source.uv.y };
+			glm::vec3 colorDelta = target.color - source.color;
+
+			float score = glm::dot(source.normal, target.normal)
+				- std::sqrt(uvDelta.x * uvDelta.x + uvDelta.y * uvDelta.y)
+				- glm::length(colorDelta);
+
+			if (score > bestScore)
+			{
+				bestScore = score;
+				best = candidate;
+			}
+		}
+
+		return best;
+	}
+
+	std::vector<uint32_t> EngineMeshSimplifier::simplify(const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float targetError, float* resultError)
+	{
+		if (resultError != nullptr) *resultError = 0.f;
+
+		if (indices.size() <= targetIndexCount || indices.size() < 3)
+		{
+			return indices;
+		}
+
+		// Group vertices by position, topology and quadrics live on these groups
+		std::vector<uint32_t> sorted(vertices.size());
+		std::iota(sorted.begin(), sorted.end(), 0);
+		std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b)
+			{
+				auto& pa = vertices[a].position;
+				auto& pb = vertices[b].position;
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				return pa.z < pb.z;
+			});
+
+		std::vector<uint32_t> positionOf(vertices.size());
+		std::vector<glm::vec3> positions;
+		std::vector<std::vector<uint32_t>> positionVertices;
+
+		for (size_t i = 0; i < sorted.size(); i++)
+		{
+			uint32_t vertex = sorted[i];
+
+			if (i == 0 || !samePosition(vertices[vertex].position, positions.back()))
+			{
+				positions.push_back(vertices[vertex].position);
+				positionVertices.emplace_back();
+			}
+
+			positionOf[vertex] = static_cast<uint32_t>(positions.size() - 1);
+			positionVertices.back().push_back(vertex);
+		}
+
+		size_t triangleCount = indices.size() / 3;
+		std::vector<std::array<uint32_t, 3>> corners(triangleCount);	// position ids
+		std::vector<std::array<uint32_t, 3>> cornerVertices(triangleCount);
+		std::vector<bool> alive(triangleCount, true);
+		size_t aliveCount = 0;
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				cornerVertices[t][k] = indices[t * 3 + k];
+				corners[t][k] = positionOf[indices[t * 3 + k]];
+			}
+
+			if (corners[t][0] == corners[t][1] || corners[t][1] == corners[t][2] || corners[t][0] == corners[t][2])
+			{
+				alive[t] = false;
+			}
+			else
+			{
+				aliveCount++;
+			}
+		}
+
+		// Face quadrics weighted by area, plus border planes along edges used by a single triangle
+		std::vector<Quadric> quadrics(positions.size());
+		std::vector<std::pair<uint64_t, size_t>> edges;
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (!alive[t]) continue;
+
+			glm::vec3 normal = triangleNormal(positions[corners[t][0]], positions[corners[t][1]], positions[corners[t][2]]);
+			float doubleArea = glm::length(normal);
+			if (doubleArea <= 0.f) continue;
+
+			normal = normal / doubleArea;
+			double distance = -glm::dot(normal, positions[corners[t][0]]);
+
+			for (int k = 0; k < 3; k++)
+			{
+				quadrics[corners[t][k]].addPlane(normal, distance, doubleArea * .5f);
+
+				uint32_t a = corners[t][k];
+				uint32_t b = corners[t][(k + 1) % 3];
+				edges.push_back({ (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b), t });
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			bool shared = (i > 0 && edges[i - 1].first == edges[i].first) || (i + 1 < edges.size() && edges[i + 1].first == edges[i].first);
+			if (shared) continue;
+
+			size_t t = edges[i].second;
+			uint32_t a = static_cast<uint32_t>(edges[i].first >> 32);
+			uint32_t b = static_cast<uint32_t>(edges[i].first & 0xffffffff);
+
+			glm::vec3 edge = positions[b] - positions[a];
+			glm::vec3 faceNormal = triangleNormal(positions[corners[t][0]], positions[corners[t][1]], positions[corners[t][2]]);
+			glm::vec3 borderNormal = glm::cross(edge, faceNormal);
+			float length = glm::length(borderNormal);
+			if (length <= 0.f) continue;
+
+			borderNormal = borderNormal / length;
+			double distance = -glm::dot(borderNormal, positions[a]);
+			double weight = glm::dot(edge, edge) * BORDER_WEIGHT;
+
+			quadrics[a].addPlane(borderNormal, distance, weight);
+			quadrics[b].addPlane(borderNormal, distance, weight);
+		}
+
+		// The quadric cost is a weighted mean and only orders the collapses. The error that is limited and
+		// reported is measured: every full detail position is represented by one surviving position, and its
+		// squared distance to the faces around that one bounds how far it lies from the simplified surface
+		double errorLimit = static_cast<double>(targetError) * targetError;
+		std::vector<std::vector<uint32_t>> represented(positions.size());
+		std::vector<double> deviations(positions.size(), 0.0);
+
+		for (uint32_t i = 0; i < positions.size(); i++)
+		{
+			represented[i].push_back(i);
+		}
+
+		std::vector<std::vector<uint32_t>> adjacency(positions.size());
+		std::vector<bool> locked(positions.size());
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> neighbours;
+		std::vector<double> neighbourDeviations;
+		std::vector<std::array<uint32_t, 3>> faces;
+
+		// Deviation of the positions represented by position once from has moved onto to, infinite when no
+		// face is left around it. to also takes over from's faces and represented positions
+		auto deviationAfter = [&](uint32_t position, uint32_t from, uint32_t to)
+		{
+			uint32_t sources[2] = { position, from };
+			int sourceCount = position == to ? 2 : 1;
+
+			faces.clear();
+
+			for (int i = 0; i < sourceCount; i++)
+			{
+				for (uint32_t t : adjacency[sources[i]])
+				{
+					if (!alive[t]) continue;
+
+					std::array<uint32_t, 3> c = corners[t];
+					for (auto& corner : c) corner = corner == from ? to : corner;
+
+					if (c[0] != c[1] && c[1] != c[2] && c[0] != c[2]) faces.push_back(c);
+				}
+			}
+
+			if (faces.empty()) return std::numeric_limits<double>::max();
+
+			double deviation = 0;
+
+			for (int i = 0; i < sourceCount; i++)
+			{
+				for (uint32_t member : represented[sources[i]])
+				{
+					double closest = std::numeric_limits<double>::max();
+
+					// A face closer than the deviation so far can't raise it, one past the limit ends the search
+					for (auto& c : faces)
+					{
+						closest = std::min(closest, static_cast<double>(distanceSquaredToTriangle(positions[member], positions[c[0]], positions[c[1]], positions[c[2]])));
+						if (closest <= deviation) break;
+					}
+
+					deviation = std::max(deviation, closest);
+					if (deviation > errorLimit) return deviation;
+				}
+			}
+
+			return deviation;
+		};
+
+		// Each pass collapses a batch of independent edges cheapest first, then rebuilds the candidates
+		while (aliveCount * 3 > targetIndexCount)
+		{
+			for (auto& list : adjacency) list.clear();
+			collapses.clear();
+
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				if (!alive[t]) continue;
+
+				for (int k = 0; k < 3; k++)
+				{
+					adjacency[corners[t][k]].push_back(static_cast<uint32_t>(t));
+
+					uint32_t a = corners[t][k];
+					uint32_t b = corners[t][(k + 1) % 3];
+
+					Quadric combined = quadrics[a];
+					combined.add(quadrics[b]);
+
+					double toB = combined.evaluate(positions[b]);
+					double toA = combined.evaluate(positions[a]);
+
+					// Interior edges show up twice, locking skips the second copy
+					collapses.push_back(toB <= toA ? Collapse{ a, b, toB } : Collapse{ b, a, toA });
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r)
+				{
+					return l.error < r.error;
+				});
+
+			std::fill(locked.begin(), locked.end(), false);
+			size_t collapsed = 0;
+
+			for (auto& collapse : collapses)
+			{
+				// Past the limit even the mean distance is too large, nothing later in the order is worth measuring
+				if (aliveCount * 3 <= targetIndexCount || collapse.error > errorLimit) break;
+				if (locked[collapse.from] || locked[collapse.to]) continue;
+
+				// Reject collapses folding a surviving neighbour over
+				bool flips = false;
+
+				for (uint32_t t : adjacency[collapse.from])
+				{
+					if (!alive[t]) continue;
+
+					auto& c = corners[t];
+					if (c[0] == collapse.to || c[1] == collapse.to || c[2] == collapse.to) continue;
+
+					glm::vec3 p[3];
+					glm::vec3 moved[3];
+
+					for (int k = 0; k < 3; k++)
+					{
+						p[k] = positions[c[k]];
+						moved[k] = c[k] == collapse.from ? positions[collapse.to] : p[k];
+					}
+
+					glm::vec3 before = triangleNormal(p[0], p[1], p[2]);
+					glm::vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+					float lengths = glm::length(before) * glm::length(after);
+
+					if (lengths <= 0.f || glm::dot(before, after) < MIN_FLIP_COSINE * lengths)
+					{
+						flips = true;
+						break;
+					}
+				}
+
+				if (flips) continue;
+
+				// The faces of to and of the positions around from change, measure them before committing
+				double toDeviation = deviationAfter(collapse.to, collapse.from, collapse.to);
+				if (toDeviation > errorLimit) continue;
+
+				neighbours.clear();
+				neighbourDeviations.clear();
+				bool deviates = false;
+
+				for (uint32_t t : adjacency[collapse.from])
+				{
+					if (!alive[t]) continue;
+
+					for (uint32_t neighbour : corners[t])
+					{
+						if (neighbour == collapse.from || neighbour == collapse.to) continue;
+						if (std::find(neighbours.begin(), neighbours.end(), neighbour) != neighbours.end()) continue;
+
+						neighbours.push_back(neighbour);
+						neighbourDeviations.push_back(deviationAfter(neighbour, collapse.from, collapse.to));
+						deviates = deviates || neighbourDeviations.back() > errorLimit;
+					}
+
+					if (deviates) break;
+				}
+
+				if (deviates) continue;
+
+				for (uint32_t t : adjacency[collapse.from])
+				{
+					if (!alive[t]) continue;
+
+					for (int k = 0; k < 3; k++)
+					{
+						if (corners[t][k] != collapse.from) continue;
+
+						corners[t][k] = collapse.to;
+						cornerVertices[t][k] = closestAttributes(vertices, positionVertices[collapse.to], cornerVertices[t][k]);
+					}
+
+					auto& c = corners[t];
+
+					if (c[0] == c[1] || c[1] == c[2] || c[0] == c[2])
+					{
+						alive[t] = false;
+						aliveCount--;
+					}
+					else
+					{
+						adjacency[collapse.to].push_back(t);
+					}
+				}
+
+				adjacency[collapse.from].clear();
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+
+				represented[collapse.to].insert(represented[collapse.to].end(), represented[collapse.from].begin(), represented[collapse.from].end());
+				represented[collapse.from].clear();
+				deviations[collapse.from] = 0;
+				deviations[collapse.to] = toDeviation;
+
+				for (size_t i = 0; i < neighbours.size(); i++)
+				{
+					deviations[neighbours[i]] = neighbourDeviations[i];
+				}
+
+				locked[collapse.from] = true;
+				locked[collapse.to] = true;
+				collapsed++;
+			}
+
+			if (collapsed == 0) break;
+		}
+
+		std::vector<uint32_t> result;
+		result.reserve(aliveCount * 3);
+
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (!alive[t]) continue;
+
+			result.insert(result.end(), cornerVertices[t].begin(), cornerVertices[t].end());
+		}
+
+		if (resultError != nullptr) *resultError = static_cast<float>(std::sqrt(*std::max_element(deviations.begin(), deviations.end())));
+
+		return result;
+	}
+
+	float EngineMeshSimplifier::measureDeviation(const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const std::vector<uint32_t>& simplifiedIndices)
+	{
+		std::vector<bool> measured(vertices.size());
+		float maxDistance = 0.f;
+
+		for (uint32_t index : indices)
+		{
+			if (measured[index]) continue;
+			measured[index] = true;
+
+			auto& p = vertices[index].position;
+			float closest = std::numeric_limits<float>::max();
+
+			for (size_t i = 0; i + 2 < simplifiedIndices.size(); i += 3)
+			{
+				closest = std::min(closest, distanceSquaredToTriangle(p, vertices[simplifiedIndices[i]].position,
+					vertices[simplifiedIndices[i + 1]].position, vertices[simplifiedIndices[i + 2]].position));
+			}
+
+			maxDistance = std::max(maxDistance, closest);
+		}
+
+		return std::sqrt(maxDistance);
+	}
+
+	bool EngineMeshSimplifier::testLods(const std::vector<std::string>& filepaths)
+	{
+		// The simplifier and the measurement round differently on the way through double and sqrt
+		constexpr float TOLERANCE = 1e-5f;
+
+		bool passed = true;
+
+		for (auto& filepath : filepaths)
+		{
+			EngineModel::Builder builder{};
+			builder.lodCount = EngineModel::MAX_LODS;
+			builder.loadModel(filepath);
+
+			auto& fullDetail = builder.lods[0];
+			std::vector<uint32_t> fullIndices(builder.indices.begin() + fullDetail.firstIndex, builder.indices.begin() + fullDetail.firstIndex + fullDetail.indexCount);
+
+			std::cout << filepath << ": " << fullDetail.indexCount / 3 << " tris, " << builder.lods.size() - 1 << " LODs" << std::endl;
+
+			for (size_t i = 1; i < builder.lods.size(); i++)
+			{
+				auto& lod = builder.lods[i];
+				std::vector<uint32_t> lodIndices(builder.indices.begin() + lod.firstIndex, builder.indices.begin() + lod.firstIndex + lod.indexCount);
+
+				float deviation = measureDeviation(builder.vertices, fullIndices, lodIndices);
+				bool withinError = deviation <= lod.error * (1.f + TOLERANCE);
+
+				std::cout << "  LOD " << i << ": " << lod.indexCount / 3 << " tris, error " << lod.error << ", measured " << deviation
+					<< (withinError ? ", passed" : ", FAILED") << std::endl;
+
+				passed = passed && withinError;
+			}
+		}
+
+		return passed;
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "engineModel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Quadric error metric edge collapse simplification (Garland and Heckbert). Collapses only ever move a
+	// vertex onto an existing neighbour, so the result indexes the same vertex array as the input and a
+	// whole LOD chain can share one vertex buffer. Vertices sharing a position (normal or uv seams) collapse
+	// together, open borders are held in place by extra perpendicular planes
+	class EngineMeshSimplifier
+	{
+	public:
+		// Collapses edges cheapest first until the index count reaches targetIndexCount. Collapses that would
+		// leave a full detail vertex further than targetError (model units) from the simplified surface are
+		// skipped. The largest such distance is written to resultError, an upper bound rather than an average
+		static std::vector<uint32_t> simplify(const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+			size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+		// Largest distance of a vertex of indices to the surface of simplifiedIndices, by brute force
+		static float measureDeviation(const std::vector<EngineModel::Vertex>& vertices, const std::vector<uint32_t>& indices,
+			const std::vector<uint32_t>& simplifiedIndices);
+
+		// Builds the LOD chain of every file and checks that each level's measured deviation stays within the
+		// error it reports. Prints the outcome and returns whether every level passed
+		static bool testLods(const std::vector<std::string>& filepaths);
+	};
+} // namespace
\ No newline at end of file
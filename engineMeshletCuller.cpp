@@ -0,0 +1,229 @@
+#include "engineMeshletCuller.h"
+#include "engineSwapchain.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	struct MeshletCullPushConstants
+	{
+		glm::mat4 modelMatrix{ 1.f };
+		uint32_t meshletCount = 0;
+		uint32_t drawIndex = 0;
+	};
+
+	// Must match the constant_id in meshletCull.comp and meshlet.task
+	static constexpr uint32_t CONE_CULLING_CONSTANT = 2;
+
+	EngineMeshletCuller::EngineMeshletCuller(EngineDevice& device, EngineShaderCompiler& compiler, VkDescriptorSetLayout globalSetLayout)
+		: engDevice{ device }, compiler{ compiler }, descriptorCache{ device }
+	{
+		VkShaderStageFlags meshletStages = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		if (engDevice.supportsMeshShaders())
+		{
+			meshletStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+		}
+
+		meshletSetLayout = EngineDescriptorSetLayout::Builder(engDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletStages)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletStages)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletStages)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletStages)
+			.addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshletStages)
+			.build();
+
+		outputSetLayout = EngineDescriptorSetLayout::Builder(engDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT)
+			.build();
+
+		descriptorPool = EngineDescriptorPool::Builder(engDevice)
+			.setMaxSets(MAX_MESHLET_MODELS + EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_MESHLET_MODELS * 5 + EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+			.build();
+
+		createPipelineLayout(globalSetLayout);
+
+		watchId = compiler.watch("shaders/meshletCull.comp", [this]() { pipeline.reset(); });
+	}
+
+	EngineMeshletCuller::~EngineMeshletCuller()
+	{
+		compiler.unwatch(watchId);
+
+		// The layouts die with this object, don't leave their sets behind in the cache
+		descriptorCache.clear();
+		vkDestroyPipelineLayout(engDevice.getDevice(), pipelineLayout, nullptr);
+	}
+
+	void EngineMeshletCuller::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(MeshletCullPushConstants);
+
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, meshletSetLayout->getDescriptorSetLayout(),
+			outputSetLayout->getDescriptorSetLayout() };
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(engDevice.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	EngComputePipeline& EngineMeshletCuller::getPipeline()
+	{
+		if (pipeline == nullptr || pipelineConeCulling != coneCulling)
+		{
+			ShaderVariant variant{};
+			variant.set(CONE_CULLING_CONSTANT, coneCulling);
+
+			pipeline = std::make_unique<EngComputePipeline>(engDevice, compiler.compile("shaders/meshletCull.comp"), pipelineLayout, variant);
+			pipelineConeCulling = coneCulling;
+		}
+
+		return *pipeline;
+	}
+
+	VkDescriptorSet EngineMeshletCuller::getMeshletSet(EngineModel& model)
+	{
+		assert(model.hasMeshlets() && "Model has no meshlets");
+
+		auto meshletInfo = model.getMeshletBuffer().descriptorInfo();
+		auto meshletVertexInfo = model.getMeshletVertexBuffer().descriptorInfo();
+		auto meshletTriangleInfo = model.getMeshletTriangleBuffer().descriptorInfo();
+		auto vertexInfo = model.getVertexBuffer().descriptorInfo();
+		auto dequantizeInfo = model.getMeshletInfoBuffer().descriptorInfo();
+
+		VkDescriptorSet set;
+
+		EngineDescriptorWriter(*meshletSetLayout, *descriptorPool)
+			.writeBuffer(0, &meshletInfo)
+			.writeBuffer(1, &meshletVertexInfo)
+			.writeBuffer(2, &meshletTriangleInfo)
+			.writeBuffer(3, &vertexInfo)
+			.writeBuffer(4, &dequantizeInfo)
+			.build(set, descriptorCache);
+
+		return set;
+	}
+
+	void EngineMeshletCuller::begin(FrameInfo& frameInfo)
+	{
+		assert(!recording && "Meshlet culling already begun this frame");
+
+		if (outputIndexBuffers.empty())
+		{
+			for (int i = 0; i < EngineSwapChain::MAX_FRAMES_IN_FLIGHT; i++)
+			{
+				outputIndexBuffers.push_back(std::make_unique<EngineBuffer>(engDevice, sizeof(uint32_t), MAX_COMPACTED_INDICES,
+					VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+			}
+		}
+
+		// Zeroed index counts, the compute pass bumps them atomically
+		commands = frameInfo.frameAllocator.allocate(MAX_DRAWS * sizeof(VkDrawIndexedIndirectCommand));
+		drawCount = 0;
+		indexHead = 0;
+		recording = true;
+
+		auto& pipelineRef = getPipeline();
+		pipelineRef.bind(frameInfo.commandBuffer);
+
+		auto indexInfo = outputIndexBuffers[frameInfo.frameIndex]->descriptorInfo();
+		VkDescriptorBufferInfo commandInfo{ frameInfo.frameAllocator.getBuffer(), 0, MAX_DRAWS * sizeof(VkDrawIndexedIndirectCommand) };
+
+		VkDescriptorSet outputSet;
+
+		EngineDescriptorWriter(*outputSetLayout, *descriptorPool)
+			.writeBuffer(0, &indexInfo)
+			.writeBuffer(1, &commandInfo)
+			.build(outputSet, descriptorCache);
+
+		uint32_t commandOffset = static_cast<uint32_t>(commands.offset);
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+			0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+			2, 1, &outputSet, 1, &commandOffset);
+	}
+
+	bool EngineMeshletCuller::cull(FrameInfo& frameInfo, EngineModel& model, const glm::mat4& modelMatrix, uint32_t& drawIndex)
+	{
+		assert(recording && "Meshlet culling not begun");
+
+		uint32_t indexCapacity = model.getMeshletTriangleCount() * 3;
+
+		if (drawCount >= MAX_DRAWS || indexHead + indexCapacity > MAX_COMPACTED_INDICES)
+		{
+			return false;
+		}
+
+		drawIndex = drawCount++;
+
+		VkDrawIndexedIndirectCommand command{};
+		command.indexCount = 0;
+		command.instanceCount = 1;
+		command.firstIndex = indexHead;
+		command.vertexOffset = 0;
+		command.firstInstance = 0;
+
+		static_cast<VkDrawIndexedIndirectCommand*>(commands.mapped)[drawIndex] = command;
+		indexHead += indexCapacity;
+
+		VkDescriptorSet meshletSet = getMeshletSet(model);
+
+		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+			1, 1, &meshletSet, 0, nullptr);
+
+		MeshletCullPushConstants push{};
+		push.modelMatrix = modelMatrix;
+		push.meshletCount = model.getMeshletCount();
+		push.drawIndex = drawIndex;
+
+		vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+			sizeof(MeshletCullPushConstants), &push);
+
+		vkCmdDispatch(frameInfo.commandBuffer, (push.meshletCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+		return true;
+	}
+
+	void EngineMeshletCuller::end(FrameInfo& frameInfo)
+	{
+		assert(recording && "Meshlet culling not begun");
+		recording = false;
+
+		// Compacted indices and counts must land before the draws read them
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+		vkCmdPipelineBarrier(frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void EngineMeshletCuller::draw(FrameInfo& frameInfo, uint32_t drawIndex)
+	{
+		assert(drawIndex < drawCount && "Draw was not culled this frame");
+
+		vkCmdBindIndexBuffer(frameInfo.commandBuffer, outputIndexBuffers[frameInfo.frameIndex]->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, frameInfo.frameAllocator.getBuffer(),
+			commands.offset + drawIndex * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+} // namespace
\ No newline at end of file
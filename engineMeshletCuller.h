@@ -0,0 +1,79 @@
+#pragma once
+
+#include "engPipeline.h"
+#include "engineDevice.h"
+#include "engineBuffer.h"
+#include "engineDescriptors.h"
+#include "engineFrameInfo.h"
+#include "engineModel.h"
+#include "engineShaderCompiler.h"
+
+#include <memory>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// GPU meshlet culling for devices without mesh shaders. Outside the render pass, one compute dispatch
+	// per object tests every meshlet against the frustum and its normal cone and appends the indices of
+	// the survivors to a compacted index buffer, counting them into an indirect draw. Inside the render
+	// pass each object is then drawn with vkCmdDrawIndexedIndirect.
+	//
+	// Also owns the meshlet descriptor set layout shared with the mesh shader path:
+	// 0 meshlets, 1 meshlet vertices, 2 meshlet triangles, 3 vertices, 4 dequantization info
+	class EngineMeshletCuller
+	{
+	public:
+		static constexpr uint32_t MAX_DRAWS = 4096;
+		static constexpr uint32_t MAX_COMPACTED_INDICES = 4 * 1024 * 1024;	// per frame in flight
+		static constexpr uint32_t WORKGROUP_SIZE = 64;						// local_size_x of meshletCull.comp
+		static constexpr uint32_t MAX_MESHLET_MODELS = 256;
+
+		EngineMeshletCuller(EngineDevice& device, EngineShaderCompiler& compiler, VkDescriptorSetLayout globalSetLayout);
+		~EngineMeshletCuller();
+
+		EngineMeshletCuller(const EngineMeshletCuller&) = delete;
+		EngineMeshletCuller& operator=(const EngineMeshletCuller&) = delete;
+
+		VkDescriptorSetLayout getMeshletSetLayout() const { return meshletSetLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getMeshletSet(EngineModel& model);
+
+		// Cone culling assumes closed or back face culled meshes, open ones show their inside
+		void setConeCullingEnabled(bool enabled) { coneCulling = enabled; }
+
+		// Recorded outside the render pass. cull returns false when this frame's draw or index capacity is
+		// used up, the caller then draws the object unculled
+		void begin(FrameInfo& frameInfo);
+		bool cull(FrameInfo& frameInfo, EngineModel& model, const glm::mat4& modelMatrix, uint32_t& drawIndex);
+		void end(FrameInfo& frameInfo);
+
+		// Inside the render pass, after model.bind
+		void draw(FrameInfo& frameInfo, uint32_t drawIndex);
+
+	private:
+		EngineDevice& engDevice;
+		EngineShaderCompiler& compiler;
+		uint32_t watchId;
+
+		std::unique_ptr<EngineDescriptorSetLayout> meshletSetLayout;
+		std::unique_ptr<EngineDescriptorSetLayout> outputSetLayout;
+		std::unique_ptr<EngineDescriptorPool> descriptorPool;
+		EngineDescriptorSetCache descriptorCache;
+
+		VkPipelineLayout pipelineLayout;
+		std::unique_ptr<EngComputePipeline> pipeline;
+		bool pipelineConeCulling = false;
+		bool coneCulling = true;
+
+		// Created on first use, devices with mesh shaders never need them
+		std::vector<std::unique_ptr<EngineBuffer>> outputIndexBuffers;
+
+		EngineRingBuffer::Allocation commands{};
+		uint32_t drawCount = 0;
+		uint32_t indexHead = 0;
+		bool recording = false;
+
+		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		EngComputePipeline& getPipeline();
+	};
+} // namespace
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "engineMeshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace gameEngine
+{
+	// Clusters whose normals spread close to a hemisphere almost never cull, skip the test for them
+	static constexpr float MIN_CONE_DOT = .1f;
+
+	static void computeBounds(const std::vector<EngineModel::Vertex>& vertices, const MeshletData& data, Meshlet& meshlet)
+	{
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ -std::numeric_limits<float>::max() };
+
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			auto& position = vertices[data.vertices[meshlet.vertexOffset + i]].position;
+			boundsMin = glm::min(boundsMin, position);
+			boundsMax = glm::max(boundsMax, position);
+		}
+
+		glm::vec3 center = (boundsMin + boundsMax) * .5f;
+		float radius = 0.f;
+
+		for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+		{
+			radius = std::max(radius, glm::length(vertices[data.vertices[meshlet.vertexOffset + i]].position - center));
+		}
+
+		meshlet.sphere = glm::vec4{ center, radius };
+
+		// Cone around the face normals, from their area independent average
+		std::vector<glm::vec3> normals{};
+		glm::vec3 axis{ 0.f };
+
+		for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+		{
+			uint32_t packed = data.triangles[meshlet.triangleOffset + t];
+			auto& a = vertices[data.vertices[meshlet.vertexOffset + (packed & 0xff)]].position;
+			auto& b = vertices[data.vertices[meshlet.vertexOffset + ((packed >> 8) & 0xff)]].position;
+			auto& c = vertices[data.vertices[meshlet.vertexOffset + ((packed >> 16) & 0xff)]].position;
+
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			if (length <= 0.f) continue;
+
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		float axisLength = glm::length(axis);
+
+		if (normals.empty() || axisLength <= 0.f)
+		{
+			meshlet.cone = glm::vec4{ 0.f, 0.f, 1.f, 1.f };
+			return;
+		}
+
+		axis /= axisLength;
+		float minDot = 1.f;
+
+		for (auto& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(axis, normal));
+		}
+
+		// Every triangle faces away once the view direction is within 90 degrees minus the spread of the
+		// axis, the shaders compare against the sine of the spread
+		float cutoff = minDot <= MIN_CONE_DOT ? 1.f : std::sqrt(1.f - minDot * minDot);
+		meshlet.cone = glm::vec4{ axis, cutoff };
+	}
+
+	MeshletData EngineMeshletBuilder::build(const std::vector<EngineModel::Vertex>& vertices, const uint32_t* indices, size_t indexCount)
+	{
+		MeshletData data{};
+
+		// Model vertex -> local index in the meshlet being built
+		std::vector<uint8_t> localIndex(vertices.size(), 0xff);
+		Meshlet current{};
+
+		auto flush = [&]()
+			{
+				if (current.triangleCount == 0) return;
+
+				for (uint32_t i = 0; i < current.vertexCount; i++)
+				{
+					localIndex[data.vertices[current.vertexOffset + i]] = 0xff;
+				}
+
+				computeBounds(vertices, data, current);
+				data.meshlets.push_back(current);
+
+				current = Meshlet{};
+				current.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+				current.triangleOffset = static_cast<uint32_t>(data.triangles.size());
+			};
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			uint32_t a = indices[i + 0];
+			uint32_t b = indices[i + 1];
+			uint32_t c = indices[i + 2];
+
+			uint32_t newVertices = (localIndex[a] == 0xff) + (localIndex[b] == 0xff) + (localIndex[c] == 0xff);
+
+			if (current.vertexCount + newVertices > MAX_VERTICES || current.triangleCount + 1 > MAX_TRIANGLES)
+			{
+				flush();
+			}
+
+			uint32_t packed = 0;
+			uint32_t corners[3] = { a, b, c };
+
+			for (int k = 0; k < 3; k++)
+			{
+				if (localIndex[corners[k]] == 0xff)
+				{
+					localIndex[corners[k]] = static_cast<uint8_t>(current.vertexCount++);
+					data.vertices.push_back(corners[k]);
+				}
+
+				packed |= static_cast<uint32_t>(localIndex[corners[k]]) << (k * 8);
+			}
+
+			data.triangles.push_back(packed);
+			current.triangleCount++;
+		}
+
+		flush();
+
+		return data;
+	}
+} // namespace
\ No newline at end of file
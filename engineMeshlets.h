@@ -0,0 +1,42 @@
+#pragma once
+
+#include "engineModel.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// std430 layout shared with meshletCull.comp, meshlet.task and meshlet.mesh
+	struct Meshlet
+	{
+		glm::vec4 sphere{ 0.f };	// model space bounding sphere, w is the radius
+		glm::vec4 cone{ 0.f };		// normal cone axis, w is the sine of its spread (1 when the cone can't cull)
+		uint32_t vertexOffset = 0;	// first entry in MeshletData::vertices
+		uint32_t triangleOffset = 0;	// first entry in MeshletData::triangles
+		uint32_t vertexCount = 0;
+		uint32_t triangleCount = 0;
+	};
+
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match its std430 declaration");
+
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets{};
+		std::vector<uint32_t> vertices{};	// meshlet local vertex -> model vertex
+		std::vector<uint32_t> triangles{};	// three 8 bit local indices per triangle, packed low to high
+	};
+
+	// Splits an indexed triangle list into clusters small enough for one mesh shader workgroup and computes
+	// the bounds used to cull them. Triangles are taken in index buffer order, which after
+	// EngineMeshOptimizer::optimizeVertexCache already walks the mesh in compact strips
+	class EngineMeshletBuilder
+	{
+	public:
+		static constexpr uint32_t MAX_VERTICES = 64;
+		static constexpr uint32_t MAX_TRIANGLES = 124;
+
+		static MeshletData build(const std::vector<EngineModel::Vertex>& vertices, const uint32_t* indices, size_t indexCount);
+	};
+} // namespace
\ No newline at end of file
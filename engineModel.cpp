@@ -1,47 +1,166 @@
 #include "engineModel.h"
 
+#include "engineMeshOptimizer.h"
+#include "engineMeshSimplifier.h"
+#include "engineMeshlets.h"
+#include "engineObjParser.h"
 #include "engineUtils.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
+#include <iostream>
+#include <limits>
 
-namespace std
+namespace gameEngine
 {
-	template<>
-	struct hash<gameEngine::EngineModel::Vertex>
+	struct CompactVertex
+	{
+		uint16_t position[4];	// unorm within the mesh bounds, w unused
+		int16_t normal[2];		// octahedral
+		uint16_t uv[2];			// half float
+	};
+
+	struct CompactColorVertex
 	{
-		size_t operator()(gameEngine::EngineModel::Vertex const& vertex) const
+		uint16_t position[4];
+		int16_t normal[2];
+		uint16_t uv[2];
+		uint8_t color[4];
+	};
+
+	static_assert(sizeof(CompactVertex) == 16, "CompactVertex must be tightly packed");
+	static_assert(sizeof(CompactColorVertex) == 20, "CompactColorVertex must be tightly packed");
+
+	// Octahedral normal encoding, see "A Survey of Efficient Representations for Independent Unit Vectors"
+	static void encodeOctahedral(glm::vec3 n, int16_t out[2])
+	{
+		float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		glm::vec2 p = l1 > 0.f ? glm::vec2(n.x, n.y) / l1 : glm::vec2(0.f);
+
+		if (l1 > 0.f && n.z < 0.f)
 		{
-			size_t seed = 0;
-			gameEngine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
+			glm::vec2 folded{ (1.f - std::abs(p.y)) * (p.x >= 0.f ? 1.f : -1.f), (1.f - std::abs(p.x)) * (p.y >= 0.f ? 1.f : -1.f) };
+			p = folded;
 		}
-	};
-}
 
-namespace gameEngine
-{
+		out[0] = static_cast<int16_t>(std::round(glm::clamp(p.x, -1.f, 1.f) * 32767.f));
+		out[1] = static_cast<int16_t>(std::round(glm::clamp(p.y, -1.f, 1.f) * 32767.f));
+	}
+
+	static uint16_t quantizeUnorm16(float value)
+	{
+		return static_cast<uint16_t>(std::round(glm::clamp(value, 0.f, 1.f) * 65535.f));
+	}
+
+	static uint8_t quantizeUnorm8(float value)
+	{
+		return static_cast<uint8_t>(std::round(glm::clamp(value, 0.f, 1.f) * 255.f));
+	}
+
+	VkDeviceSize EngineModel::Payload::getUploadSize() const
+	{
+		VkDeviceSize size = vertexData.size() + indices.size() * sizeof(uint32_t);
+
+		if (meshlets)
+		{
+			size += meshlets->meshlets.size() * sizeof(Meshlet) + (meshlets->vertices.size() + meshlets->triangles.size()) * sizeof(uint32_t);
+		}
+
+		return size;
+	}
+
+	EngineModel::Payload EngineModel::createPayload(const Builder& builder)
+	{
+		assert(builder.vertices.size() >= 3 && "Vertex count must be at least 3");
+
+		Payload payload{};
+		payload.layout = builder.layout;
+		payload.vertexData = packVertices(builder.vertices, builder.layout, payload.dequantizeMatrix);
+		payload.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+		payload.indices = builder.indices;
+		payload.lods = builder.lods;
+
+		if (payload.lods.empty())
+		{
+			payload.lods.push_back({ 0, static_cast<uint32_t>(payload.indices.size()), 0.f });
+		}
+
+		if (builder.meshlets && !builder.indices.empty())
+		{
+			auto meshlets = std::make_shared<MeshletData>(EngineMeshletBuilder::build(builder.vertices, builder.indices.data(), payload.lods[0].indexCount));
+
+			if (!meshlets->meshlets.empty())
+			{
+				payload.meshlets = std::move(meshlets);
+			}
+		}
+
+		// Centered on the bounds, not minimal but cheap and plenty for LOD selection
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ -std::numeric_limits<float>::max() };
+
+		for (auto& vertex : builder.vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+
+		payload.boundingCenter = (boundsMin + boundsMax) * .5f;
+
+		for (auto& vertex : builder.vertices)
+		{
+			payload.boundingRadius = glm::max(payload.boundingRadius, glm::length(vertex.position - payload.boundingCenter));
+		}
 
-	EngineModel::EngineModel(EngineDevice& device, const EngineModel::Builder& builder) : engDevice{ device }
+		return payload;
+	}
+
+	EngineModel::EngineModel(EngineDevice& device, const EngineModel::Builder& builder) : engDevice{ device }, vertexLayout{ builder.layout }
+	{
+		Payload payload = createPayload(builder);
+		std::vector<std::unique_ptr<EngineBuffer>> stagingBuffers;
+
+		VkCommandBuffer commandBuffer = engDevice.beginSingleTimeCommands();
+		recordUpload(payload, commandBuffer, stagingBuffers);
+		engDevice.endSingleTimeCommands(commandBuffer);
+
+		setResident();
+	}
+
+	EngineModel::EngineModel(EngineDevice& device, VertexLayout layout) : engDevice{ device }, vertexLayout{ layout }
 	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
 	}
 
 	EngineModel::~EngineModel() {}
 
-	std::shared_ptr<EngineModel> EngineModel::createModelFromFile(EngineDevice& device, const std::string& filepath)
+	std::shared_ptr<EngineModel> EngineModel::createModelFromFile(EngineDevice& device, const std::string& filepath, VertexLayout layout, uint32_t lodCount, bool meshlets)
 	{
 		Builder builder;
+		builder.layout = layout;
+		builder.lodCount = lodCount;
+		builder.meshlets = meshlets;
 
 		builder.loadModel(filepath);
-		return std::make_unique<EngineModel>(device, builder);
+		auto model = std::make_shared<EngineModel>(device, builder);
+
+		if (verboseOutput)
+		{
+			std::cout << filepath << ": " << model->getVertexCount() << " vertices, " << getVertexStride(layout) << " bytes/vertex, "
+				<< model->getVertexBufferSize() / 1024.f << " KB (" << model->getVertexCount() * sizeof(Vertex) / 1024.f << " KB unpacked)" << std::endl;
+
+			if (model->hasMeshlets())
+			{
+				std::cout << filepath << ": " << model->getMeshletCount() << " meshlets, "
+					<< static_cast<float>(model->getMeshletTriangleCount()) / model->getMeshletCount() << " triangles/meshlet" << std::endl;
+			}
+		}
+
+		return model;
 	}
 
 	void EngineModel::bind(VkCommandBuffer commandBuffer)
@@ -57,11 +176,12 @@ namespace gameEngine
 		}
 	}
 
-	void EngineModel::draw(VkCommandBuffer commandBuffer)
+	void EngineModel::draw(VkCommandBuffer commandBuffer, uint32_t lod)
 	{
 		if (hasIndexBuffer)
 		{
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			assert(lod < lods.size() && "LOD out of range");
+			vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, 1, lods[lod].firstIndex, 0, 0);
 		}
 		else
 		{
@@ -69,59 +189,231 @@ namespace gameEngine
 		}
 	}
 
-	void EngineModel::createVertexBuffers(const std::vector<Vertex>& vertices)
+	uint32_t EngineModel::selectLod(float pixelsPerUnit, uint32_t currentLod, float thresholdPixels, float hysteresis) const
 	{
-		vertexCount = static_cast<uint32_t>(vertices.size());
-
-		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
+		uint32_t lod = 0;
 
-		EngineBuffer stagingBuffer{ engDevice, vertexSize,
-			vertexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
+		// Errors grow along the chain, so the first level that projects too large ends the search
+		for (uint32_t i = 1; i < lods.size(); i++)
+		{
+			float limit = i > currentLod ? thresholdPixels * (1.f - hysteresis) : thresholdPixels;
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
+			if (lods[i].error * pixelsPerUnit > limit) break;
 
-		vertexBuffer = std::make_unique<EngineBuffer>(engDevice, vertexSize, vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			lod = i;
+		}
 
-		engDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		return lod;
 	}
 
-	void EngineModel::createIndexBuffers(const std::vector<uint32_t>& indices)
+	void EngineModel::recordUpload(const Payload& payload, VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<EngineBuffer>>& stagingBuffers)
 	{
-		indexCount = static_cast<uint32_t>(indices.size());
+		assert(payload.layout == vertexLayout && "Payload was packed for another vertex layout");
+		assert(!resident && "Model is already resident");
+
+		// Everything but the buffers is kept across evictions, set it again in case the source changed
+		dequantizeMatrix = payload.dequantizeMatrix;
+		vertexCount = payload.vertexCount;
+		indexCount = static_cast<uint32_t>(payload.indices.size());
 		hasIndexBuffer = indexCount > 0;
+		lods = payload.lods;
+		boundingCenter = payload.boundingCenter;
+		boundingRadius = payload.boundingRadius;
+
+		// Mesh shaders read vertices as a storage buffer
+		storageVertices = payload.meshlets != nullptr;
+
+		VkBufferUsageFlags vertexUsage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+
+		if (storageVertices)
+		{
+			vertexUsage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		}
 
-		if (!hasIndexBuffer)
+		vertexBuffer = createDeviceBuffer(payload.vertexData.data(), getVertexStride(vertexLayout), vertexCount, vertexUsage, commandBuffer, stagingBuffers);
+
+		if (hasIndexBuffer)
+		{
+			indexBuffer = createDeviceBuffer(payload.indices.data(), sizeof(uint32_t), indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, commandBuffer, stagingBuffers);
+		}
+
+		if (!payload.meshlets)
 		{
+			meshletCount = 0;
+			meshletTriangleCount = 0;
 			return;
 		}
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+		const MeshletData& data = *payload.meshlets;
+		meshletCount = static_cast<uint32_t>(data.meshlets.size());
+		meshletTriangleCount = static_cast<uint32_t>(data.triangles.size());
+
+		meshletBuffer = createDeviceBuffer(data.meshlets.data(), sizeof(Meshlet), meshletCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, commandBuffer, stagingBuffers);
+		meshletVertexBuffer = createDeviceBuffer(data.vertices.data(), sizeof(uint32_t), static_cast<uint32_t>(data.vertices.size()),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, commandBuffer, stagingBuffers);
+		meshletTriangleBuffer = createDeviceBuffer(data.triangles.data(), sizeof(uint32_t), meshletTriangleCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, commandBuffer, stagingBuffers);
+
+		// Mesh shaders fetch raw vertices, they undo the position quantization themselves while culling
+		// keeps working on the model space bounds
+		glm::vec4 info[2] = { dequantizeMatrix[3], glm::vec4{ dequantizeMatrix[0][0], dequantizeMatrix[1][1], dequantizeMatrix[2][2], 0.f } };
+		meshletInfoBuffer = createDeviceBuffer(info, sizeof(info), 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, commandBuffer, stagingBuffers);
+	}
+
+	void EngineModel::evict()
+	{
+		resident = false;
+
+		vertexBuffer.reset();
+		indexBuffer.reset();
+		meshletBuffer.reset();
+		meshletVertexBuffer.reset();
+		meshletTriangleBuffer.reset();
+		meshletInfoBuffer.reset();
+	}
+
+	VkDeviceSize EngineModel::getMemorySize() const
+	{
+		VkDeviceSize size = 0;
+
+		for (auto* buffer : { &vertexBuffer, &indexBuffer, &meshletBuffer, &meshletVertexBuffer, &meshletTriangleBuffer, &meshletInfoBuffer })
+		{
+			if (*buffer) size += (*buffer)->getBufferSize();
+		}
 
-		uint32_t indexSize = sizeof(indices[0]);
+		return size;
+	}
 
-		EngineBuffer stagingBuffer{ engDevice, indexSize,
-			indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	std::unique_ptr<EngineBuffer> EngineModel::createDeviceBuffer(const void* data, uint32_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage,
+		VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<EngineBuffer>>& stagingBuffers)
+	{
+		auto stagingBuffer = std::make_unique<EngineBuffer>(engDevice, instanceSize,
+			instanceCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
+		);
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+		stagingBuffer->map();
+		stagingBuffer->writeToBuffer(const_cast<void*>(data));
 
-		indexBuffer = std::make_unique<EngineBuffer>(engDevice, indexSize, indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		auto buffer = std::make_unique<EngineBuffer>(engDevice, instanceSize, instanceCount,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-		engDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+		// Nothing writes model data after this copy, so it may be compacted later
+		buffer->setRelocatable(true);
+
+		VkBufferCopy copyRegion{};
+		copyRegion.size = static_cast<VkDeviceSize>(instanceSize) * instanceCount;
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer->getBuffer(), buffer->getBuffer(), 1, &copyRegion);
+
+		stagingBuffers.push_back(std::move(stagingBuffer));
+		return buffer;
+	}
+
+	std::vector<uint8_t> EngineModel::packVertices(const std::vector<Vertex>& vertices, VertexLayout vertexLayout, glm::mat4& dequantizeMatrix)
+	{
+		std::vector<uint8_t> packed(vertices.size() * getVertexStride(vertexLayout));
+
+		if (vertexLayout == VertexLayout::Full)
+		{
+			memcpy(packed.data(), vertices.data(), packed.size());
+			dequantizeMatrix = glm::mat4{ 1.f };
+			return packed;
+		}
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ -std::numeric_limits<float>::max() };
+
+		for (auto& vertex : vertices)
+		{
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
+		}
+
+		// Flat meshes (like the floor quad) have a zero extent on one axis, keep the division defined
+		glm::vec3 extent = boundsMax - boundsMin;
+		extent = glm::vec3{ extent.x > 0.f ? extent.x : 1.f, extent.y > 0.f ? extent.y : 1.f, extent.z > 0.f ? extent.z : 1.f };
+
+		dequantizeMatrix = glm::scale(glm::translate(glm::mat4{ 1.f }, boundsMin), extent);
+
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			auto& vertex = vertices[i];
+
+			// Both compact layouts share their first 16 bytes
+			CompactColorVertex compact{};
+			glm::vec3 normalized = (vertex.position - boundsMin) / extent;
+			compact.position[0] = quantizeUnorm16(normalized.x);
+			compact.position[1] = quantizeUnorm16(normalized.y);
+			compact.position[2] = quantizeUnorm16(normalized.z);
+			compact.position[3] = 0;
+			encodeOctahedral(vertex.normal, compact.normal);
+			compact.uv[0] = glm::packHalf1x16(vertex.uv.x);
+			compact.uv[1] = glm::packHalf1x16(vertex.uv.y);
+			compact.color[0] = quantizeUnorm8(vertex.color.r);
+			compact.color[1] = quantizeUnorm8(vertex.color.g);
+			compact.color[2] = quantizeUnorm8(vertex.color.b);
+			compact.color[3] = 255;
+
+			uint32_t stride = getVertexStride(vertexLayout);
+			memcpy(packed.data() + i * stride, &compact, stride);
+		}
+
+		return packed;
+	}
+
+	uint32_t EngineModel::getVertexStride(VertexLayout layout)
+	{
+		switch (layout)
+		{
+		case VertexLayout::Compact: return sizeof(CompactVertex);
+		case VertexLayout::CompactColor: return sizeof(CompactColorVertex);
+		default: return sizeof(Vertex);
+		}
+	}
+
+	std::vector<VkVertexInputBindingDescription> EngineModel::getBindingDescriptions(VertexLayout layout)
+	{
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = getVertexStride(layout);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> EngineModel::getAttributeDescriptions(VertexLayout layout)
+	{
+		if (layout == VertexLayout::Full)
+		{
+			return Vertex::getAttributeDescriptions();
+		}
+
+		// Locations match shader.vert, the normal arrives as a vec2 and is decoded in the shader
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+		attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactColorVertex, position) });
+		attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactColorVertex, normal) });
+		attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactColorVertex, uv) });
+
+		if (layout == VertexLayout::CompactColor)
+		{
+			attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactColorVertex, color) });
+		}
+
+		return attributeDescriptions;
 	}
 
+	std::vector<std::pair<std::string, std::string>> EngineModel::getShaderDefines(VertexLayout layout)
+	{
+		switch (layout)
+		{
+		case VertexLayout::Compact: return { { "VERTEX_LAYOUT_COMPACT", "1" } };
+		case VertexLayout::CompactColor: return { { "VERTEX_HAS_COLOR", "1" }, { "VERTEX_LAYOUT_COMPACT", "1" } };
+		default: return {};
+		}
+	}
 
 	std::vector<VkVertexInputBindingDescription> EngineModel::Vertex::getBindingDescriptions()
 	{
@@ -133,6 +425,21 @@ namespace gameEngine
 		return bindingDescriptions;
 	}
 
+	size_t EngineModel::VertexHash::operator()(const Vertex& vertex) const
+	{
+		static_assert(sizeof(Vertex) == 11 * sizeof(float), "Vertex must not contain padding");
+
+		float components[11];
+		std::memcpy(components, &vertex, sizeof(components));
+
+		for (float& component : components)
+		{
+			component += 0.f;
+		}
+
+		return static_cast<size_t>(hashBytes(components, sizeof(components)));
+	}
+
 	std::vector<VkVertexInputAttributeDescription> EngineModel::Vertex::getAttributeDescriptions()
 	{
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
@@ -147,74 +454,67 @@ namespace gameEngine
 
 	void EngineModel::Builder::loadModel(const std::string& filepath)
 	{
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
+		EngineObjParser::parse(filepath, vertices, indices);
 
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str()))
+		EngineMeshOptimizer::optimize(vertices, indices, filepath);
+		generateLods(filepath);
+	}
+
+	void EngineModel::Builder::generateLods(const std::string& name)
+	{
+		lods.clear();
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.f });
+
+		if (lodCount <= 1 || indices.empty())
+		{
+			return;
+		}
+
+		glm::vec3 boundsMin{ std::numeric_limits<float>::max() };
+		glm::vec3 boundsMax{ -std::numeric_limits<float>::max() };
+
+		for (auto& vertex : vertices)
 		{
-			throw std::runtime_error(warn + err);
+			boundsMin = glm::min(boundsMin, vertex.position);
+			boundsMax = glm::max(boundsMax, vertex.position);
 		}
 
-		vertices.clear();
-		indices.clear();
+		float maxError = lodMaxError * glm::length(boundsMax - boundsMin) * .5f;
+
+		// Every level is simplified from full detail rather than from its predecessor, errors don't stack
+		const std::vector<uint32_t> fullDetail = indices;
+		uint32_t levels = glm::min(lodCount, MAX_LODS);
 
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+		for (uint32_t i = 1; i < levels; i++)
+		{
+			size_t target = static_cast<size_t>(lods.back().indexCount * lodReduction) / 3 * 3;
+			float error = 0.f;
+
+			std::vector<uint32_t> lodIndices = EngineMeshSimplifier::simplify(vertices, fullDetail, target, maxError, &error);
+
+			// The error bound or the mesh topology stopped the simplifier, a level barely smaller than the
+			// previous one only costs memory
+			if (lodIndices.empty() || lodIndices.size() > lods.back().indexCount * 0.9f)
+			{
+				break;
+			}
 
-		for (const auto& shape : shapes)
+			EngineMeshOptimizer::optimizeVertexCache(lodIndices, vertices.size());
+
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), glm::max(error, lods.back().error) });
+			indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		}
+
+		if (verboseOutput)
 		{
-			for (const auto& index : shape.mesh.indices)
+			std::cout << name << ": " << lods.size() << " LODs";
+
+			for (auto& lod : lods)
 			{
-				Vertex vertex{};
-
-				if (index.vertex_index >= 0)
-				{
-					vertex.position =
-					{
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2],
-					};
-				}
-
-				if (index.vertex_index >= 0)
-				{
-					vertex.color =
-					{
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
-				}
-
-				if (index.normal_index >= 0)
-				{
-					vertex.normal =
-					{
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2],
-					};
-				}
-
-				if (index.texcoord_index >= 0)
-				{
-					vertex.uv =
-					{
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
-
-				if (uniqueVertices.count(vertex) == 0)
-				{
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-
-				indices.push_back(uniqueVertices[vertex]);
+				std::cout << " [" << lod.indexCount / 3 << " tris, error " << lod.error << "]";
 			}
+
+			std::cout << std::endl;
 		}
 	}
 } // namespace
\ No newline at end of file
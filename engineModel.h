@@ -7,15 +7,42 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace gameEngine
 {
+	struct MeshletData;
 
 	class EngineModel
 	{
 	public:
+		// GPU side vertex formats. Full uploads Vertex as is (44 bytes). The compact layouts store positions
+		// as 16 bit unorm inside the mesh bounds (undone by getDequantizeMatrix), octahedral normals in
+		// 2x16 bit snorm and half float uvs, optionally followed by an RGBA8 color
+		enum class VertexLayout
+		{
+			Full,			// 44 bytes
+			Compact,		// 16 bytes, color is white
+			CompactColor,	// 20 bytes
+		};
+
+		static constexpr uint32_t VERTEX_LAYOUT_COUNT = 3;
+		static constexpr uint32_t MAX_LODS = 8;
+
+		// A level of detail is a range of the shared index buffer, error is how far (model units) any vertex
+		// of the full detail mesh lies from its surface at most
+		struct Lod
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			float error = 0.f;
+		};
+
 		struct Vertex
 		{
 			glm::vec3 position{};
@@ -32,36 +59,152 @@ namespace gameEngine
 			}
 		};
 
+		// Hashes the raw bytes of a vertex, with -0 folded into 0 so vertices that compare equal hash equal
+		struct VertexHash
+		{
+			size_t operator()(const Vertex& vertex) const;
+		};
+
 		struct Builder
 		{
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
+			VertexLayout layout = VertexLayout::Full;
+
+			// LOD chain settings, every level targets lodReduction of the previous level's triangles and
+			// stops early once the error would exceed lodMaxError (relative to the mesh radius)
+			uint32_t lodCount = 1;
+			float lodReduction = .5f;
+			float lodMaxError = .1f;
+			std::vector<Lod> lods{};
+
+			// Also split LOD 0 into meshlets for cluster culling (see EngineMeshletBuilder)
+			bool meshlets = false;
 
 			void loadModel(const std::string& filepath);
+			void generateLods(const std::string& name);
+		};
+
+		// Everything a model uploads, packed and ready to copy. Built from a Builder on any thread
+		struct Payload
+		{
+			VertexLayout layout = VertexLayout::Full;
+			std::vector<uint8_t> vertexData{};
+			uint32_t vertexCount = 0;
+			std::vector<uint32_t> indices{};
+			std::vector<Lod> lods{};
+			glm::mat4 dequantizeMatrix{ 1.f };
+			glm::vec3 boundingCenter{ 0.f };
+			float boundingRadius = 0.f;
+			std::shared_ptr<const MeshletData> meshlets{};
+
+			VkDeviceSize getUploadSize() const;
 		};
 
+		static Payload createPayload(const Builder& builder);
+
+		// Uploads right away and waits for the copies to finish
 		EngineModel(EngineDevice& device, const EngineModel::Builder& builder);
+
+		// An empty model that isn't resident until a payload is uploaded into it, see EngineAssetManager
+		EngineModel(EngineDevice& device, VertexLayout layout);
+
 		~EngineModel();
 
 		EngineModel(const EngineModel&) = delete;
 		EngineModel& operator=(const EngineModel&) = delete;
 
-		static std::shared_ptr<EngineModel> createModelFromFile(EngineDevice& device, const std::string& filepath);
+		static std::shared_ptr<EngineModel> createModelFromFile(EngineDevice& device, const std::string& filepath, VertexLayout layout = VertexLayout::Full, uint32_t lodCount = 1, bool meshlets = false);
+
+		static uint32_t getVertexStride(VertexLayout layout);
+		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(VertexLayout layout);
+		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexLayout layout);
+		static std::vector<std::pair<std::string, std::string>> getShaderDefines(VertexLayout layout);
+
+		// Creates the GPU buffers and records the copies into them. The staging buffers are appended to
+		// stagingBuffers and must live until commandBuffer completed, after which setResident is called
+		void recordUpload(const Payload& payload, VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<EngineBuffer>>& stagingBuffers);
+		void setResident() { resident = true; }
+
+		// Releases the GPU buffers but keeps bounds and LOD metadata, so the model can still be culled and
+		// asked for again. The buffers go through the device's deletion queue, frames in flight may still
+		// draw the model
+		void evict();
+
+		// Models that aren't resident have no buffers and must not be bound or drawn
+		bool isResident() const { return resident; }
+		VkDeviceSize getMemorySize() const;
+
+		// Frame number the model was last inside the view, for least recently visible eviction
+		void markVisible(uint64_t frameNumber) { lastVisibleFrame = std::max(lastVisibleFrame, frameNumber); }
+		uint64_t getLastVisibleFrame() const { return lastVisibleFrame; }
 
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
+		void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+
+		// Coarsest level whose error projects to at most thresholdPixels. Moving to a coarser level than
+		// currentLod needs the error to fit within (1 - hysteresis) of the threshold, so objects sitting
+		// right at a switching distance don't flicker between two levels
+		uint32_t selectLod(float pixelsPerUnit, uint32_t currentLod, float thresholdPixels, float hysteresis) const;
+
+		uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+		const Lod& getLod(uint32_t lod) const { return lods[lod]; }
+		uint32_t getTriangleCount(uint32_t lod = 0) const { return hasIndexBuffer ? lods[lod].indexCount / 3 : vertexCount / 3; }
+
+		// Model space bounding sphere
+		const glm::vec3& getBoundingCenter() const { return boundingCenter; }
+		float getBoundingRadius() const { return boundingRadius; }
+
+		// Meshlet storage buffers, only present when the model was built with meshlets. The vertex buffer
+		// is then also a storage buffer so mesh shaders can fetch from it
+		bool hasMeshlets() const { return meshletCount > 0; }
+		uint32_t getMeshletCount() const { return meshletCount; }
+		uint32_t getMeshletTriangleCount() const { return meshletTriangleCount; }
+		EngineBuffer& getVertexBuffer() { return *vertexBuffer; }
+		EngineBuffer& getMeshletBuffer() { return *meshletBuffer; }
+		EngineBuffer& getMeshletVertexBuffer() { return *meshletVertexBuffer; }
+		EngineBuffer& getMeshletTriangleBuffer() { return *meshletTriangleBuffer; }
+		EngineBuffer& getMeshletInfoBuffer() { return *meshletInfoBuffer; }
+
+		VertexLayout getVertexLayout() const { return vertexLayout; }
+		uint32_t getVertexCount() const { return vertexCount; }
+		VkDeviceSize getVertexBufferSize() const { return static_cast<VkDeviceSize>(vertexCount) * getVertexStride(vertexLayout); }
+
+		// Maps quantized positions back into model space, fold it into the model matrix
+		const glm::mat4& getDequantizeMatrix() const { return dequantizeMatrix; }
 
 	private:
 		EngineDevice& engDevice;
 
+		VertexLayout vertexLayout;
+		glm::mat4 dequantizeMatrix{ 1.f };
+
+		bool resident = false;
+		uint64_t lastVisibleFrame = 0;
+
 		std::unique_ptr<EngineBuffer> vertexBuffer;
-		uint32_t vertexCount;
+		uint32_t vertexCount = 0;
 
-		bool hasIndexBuffer;
+		bool hasIndexBuffer = false;
 		std::unique_ptr<EngineBuffer> indexBuffer;
-		uint32_t indexCount;
+		uint32_t indexCount = 0;
+		std::vector<Lod> lods;
+
+		glm::vec3 boundingCenter{ 0.f };
+		float boundingRadius = 0.f;
+
+		bool storageVertices = false;
+		uint32_t meshletCount = 0;
+		uint32_t meshletTriangleCount = 0;
+		std::unique_ptr<EngineBuffer> meshletBuffer;
+		std::unique_ptr<EngineBuffer> meshletVertexBuffer;
+		std::unique_ptr<EngineBuffer> meshletTriangleBuffer;
+		std::unique_ptr<EngineBuffer> meshletInfoBuffer;
+
+		static std::vector<uint8_t> packVertices(const std::vector<Vertex>& vertices, VertexLayout layout, glm::mat4& dequantizeMatrix);
 
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
+		// Device local buffer filled from a staging buffer by a copy recorded into commandBuffer
+		std::unique_ptr<EngineBuffer> createDeviceBuffer(const void* data, uint32_t instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage,
+			VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<EngineBuffer>>& stagingBuffers);
 	};
 } // namespace
\ No newline at end of file
@@ -0,0 +1,961 @@
+#include "engineObjParser.h"
+#include "engineFlatHashMap.h"
+#include "engineUtils.h"
+
+// Only the benchmark still loads through tinyobjloader, as the reference the parser is checked against
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace std
+{
+	template<>
+	struct hash<gameEngine::EngineModel::Vertex>
+	{
+		size_t operator()(gameEngine::EngineModel::Vertex const& vertex) const
+		{
+			size_t seed = 0;
+			gameEngine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
+	};
+}
+
+namespace gameEngine
+{
+	using Vertex = EngineModel::Vertex;
+
+	// Read only view of a whole file, unmapped on destruction
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& filepath)
+		{
+#ifdef _WIN32
+			file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+			LARGE_INTEGER fileSize{};
+
+			if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize))
+			{
+				throw std::runtime_error("failed to open file: " + filepath);
+			}
+
+			length = static_cast<size_t>(fileSize.QuadPart);
+
+			if (length > 0)
+			{
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				bytes = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+			}
+#else
+			fd = open(filepath.c_str(), O_RDONLY);
+
+			struct stat fileStat{};
+
+			if (fd < 0 || fstat(fd, &fileStat) != 0)
+			{
+				throw std::runtime_error("failed to open file: " + filepath);
+			}
+
+			length = static_cast<size_t>(fileStat.st_size);
+
+			if (length > 0)
+			{
+				void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				bytes = view == MAP_FAILED ? nullptr : static_cast<const char*>(view);
+
+				if (bytes != nullptr)
+				{
+					madvise(view, length, MADV_SEQUENTIAL);
+				}
+			}
+#endif
+			if (length > 0 && bytes == nullptr)
+			{
+				release();
+				throw std::runtime_error("failed to map file: " + filepath);
+			}
+		}
+
+		~MappedFile() { release(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* data() const { return bytes; }
+		size_t size() const { return length; }
+
+	private:
+		const char* bytes = nullptr;
+		size_t length = 0;
+
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+
+		void release()
+		{
+			if (bytes != nullptr) UnmapViewOfFile(bytes);
+			if (mapping != nullptr) CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+		}
+#else
+		int fd = -1;
+
+		void release()
+		{
+			if (bytes != nullptr) munmap(const_cast<char*>(bytes), length);
+			if (fd >= 0) close(fd);
+		}
+#endif
+	};
+
+	// Runs body(0) .. body(count - 1) on their own threads, rethrowing the first exception
+	static void parallelFor(uint32_t count, const std::function<void(uint32_t)>& body)
+	{
+		if (count == 1)
+		{
+			body(0);
+			return;
+		}
+
+		std::vector<std::future<void>> tasks{};
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			tasks.push_back(std::async(std::launch::async, body, i));
+		}
+
+		for (auto& task : tasks)
+		{
+			task.get();
+		}
+	}
+
+	// --- Number parsing. Eight bytes are classified and converted at once (SWAR), what remains follows
+	// tinyobjloader's tryParseDouble step by step so every float rounds exactly as before
+
+	static inline uint32_t countTrailingZeros(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	static inline uint64_t load8(const char* p)
+	{
+		uint64_t chunk;
+		std::memcpy(&chunk, p, sizeof(chunk));
+		return chunk;
+	}
+
+	// Number of leading ASCII digits in the eight characters of chunk (little endian)
+	static inline uint32_t leadingDigits(uint64_t chunk)
+	{
+		uint64_t t = chunk ^ 0x3030303030303030ull;
+		uint64_t nonDigit = (((t & 0x7f7f7f7f7f7f7f7full) + 0x7676767676767676ull) | t) & 0x8080808080808080ull;
+		return nonDigit == 0 ? 8 : countTrailingZeros(nonDigit) / 8;
+	}
+
+	// Value of the first count (1 to 8) digits of chunk
+	static inline uint64_t convertDigits(uint64_t chunk, uint32_t count)
+	{
+		uint64_t t = ((chunk ^ 0x3030303030303030ull) << (8 * (8 - count)));
+		t = (t * 10 + (t >> 8)) & 0x00ff00ff00ff00ffull;
+		t = (t * (1 + (100ull << 16)) >> 16) & 0x0000ffff0000ffffull;
+		return (t * (1 + (10000ull << 32))) >> 32;
+	}
+
+	static inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+	static const uint64_t POWERS_OF_TEN[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+	// Reads up to maxDigits decimal digits into value, returning how many there were
+	static inline uint32_t readDigits(const char*& p, const char* end, uint64_t& value, uint32_t maxDigits)
+	{
+		uint32_t total = 0;
+
+		while (total + 8 <= maxDigits && end - p >= 8)
+		{
+			uint32_t count = leadingDigits(load8(p));
+			if (count == 0) return total;
+
+			value = value * POWERS_OF_TEN[count] + convertDigits(load8(p), count);
+			p += count;
+			total += count;
+
+			if (count < 8) return total;
+		}
+
+		while (total < maxDigits && p < end && isDigit(*p))
+		{
+			value = value * 10 + static_cast<uint64_t>(*p - '0');
+			p++;
+			total++;
+		}
+
+		return total;
+	}
+
+	// Same grammar and arithmetic as tinyobj::tryParseDouble, trailing characters are ignored
+	static bool parseDouble(const char* p, const char* end, double& result)
+	{
+		static const double POW_LUT[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+		static const int LUT_ENTRIES = sizeof(POW_LUT) / sizeof(POW_LUT[0]);
+
+		if (p >= end) return false;
+
+		char sign = '+';
+		bool leadingDot = false;
+
+		if (*p == '+' || *p == '-')
+		{
+			sign = *p++;
+			leadingDot = p != end && *p == '.';
+		}
+		else if (*p == '.')
+		{
+			leadingDot = true;
+		}
+		else if (!isDigit(*p))
+		{
+			return false;
+		}
+
+		double mantissa = 0.0;
+		int exponent = 0;
+
+		if (!leadingDot)
+		{
+			// Integers up to 15 digits are exact in a double, accumulating them as integers changes nothing
+			uint64_t integer = 0;
+			uint32_t read = readDigits(p, end, integer, 15);
+			if (read == 0) return false;
+
+			mantissa = static_cast<double>(integer);
+
+			while (p < end && isDigit(*p))
+			{
+				mantissa = mantissa * 10 + static_cast<int>(*p++ - '0');
+			}
+		}
+
+		if (p < end && *p == '.')
+		{
+			p++;
+
+			for (int read = 1; p < end && isDigit(*p); read++, p++)
+			{
+				mantissa += static_cast<int>(*p - '0') * (read < LUT_ENTRIES ? POW_LUT[read] : std::pow(10.0, -read));
+			}
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			char exponentSign = '+';
+
+			if (p < end && (*p == '+' || *p == '-'))
+			{
+				exponentSign = *p++;
+			}
+			else if (p >= end || !isDigit(*p))
+			{
+				return false;
+			}
+
+			int read = 0;
+
+			for (; p < end && isDigit(*p); read++, p++)
+			{
+				if (exponent > std::numeric_limits<int>::max() / 10) return false;
+				exponent = exponent * 10 + static_cast<int>(*p - '0');
+			}
+
+			if (read == 0) return false;
+			exponent *= exponentSign == '+' ? 1 : -1;
+		}
+
+		result = (sign == '+' ? 1 : -1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	}
+
+	static inline bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+	static inline const char* skipBlanks(const char* p, const char* end)
+	{
+		while (p < end && isBlank(*p)) p++;
+		return p;
+	}
+
+	// Next whitespace separated float of the line, false (and p past the token) when it doesn't parse
+	static inline bool parseFloat(const char*& p, const char* end, float& out)
+	{
+		p = skipBlanks(p, end);
+		const char* tokenEnd = p;
+		while (tokenEnd < end && !isBlank(*tokenEnd) && *tokenEnd != '\r') tokenEnd++;
+
+		double value;
+		bool parsed = parseDouble(p, tokenEnd, value);
+		if (parsed) out = static_cast<float>(value);
+
+		p = tokenEnd;
+		return parsed;
+	}
+
+	// atoi, which is what tinyobjloader reads face indices with
+	static inline int32_t parseInt(const char* p, const char* end)
+	{
+		p = skipBlanks(p, end);
+		bool negative = false;
+
+		if (p < end && (*p == '+' || *p == '-'))
+		{
+			negative = *p++ == '-';
+		}
+
+		uint64_t value = 0;
+		readDigits(p, end, value, 10);
+
+		return static_cast<int32_t>(negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value));
+	}
+
+	// --- Chunk parsing
+
+	struct Corner
+	{
+		int32_t position = -1;
+		int32_t uv = -1;
+		int32_t normal = -1;
+	};
+
+	struct ObjChunk
+	{
+		std::vector<glm::vec3> positions{};
+		std::vector<glm::vec3> colors{};
+		std::vector<glm::vec3> normals{};
+		std::vector<glm::vec2> uvs{};
+		std::vector<Corner> corners{};		// triangulated, three per triangle
+		std::vector<size_t> relative{};		// int32_t slots of corners holding negative indices, still without the chunk's base
+	};
+
+	// One index of a face corner. Positive indices are global and one based, negative ones count back
+	// from the elements this chunk has seen so far and get the elements of earlier chunks added later
+	static bool resolveIndex(int32_t index, size_t localCount, int32_t& out, bool& relative)
+	{
+		if (index == 0) return false;
+
+		relative = index < 0;
+		out = relative ? static_cast<int32_t>(localCount) + index : index - 1;
+		return true;
+	}
+
+	static void parseFace(const char* p, const char* end, ObjChunk& chunk, std::vector<Corner>& face, std::vector<uint8_t>& faceRelative)
+	{
+		face.clear();
+		faceRelative.clear();
+
+		// Reads one index of the corner at p, flagging it in relativeMask when it still needs the chunk's base
+		auto readIndex = [&](size_t localCount, int32_t& out, uint8_t& relativeMask, uint8_t flag)
+			{
+				bool relative = false;
+
+				if (!resolveIndex(parseInt(p, end), localCount, out, relative))
+				{
+					throw std::runtime_error("invalid face index");
+				}
+
+				relativeMask |= relative ? flag : 0;
+				while (p < end && *p != '/' && !isBlank(*p) && *p != '\r') p++;
+			};
+
+		// v, v/t, v//n or v/t/n
+		while (p < end && *p != '\r')
+		{
+			Corner corner{};
+			uint8_t relativeMask = 0;
+
+			readIndex(chunk.positions.size(), corner.position, relativeMask, 1);
+
+			if (p < end && *p == '/')
+			{
+				p++;
+
+				if (p < end && *p == '/')
+				{
+					p++;
+					readIndex(chunk.normals.size(), corner.normal, relativeMask, 4);
+				}
+				else
+				{
+					readIndex(chunk.uvs.size(), corner.uv, relativeMask, 2);
+
+					if (p < end && *p == '/')
+					{
+						p++;
+						readIndex(chunk.normals.size(), corner.normal, relativeMask, 4);
+					}
+				}
+			}
+
+			face.push_back(corner);
+			faceRelative.push_back(relativeMask);
+
+			while (p < end && (isBlank(*p) || *p == '\r')) p++;
+		}
+
+		if (face.size() < 3) return;
+
+		// Triangle fan, as tinyobjloader triangulates
+		for (size_t k = 2; k < face.size(); k++)
+		{
+			size_t fan[3] = { 0, k - 1, k };
+
+			for (size_t c : fan)
+			{
+				for (int component = 0; component < 3; component++)
+				{
+					if (faceRelative[c] & (1 << component))
+					{
+						chunk.relative.push_back(chunk.corners.size() * 3 + component);
+					}
+				}
+
+				chunk.corners.push_back(face[c]);
+			}
+		}
+	}
+
+	static void parseChunk(const char* begin, const char* end, ObjChunk& chunk)
+	{
+		std::vector<Corner> face{};
+		std::vector<uint8_t> faceRelative{};
+
+		for (const char* line = begin; line < end;)
+		{
+			const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', end - line));
+			if (lineEnd == nullptr) lineEnd = end;
+
+			const char* p = skipBlanks(line, lineEnd);
+			line = lineEnd + 1;
+
+			if (lineEnd - p < 2 || p[0] == '#') continue;
+
+			if (p[0] == 'v' && isBlank(p[1]))
+			{
+				p += 2;
+				glm::vec3 position{ 0.f };
+				parseFloat(p, lineEnd, position.x);
+				parseFloat(p, lineEnd, position.y);
+				parseFloat(p, lineEnd, position.z);
+
+				// A color needs all three components, anything less (say a w) leaves the vertex white
+				glm::vec3 color{ 1.f };
+
+				if (!parseFloat(p, lineEnd, color.r) || !parseFloat(p, lineEnd, color.g) || !parseFloat(p, lineEnd, color.b))
+				{
+					color = glm::vec3{ 1.f };
+				}
+
+				chunk.positions.push_back(position);
+				chunk.colors.push_back(color);
+			}
+			else if (p[0] == 'v' && p[1] == 'n' && lineEnd - p > 2 && isBlank(p[2]))
+			{
+				p += 3;
+				glm::vec3 normal{ 0.f };
+				parseFloat(p, lineEnd, normal.x);
+				parseFloat(p, lineEnd, normal.y);
+				parseFloat(p, lineEnd, normal.z);
+				chunk.normals.push_back(normal);
+			}
+			else if (p[0] == 'v' && p[1] == 't' && lineEnd - p > 2 && isBlank(p[2]))
+			{
+				p += 3;
+				glm::vec2 uv{ 0.f };
+				parseFloat(p, lineEnd, uv.x);
+				parseFloat(p, lineEnd, uv.y);
+				chunk.uvs.push_back(uv);
+			}
+			else if (p[0] == 'f' && isBlank(p[1]))
+			{
+				parseFace(skipBlanks(p + 2, lineEnd), lineEnd, chunk, face, faceRelative);
+			}
+		}
+	}
+
+	// --- Vertex deduplication. Corners are hashed in parallel and sharded by hash, each shard finds the
+	// first corner equal to each of its corners on its own thread. Numbering those first corners in file
+	// order then gives exactly the indices a sequential hash map would have
+
+	static void deduplicate(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t threadCount)
+	{
+		const uint32_t cornerCount = static_cast<uint32_t>(corners.size());
+		const uint32_t shardCount = threadCount * 4;
+
+		// The shard is picked from bits the hash map neither indexes nor tags with, which would otherwise
+		// be the same for every entry of a shard
+		auto shardOf = [shardCount](size_t hash) { return static_cast<uint32_t>((hash >> 32) % shardCount); };
+
+		EngineModel::VertexHash hasher{};
+		std::vector<size_t> hashes(cornerCount);
+		std::vector<uint32_t> shardSizes(static_cast<size_t>(threadCount) * shardCount, 0);
+
+		auto rangeBegin = [&](uint32_t thread) { return static_cast<uint32_t>(static_cast<uint64_t>(cornerCount) * thread / threadCount); };
+
+		parallelFor(threadCount, [&](uint32_t thread)
+			{
+				for (uint32_t i = rangeBegin(thread); i < rangeBegin(thread + 1); i++)
+				{
+					hashes[i] = hasher(corners[i]);
+					shardSizes[static_cast<size_t>(thread) * shardCount + shardOf(hashes[i])]++;
+				}
+			});
+
+		// Shard major, thread minor offsets keep every shard's corners in file order
+		std::vector<uint32_t> shardBegin(shardCount + 1, 0);
+		std::vector<uint32_t> scatterOffsets(shardSizes.size(), 0);
+		uint32_t offset = 0;
+
+		for (uint32_t shard = 0; shard < shardCount; shard++)
+		{
+			shardBegin[shard] = offset;
+
+			for (uint32_t thread = 0; thread < threadCount; thread++)
+			{
+				scatterOffsets[static_cast<size_t>(thread) * shardCount + shard] = offset;
+				offset += shardSizes[static_cast<size_t>(thread) * shardCount + shard];
+			}
+		}
+
+		shardBegin[shardCount] = offset;
+		std::vector<uint32_t> sharded(cornerCount);
+
+		parallelFor(threadCount, [&](uint32_t thread)
+			{
+				uint32_t* threadOffsets = &scatterOffsets[static_cast<size_t>(thread) * shardCount];
+
+				for (uint32_t i = rangeBegin(thread); i < rangeBegin(thread + 1); i++)
+				{
+					sharded[threadOffsets[shardOf(hashes[i])]++] = i;
+				}
+			});
+
+		// firstEqual[i] is the first corner with the same vertex as corner i
+		std::vector<uint32_t> firstEqual(cornerCount);
+
+		parallelFor(threadCount, [&](uint32_t thread)
+			{
+				for (uint32_t shard = thread; shard < shardCount; shard += threadCount)
+				{
+					EngineFlatHashMap<Vertex, uint32_t, EngineModel::VertexHash> seen{ shardBegin[shard + 1] - shardBegin[shard] };
+
+					for (uint32_t s = shardBegin[shard]; s < shardBegin[shard + 1]; s++)
+					{
+						uint32_t corner = sharded[s];
+						firstEqual[corner] = *seen.insert(corners[corner], corner, hashes[corner]).first;
+					}
+				}
+			});
+
+		vertices.clear();
+		indices.resize(cornerCount);
+
+		for (uint32_t i = 0; i < cornerCount; i++)
+		{
+			if (firstEqual[i] == i)
+			{
+				indices[i] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(corners[i]);
+			}
+			else
+			{
+				indices[i] = indices[firstEqual[i]];
+			}
+		}
+	}
+
+	void EngineObjParser::parse(const std::string& filepath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, uint32_t threadCount)
+	{
+		MappedFile file{ filepath };
+		const char* data = file.data();
+		const size_t size = file.size();
+
+		if (threadCount == 0)
+		{
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		uint32_t chunkCount = static_cast<uint32_t>(std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, threadCount));
+
+		// Chunks start right after a line break so no line is split
+		std::vector<const char*> chunkBegin(chunkCount + 1, data + size);
+		chunkBegin[0] = data;
+
+		for (uint32_t i = 1; i < chunkCount; i++)
+		{
+			const char* guess = data + size / chunkCount * i;
+			const char* lineBreak = static_cast<const char*>(std::memchr(guess, '\n', data + size - guess));
+			chunkBegin[i] = lineBreak ? std::max(lineBreak + 1, chunkBegin[i - 1]) : data + size;
+		}
+
+		std::vector<ObjChunk> chunks(chunkCount);
+
+		try
+		{
+			parallelFor(chunkCount, [&](uint32_t i) { parseChunk(chunkBegin[i], chunkBegin[i + 1], chunks[i]); });
+		}
+		catch (const std::runtime_error& e)
+		{
+			throw std::runtime_error(filepath + ": " + e.what());
+		}
+
+		// Element counts of all earlier chunks
+		struct ChunkBase
+		{
+			size_t positions = 0;
+			size_t normals = 0;
+			size_t uvs = 0;
+			size_t corners = 0;
+		};
+
+		std::vector<ChunkBase> bases(chunkCount + 1);
+
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			bases[i + 1].positions = bases[i].positions + chunks[i].positions.size();
+			bases[i + 1].normals = bases[i].normals + chunks[i].normals.size();
+			bases[i + 1].uvs = bases[i].uvs + chunks[i].uvs.size();
+			bases[i + 1].corners = bases[i].corners + chunks[i].corners.size();
+		}
+
+		const ChunkBase& totals = bases[chunkCount];
+
+		if (totals.corners > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::runtime_error(filepath + ": too many face corners");
+		}
+
+		std::vector<glm::vec3> positions(totals.positions);
+		std::vector<glm::vec3> colors(totals.positions);
+		std::vector<glm::vec3> normals(totals.normals);
+		std::vector<glm::vec2> uvs(totals.uvs);
+
+		parallelFor(chunkCount, [&](uint32_t i)
+			{
+				std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + bases[i].positions);
+				std::copy(chunks[i].colors.begin(), chunks[i].colors.end(), colors.begin() + bases[i].positions);
+				std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normals.begin() + bases[i].normals);
+				std::copy(chunks[i].uvs.begin(), chunks[i].uvs.end(), uvs.begin() + bases[i].uvs);
+
+				std::vector<glm::vec3>().swap(chunks[i].positions);
+				std::vector<glm::vec3>().swap(chunks[i].colors);
+				std::vector<glm::vec3>().swap(chunks[i].normals);
+				std::vector<glm::vec2>().swap(chunks[i].uvs);
+			});
+
+		std::vector<Vertex> corners(totals.corners);
+
+		try
+		{
+			parallelFor(chunkCount, [&](uint32_t i)
+				{
+					auto& chunk = chunks[i];
+
+					const size_t base[3] = { bases[i].positions, bases[i].uvs, bases[i].normals };
+
+					for (size_t slot : chunk.relative)
+					{
+						Corner& corner = chunk.corners[slot / 3];
+						int32_t& index = slot % 3 == 0 ? corner.position : slot % 3 == 1 ? corner.uv : corner.normal;
+						index += static_cast<int32_t>(base[slot % 3]);
+
+						if (index < 0)
+						{
+							throw std::runtime_error("face index out of range");
+						}
+					}
+
+					for (size_t c = 0; c < chunk.corners.size(); c++)
+					{
+						const Corner& corner = chunk.corners[c];
+						Vertex& vertex = corners[bases[i].corners + c];
+
+						// -1 marks an absent uv or normal, every other index is resolved and non negative by now
+						if (corner.position < 0 || corner.position >= static_cast<int64_t>(positions.size()) ||
+							corner.normal >= static_cast<int64_t>(normals.size()) || corner.uv >= static_cast<int64_t>(uvs.size()))
+						{
+							throw std::runtime_error("face index out of range");
+						}
+
+						vertex.position = positions[corner.position];
+						vertex.color = colors[corner.position];
+						if (corner.normal >= 0) vertex.normal = normals[corner.normal];
+						if (corner.uv >= 0) vertex.uv = uvs[corner.uv];
+					}
+
+					std::vector<Corner>().swap(chunk.corners);
+				});
+		}
+		catch (const std::runtime_error& e)
+		{
+			throw std::runtime_error(filepath + ": " + e.what());
+		}
+
+		// Small files aren't worth the threads in the dedup either
+		deduplicate(corners, vertices, indices, chunkCount);
+	}
+
+	// The loading path this parser replaced
+	static void loadReference(const std::string& filepath, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str()))
+		{
+			throw std::runtime_error(warn + err);
+		}
+
+		vertices.clear();
+		indices.clear();
+
+		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+		for (const auto& shape : shapes)
+		{
+			for (const auto& index : shape.mesh.indices)
+			{
+				Vertex vertex{};
+
+				if (index.vertex_index >= 0)
+				{
+					vertex.position = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2] };
+					vertex.color = { attrib.colors[3 * index.vertex_index + 0], attrib.colors[3 * index.vertex_index + 1], attrib.colors[3 * index.vertex_index + 2] };
+				}
+
+				if (index.normal_index >= 0)
+				{
+					vertex.normal = { attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2] };
+				}
+
+				if (index.texcoord_index >= 0)
+				{
+					vertex.uv = { attrib.texcoords[2 * index.texcoord_index + 0], attrib.texcoords[2 * index.texcoord_index + 1] };
+				}
+
+				auto inserted = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(vertices.size()));
+
+				if (inserted.second)
+				{
+					vertices.push_back(vertex);
+				}
+
+				indices.push_back(inserted.first->second);
+			}
+		}
+	}
+
+	void EngineObjParser::benchmark(const std::string& filepath, uint32_t iterations)
+	{
+		using Loader = std::function<void(std::vector<Vertex>&, std::vector<uint32_t>&)>;
+
+		const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		const double megabytes = MappedFile{ filepath }.size() / (1024.0 * 1024.0);
+
+		std::vector<std::pair<std::string, Loader>> loaders
+		{
+			{ "tinyobjloader", [&](auto& v, auto& i) { loadReference(filepath, v, i); } },
+			{ "parallel, 1 thread", [&](auto& v, auto& i) { parse(filepath, v, i, 1); } },
+			{ "parallel, " + std::to_string(hardwareThreads) + " threads", [&](auto& v, auto& i) { parse(filepath, v, i, hardwareThreads); } },
+		};
+
+		std::cout << filepath << ": " << megabytes << " MB, " << iterations << " iterations" << std::endl;
+
+		std::vector<Vertex> referenceVertices{};
+		std::vector<uint32_t> referenceIndices{};
+
+		for (size_t l = 0; l < loaders.size(); l++)
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			double bestSeconds = std::numeric_limits<double>::max();
+
+			for (uint32_t i = 0; i < std::max(1u, iterations); i++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				loaders[l].second(vertices, indices);
+				auto stop = std::chrono::high_resolution_clock::now();
+
+				bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(stop - start).count());
+			}
+
+			std::cout << "  " << loaders[l].first << ": " << bestSeconds * 1000.0 << " ms, " << megabytes / bestSeconds << " MB/s, "
+				<< vertices.size() << " vertices, " << indices.size() / 3 << " triangles";
+
+			if (l == 0)
+			{
+				referenceVertices = std::move(vertices);
+				referenceIndices = std::move(indices);
+			}
+			else
+			{
+				std::cout << (vertices == referenceVertices && indices == referenceIndices ? ", matches" : ", MISMATCH");
+			}
+
+			std::cout << std::endl;
+		}
+	}
+
+	// Sequential welding of a corner stream, the way loadModel did it and with the flat map
+	static void weldUnordered(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+
+		for (const auto& vertex : corners)
+		{
+			if (uniqueVertices.count(vertex) == 0)
+			{
+				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+			}
+
+			indices.push_back(uniqueVertices[vertex]);
+		}
+	}
+
+	static void weldFlat(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		EngineFlatHashMap<Vertex, uint32_t, EngineModel::VertexHash> uniqueVertices{};
+
+		for (const auto& vertex : corners)
+		{
+			auto inserted = uniqueVertices.insert(vertex, static_cast<uint32_t>(vertices.size()));
+
+			if (inserted.second)
+			{
+				vertices.push_back(vertex);
+			}
+
+			indices.push_back(*inserted.first);
+		}
+	}
+
+	void EngineObjParser::benchmarkWelding(const std::vector<std::string>& filepaths, size_t syntheticIndexCount, uint32_t iterations)
+	{
+		std::vector<std::pair<std::string, std::vector<Vertex>>> meshes{};
+
+		for (auto& filepath : filepaths)
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			parse(filepath, vertices, indices);
+
+			std::vector<Vertex> corners{};
+			corners.reserve(indices.size());
+			for (uint32_t index : indices) corners.push_back(vertices[index]);
+
+			meshes.push_back({ filepath, std::move(corners) });
+		}
+
+		// Two triangles per grid cell, every inner vertex shared by six of them
+		if (syntheticIndexCount > 0)
+		{
+			uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(syntheticIndexCount / 6.0)));
+			std::vector<Vertex> corners{};
+			corners.reserve(static_cast<size_t>(side) * side * 6);
+
+			auto gridVertex = [side](uint32_t x, uint32_t z)
+				{
+					Vertex vertex{};
+					vertex.position = { static_cast<float>(x), 0.f, static_cast<float>(z) };
+					vertex.color = glm::vec3{ 1.f };
+					vertex.normal = { 0.f, 1.f, 0.f };
+					vertex.uv = { static_cast<float>(x) / side, static_cast<float>(z) / side };
+					return vertex;
+				};
+
+			for (uint32_t z = 0; z < side && corners.size() < syntheticIndexCount; z++)
+			{
+				for (uint32_t x = 0; x < side && corners.size() < syntheticIndexCount; x++)
+				{
+					for (auto corner : { std::make_pair(0, 0), std::make_pair(0, 1), std::make_pair(1, 1), std::make_pair(0, 0), std::make_pair(1, 1), std::make_pair(1, 0) })
+					{
+						corners.push_back(gridVertex(x + corner.first, z + corner.second));
+					}
+				}
+			}
+
+			meshes.push_back({ "synthetic grid", std::move(corners) });
+		}
+
+		using Welder = void(*)(const std::vector<Vertex>&, std::vector<Vertex>&, std::vector<uint32_t>&);
+
+		auto timeWelder = [iterations](Welder welder, const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+			{
+				double bestSeconds = std::numeric_limits<double>::max();
+
+				for (uint32_t i = 0; i < std::max(1u, iterations); i++)
+				{
+					vertices.clear();
+					indices.clear();
+
+					auto start = std::chrono::high_resolution_clock::now();
+					welder(corners, vertices, indices);
+					auto stop = std::chrono::high_resolution_clock::now();
+
+					bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(stop - start).count());
+				}
+
+				return bestSeconds;
+			};
+
+		for (auto& mesh : meshes)
+		{
+			std::vector<Vertex> referenceVertices{}, vertices{};
+			std::vector<uint32_t> referenceIndices{}, indices{};
+
+			double unorderedSeconds = timeWelder(weldUnordered, mesh.second, referenceVertices, referenceIndices);
+			double flatSeconds = timeWelder(weldFlat, mesh.second, vertices, indices);
+			double millions = mesh.second.size() / 1e6;
+
+			std::cout << mesh.first << ": " << mesh.second.size() << " indices, " << referenceVertices.size() << " unique vertices" << std::endl
+				<< "  unordered_map: " << unorderedSeconds * 1000.0 << " ms, " << millions / unorderedSeconds << " M indices/s" << std::endl
+				<< "  flat map: " << flatSeconds * 1000.0 << " ms, " << millions / flatSeconds << " M indices/s, "
+				<< unorderedSeconds / flatSeconds << "x" << (vertices == referenceVertices && indices == referenceIndices ? ", matches" : ", MISMATCH")
+				<< std::endl;
+		}
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "engineModel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Wavefront OBJ loader for large assets. The file is memory mapped and split into chunks at line
+	// boundaries, every chunk is parsed on its own thread and the corners are then deduplicated into an
+	// indexed triangle list, sharded by hash across threads. Only v, vt, vn and f are read, polygons are
+	// fan triangulated. The result is identical to what tinyobjloader plus a per corner hash map produced:
+	// same float rounding, vertices numbered in first use order, colors default to white
+	class EngineObjParser
+	{
+	public:
+		// Files smaller than this per thread are parsed with fewer threads
+		static constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+		// threadCount 0 uses every hardware thread
+		static void parse(const std::string& filepath, std::vector<EngineModel::Vertex>& vertices, std::vector<uint32_t>& indices,
+			uint32_t threadCount = 0);
+
+		// Loads filepath with tinyobjloader and with parse (single threaded and on every hardware thread),
+		// prints MB/s of each and checks that all of them agree
+		static void benchmark(const std::string& filepath, uint32_t iterations);
+
+		// Welds the corners of each file and of a synthetic grid of syntheticIndexCount indices, once with
+		// the std::unordered_map the loader used to weld with and once with EngineFlatHashMap
+		static void benchmarkWelding(const std::vector<std::string>& filepaths, size_t syntheticIndexCount, uint32_t iterations);
+	};
+} // namespace
\ No newline at end of file
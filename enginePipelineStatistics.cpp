@@ -0,0 +1,62 @@
+#include "enginePipelineStatistics.h"
+
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	EnginePipelineStatistics::EnginePipelineStatistics(EngineDevice& device, uint32_t frameCount) : device{ device }, pending(frameCount, false)
+	{
+		if (!device.supportsPipelineStatistics()) return;
+
+		VkQueryPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolInfo.queryCount = frameCount;
+		poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+		if (vkCreateQueryPool(device.getDevice(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline statistics query pool!");
+		}
+	}
+
+	EnginePipelineStatistics::~EnginePipelineStatistics()
+	{
+		if (queryPool == VK_NULL_HANDLE) return;
+
+		device.deferDestruction([&device = device, queryPool = queryPool]() { vkDestroyQueryPool(device.getDevice(), queryPool, nullptr); });
+	}
+
+	void EnginePipelineStatistics::begin(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+	{
+		if (queryPool == VK_NULL_HANDLE) return;
+
+		if (pending[frameIndex])
+		{
+			uint64_t fragmentInvocations = 0;
+
+			// No wait flag, the frame completed. A frame that was never submitted reports not ready
+			if (vkGetQueryPoolResults(device.getDevice(), queryPool, frameIndex, 1, sizeof(fragmentInvocations), &fragmentInvocations,
+				sizeof(fragmentInvocations), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+			{
+				lastFragmentInvocations = fragmentInvocations;
+				totalFragmentInvocations += fragmentInvocations;
+				frameCount++;
+			}
+
+			pending[frameIndex] = false;
+		}
+
+		vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex, 1);
+		vkCmdBeginQuery(commandBuffer, queryPool, frameIndex, 0);
+	}
+
+	void EnginePipelineStatistics::end(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+	{
+		if (queryPool == VK_NULL_HANDLE) return;
+
+		vkCmdEndQuery(commandBuffer, queryPool, frameIndex);
+		pending[frameIndex] = true;
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "engineDevice.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Counts the fragment shader invocations of whole frames, one pipeline statistics query per frame in
+	// flight. A query is read back when its frame slot comes around again, so results lag a few frames
+	// behind. Does nothing on devices without the pipelineStatisticsQuery feature
+	class EnginePipelineStatistics
+	{
+	public:
+		EnginePipelineStatistics(EngineDevice& device, uint32_t frameCount);
+		~EnginePipelineStatistics();
+
+		EnginePipelineStatistics(const EnginePipelineStatistics&) = delete;
+		EnginePipelineStatistics& operator=(const EnginePipelineStatistics&) = delete;
+
+		bool isSupported() const { return queryPool != VK_NULL_HANDLE; }
+
+		// Record both outside of render passes. The slot's previous frame must have completed, as it has
+		// after EngineRenderer::beginFrame
+		void begin(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+		void end(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+		// Of the latest frame read back, 0 until there is one
+		uint64_t getFragmentInvocations() const { return lastFragmentInvocations; }
+		uint32_t getFrameCount() const { return frameCount; }
+		uint64_t getTotalFragmentInvocations() const { return totalFragmentInvocations; }
+
+	private:
+		EngineDevice& device;
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<bool> pending;
+
+		uint64_t lastFragmentInvocations = 0;
+		uint64_t totalFragmentInvocations = 0;
+		uint32_t frameCount = 0;
+	};
+} // namespace
\ No newline at end of file
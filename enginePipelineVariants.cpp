@@ -0,0 +1,143 @@
+#include "enginePipelineVariants.h"
+#include "engineUtils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	static VkShaderStageFlagBits stageFromPath(std::string filepath)
+	{
+		const std::string spirvExtension = ".spv";
+
+		if (filepath.size() > spirvExtension.size() && filepath.compare(filepath.size() - spirvExtension.size(), spirvExtension.size(), spirvExtension) == 0)
+		{
+			filepath.resize(filepath.size() - spirvExtension.size());
+		}
+
+		std::string extension = std::filesystem::path(filepath).extension().string();
+
+		if (extension == ".vert") return VK_SHADER_STAGE_VERTEX_BIT;
+		if (extension == ".frag") return VK_SHADER_STAGE_FRAGMENT_BIT;
+		if (extension == ".task") return VK_SHADER_STAGE_TASK_BIT_EXT;
+		if (extension == ".mesh") return VK_SHADER_STAGE_MESH_BIT_EXT;
+
+		throw std::runtime_error("unknown graphics shader stage for " + filepath);
+	}
+
+	static std::vector<uint32_t> readSpirvFile(const std::string& filepath)
+	{
+		std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+
+		if (!file.is_open())
+		{
+			throw std::runtime_error("failed to open file: " + filepath);
+		}
+
+		std::vector<uint32_t> spirv(static_cast<size_t>(file.tellg()) / sizeof(uint32_t));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+
+		return spirv;
+	}
+
+	EnginePipelineVariants::EnginePipelineVariants(EngineDevice& device, EngineShaderCompiler& compiler, const std::string& vertFilepath, const std::string& fragFilepath, ConfigureFn configure)
+		: EnginePipelineVariants{ device, compiler, std::vector<std::string>{ vertFilepath, fragFilepath }, std::move(configure) }
+	{
+	}
+
+	EnginePipelineVariants::EnginePipelineVariants(EngineDevice& device, EngineShaderCompiler& compiler, std::vector<std::string> shaderFilepaths, ConfigureFn configure)
+		: engDevice{ device }, compiler{ compiler }, shaderFilepaths{ std::move(shaderFilepaths) }, configure{ std::move(configure) }
+	{
+		// Listeners run from EngineShaderCompiler::pollChanges at the top of the frame, after the previous
+		// frame has been waited on, so dropping the pipelines here is safe
+		for (auto& filepath : this->shaderFilepaths)
+		{
+			if (EngineShaderCompiler::isGlslSource(filepath))
+			{
+				watchIds.push_back(compiler.watch(filepath, [this]() { clear(); }));
+			}
+		}
+	}
+
+	EnginePipelineVariants::~EnginePipelineVariants()
+	{
+		for (auto watchId : watchIds)
+		{
+			compiler.unwatch(watchId);
+		}
+	}
+
+	EngPipeline& EnginePipelineVariants::get(const ShaderVariant& variant)
+	{
+		auto it = pipelines.find(variant);
+
+		if (it != pipelines.end())
+		{
+			return *it->second;
+		}
+
+		PipelineConfigInfo pipelineConfig{};
+		EngPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		configure(pipelineConfig);
+		pipelineConfig.variant = variant;
+
+		if (verboseOutput)
+		{
+			std::cout << "Building pipeline variant " << std::hex << variant.hash() << std::dec
+				<< " of " << shaderFilepaths.back() << " (" << pipelines.size() + 1 << " variants)" << std::endl;
+		}
+
+		// Kick off every GLSL stage before waiting on any of them
+		std::vector<EngineShaderCompiler::ResultFuture> compiles(shaderFilepaths.size());
+
+		for (size_t i = 0; i < shaderFilepaths.size(); i++)
+		{
+			if (EngineShaderCompiler::isGlslSource(shaderFilepaths[i]))
+			{
+				compiles[i] = compiler.compileAsync(shaderFilepaths[i], variant.defines);
+			}
+		}
+
+		std::vector<ShaderStageSpirv> stages{};
+		std::string log;
+
+		for (size_t i = 0; i < shaderFilepaths.size(); i++)
+		{
+			ShaderStageSpirv stage{ stageFromPath(shaderFilepaths[i]), {} };
+
+			if (compiles[i].valid())
+			{
+				auto result = compiles[i].get();
+				log += result.log;
+
+				if (!result.success)
+				{
+					continue;
+				}
+
+				stage.spirv = std::move(result.spirv);
+			}
+			else
+			{
+				stage.spirv = readSpirvFile(shaderFilepaths[i]);
+			}
+
+			stages.push_back(std::move(stage));
+		}
+
+		if (stages.size() != shaderFilepaths.size())
+		{
+			throw std::runtime_error("failed to compile pipeline shaders:\n" + log);
+		}
+
+		auto pipeline = std::make_unique<EngPipeline>(engDevice, stages, pipelineConfig);
+
+		auto& result = *pipeline;
+		pipelines.emplace(variant, std::move(pipeline));
+		return result;
+	}
+} // namespace
\ No newline at end of file
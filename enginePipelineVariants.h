@@ -0,0 +1,48 @@
+#pragma once
+
+#include "engPipeline.h"
+#include "engineDevice.h"
+#include "engineShaderCompiler.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Lazily built family of pipelines sharing shaders and fixed function state, differing only in their
+	// specialization constants and defines. A variant is compiled the first time something asks for it, so
+	// only the combinations scenes actually use ever get built. GLSL sources are compiled at runtime and
+	// watched, editing one drops every variant so they are rebuilt from the new source
+	class EnginePipelineVariants
+	{
+	public:
+		using ConfigureFn = std::function<void(PipelineConfigInfo&)>;
+
+		EnginePipelineVariants(EngineDevice& device, EngineShaderCompiler& compiler, const std::string& vertFilepath, const std::string& fragFilepath, ConfigureFn configure);
+
+		// One file per stage, the stage comes from the extension (shader.mesh or shader.mesh.spv)
+		EnginePipelineVariants(EngineDevice& device, EngineShaderCompiler& compiler, std::vector<std::string> shaderFilepaths, ConfigureFn configure);
+		~EnginePipelineVariants();
+
+		EnginePipelineVariants(const EnginePipelineVariants&) = delete;
+		EnginePipelineVariants& operator=(const EnginePipelineVariants&) = delete;
+
+		EngPipeline& get(const ShaderVariant& variant);
+
+		void clear() { pipelines.clear(); }
+		size_t size() const { return pipelines.size(); }
+
+	private:
+		EngineDevice& engDevice;
+		EngineShaderCompiler& compiler;
+		std::vector<uint32_t> watchIds;
+		std::vector<std::string> shaderFilepaths;
+		ConfigureFn configure;
+
+		std::unordered_map<ShaderVariant, std::unique_ptr<EngPipeline>, ShaderVariantHash> pipelines;
+	};
+} // namespace
\ No newline at end of file
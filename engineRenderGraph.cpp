@@ -0,0 +1,945 @@
+#include "engineRenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::clearColor(ResourceId resource, VkClearColorValue clearValue)
+	{
+		VkClearValue value{};
+		value.color = clearValue;
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::ColorAttachment, true, value, 0 });
+		return *this;
+	}
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::writeColor(ResourceId resource)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::ColorAttachment, false, {}, 0 });
+		return *this;
+	}
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::clearDepth(ResourceId resource, VkClearDepthStencilValue clearValue)
+	{
+		VkClearValue value{};
+		value.depthStencil = clearValue;
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::DepthAttachment, true, value, 0 });
+		return *this;
+	}
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::writeDepth(ResourceId resource)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::DepthAttachment, false, {}, 0 });
+		return *this;
+	}
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::readDepth(ResourceId resource)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::DepthRead, false, {}, 0 });
+		return *this;
+	}
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::sample(ResourceId resource, VkPipelineStageFlags stages)
+	{
+		graph.passes[passIndex].accesses.push_back({ resource, AccessType::Sampled, false, {}, stages });
+		return *this;
+	}
+
+	EngineRenderGraph::PassBuilder& EngineRenderGraph::PassBuilder::setSideEffects()
+	{
+		graph.passes[passIndex].sideEffects = true;
+		return *this;
+	}
+
+	EngineRenderGraph::EngineRenderGraph(EngineDevice& device) : device{ device }
+	{
+		listenerId = device.addResourceListener(nullptr, [this](VkImageView imageView) { invalidateFramebuffers(imageView); });
+	}
+
+	EngineRenderGraph::~EngineRenderGraph()
+	{
+		device.removeResourceListener(listenerId);
+
+		std::vector<VkFramebuffer> framebufferHandles;
+		std::vector<VkRenderPass> renderPassHandles;
+
+		for (auto& kv : framebuffers) framebufferHandles.push_back(kv.second);
+		for (auto& kv : renderPasses) renderPassHandles.push_back(kv.second);
+
+		device.deferDestruction([&device = device, framebufferHandles = std::move(framebufferHandles), renderPassHandles = std::move(renderPassHandles)]()
+			{
+				for (auto framebuffer : framebufferHandles) vkDestroyFramebuffer(device.getDevice(), framebuffer, nullptr);
+				for (auto renderPass : renderPassHandles) vkDestroyRenderPass(device.getDevice(), renderPass, nullptr);
+			});
+
+		// After the framebuffers that use them
+		destroyTransientImages();
+	}
+
+	void EngineRenderGraph::reset()
+	{
+		resources.clear();
+		passes.clear();
+	}
+
+	EngineRenderGraph::ResourceId EngineRenderGraph::importImage(const std::string& name, VkImage image, VkImageView view, VkFormat format,
+		VkExtent2D extent, VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkImageLayout finalLayout)
+	{
+		resources.push_back({ name, format, extent, true, image, view, initialLayout, initialStages, finalLayout });
+		return static_cast<ResourceId>(resources.size() - 1);
+	}
+
+	EngineRenderGraph::ResourceId EngineRenderGraph::createImage(const std::string& name, VkFormat format, VkExtent2D extent)
+	{
+		resources.push_back({ name, format, extent, false, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED, 0,
+			VK_IMAGE_LAYOUT_UNDEFINED });
+		return static_cast<ResourceId>(resources.size() - 1);
+	}
+
+	void EngineRenderGraph::addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup,
+		std::function<void(VkCommandBuffer)> execute)
+	{
+		passes.push_back({ name, {}, false, std::move(execute) });
+
+		PassBuilder builder{ *this, static_cast<uint32_t>(passes.size() - 1) };
+		setup(builder);
+
+		for (auto& access : passes.back().accesses)
+		{
+			if (access.resource >= resources.size())
+			{
+				throw std::runtime_error("render graph pass " + name + " uses an unknown resource");
+			}
+		}
+	}
+
+	void EngineRenderGraph::compile()
+	{
+		// Image handles of imported resources change from frame to frame (swap chain images) and are only
+		// looked up while recording, the plan only depends on what is declared
+		std::vector<uint64_t> signature = getSignature();
+
+		if (signature == planSignature) return;
+
+		planSignature = std::move(signature);
+		planPasses();
+		stats.compileCount++;
+	}
+
+	void EngineRenderGraph::execute(VkCommandBuffer commandBuffer)
+	{
+		assert(getSignature() == planSignature && "Render graph changed since it was compiled");
+
+		for (auto& plannedPass : plan)
+		{
+			Pass& pass = passes[plannedPass.passIndex];
+
+			recordBarriers(commandBuffer, plannedPass.barriers);
+
+			if (plannedPass.attachments.empty())
+			{
+				pass.execute(commandBuffer);
+				continue;
+			}
+
+			beginRendering(commandBuffer, plannedPass);
+
+			VkViewport viewport{};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = static_cast<float>(plannedPass.extent.width);
+			viewport.height = static_cast<float>(plannedPass.extent.height);
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			VkRect2D scissor{ {0, 0}, plannedPass.extent };
+
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+			pass.execute(commandBuffer);
+
+			if (plannedPass.renderPass == VK_NULL_HANDLE)
+			{
+				device.cmdEndRendering(commandBuffer);
+			}
+			else
+			{
+				vkCmdEndRenderPass(commandBuffer);
+			}
+		}
+
+		recordBarriers(commandBuffer, finalBarriers);
+	}
+
+	VkImage EngineRenderGraph::getImage(ResourceId resource) const
+	{
+		return resources[resource].imported ? resources[resource].image : transientImages[resource].image;
+	}
+
+	VkImageView EngineRenderGraph::getImageView(ResourceId resource) const
+	{
+		return resources[resource].imported ? resources[resource].view : transientImages[resource].view;
+	}
+
+	std::vector<uint64_t> EngineRenderGraph::getSignature() const
+	{
+		std::vector<uint64_t> signature{ resources.size(), passes.size() };
+
+		for (auto& resource : resources)
+		{
+			signature.insert(signature.end(), { static_cast<uint64_t>(resource.format), resource.extent.width, resource.extent.height,
+				resource.imported, static_cast<uint64_t>(resource.initialLayout), resource.initialStages, static_cast<uint64_t>(resource.finalLayout) });
+		}
+
+		for (auto& pass : passes)
+		{
+			signature.insert(signature.end(), { pass.sideEffects, pass.accesses.size() });
+
+			for (auto& access : pass.accesses)
+			{
+				signature.insert(signature.end(), { access.resource, static_cast<uint64_t>(access.type), access.clear, access.stages });
+			}
+		}
+
+		return signature;
+	}
+
+	void EngineRenderGraph::planPasses()
+	{
+		// Culling, from the last pass back: a pass lives if it has side effects or writes what a living
+		// pass after it (or the imported image after the frame) reads. Clears end that dependency
+		std::vector<bool> passAlive(passes.size(), false);
+		std::vector<bool> needed(resources.size(), false);
+
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			needed[i] = resources[i].imported;
+		}
+
+		for (size_t i = passes.size(); i-- > 0;)
+		{
+			const Pass& pass = passes[i];
+			bool alive = pass.sideEffects;
+
+			for (auto& access : pass.accesses)
+			{
+				if (getAccessInfo(access).write && needed[access.resource]) alive = true;
+			}
+
+			if (!alive) continue;
+
+			passAlive[i] = true;
+
+			for (auto& access : pass.accesses)
+			{
+				if (access.clear) needed[access.resource] = false;
+			}
+
+			for (auto& access : pass.accesses)
+			{
+				if (!access.clear) needed[access.resource] = true;
+			}
+		}
+
+		// Transients are discarded (UNDEFINED) on first use, after whatever last touched their memory: the
+		// previous frame's use of the same image, or an image aliasing it. Any transient access may have
+		// been that one, so the first barrier waits on all of them
+		VkPipelineStageFlags transientStages = 0;
+		VkAccessFlags transientWrites = 0;
+
+		for (size_t i = 0; i < passes.size(); i++)
+		{
+			if (!passAlive[i]) continue;
+
+			for (auto& access : passes[i].accesses)
+			{
+				if (resources[access.resource].imported) continue;
+
+				AccessInfo info = getAccessInfo(access);
+				transientStages |= info.stages;
+				if (info.write) transientWrites |= info.access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+			}
+		}
+
+		struct ResourceState
+		{
+			VkImageLayout layout;
+			VkPipelineStageFlags writeStages;
+			VkAccessFlags writeAccess;
+			VkPipelineStageFlags readStages;	// since the last write
+			VkPipelineStageFlags visibleStages;	// that the last write was made visible to
+			bool used;
+		};
+
+		std::vector<ResourceState> states(resources.size());
+
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			if (resources[i].imported)
+			{
+				states[i] = { resources[i].initialLayout, resources[i].initialStages, 0, 0, 0, false };
+			}
+			else
+			{
+				states[i] = { VK_IMAGE_LAYOUT_UNDEFINED, transientStages, transientWrites, 0, 0, false };
+			}
+		}
+
+		plan.clear();
+		finalBarriers = {};
+		stats.passCount = static_cast<uint32_t>(passes.size());
+		stats.culledPassCount = 0;
+		stats.barrierCount = 0;
+		stats.barrierBatchCount = 0;
+		stats.naiveBarrierCount = 0;
+
+		for (size_t i = 0; i < passes.size(); i++)
+		{
+			const Pass& pass = passes[i];
+
+			// Without the graph every declared pass runs and every use gets its own barrier
+			stats.naiveBarrierCount += static_cast<uint32_t>(pass.accesses.size());
+
+			if (!passAlive[i])
+			{
+				stats.culledPassCount++;
+				continue;
+			}
+
+			PlannedPass plannedPass{ static_cast<uint32_t>(i) };
+			std::vector<uint32_t> colorAttachments;
+			std::vector<uint32_t> depthAttachments;
+			std::vector<VkAttachmentLoadOp> loadOps(pass.accesses.size());
+
+			for (uint32_t accessIndex = 0; accessIndex < pass.accesses.size(); accessIndex++)
+			{
+				const Access& access = pass.accesses[accessIndex];
+				AccessInfo info = getAccessInfo(access);
+				ResourceState& state = states[access.resource];
+
+				if (access.type == AccessType::ColorAttachment) colorAttachments.push_back(accessIndex);
+				else if (access.type != AccessType::Sampled) depthAttachments.push_back(accessIndex);
+
+				bool layoutChange = state.layout != info.layout;
+				bool hazard = info.write ? (state.writeStages | state.readStages) != 0
+					: state.writeStages != 0 && (info.stages & ~state.visibleStages) != 0;
+
+				// An image used twice by the pass (depth tested and sampled) gets one barrier covering both
+				auto merged = std::find_if(plannedPass.barriers.barriers.begin(), plannedPass.barriers.barriers.end(),
+					[&access](const ImageBarrier& barrier) { return barrier.resource == access.resource; });
+
+				if (merged != plannedPass.barriers.barriers.end())
+				{
+					if (layoutChange)
+					{
+						throw std::runtime_error("render graph pass " + pass.name + " uses " + resources[access.resource].name + " in two layouts");
+					}
+
+					merged->dstAccess |= info.access;
+					plannedPass.barriers.dstStages |= info.stages;
+					hazard = true;
+				}
+				else if (layoutChange || hazard)
+				{
+					VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+
+					plannedPass.barriers.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+					plannedPass.barriers.dstStages |= info.stages;
+					plannedPass.barriers.barriers.push_back({ access.resource, state.layout, info.layout, state.writeAccess, info.access });
+				}
+
+				// Nothing to keep from an image that was never written
+				loadOps[accessIndex] = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+					: state.layout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD;
+
+				if (info.write)
+				{
+					state.writeStages = info.stages;
+					state.writeAccess = info.access & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+					state.readStages = 0;
+					state.visibleStages = 0;
+				}
+				else if (layoutChange)
+				{
+					state.readStages = info.stages;
+					state.visibleStages = info.stages;
+				}
+				else
+				{
+					state.readStages |= info.stages;
+					if (hazard) state.visibleStages |= info.stages;
+				}
+
+				state.layout = info.layout;
+				state.used = true;
+			}
+
+			if (depthAttachments.size() > 1)
+			{
+				throw std::runtime_error("render graph pass " + pass.name + " has more than one depth attachment");
+			}
+
+			plannedPass.attachments = std::move(colorAttachments);
+			plannedPass.attachments.insert(plannedPass.attachments.end(), depthAttachments.begin(), depthAttachments.end());
+
+			for (uint32_t accessIndex : plannedPass.attachments)
+			{
+				plannedPass.loadOps.push_back(loadOps[accessIndex]);
+				VkExtent2D extent = resources[pass.accesses[accessIndex].resource].extent;
+
+				if (accessIndex != plannedPass.attachments.front() &&
+					(extent.width != plannedPass.extent.width || extent.height != plannedPass.extent.height))
+				{
+					throw std::runtime_error("render graph pass " + pass.name + " has attachments of different sizes");
+				}
+
+				plannedPass.extent = extent;
+			}
+
+			plan.push_back(std::move(plannedPass));
+		}
+
+		// Imported images end up the way their owner expects them, the next user waits on its own
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			ResourceState& state = states[i];
+
+			if (!resources[i].imported || !state.used) continue;
+
+			stats.naiveBarrierCount++;
+
+			if (state.layout == resources[i].finalLayout) continue;
+
+			VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+
+			finalBarriers.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			finalBarriers.barriers.push_back({ static_cast<ResourceId>(i), state.layout, resources[i].finalLayout, state.writeAccess, 0 });
+		}
+
+		// Attachments are only stored when a later pass or the owner of an imported image reads them
+		std::vector<bool> live(resources.size(), false);
+
+		for (size_t i = 0; i < resources.size(); i++)
+		{
+			live[i] = resources[i].imported;
+		}
+
+		for (size_t i = plan.size(); i-- > 0;)
+		{
+			PlannedPass& plannedPass = plan[i];
+			const Pass& pass = passes[plannedPass.passIndex];
+
+			plannedPass.storeOps.clear();
+
+			for (uint32_t accessIndex : plannedPass.attachments)
+			{
+				plannedPass.storeOps.push_back(live[pass.accesses[accessIndex].resource] ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE);
+			}
+
+			for (auto& access : pass.accesses)
+			{
+				if (access.clear) live[access.resource] = false;
+			}
+
+			for (auto& access : pass.accesses)
+			{
+				if (!access.clear) live[access.resource] = true;
+			}
+		}
+
+		for (auto& plannedPass : plan)
+		{
+			if (!plannedPass.attachments.empty() && !device.supportsDynamicRendering())
+			{
+				plannedPass.renderPass = getRenderPass(plannedPass);
+			}
+
+			if (!plannedPass.barriers.barriers.empty())
+			{
+				stats.barrierCount += static_cast<uint32_t>(plannedPass.barriers.barriers.size());
+				stats.barrierBatchCount++;
+			}
+		}
+
+		if (!finalBarriers.barriers.empty())
+		{
+			stats.barrierCount += static_cast<uint32_t>(finalBarriers.barriers.size());
+			stats.barrierBatchCount++;
+		}
+
+		destroyTransientImages();
+		createTransientImages();
+	}
+
+	void EngineRenderGraph::createTransientImages()
+	{
+		struct Placement
+		{
+			ResourceId resource;
+			uint32_t firstPass;
+			uint32_t lastPass;
+			VkMemoryRequirements requirements;
+			VkDeviceSize offset;
+		};
+
+		std::vector<Placement> placements;
+		std::vector<VkImageUsageFlags> usages(resources.size(), 0);
+		std::vector<uint32_t> firstPasses(resources.size(), UINT32_MAX);
+		std::vector<uint32_t> lastPasses(resources.size(), 0);
+
+		transientImages.assign(resources.size(), {});
+
+		for (uint32_t i = 0; i < plan.size(); i++)
+		{
+			for (auto& access : passes[plan[i].passIndex].accesses)
+			{
+				if (resources[access.resource].imported) continue;
+
+				usages[access.resource] |= access.type == AccessType::ColorAttachment ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+					: access.type == AccessType::Sampled ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+				firstPasses[access.resource] = std::min(firstPasses[access.resource], i);
+				lastPasses[access.resource] = std::max(lastPasses[access.resource], i);
+			}
+		}
+
+		bool allDepth = true;
+
+		for (ResourceId resource = 0; resource < resources.size(); resource++)
+		{
+			// Transients of culled passes aren't created at all
+			if (usages[resource] == 0) continue;
+
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent = { resources[resource].extent.width, resources[resource].extent.height, 1 };
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = resources[resource].format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = usages[resource];
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			if (vkCreateImage(device.getDevice(), &imageInfo, nullptr, &transientImages[resource].image) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph image " + resources[resource].name + "!");
+			}
+
+			Placement placement{ resource, firstPasses[resource], lastPasses[resource], {}, 0 };
+			vkGetImageMemoryRequirements(device.getDevice(), transientImages[resource].image, &placement.requirements);
+			placements.push_back(placement);
+
+			allDepth = allDepth && isDepthFormat(resources[resource].format);
+		}
+
+		stats.transientBytes = 0;
+		stats.naiveTransientBytes = 0;
+
+		if (placements.empty()) return;
+
+		// Largest first, each at the lowest offset where it overlaps no placed image that is alive at the
+		// same time. The candidates are 0 and the ends of those images
+		std::sort(placements.begin(), placements.end(), [](const Placement& a, const Placement& b) { return a.requirements.size > b.requirements.size; });
+
+		VkMemoryRequirements requirements{ 0, 1, ~0u };
+
+		for (size_t i = 0; i < placements.size(); i++)
+		{
+			Placement& placement = placements[i];
+			VkDeviceSize alignment = placement.requirements.alignment;
+			std::vector<VkDeviceSize> candidates{ 0 };
+
+			for (size_t j = 0; j < i; j++)
+			{
+				if (placements[j].lastPass < placement.firstPass || placement.lastPass < placements[j].firstPass) continue;
+
+				VkDeviceSize end = placements[j].offset + placements[j].requirements.size;
+				candidates.push_back((end + alignment - 1) / alignment * alignment);
+			}
+
+			std::sort(candidates.begin(), candidates.end());
+
+			for (VkDeviceSize offset : candidates)
+			{
+				bool fits = true;
+
+				for (size_t j = 0; j < i && fits; j++)
+				{
+					if (placements[j].lastPass < placement.firstPass || placement.lastPass < placements[j].firstPass) continue;
+
+					fits = offset + placement.requirements.size <= placements[j].offset ||
+						placements[j].offset + placements[j].requirements.size <= offset;
+				}
+
+				if (fits)
+				{
+					placement.offset = offset;
+					break;
+				}
+			}
+
+			requirements.size = std::max(requirements.size, placement.offset + placement.requirements.size);
+			requirements.alignment = std::max(requirements.alignment, alignment);
+			requirements.memoryTypeBits &= placement.requirements.memoryTypeBits;
+			stats.naiveTransientBytes += (placement.requirements.size + alignment - 1) / alignment * alignment;
+		}
+
+		if (requirements.memoryTypeBits == 0)
+		{
+			throw std::runtime_error("no memory type suits every render graph image!");
+		}
+
+		transientCategory = allDepth ? MemoryCategory::Depth : MemoryCategory::Image;
+		device.allocateImageMemory(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, transientCategory, transientMemory);
+		stats.transientBytes = requirements.size;
+
+		for (auto& placement : placements)
+		{
+			TransientImage& transient = transientImages[placement.resource];
+			VkFormat format = resources[placement.resource].format;
+			transient.offset = placement.offset;
+
+			if (vkBindImageMemory(device.getDevice(), transient.image, transientMemory.memory, transientMemory.offset + transient.offset) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to bind render graph image memory!");
+			}
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = transient.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = format;
+			viewInfo.subresourceRange = { isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+			if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &transient.view) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph image view!");
+			}
+		}
+	}
+
+	void EngineRenderGraph::destroyTransientImages()
+	{
+		std::vector<TransientImage> images;
+
+		for (auto& transient : transientImages)
+		{
+			if (transient.image == VK_NULL_HANDLE) continue;
+
+			if (transient.view != VK_NULL_HANDLE) device.notifyImageViewDestroyed(transient.view);
+			images.push_back(transient);
+		}
+
+		transientImages.clear();
+
+		if (images.empty() && transientMemory.memory == VK_NULL_HANDLE) return;
+
+		device.deferDestruction([&device = device, images = std::move(images), memory = transientMemory, category = transientCategory]()
+			{
+				for (auto& transient : images)
+				{
+					vkDestroyImageView(device.getDevice(), transient.view, nullptr);
+					vkDestroyImage(device.getDevice(), transient.image, nullptr);
+				}
+
+				if (memory.memory != VK_NULL_HANDLE) device.freeImageMemory(memory, category);
+			});
+
+		transientMemory = {};
+	}
+
+	EngineRenderGraph::AccessInfo EngineRenderGraph::getAccessInfo(const Access& access) const
+	{
+		constexpr VkPipelineStageFlags FRAGMENT_TESTS = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		switch (access.type)
+		{
+		case AccessType::ColorAttachment:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true };
+		case AccessType::DepthAttachment:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, FRAGMENT_TESTS,
+				VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true };
+		case AccessType::DepthRead:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, FRAGMENT_TESTS, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, false };
+		default:
+			// Depth sampled in the same pass it is tested against needs the same layout for both
+			return { isDepthFormat(resources[access.resource].format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+				: VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, access.stages, VK_ACCESS_SHADER_READ_BIT, false };
+		}
+	}
+
+	VkRenderPass EngineRenderGraph::getRenderPass(const PlannedPass& plannedPass)
+	{
+		const Pass& pass = passes[plannedPass.passIndex];
+		std::vector<VkAttachmentDescription> attachments;
+
+		// Layouts don't change inside, barriers before the pass take care of that. Without other
+		// differences than load and store ops and layouts these stay compatible with the render passes of
+		// getPipelineAttachments, which pipelines are created against
+		for (size_t i = 0; i < plannedPass.attachments.size(); i++)
+		{
+			const Access& access = pass.accesses[plannedPass.attachments[i]];
+			VkImageLayout layout = getAccessInfo(access).layout;
+
+			VkAttachmentDescription attachment{};
+			attachment.format = resources[access.resource].format;
+			attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment.loadOp = plannedPass.loadOps[i];
+			attachment.storeOp = plannedPass.storeOps[i];
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = layout;
+			attachment.finalLayout = layout;
+			attachments.push_back(attachment);
+		}
+
+		return getRenderPass(attachments, pass.accesses[plannedPass.attachments.back()].type != AccessType::ColorAttachment);
+	}
+
+	VkRenderPass EngineRenderGraph::getRenderPass(const std::vector<VkAttachmentDescription>& attachments, bool hasDepth)
+	{
+		std::vector<VkAttachmentReference> colorReferences;
+		VkAttachmentReference depthReference{};
+		std::vector<uint64_t> key{ hasDepth };
+
+		for (size_t i = 0; i < attachments.size(); i++)
+		{
+			const VkAttachmentDescription& attachment = attachments[i];
+
+			if (hasDepth && i == attachments.size() - 1) depthReference = { static_cast<uint32_t>(i), attachment.initialLayout };
+			else colorReferences.push_back({ static_cast<uint32_t>(i), attachment.initialLayout });
+
+			key.insert(key.end(), { static_cast<uint64_t>(attachment.format), static_cast<uint64_t>(attachment.loadOp),
+				static_cast<uint64_t>(attachment.storeOp), static_cast<uint64_t>(attachment.initialLayout) });
+		}
+
+		auto cached = renderPasses.find(key);
+		if (cached != renderPasses.end()) return cached->second;
+
+		VkSubpassDescription subpass{};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+		subpass.pColorAttachments = colorReferences.data();
+		subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+		VkRenderPassCreateInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		renderPassInfo.pAttachments = attachments.data();
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		VkRenderPass renderPass;
+
+		if (vkCreateRenderPass(device.getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create render graph render pass!");
+		}
+
+		renderPasses.emplace(std::move(key), renderPass);
+		stats.renderPassObjectCount++;
+		return renderPass;
+	}
+
+	PipelineAttachments EngineRenderGraph::getPipelineAttachments(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat)
+	{
+		PipelineAttachments pipelineAttachments{ colorFormats, depthFormat, VK_NULL_HANDLE };
+
+		if (device.supportsDynamicRendering()) return pipelineAttachments;
+
+		// Only formats matter for compatibility, the render pass of a pass clearing everything will do
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkFormat> formats = colorFormats;
+		bool hasDepth = depthFormat != VK_FORMAT_UNDEFINED;
+
+		if (hasDepth) formats.push_back(depthFormat);
+
+		for (size_t i = 0; i < formats.size(); i++)
+		{
+			bool depth = hasDepth && i == formats.size() - 1;
+
+			VkAttachmentDescription attachment{};
+			attachment.format = formats[i];
+			attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			attachment.finalLayout = attachment.initialLayout;
+			attachments.push_back(attachment);
+		}
+
+		pipelineAttachments.renderPass = getRenderPass(attachments, hasDepth);
+		return pipelineAttachments;
+	}
+
+	VkFramebuffer EngineRenderGraph::getFramebuffer(const PlannedPass& plannedPass)
+	{
+		const Pass& pass = passes[plannedPass.passIndex];
+		FramebufferKey key{ plannedPass.renderPass, {} };
+
+		for (uint32_t accessIndex : plannedPass.attachments)
+		{
+			key.second.push_back(getImageView(pass.accesses[accessIndex].resource));
+		}
+
+		auto cached = framebuffers.find(key);
+		if (cached != framebuffers.end()) return cached->second;
+
+		VkFramebufferCreateInfo framebufferInfo{};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = plannedPass.renderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(key.second.size());
+		framebufferInfo.pAttachments = key.second.data();
+		framebufferInfo.width = plannedPass.extent.width;
+		framebufferInfo.height = plannedPass.extent.height;
+		framebufferInfo.layers = 1;
+
+		VkFramebuffer framebuffer;
+
+		if (vkCreateFramebuffer(device.getDevice(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create render graph framebuffer!");
+		}
+
+		framebuffers.emplace(std::move(key), framebuffer);
+		stats.framebufferObjectCount++;
+		return framebuffer;
+	}
+
+	void EngineRenderGraph::beginRendering(VkCommandBuffer commandBuffer, const PlannedPass& plannedPass)
+	{
+		const Pass& pass = passes[plannedPass.passIndex];
+
+		if (plannedPass.renderPass != VK_NULL_HANDLE)
+		{
+			std::vector<VkClearValue> clearValues;
+
+			for (uint32_t accessIndex : plannedPass.attachments)
+			{
+				clearValues.push_back(pass.accesses[accessIndex].clearValue);
+			}
+
+			VkRenderPassBeginInfo renderPassInfo{};
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+			renderPassInfo.renderPass = plannedPass.renderPass;
+			renderPassInfo.framebuffer = getFramebuffer(plannedPass);
+			renderPassInfo.renderArea.offset = { 0, 0 };
+			renderPassInfo.renderArea.extent = plannedPass.extent;
+			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+			renderPassInfo.pClearValues = clearValues.data();
+
+			vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+			return;
+		}
+
+		// Same load and store ops and layouts as the render pass would have had, the barriers before the
+		// pass already did the transitions
+		std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+		VkRenderingAttachmentInfoKHR depthAttachment{};
+		bool hasDepth = false;
+
+		for (size_t i = 0; i < plannedPass.attachments.size(); i++)
+		{
+			const Access& access = pass.accesses[plannedPass.attachments[i]];
+
+			VkRenderingAttachmentInfoKHR attachment{};
+			attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			attachment.imageView = getImageView(access.resource);
+			attachment.imageLayout = getAccessInfo(access).layout;
+			attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+			attachment.loadOp = plannedPass.loadOps[i];
+			attachment.storeOp = plannedPass.storeOps[i];
+			attachment.clearValue = access.clearValue;
+
+			if (access.type == AccessType::ColorAttachment)
+			{
+				colorAttachments.push_back(attachment);
+			}
+			else
+			{
+				depthAttachment = attachment;
+				hasDepth = true;
+			}
+		}
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = plannedPass.extent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+		renderingInfo.pColorAttachments = colorAttachments.data();
+		renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+
+		device.cmdBeginRendering(commandBuffer, renderingInfo);
+	}
+
+	void EngineRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch)
+	{
+		if (batch.barriers.empty()) return;
+
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+
+		for (auto& barrier : batch.barriers)
+		{
+			VkFormat format = resources[barrier.resource].format;
+			VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+			if (isDepthFormat(format))
+			{
+				aspect = hasStencilComponent(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+			}
+
+			VkImageMemoryBarrier imageBarrier{};
+			imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			imageBarrier.oldLayout = barrier.oldLayout;
+			imageBarrier.newLayout = barrier.newLayout;
+			imageBarrier.srcAccessMask = barrier.srcAccess;
+			imageBarrier.dstAccessMask = barrier.dstAccess;
+			imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.image = getImage(barrier.resource);
+			imageBarrier.subresourceRange = { aspect, 0, 1, 0, 1 };
+			imageBarriers.push_back(imageBarrier);
+		}
+
+		vkCmdPipelineBarrier(commandBuffer, batch.srcStages, batch.dstStages, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+	}
+
+	void EngineRenderGraph::invalidateFramebuffers(VkImageView imageView)
+	{
+		for (auto it = framebuffers.begin(); it != framebuffers.end();)
+		{
+			const std::vector<VkImageView>& views = it->first.second;
+
+			if (std::find(views.begin(), views.end(), imageView) == views.end())
+			{
+				++it;
+				continue;
+			}
+
+			device.deferDestruction([&device = device, framebuffer = it->second]() { vkDestroyFramebuffer(device.getDevice(), framebuffer, nullptr); });
+			it = framebuffers.erase(it);
+		}
+	}
+
+	bool EngineRenderGraph::isDepthFormat(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT ||
+			format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	bool EngineRenderGraph::hasStencilComponent(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+} // namespace
\ No newline at end of file
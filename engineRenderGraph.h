@@ -0,0 +1,225 @@
+#pragma once
+
+#include "engineDevice.h"
+#include "engPipeline.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Frames are described as passes declaring which images they read and write, then compiled into
+	// barriers and render passes. Declarations are repeated every frame (reset, declare, compile, execute),
+	// compile only plans again when they differ from the last frame's, eg after a resize.
+	//
+	// Passes whose results nothing uses are culled: what counts is writing an imported image (the swap
+	// chain) or having side effects. Layout transitions and barriers come from each image's state between
+	// passes and are batched into one vkCmdPipelineBarrier per pass. Transient images share one allocation,
+	// those whose lifetimes don't overlap are placed at the same offset. Buffers aren't tracked, systems
+	// keep synchronizing their own.
+	//
+	// With VK_KHR_dynamic_rendering passes begin rendering straight on their attachments, otherwise they
+	// run in cached render passes and framebuffers, pipelines get compatible ones from getPipelineAttachments
+	class EngineRenderGraph
+	{
+	public:
+		using ResourceId = uint32_t;
+
+		// Counts of the current plan, against a graph that allocates every transient separately and puts
+		// one barrier before every use
+		struct Stats
+		{
+			uint32_t passCount = 0;
+			uint32_t culledPassCount = 0;
+			uint32_t barrierCount = 0;
+			uint32_t barrierBatchCount = 0;
+			uint32_t naiveBarrierCount = 0;
+			VkDeviceSize transientBytes = 0;
+			VkDeviceSize naiveTransientBytes = 0;
+			uint32_t compileCount = 0;
+			uint32_t renderPassObjectCount = 0;	// created so far, none with dynamic rendering
+			uint32_t framebufferObjectCount = 0;
+		};
+
+		class PassBuilder
+		{
+		public:
+			// Clears replace what the image held, plain writes keep it
+			PassBuilder& clearColor(ResourceId resource, VkClearColorValue clearValue);
+			PassBuilder& writeColor(ResourceId resource);
+			PassBuilder& clearDepth(ResourceId resource, VkClearDepthStencilValue clearValue);
+			PassBuilder& writeDepth(ResourceId resource);
+
+			// Depth tested against but not written
+			PassBuilder& readDepth(ResourceId resource);
+			PassBuilder& sample(ResourceId resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+			// Never culled, for passes writing what the graph doesn't track
+			PassBuilder& setSideEffects();
+
+		private:
+			friend class EngineRenderGraph;
+
+			PassBuilder(EngineRenderGraph& graph, uint32_t passIndex) : graph{ graph }, passIndex{ passIndex } {}
+
+			EngineRenderGraph& graph;
+			uint32_t passIndex;
+		};
+
+		EngineRenderGraph(EngineDevice& device);
+		~EngineRenderGraph();
+
+		EngineRenderGraph(const EngineRenderGraph&) = delete;
+		EngineRenderGraph& operator=(const EngineRenderGraph&) = delete;
+
+		// Drops the previous frame's declarations, planned passes and transient images are kept
+		void reset();
+
+		// An image that lives outside the graph. It is in initialLayout, last used by initialStages, and is
+		// left in finalLayout
+		ResourceId importImage(const std::string& name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+			VkImageLayout initialLayout, VkPipelineStageFlags initialStages, VkImageLayout finalLayout);
+
+		// An image the graph allocates, its contents don't survive the frame
+		ResourceId createImage(const std::string& name, VkFormat format, VkExtent2D extent);
+
+		// Passes run in the order they were added. Passes with attachments run inside a render pass with
+		// viewport and scissor set to their extent
+		void addPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, std::function<void(VkCommandBuffer)> execute);
+
+		void compile();
+		void execute(VkCommandBuffer commandBuffer);
+
+		// Valid after compile, until the next compile that plans again
+		VkImage getImage(ResourceId resource) const;
+		VkImageView getImageView(ResourceId resource) const;
+
+		const Stats& getStats() const { return stats; }
+
+		// For pipelines drawing in passes with these attachments (color ones in declaration order), with a
+		// compatible render pass when there is no dynamic rendering. It lives as long as the graph
+		PipelineAttachments getPipelineAttachments(const std::vector<VkFormat>& colorFormats, VkFormat depthFormat);
+
+	private:
+		enum class AccessType
+		{
+			ColorAttachment,
+			DepthAttachment,
+			DepthRead,
+			Sampled,
+		};
+
+		struct Access
+		{
+			ResourceId resource;
+			AccessType type;
+			bool clear;
+			VkClearValue clearValue;
+			VkPipelineStageFlags stages;	// for Sampled
+		};
+
+		struct Resource
+		{
+			std::string name;
+			VkFormat format;
+			VkExtent2D extent;
+			bool imported;
+			VkImage image;
+			VkImageView view;
+			VkImageLayout initialLayout;
+			VkPipelineStageFlags initialStages;
+			VkImageLayout finalLayout;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			std::vector<Access> accesses;
+			bool sideEffects = false;
+			std::function<void(VkCommandBuffer)> execute;
+		};
+
+		struct ImageBarrier
+		{
+			ResourceId resource;
+			VkImageLayout oldLayout;
+			VkImageLayout newLayout;
+			VkAccessFlags srcAccess;
+			VkAccessFlags dstAccess;
+		};
+
+		// Barriers before a pass, or after the last one for imported images
+		struct BarrierBatch
+		{
+			VkPipelineStageFlags srcStages = 0;
+			VkPipelineStageFlags dstStages = 0;
+			std::vector<ImageBarrier> barriers;
+		};
+
+		struct PlannedPass
+		{
+			uint32_t passIndex;
+			BarrierBatch barriers;
+			VkRenderPass renderPass = VK_NULL_HANDLE;	// null without attachments or with dynamic rendering
+			std::vector<uint32_t> attachments;	// indices into the pass's accesses, color ones first, then depth
+			std::vector<VkAttachmentLoadOp> loadOps;
+			std::vector<VkAttachmentStoreOp> storeOps;
+			VkExtent2D extent{};
+		};
+
+		struct AccessInfo
+		{
+			VkImageLayout layout;
+			VkPipelineStageFlags stages;
+			VkAccessFlags access;
+			bool write;
+		};
+
+		// Physical image of a transient, bound at offset into transientMemory
+		struct TransientImage
+		{
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkDeviceSize offset = 0;
+		};
+
+		using FramebufferKey = std::pair<VkRenderPass, std::vector<VkImageView>>;
+
+		EngineDevice& device;
+		uint32_t listenerId;
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+
+		std::vector<uint64_t> planSignature;
+		std::vector<PlannedPass> plan;
+		BarrierBatch finalBarriers;
+		std::vector<TransientImage> transientImages;	// by resource id, empty entries for imported ones
+		EngineMemoryAllocator::Allocation transientMemory{};
+		MemoryCategory transientCategory = MemoryCategory::Image;
+
+		std::map<std::vector<uint64_t>, VkRenderPass> renderPasses;
+		std::map<FramebufferKey, VkFramebuffer> framebuffers;
+		Stats stats{};
+
+		std::vector<uint64_t> getSignature() const;
+		void planPasses();
+		void createTransientImages();
+		void destroyTransientImages();
+		AccessInfo getAccessInfo(const Access& access) const;
+		VkRenderPass getRenderPass(const PlannedPass& plannedPass);
+		VkRenderPass getRenderPass(const std::vector<VkAttachmentDescription>& attachments, bool hasDepth);
+		VkFramebuffer getFramebuffer(const PlannedPass& plannedPass);
+		void beginRendering(VkCommandBuffer commandBuffer, const PlannedPass& plannedPass);
+		void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch);
+		void invalidateFramebuffers(VkImageView imageView);
+
+		static bool isDepthFormat(VkFormat format);
+		static bool hasStencilComponent(VkFormat format);
+	};
+} // namespace
\ No newline at end of file
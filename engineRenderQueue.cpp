@@ -0,0 +1,201 @@
+#include "engineRenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+
+namespace gameEngine
+{
+
+	void EngineRenderQueue::reset(float maxDepth)
+	{
+		this->maxDepth = maxDepth;
+
+		draws.clear();
+		entries.clear();
+		pipelineIds.clear();
+		descriptorSetIds.clear();
+		meshIds.clear();
+		sorted = false;
+		stats = Stats{};
+	}
+
+	void EngineRenderQueue::submit(const Draw& draw)
+	{
+		assert(!sorted && "Draws submitted after sort");
+		assert(draw.drawer != nullptr && "Draw without a drawer");
+
+		entries.push_back({ makeKey(draw), static_cast<uint32_t>(draws.size()) });
+		draws.push_back(draw);
+		stats.drawCount++;
+	}
+
+	uint32_t EngineRenderQueue::getId(IdMap& ids, uint64_t object, uint32_t bits)
+	{
+		// Past the field's range ids share its largest value, those draws only lose their grouping
+		uint32_t maxId = (1u << bits) - 1;
+
+		return *ids.insert(object, static_cast<uint32_t>(std::min<size_t>(ids.size(), maxId))).first;
+	}
+
+	uint64_t EngineRenderQueue::makeKey(const Draw& draw)
+	{
+		// No set or mesh gets id 0, ahead of every draw that binds one
+		uint64_t pipeline = getId(pipelineIds, reinterpret_cast<uintptr_t>(draw.pipeline), PIPELINE_BITS);
+		uint64_t descriptorSet = draw.descriptorSet == VK_NULL_HANDLE ? 0
+			: getId(descriptorSetIds, (uint64_t)draw.descriptorSet, DESCRIPTOR_SET_BITS - 1) + 1;
+		uint64_t mesh = draw.mesh == nullptr ? 0 : getId(meshIds, reinterpret_cast<uintptr_t>(draw.mesh), MESH_BITS - 1) + 1;
+
+		float depthRange = std::min(std::max(draw.depth / maxDepth, 0.f), 1.f);
+		uint64_t depth = static_cast<uint64_t>(depthRange * ((1u << DEPTH_BITS) - 1));
+
+		uint64_t key = static_cast<uint64_t>(draw.pass);
+		key = (key << PIPELINE_BITS) | pipeline;
+		key = (key << DESCRIPTOR_SET_BITS) | descriptorSet;
+		key = (key << MESH_BITS) | mesh;
+		key = (key << DEPTH_BITS) | depth;
+
+		return key;
+	}
+
+	void EngineRenderQueue::sort()
+	{
+		radixSort();
+		sorted = true;
+	}
+
+	void EngineRenderQueue::radixSort()
+	{
+		constexpr uint32_t DIGIT_COUNT = sizeof(uint64_t);
+		size_t count = entries.size();
+
+		if (count < 2) return;
+
+		// Histograms of every byte in one read of the keys
+		std::array<std::array<uint32_t, 256>, DIGIT_COUNT> histograms{};
+
+		for (auto& entry : entries)
+		{
+			for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++)
+			{
+				histograms[digit][(entry.key >> (digit * 8)) & 0xff]++;
+			}
+		}
+
+		scratch.resize(count);
+		SortEntry* source = entries.data();
+		SortEntry* destination = scratch.data();
+
+		// Least significant byte first, each pass is stable so earlier bytes stay ordered
+		for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++)
+		{
+			auto& histogram = histograms[digit];
+			uint32_t shift = digit * 8;
+
+			// Bytes every key shares, most of the pass and high id bits, move nothing
+			if (histogram[(source[0].key >> shift) & 0xff] == count) continue;
+
+			uint32_t offset = 0;
+
+			for (auto& bucket : histogram)
+			{
+				uint32_t bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				destination[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+			}
+
+			std::swap(source, destination);
+		}
+
+		if (source != entries.data())
+		{
+			entries.swap(scratch);
+		}
+	}
+
+	void EngineRenderQueue::record(FrameInfo& frameInfo, RenderQueuePass pass)
+	{
+		assert(sorted && "Render queue recorded before sort");
+
+		uint32_t passShift = PIPELINE_BITS + DESCRIPTOR_SET_BITS + MESH_BITS + DEPTH_BITS;
+		uint64_t passValue = static_cast<uint64_t>(pass);
+
+		auto first = std::partition_point(entries.begin(), entries.end(), [&](const SortEntry& entry) { return (entry.key >> passShift) < passValue; });
+
+		VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+		EngPipeline* boundPipeline = nullptr;
+		VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+		const void* boundMesh = nullptr;
+
+		for (auto entry = first; entry != entries.end() && (entry->key >> passShift) == passValue; ++entry)
+		{
+			const Draw& draw = draws[entry->draw];
+
+			// Layouts with different push constant ranges disturb every set, the global one included
+			if (draw.pipelineLayout != boundLayout)
+			{
+				vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					draw.pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 1, &frameInfo.globalUboOffset);
+
+				boundLayout = draw.pipelineLayout;
+				boundDescriptorSet = VK_NULL_HANDLE;
+			}
+
+			if (draw.pipeline != boundPipeline)
+			{
+				draw.pipeline->bind(frameInfo.commandBuffer);
+				boundPipeline = draw.pipeline;
+				stats.pipelineBinds++;
+
+				// A mesh is bound differently per pipeline kind, vertex buffers for vertex shaders and a
+				// descriptor set for mesh shaders
+				boundMesh = nullptr;
+			}
+			else
+			{
+				stats.pipelineBindsSaved++;
+			}
+
+			if (draw.descriptorSet != VK_NULL_HANDLE)
+			{
+				if (draw.descriptorSet != boundDescriptorSet)
+				{
+					vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						draw.pipelineLayout, draw.descriptorSetIndex, 1, &draw.descriptorSet, 0, nullptr);
+					boundDescriptorSet = draw.descriptorSet;
+					stats.descriptorSetBinds++;
+				}
+				else
+				{
+					stats.descriptorSetBindsSaved++;
+				}
+			}
+
+			if (draw.mesh != nullptr)
+			{
+				if (draw.mesh != boundMesh)
+				{
+					draw.drawer->bindMesh(frameInfo, draw.drawIndex);
+					boundMesh = draw.mesh;
+					stats.meshBinds++;
+				}
+				else
+				{
+					stats.meshBindsSaved++;
+				}
+			}
+			else
+			{
+				boundMesh = nullptr;
+			}
+
+			draw.drawer->draw(frameInfo, draw.drawIndex);
+		}
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "engineFrameInfo.h"
+#include "engPipeline.h"
+#include "engineFlatHashMap.h"
+#include "engineUtils.h"
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Passes a frame records from the queue, in the order they come in the sort key
+	enum class RenderQueuePass : uint32_t
+	{
+		DepthPrepass,
+		Opaque,
+		PointLights,
+	};
+
+	// Collects a frame's draws from every system, radix sorts them by a 64 bit key and records them with
+	// redundant state elimination. The key holds, most significant first, the pass, pipeline, descriptor
+	// set, mesh and a depth bucket, so draws sharing state end up next to each other and front to back
+	// among themselves. Pipelines, sets and meshes are numbered in the order the frame first submits them.
+	//
+	// Every pipeline layout must have the global set at set 0, it is bound whenever the layout changes
+	class EngineRenderQueue
+	{
+	public:
+		static constexpr uint32_t PASS_BITS = 4;
+		static constexpr uint32_t PIPELINE_BITS = 12;
+		static constexpr uint32_t DESCRIPTOR_SET_BITS = 12;
+		static constexpr uint32_t MESH_BITS = 20;
+		static constexpr uint32_t DEPTH_BITS = 16;
+
+		// How a system binds a mesh and draws, drawIndex is what it submitted. Draws without a mesh may
+		// bind buffers themselves
+		struct Drawer
+		{
+			std::function<void(FrameInfo&, uint32_t drawIndex)> bindMesh;
+			std::function<void(FrameInfo&, uint32_t drawIndex)> draw;
+		};
+
+		struct Draw
+		{
+			RenderQueuePass pass;
+			EngPipeline* pipeline;
+			VkPipelineLayout pipelineLayout;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;	// bound at descriptorSetIndex, null for none
+			uint32_t descriptorSetIndex = 0;
+			const void* mesh = nullptr;	// identity only, bound through the drawer. Null for none
+			float depth = 0.f;	// distance from the camera
+			const Drawer* drawer;
+			uint32_t drawIndex;
+		};
+
+		// Binds recorded against those a draw by draw recording would have made. Reset every frame
+		struct Stats
+		{
+			uint32_t drawCount = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t pipelineBindsSaved = 0;
+			uint32_t descriptorSetBinds = 0;
+			uint32_t descriptorSetBindsSaved = 0;
+			uint32_t meshBinds = 0;
+			uint32_t meshBindsSaved = 0;
+		};
+
+		EngineRenderQueue() = default;
+
+		EngineRenderQueue(const EngineRenderQueue&) = delete;
+		EngineRenderQueue& operator=(const EngineRenderQueue&) = delete;
+
+		// Drops the previous frame's draws. Depths from zero to maxDepth get distinct buckets
+		void reset(float maxDepth);
+		void submit(const Draw& draw);
+		void sort();
+
+		// After sort, inside the pass's rendering
+		void record(FrameInfo& frameInfo, RenderQueuePass pass);
+
+		const Stats& getStats() const { return stats; }
+
+	private:
+		struct SortEntry
+		{
+			uint64_t key;
+			uint32_t draw;
+		};
+
+		// Pointers and handles are aligned, their low bits alone would probe badly
+		struct ObjectHash
+		{
+			size_t operator()(uint64_t object) const { return static_cast<size_t>(hashBytes(&object, sizeof(object))); }
+		};
+
+		using IdMap = EngineFlatHashMap<uint64_t, uint32_t, ObjectHash>;
+
+		std::vector<Draw> draws;
+		std::vector<SortEntry> entries;
+		std::vector<SortEntry> scratch;
+		bool sorted = false;
+		float maxDepth = 1.f;
+
+		// Numbering of this frame's state, in first submitted order
+		IdMap pipelineIds;
+		IdMap descriptorSetIds;
+		IdMap meshIds;
+
+		Stats stats{};
+
+		uint64_t makeKey(const Draw& draw);
+		void radixSort();
+
+		static uint32_t getId(IdMap& ids, uint64_t object, uint32_t bits);
+	};
+} // namespace
\ No newline at end of file
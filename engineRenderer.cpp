@@ -2,15 +2,21 @@
 
 #include <stdexcept>
 #include <cassert>
-#include <array>
+#include <algorithm>
+#include <chrono>
 
 namespace gameEngine
 {
 
 	EngineRenderer::EngineRenderer(EngineWindow& window, EngineDevice& device) : window{ window }, engDevice{ device }
 	{
-		recreateSwapChain();
+		if (!recreateSwapChain())
+		{
+			throw std::runtime_error("window has no area to create a swap chain for!");
+		}
+
 		createCommandBuffers();
+		latencyStats.measured = engDevice.supportsPresentWait();
 	}
 
 	EngineRenderer::~EngineRenderer()
@@ -42,40 +48,120 @@ namespace gameEngine
 		commandBuffers.clear();
 	}
 
-	void EngineRenderer::recreateSwapChain()
+	bool EngineRenderer::recreateSwapChain()
 	{
 		auto extent = window.getExtent();
 
-		while (extent.width == 0 || extent.height == 0)
+		// Tried again from beginFrame, the frames in flight retire the old swap chain meanwhile
+		if (extent.width == 0 || extent.height == 0)
 		{
-			extent = window.getExtent();
-			glfwWaitEvents();
+			swapChainOutOfDate = true;
+			return false;
 		}
 
-		vkDeviceWaitIdle(engDevice.getDevice());
-
-		//engSwapChain = nullptr;
+		auto start = std::chrono::high_resolution_clock::now();
 
 		if (engSwapChain == nullptr)
 		{
-			engSwapChain = std::make_unique<EngineSwapChain>(engDevice, extent);
+			engSwapChain = std::make_unique<EngineSwapChain>(engDevice, extent, presentPolicy);
 		}
 		else
 		{
 			std::shared_ptr<EngineSwapChain> oldSwapChain = std::move(engSwapChain);
-			engSwapChain = std::make_unique<EngineSwapChain>(engDevice, extent, oldSwapChain);
+			engSwapChain = std::make_unique<EngineSwapChain>(engDevice, extent, presentPolicy, oldSwapChain);
 
 			if (!oldSwapChain->compareSwapFormats(*engSwapChain.get()))
 			{
 				throw std::runtime_error("Swap chain image format has changed!");
 			}
 		}
+
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		recreateStats.count++;
+		recreateStats.totalMilliseconds += milliseconds;
+		recreateStats.maxMilliseconds = std::max(recreateStats.maxMilliseconds, milliseconds);
+
+		// Present ids start over with the new swap chain
+		latencySamples.clear();
+
+		swapChainOutOfDate = false;
+		return true;
+	}
+
+	void EngineRenderer::setPresentPolicy(PresentPolicy policy)
+	{
+		if (policy != presentPolicy)
+		{
+			presentPolicy = policy;
+			swapChainOutOfDate = true;
+		}
+	}
+
+	void EngineRenderer::syncInput()
+	{
+		if (latencyMode == LatencyMode::LowLatency && !swapChainOutOfDate)
+		{
+			uint64_t presentId = engSwapChain->getLastPresentId();
+
+			// A timeout or an out of date swap chain only means this frame isn't held back
+			if (presentId != 0)
+			{
+				engSwapChain->waitForPresent(presentId, PRESENT_WAIT_TIMEOUT);
+			}
+			else
+			{
+				engDevice.getGraphicsTimeline().wait(lastFrameValue);
+			}
+		}
+
+		collectLatencySamples();
+
+		inputTime = std::chrono::high_resolution_clock::now();
+		inputSampled = true;
+	}
+
+	void EngineRenderer::collectLatencySamples()
+	{
+		while (!latencySamples.empty())
+		{
+			const LatencySample& sample = latencySamples.front();
+			bool complete;
+
+			if (sample.presentId != 0)
+			{
+				VkResult result = engSwapChain->waitForPresent(sample.presentId, 0);
+				if (result == VK_TIMEOUT) break;
+
+				// Anything else than success means the frame won't be shown, it has no latency to report
+				complete = result == VK_SUCCESS;
+			}
+			else
+			{
+				if (!engDevice.getGraphicsTimeline().isComplete(sample.timelineValue)) break;
+				complete = true;
+			}
+
+			if (complete)
+			{
+				double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sample.inputTime).count();
+				latencyStats.sampleCount++;
+				latencyStats.totalMilliseconds += milliseconds;
+				latencyStats.maxMilliseconds = std::max(latencyStats.maxMilliseconds, milliseconds);
+			}
+
+			latencySamples.pop_front();
+		}
 	}
 
 	VkCommandBuffer EngineRenderer::beginFrame()
 	{
 		assert(!isFrameStarted && "Can't call beginFrame when already in progress");
 
+		if (swapChainOutOfDate && !recreateSwapChain())
+		{
+			return nullptr;
+		}
+
 		auto result = engSwapChain->acquireNextImage(&currentImageIndex);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR)
@@ -116,6 +202,13 @@ namespace gameEngine
 		}
 
 		auto result = engSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		lastFrameValue = engDevice.getGraphicsTimeline().getSubmittedValue();
+
+		if (inputSampled)
+		{
+			latencySamples.push_back({ inputTime, engSwapChain->getLastPresentId(), lastFrameValue });
+			inputSampled = false;
+		}
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.wasWindowResized())
 		{
@@ -129,48 +222,6 @@ namespace gameEngine
 
 		isFrameStarted = false;
 
-		currentFrameIndex = (currentFrameIndex + 1) & EngineSwapChain::MAX_FRAMES_IN_FLIGHT;
-	}
-
-	void EngineRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
-	{
-		assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
-		assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
-
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = engSwapChain->getRenderPass();
-		renderPassInfo.framebuffer = engSwapChain->getFrameBuffer(currentImageIndex);
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = engSwapChain->getSwapChainExtent();
-
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
-		clearValues[1].depthStencil = { 1.0f, 0 };
-
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
-
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(engSwapChain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(engSwapChain->getSwapChainExtent().height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		VkRect2D scissor{ {0, 0}, engSwapChain->getSwapChainExtent() };
-
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-	}
-
-	void EngineRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
-	{
-		assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-		assert(commandBuffer == getCurrentCommandBuffer() && "Can't end render pass on command buffer from a different frame");
-
-		vkCmdEndRenderPass(commandBuffer);
+		currentFrameIndex = (currentFrameIndex + 1) % EngineSwapChain::MAX_FRAMES_IN_FLIGHT;
 	}
 } // namespace
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include "engineDevice.h"
 #include "engineSwapchain.h"
 
+#include <chrono>
+#include <deque>
 #include <memory>
 #include <vector>
 #include <cassert>
@@ -11,25 +13,88 @@
 namespace gameEngine
 {
 
+	// LowLatency keeps at most one frame queued ahead of the display: syncInput waits until the last frame
+	// was presented (or finished on the GPU without VK_KHR_present_wait) before input is sampled
+	enum class LatencyMode
+	{
+		Throughput,
+		LowLatency,
+	};
+
 	class EngineRenderer
 	{
 	public:
+		// Upper bound of the presentation wait in low latency mode, so a hidden window never stalls the loop
+		static constexpr uint64_t PRESENT_WAIT_TIMEOUT = 100'000'000;
+
+		// Time from syncInput to the frame being presented, measured with VK_KHR_present_wait, otherwise to
+		// the frame completing on the GPU. Completion is noticed on the next poll, so frames that aren't
+		// waited for are overestimated by up to a frame
+		struct LatencyStats
+		{
+			uint32_t sampleCount = 0;
+			double totalMilliseconds = 0.0;
+			double maxMilliseconds = 0.0;
+			bool measured = false;
+
+			double getAverageMilliseconds() const { return sampleCount > 0 ? totalMilliseconds / sampleCount : 0.0; }
+		};
+
+		// Swap chains created so far and the CPU time it took, for the resize benchmark
+		struct RecreateStats
+		{
+			uint32_t count = 0;
+			double totalMilliseconds = 0.0;
+			double maxMilliseconds = 0.0;
+		};
+
 		EngineRenderer(EngineWindow& window, EngineDevice& device);
 		~EngineRenderer();
 
 		EngineRenderer(const EngineRenderer&) = delete;
 		EngineRenderer& operator=(const EngineRenderer&) = delete;
 
-		VkRenderPass getSwapChainRenderPass() const { return engSwapChain->getRenderPass(); }
 		float getAspectRatio() const { return engSwapChain->extentAspectRatio(); }
+		VkExtent2D getSwapChainExtent() const { return engSwapChain->getSwapChainExtent(); }
+
+		VkFormat getSwapChainImageFormat() const { return engSwapChain->getSwapChainImageFormat(); }
+		VkFormat getSwapChainDepthFormat() const { return engSwapChain->getSwapChainDepthFormat(); }
 
 		VkCommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
-		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+
+		// The image acquired for the frame in progress, the frame's render graph draws into it and leaves it
+		// ready to present
+		VkImage getSwapChainImage() const
+		{
+			assert(isFrameStarted && "Cannot get swap chain image when frame not in progress");
+			return engSwapChain->getImage(currentImageIndex);
+		}
+
+		VkImageView getSwapChainImageView() const
+		{
+			assert(isFrameStarted && "Cannot get swap chain image view when frame not in progress");
+			return engSwapChain->getImageView(currentImageIndex);
+		}
 
 		bool isFrameInProgress() const { return isFrameStarted; }
 
+		// Minimized windows have no swap chain to draw to, beginFrame returns null until they are restored
+		bool isSwapChainOutOfDate() const { return swapChainOutOfDate; }
+		const RecreateStats& getRecreateStats() const { return recreateStats; }
+
+		// Takes effect with the next frame, which recreates the swap chain
+		void setPresentPolicy(PresentPolicy policy);
+		PresentPolicy getPresentPolicy() const { return presentPolicy; }
+
+		void setLatencyMode(LatencyMode mode) { latencyMode = mode; }
+		LatencyMode getLatencyMode() const { return latencyMode; }
+
+		// Call right before polling input. Waits in low latency mode, then marks the time input was sampled
+		// for the next frame's latency sample
+		void syncInput();
+		const LatencyStats& getLatencyStats() const { return latencyStats; }
+
 		int getFrameIndex() const
 		{
 			assert(isFrameStarted && "Cannot get frame index when frame not in progress");
@@ -51,9 +116,27 @@ namespace gameEngine
 		uint32_t currentImageIndex;
 		int currentFrameIndex{ 0 };
 		bool isFrameStarted = false;
+		bool swapChainOutOfDate = false;
+		RecreateStats recreateStats{};
+
+		struct LatencySample
+		{
+			std::chrono::high_resolution_clock::time_point inputTime;
+			uint64_t presentId;	// 0 without present wait
+			uint64_t timelineValue;
+		};
+
+		PresentPolicy presentPolicy = PresentPolicy::Mailbox;
+		LatencyMode latencyMode = LatencyMode::Throughput;
+		std::chrono::high_resolution_clock::time_point inputTime{};
+		bool inputSampled = false;
+		uint64_t lastFrameValue = 0;
+		std::deque<LatencySample> latencySamples;
+		LatencyStats latencyStats{};
 
 		void createCommandBuffers();
 		void freeCommandBuffers();
-		void recreateSwapChain();
+		bool recreateSwapChain();
+		void collectLatencySamples();
 	};
 } // namespace
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "engineRingBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace gameEngine
+{
+	VkDeviceSize EngineRingBuffer::alignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	EngineRingBuffer::EngineRingBuffer(EngineDevice& device, VkDeviceSize frameSize, uint32_t frameCount, VkBufferUsageFlags usageFlags)
+		: engDevice{ device }, frameCount{ frameCount }
+	{
+		auto& limits = device.properties.limits;
+
+		alignment = 4;
+
+		if (usageFlags & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+		{
+			alignment = std::max(alignment, limits.minUniformBufferOffsetAlignment);
+		}
+
+		if (usageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+		{
+			alignment = std::max(alignment, limits.minStorageBufferOffsetAlignment);
+		}
+
+		// Slots start on a nonCoherentAtomSize boundary so a frame can be flushed without touching its neighbours
+		atomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+		this->frameSize = alignUp(alignUp(frameSize, alignment), atomSize);
+
+		buffer = std::make_unique<EngineBuffer>(device, this->frameSize, frameCount, usageFlags,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+		if (buffer->map() != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to map ring buffer!");
+		}
+	}
+
+	EngineRingBuffer::~EngineRingBuffer() {}
+
+	/**
+	 * Rewind the slot belonging to frameIndex. Only call once that frame's timeline value has completed,
+	 * which EngineRenderer::beginFrame guarantees for the index it hands out
+	 */
+	void EngineRingBuffer::beginFrame(int frameIndex)
+	{
+		assert(frameIndex >= 0 && static_cast<uint32_t>(frameIndex) < frameCount && "Frame index out of range");
+
+		frameBase = frameSize * frameIndex;
+		head = frameBase;
+		flushedHead = frameBase;
+	}
+
+	EngineRingBuffer::Allocation EngineRingBuffer::allocate(VkDeviceSize size)
+	{
+		VkDeviceSize offset = alignUp(head, alignment);
+
+		if (offset + size > frameBase + frameSize)
+		{
+			throw std::runtime_error("ring buffer frame slot overflow!");
+		}
+
+		head = offset + size;
+
+		Allocation allocation{};
+		allocation.mapped = static_cast<char*>(buffer->getMappedMemory()) + offset;
+		allocation.offset = offset;
+		allocation.size = size;
+		return allocation;
+	}
+
+	EngineRingBuffer::Allocation EngineRingBuffer::push(const void* data, VkDeviceSize size)
+	{
+		Allocation allocation = allocate(size);
+		memcpy(allocation.mapped, data, size);
+		return allocation;
+	}
+
+	/**
+	 * Flush everything pushed since the last flush with a single range, rounded out to nonCoherentAtomSize
+	 *
+	 * @note Only required for non-coherent memory, but cheap enough to always call once per frame
+	 */
+	VkResult EngineRingBuffer::flush()
+	{
+		if (head == flushedHead)
+		{
+			return VK_SUCCESS;
+		}
+
+		VkDeviceSize offset = flushedHead & ~(atomSize - 1);
+		VkDeviceSize end = std::min(alignUp(head, atomSize), frameBase + frameSize);
+		flushedHead = head;
+
+		return buffer->flush(end - offset, offset);
+	}
+} // namespace
\ No newline at end of file
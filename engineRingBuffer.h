@@ -0,0 +1,62 @@
+#pragma once
+
+#include "engineBuffer.h"
+#include "engineDevice.h"
+
+#include <memory>
+
+namespace gameEngine
+{
+
+	// Linear per-frame allocator over one persistently mapped buffer. Each frame in flight owns a slot of
+	// frameSize bytes, pushes are bump allocated inside the current slot and the slot is rewound when the
+	// frame that last used it has finished on the GPU
+	class EngineRingBuffer
+	{
+	public:
+		struct Allocation
+		{
+			void* mapped = nullptr;
+			VkDeviceSize offset = 0;	// from the start of the buffer, usable directly as a dynamic offset
+			VkDeviceSize size = 0;
+		};
+
+		EngineRingBuffer(EngineDevice& device, VkDeviceSize frameSize, uint32_t frameCount, VkBufferUsageFlags usageFlags);
+		~EngineRingBuffer();
+
+		EngineRingBuffer(const EngineRingBuffer&) = delete;
+		EngineRingBuffer& operator=(const EngineRingBuffer&) = delete;
+
+		void beginFrame(int frameIndex);
+		Allocation allocate(VkDeviceSize size);
+		Allocation push(const void* data, VkDeviceSize size);
+		VkResult flush();
+
+		template<typename T>
+		uint32_t push(const T& value)
+		{
+			return static_cast<uint32_t>(push(&value, sizeof(T)).offset);
+		}
+
+		VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const { return VkDescriptorBufferInfo{ buffer->getBuffer(), 0, range }; }
+		VkBuffer getBuffer() const { return buffer->getBuffer(); }
+		VkDeviceSize getAlignment() const { return alignment; }
+		VkDeviceSize getFrameSize() const { return frameSize; }
+		VkDeviceSize getUsedSize() const { return head - frameBase; }
+
+	private:
+		static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment);
+
+		EngineDevice& engDevice;
+		std::unique_ptr<EngineBuffer> buffer;
+
+		VkDeviceSize frameSize;
+		uint32_t frameCount;
+		VkDeviceSize alignment;
+		VkDeviceSize atomSize;
+
+		VkDeviceSize frameBase = 0;
+		VkDeviceSize head = 0;
+		VkDeviceSize flushedHead = 0;
+	};
+} // namespace
\ No newline at end of file
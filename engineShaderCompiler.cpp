@@ -0,0 +1,332 @@
+#include "engineShaderCompiler.h"
+#include "engineUtils.h"
+
+#include <shaderc/shaderc.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace gameEngine
+{
+	// Bump whenever compile options change so stale cache entries are ignored
+	static constexpr uint64_t SHADER_CACHE_VERSION = 2;
+
+	static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+	{
+		auto bytes = static_cast<const unsigned char*>(data);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+
+	static bool shaderKindFromPath(const std::filesystem::path& filepath, shaderc_shader_kind& kind)
+	{
+		auto extension = filepath.extension().string();
+
+		if (extension == ".vert") kind = shaderc_glsl_vertex_shader;
+		else if (extension == ".frag") kind = shaderc_glsl_fragment_shader;
+		else if (extension == ".comp") kind = shaderc_glsl_compute_shader;
+		else if (extension == ".task") kind = shaderc_glsl_task_shader;
+		else if (extension == ".mesh") kind = shaderc_glsl_mesh_shader;
+		else return false;
+
+		return true;
+	}
+
+	static bool readTextFile(const std::filesystem::path& filepath, std::string& contents)
+	{
+		std::ifstream file(filepath, std::ios::binary);
+
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		std::stringstream stream;
+		stream << file.rdbuf();
+		contents = stream.str();
+		return true;
+	}
+
+	EngineShaderCompiler::EngineShaderCompiler(const std::string& cacheDirectory) : cacheDirectory{ cacheDirectory }
+	{
+		std::filesystem::create_directories(this->cacheDirectory);
+		worker = std::thread([this]() { workerLoop(); });
+	}
+
+	EngineShaderCompiler::~EngineShaderCompiler()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ jobMutex };
+			stopping = true;
+		}
+
+		jobCondition.notify_all();
+		worker.join();
+	}
+
+	bool EngineShaderCompiler::isGlslSource(const std::string& filepath)
+	{
+		shaderc_shader_kind kind;
+		return shaderKindFromPath(filepath, kind);
+	}
+
+	EngineShaderCompiler::ResultFuture EngineShaderCompiler::compileAsync(const std::string& filepath, const Defines& defines)
+	{
+		Job job{ filepath, defines, {} };
+		ResultFuture result = job.promise.get_future().share();
+
+		{
+			std::lock_guard<std::mutex> lock{ jobMutex };
+			jobs.push_back(std::move(job));
+		}
+
+		jobCondition.notify_one();
+		return result;
+	}
+
+	std::vector<uint32_t> EngineShaderCompiler::compile(const std::string& filepath, const Defines& defines)
+	{
+		Result result = compileAsync(filepath, defines).get();
+
+		if (!result.success)
+		{
+			throw std::runtime_error("failed to compile shader " + filepath + ":\n" + result.log);
+		}
+
+		return result.spirv;
+	}
+
+	void EngineShaderCompiler::workerLoop()
+	{
+		while (true)
+		{
+			Job job;
+
+			{
+				std::unique_lock<std::mutex> lock{ jobMutex };
+				jobCondition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+				if (jobs.empty())
+				{
+					return;
+				}
+
+				job = std::move(jobs.front());
+				jobs.pop_front();
+			}
+
+			try
+			{
+				job.promise.set_value(compileNow(job.filepath, job.defines));
+			}
+			catch (...)
+			{
+				job.promise.set_exception(std::current_exception());
+			}
+		}
+	}
+
+	EngineShaderCompiler::Result EngineShaderCompiler::compileNow(const std::string& filepath, const Defines& defines)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		Result result{};
+
+		shaderc_shader_kind kind;
+		std::string source;
+
+		if (!shaderKindFromPath(filepath, kind))
+		{
+			result.log = "unknown shader stage for " + filepath;
+			return result;
+		}
+
+		if (!readTextFile(filepath, source))
+		{
+			result.log = "failed to open " + filepath;
+			return result;
+		}
+
+		// Cache key: source + stage + defines
+		uint64_t key = fnv1a(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+		key = fnv1a(source.data(), source.size(), key);
+		key = fnv1a(&kind, sizeof(kind), key);
+
+		for (auto& define : defines)
+		{
+			key = fnv1a(define.first.data(), define.first.size(), key);
+			key = fnv1a("=", 1, key);
+			key = fnv1a(define.second.data(), define.second.size(), key);
+			key = fnv1a("\n", 1, key);
+		}
+
+		std::stringstream cacheName;
+		cacheName << std::filesystem::path(filepath).filename().string() << "." << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+		auto cachePath = cacheDirectory / cacheName.str();
+
+		std::ifstream cached(cachePath, std::ios::ate | std::ios::binary);
+
+		if (cached.is_open() && cached.tellg() > 0 && cached.tellg() % sizeof(uint32_t) == 0)
+		{
+			result.spirv.resize(static_cast<size_t>(cached.tellg()) / sizeof(uint32_t));
+			cached.seekg(0);
+			cached.read(reinterpret_cast<char*>(result.spirv.data()), result.spirv.size() * sizeof(uint32_t));
+			result.success = cached.good();
+			result.cacheHit = result.success;
+		}
+
+		if (!result.success)
+		{
+			shaderc::Compiler compiler;
+			shaderc::CompileOptions options;
+			options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+			options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+			for (auto& define : defines)
+			{
+				options.AddMacroDefinition(define.first, define.second);
+			}
+
+			shaderc::SpvCompilationResult compiled = compiler.CompileGlslToSpv(source, kind, filepath.c_str(), options);
+			result.log = compiled.GetErrorMessage();
+
+			if (compiled.GetCompilationStatus() != shaderc_compilation_status_success)
+			{
+				return result;
+			}
+
+			result.spirv.assign(compiled.cbegin(), compiled.cend());
+			result.success = true;
+
+			// Write next to the final name and rename, so a crash can't leave a truncated cache entry
+			auto tempPath = cachePath;
+			tempPath += ".tmp";
+
+			{
+				std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+				out.write(reinterpret_cast<const char*>(result.spirv.data()), result.spirv.size() * sizeof(uint32_t));
+			}
+
+			std::error_code error;
+			std::filesystem::rename(tempPath, cachePath, error);
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+
+		if (verboseOutput)
+		{
+			std::cout << (result.cacheHit ? "Loaded cached " : "Compiled ") << filepath
+				<< " in " << result.milliseconds << " ms" << std::endl;
+		}
+
+		return result;
+	}
+
+	uint32_t EngineShaderCompiler::watch(const std::string& filepath, std::function<void()> onChanged)
+	{
+		uint32_t watchId = nextWatchId++;
+
+		auto it = watchedFiles.find(filepath);
+
+		if (it == watchedFiles.end())
+		{
+			WatchedFile watched{};
+			std::error_code error;
+			watched.lastWriteTime = std::filesystem::last_write_time(filepath, error);
+			it = watchedFiles.emplace(filepath, std::move(watched)).first;
+		}
+
+		it->second.listeners[watchId] = std::move(onChanged);
+		watchIds[watchId] = filepath;
+		return watchId;
+	}
+
+	void EngineShaderCompiler::unwatch(uint32_t watchId)
+	{
+		auto idIt = watchIds.find(watchId);
+
+		if (idIt == watchIds.end())
+		{
+			return;
+		}
+
+		auto fileIt = watchedFiles.find(idIt->second);
+		fileIt->second.listeners.erase(watchId);
+
+		if (fileIt->second.listeners.empty())
+		{
+			watchedFiles.erase(fileIt);
+		}
+
+		watchIds.erase(idIt);
+	}
+
+	void EngineShaderCompiler::pollChanges()
+	{
+		auto now = std::chrono::steady_clock::now();
+
+		if (now - lastPoll < POLL_INTERVAL)
+		{
+			return;
+		}
+
+		lastPoll = now;
+
+		for (auto& kv : watchedFiles)
+		{
+			auto& watched = kv.second;
+
+			if (watched.pending)
+			{
+				if (watched.pendingResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				{
+					continue;
+				}
+
+				watched.pending = false;
+				Result result = watched.pendingResult.get();
+
+				if (!result.success)
+				{
+					// Keep running with the last good pipelines until the source is fixed
+					std::cerr << "Shader reload failed for " << kv.first << ":\n" << result.log << std::endl;
+					continue;
+				}
+
+				if (verboseOutput)
+				{
+					std::cout << "Reloading pipelines using " << kv.first << std::endl;
+				}
+
+				for (auto& listener : watched.listeners)
+				{
+					listener.second();
+				}
+
+				continue;
+			}
+
+			std::error_code error;
+			auto writeTime = std::filesystem::last_write_time(kv.first, error);
+
+			if (error || writeTime == watched.lastWriteTime)
+			{
+				continue;
+			}
+
+			// Compile once up front to validate the edit, listeners rebuild their own variants afterwards
+			watched.lastWriteTime = writeTime;
+			watched.pending = true;
+			watched.pendingResult = compileAsync(kv.first);
+		}
+	}
+} // namespace
\ No newline at end of file
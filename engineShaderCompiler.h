@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Compiles GLSL to SPIR-V with shaderc on a worker thread. Results are cached on disk keyed by a hash of
+	// the source, stage and defines, so unchanged shaders skip compilation on the next start. Watched source
+	// files are polled for changes and listeners are told once the new version compiled cleanly
+	class EngineShaderCompiler
+	{
+	public:
+		using Defines = std::vector<std::pair<std::string, std::string>>;
+
+		struct Result
+		{
+			bool success = false;
+			bool cacheHit = false;
+			std::vector<uint32_t> spirv{};
+			std::string log{};
+			double milliseconds = 0.0;
+		};
+
+		using ResultFuture = std::shared_future<Result>;
+
+		EngineShaderCompiler(const std::string& cacheDirectory = "shaders/cache");
+		~EngineShaderCompiler();
+
+		EngineShaderCompiler(const EngineShaderCompiler&) = delete;
+		EngineShaderCompiler& operator=(const EngineShaderCompiler&) = delete;
+
+		static bool isGlslSource(const std::string& filepath);
+
+		ResultFuture compileAsync(const std::string& filepath, const Defines& defines = {});
+		std::vector<uint32_t> compile(const std::string& filepath, const Defines& defines = {});
+
+		uint32_t watch(const std::string& filepath, std::function<void()> onChanged);
+		void unwatch(uint32_t watchId);
+
+		// Call once per frame from the main thread, listeners are invoked from here
+		void pollChanges();
+
+	private:
+		struct Job
+		{
+			std::string filepath;
+			Defines defines;
+			std::promise<Result> promise;
+		};
+
+		struct WatchedFile
+		{
+			std::filesystem::file_time_type lastWriteTime;
+			std::unordered_map<uint32_t, std::function<void()>> listeners;
+			bool pending = false;
+			ResultFuture pendingResult;
+		};
+
+		static constexpr std::chrono::milliseconds POLL_INTERVAL{ 250 };
+
+		void workerLoop();
+		Result compileNow(const std::string& filepath, const Defines& defines);
+
+		std::filesystem::path cacheDirectory;
+
+		std::thread worker;
+		std::mutex jobMutex;
+		std::condition_variable jobCondition;
+		std::deque<Job> jobs;
+		bool stopping = false;
+
+		std::unordered_map<std::string, WatchedFile> watchedFiles;
+		std::unordered_map<uint32_t, std::string> watchIds;
+		uint32_t nextWatchId = 0;
+		std::chrono::steady_clock::time_point lastPoll{};
+	};
+} // namespace
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "engineSwapchain.h"
+#include "engineUtils.h"
 
-#include <array>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -11,28 +12,22 @@
 namespace gameEngine
 {
 
-	EngineSwapChain::EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent)
-		: device{ deviceRef }, windowExtent{ extent }
+	EngineSwapChain::EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, PresentPolicy policy)
+		: device{ deviceRef }, windowExtent{ extent }, presentPolicy{ policy }
 	{
 		init();
 	}
 
-	EngineSwapChain::EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<EngineSwapChain> previous)
-		: device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous }
+	EngineSwapChain::EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, PresentPolicy policy, std::shared_ptr<EngineSwapChain> previous)
+		: device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous }, presentPolicy{ policy }
 	{
 		init();
-
-		// clean up old swap chain
-		oldSwapChain = nullptr;
 	}
 
 	void EngineSwapChain::init()
 	{
 		createSwapChain();
 		createImageViews();
-		createRenderPass();
-		createDepthResources();
-		createFramebuffers();
 		createSyncObjects();
 	}
 
@@ -40,43 +35,37 @@ namespace gameEngine
 	{
 		for (auto imageView : swapChainImageViews)
 		{
-			vkDestroyImageView(device.getDevice(), imageView, nullptr);
-		}
-
-		swapChainImageViews.clear();
-
-		if (swapChain != nullptr)
-		{
-			vkDestroySwapchainKHR(device.getDevice(), swapChain, nullptr);
-			swapChain = nullptr;
+			device.notifyImageViewDestroyed(imageView);
 		}
 
-		for (int i = 0; i < depthImages.size(); i++)
-		{
-			vkDestroyImageView(device.getDevice(), depthImageViews[i], nullptr);
-			vkDestroyImage(device.getDevice(), depthImages[i], nullptr);
-			vkFreeMemory(device.getDevice(), depthImageMemorys[i], nullptr);
-		}
-
-		for (auto framebuffer : swapChainFramebuffers)
-		{
-			vkDestroyFramebuffer(device.getDevice(), framebuffer, nullptr);
-		}
-
-		vkDestroyRenderPass(device.getDevice(), renderPass, nullptr);
-
-		// cleanup syncronization objects
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
-		{
-			vkDestroySemaphore(device.getDevice(), renderFinishedSemaphores[i], nullptr);
-			vkDestroySemaphore(device.getDevice(), imageAvailableSemaphores[i], nullptr);
-			vkDestroyFence(device.getDevice(), inFlightFences[i], nullptr);
-		}
+		// Usually already complete, an old swap chain is only let go once a newer frame finished
+		device.deferDestruction([&device = device, swapChain = swapChain, imageViews = swapChainImageViews,
+			imageAvailableSemaphores = imageAvailableSemaphores, renderFinishedSemaphores = renderFinishedSemaphores]()
+			{
+				for (auto imageView : imageViews)
+				{
+					vkDestroyImageView(device.getDevice(), imageView, nullptr);
+				}
+
+				vkDestroySwapchainKHR(device.getDevice(), swapChain, nullptr);
+
+				for (size_t i = 0; i < imageAvailableSemaphores.size(); i++)
+				{
+					vkDestroySemaphore(device.getDevice(), renderFinishedSemaphores[i], nullptr);
+					vkDestroySemaphore(device.getDevice(), imageAvailableSemaphores[i], nullptr);
+				}
+			});
 	}
 
 	VkResult EngineSwapChain::acquireNextImage(uint32_t* imageIndex)
 	{
-		vkWaitForFences(device.getDevice(), 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+		device.getGraphicsTimeline().wait(inFlightValues[currentFrame]);
+
+		// Presents from the old swap chain were queued before this one's first frame
+		if (oldSwapChain != nullptr && firstFrameValue != 0 && device.getGraphicsTimeline().isComplete(firstFrameValue))
+		{
+			oldSwapChain = nullptr;
+		}
 
 		// imageAvailableSemaphores[currentFrame] must be a not signaled semaphore
 		VkResult result = vkAcquireNextImageKHR(device.getDevice(), swapChain, std::numeric_limits<uint64_t>::max(),
@@ -87,12 +76,7 @@ namespace gameEngine
 
 	VkResult EngineSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex)
 	{
-		if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
-		{
-			vkWaitForFences(device.getDevice(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-		}
-
-		imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+		device.getGraphicsTimeline().wait(imagesInFlight[*imageIndex]);
 
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -110,11 +94,13 @@ namespace gameEngine
 		submitInfo.signalSemaphoreCount = 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		vkResetFences(device.getDevice(), 1, &inFlightFences[currentFrame]);
+		uint64_t value = device.getGraphicsTimeline().submit(submitInfo);
+		inFlightValues[currentFrame] = value;
+		imagesInFlight[*imageIndex] = value;
 
-		if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
+		if (firstFrameValue == 0)
 		{
-			throw std::runtime_error("failed to submit draw command buffer!");
+			firstFrameValue = value;
 		}
 
 		VkPresentInfoKHR presentInfo{};
@@ -127,6 +113,19 @@ namespace gameEngine
 		presentInfo.pSwapchains = swapChains;
 		presentInfo.pImageIndices = imageIndex;
 
+		// Lets the renderer wait until this frame is on screen, see EngineRenderer::syncInput
+		VkPresentIdKHR presentIdInfo{};
+		uint64_t presentId = lastPresentId + 1;
+
+		if (device.supportsPresentWait())
+		{
+			presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+			presentIdInfo.swapchainCount = 1;
+			presentIdInfo.pPresentIds = &presentId;
+			presentInfo.pNext = &presentIdInfo;
+			lastPresentId = presentId;
+		}
+
 		auto result = vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
 
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -139,7 +138,7 @@ namespace gameEngine
 		SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
 		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-		VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+		presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 		VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
 		uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -195,6 +194,7 @@ namespace gameEngine
 		vkGetSwapchainImagesKHR(device.getDevice(), swapChain, &imageCount, swapChainImages.data());
 
 		swapChainImageFormat = surfaceFormat.format;
+		swapChainDepthFormat = findDepthFormat();
 		swapChainExtent = extent;
 	}
 
@@ -222,160 +222,28 @@ namespace gameEngine
 		}
 	}
 
-	void EngineSwapChain::createRenderPass() {
-		VkAttachmentDescription depthAttachment{};
-		depthAttachment.format = findDepthFormat();
-		depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-		VkAttachmentReference depthAttachmentRef{};
-		depthAttachmentRef.attachment = 1;
-		depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-		VkAttachmentDescription colorAttachment = {};
-		colorAttachment.format = getSwapChainImageFormat();
-		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-		VkAttachmentReference colorAttachmentRef = {};
-		colorAttachmentRef.attachment = 0;
-		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-		VkSubpassDescription subpass = {};
-		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-		subpass.colorAttachmentCount = 1;
-		subpass.pColorAttachments = &colorAttachmentRef;
-		subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-		VkSubpassDependency dependency = {};
-		dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-		dependency.srcAccessMask = 0;
-		dependency.srcStageMask =
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.dstSubpass = 0;
-		dependency.dstStageMask =
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-		dependency.dstAccessMask =
-			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-		std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
-		VkRenderPassCreateInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-		renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		renderPassInfo.pAttachments = attachments.data();
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = &subpass;
-		renderPassInfo.dependencyCount = 1;
-		renderPassInfo.pDependencies = &dependency;
-
-		if (vkCreateRenderPass(device.getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create render pass!");
-		}
-	}
-
-	void EngineSwapChain::createFramebuffers()
-	{
-		swapChainFramebuffers.resize(imageCount());
-
-		for (size_t i = 0; i < imageCount(); i++)
-		{
-			std::array<VkImageView, 2> attachments = { swapChainImageViews[i], depthImageViews[i] };
-
-			VkExtent2D swapChainExtent = getSwapChainExtent();
-
-			VkFramebufferCreateInfo framebufferInfo{};
-			framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-			framebufferInfo.renderPass = renderPass;
-			framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-			framebufferInfo.pAttachments = attachments.data();
-			framebufferInfo.width = swapChainExtent.width;
-			framebufferInfo.height = swapChainExtent.height;
-			framebufferInfo.layers = 1;
-
-			if (vkCreateFramebuffer(device.getDevice(), &framebufferInfo, nullptr, &swapChainFramebuffers[i]) != VK_SUCCESS)
-			{
-				throw std::runtime_error("failed to create framebuffer!");
-			}
-		}
-	}
-
-	void EngineSwapChain::createDepthResources()
-	{
-		VkFormat depthFormat = findDepthFormat();
-		swapChainDepthFormat = depthFormat;
-		VkExtent2D swapChainExtent = getSwapChainExtent();
-
-		depthImages.resize(imageCount());
-		depthImageMemorys.resize(imageCount());
-		depthImageViews.resize(imageCount());
-
-		for (int i = 0; i < depthImages.size(); i++)
-		{
-			VkImageCreateInfo imageInfo{};
-			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-			imageInfo.imageType = VK_IMAGE_TYPE_2D;
-			imageInfo.extent.width = swapChainExtent.width;
-			imageInfo.extent.height = swapChainExtent.height;
-			imageInfo.extent.depth = 1;
-			imageInfo.mipLevels = 1;
-			imageInfo.arrayLayers = 1;
-			imageInfo.format = depthFormat;
-			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			imageInfo.flags = 0;
-
-			device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImages[i], depthImageMemorys[i]);
-
-			VkImageViewCreateInfo viewInfo{};
-			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-			viewInfo.image = depthImages[i];
-			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-			viewInfo.format = depthFormat;
-			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			viewInfo.subresourceRange.baseMipLevel = 0;
-			viewInfo.subresourceRange.levelCount = 1;
-			viewInfo.subresourceRange.baseArrayLayer = 0;
-			viewInfo.subresourceRange.layerCount = 1;
-
-			if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS)
-			{
-				throw std::runtime_error("failed to create texture image view!");
-			}
-		}
-	}
-
 	void EngineSwapChain::createSyncObjects()
 	{
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-		imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+		inFlightValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
+		imagesInFlight.resize(imageCount(), 0);
+
+		// The renderer's command buffers and frame data follow the frame slots, which carry on from the old one
+		if (oldSwapChain != nullptr)
+		{
+			inFlightValues = oldSwapChain->inFlightValues;
+			currentFrame = oldSwapChain->currentFrame;
+		}
 
+		// Acquire and present only take binary semaphores, frame completion is tracked on the device's timeline
 		VkSemaphoreCreateInfo semaphoreInfo{};
 		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		VkFenceCreateInfo fenceInfo{};
-		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 		{
 			if (vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-				vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-				vkCreateFence(device.getDevice(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+				vkCreateSemaphore(device.getDevice(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS)
 			{
 				throw std::runtime_error("failed to create synchronization objects for a frame!");
 			}
@@ -397,28 +265,55 @@ namespace gameEngine
 
 	VkPresentModeKHR EngineSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
 	{
-		for (const auto& availablePresentMode : availablePresentModes)
+		// Closest modes first, FIFO is always there to end on
+		std::vector<VkPresentModeKHR> preferred{};
+
+		switch (presentPolicy)
 		{
-			if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-			{
-				std::cout << "Present mode: Mailbox" << std::endl;
-				return availablePresentMode;
-			}
+		case PresentPolicy::Fifo:
+			preferred = { VK_PRESENT_MODE_FIFO_KHR };
+			break;
+		case PresentPolicy::FifoRelaxed:
+			preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+			break;
+		case PresentPolicy::Mailbox:
+			preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR };
+			break;
+		case PresentPolicy::Immediate:
+			preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR };
+			break;
 		}
 
-		/*
-		for (const auto &availablePresentMode : availablePresentModes)
+		VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+
+		for (VkPresentModeKHR candidate : preferred)
 		{
-			if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR)
+			if (std::find(availablePresentModes.begin(), availablePresentModes.end(), candidate) != availablePresentModes.end())
 			{
-				std::cout << "Present mode: Immediate" << std::endl;
-				return availablePresentMode;
+				mode = candidate;
+				break;
 			}
 		}
-		*/
 
-		std::cout << "Present mode: V-Sync" << std::endl;
-		return VK_PRESENT_MODE_FIFO_KHR;
+		// Resizes recreate the swap chain many times, only changes are worth a line
+		if (verboseOutput && (oldSwapChain == nullptr || oldSwapChain->presentMode != mode))
+		{
+			std::cout << "Present mode: " << getPresentModeName(mode) << std::endl;
+		}
+
+		return mode;
+	}
+
+	const char* EngineSwapChain::getPresentModeName(VkPresentModeKHR mode)
+	{
+		switch (mode)
+		{
+		case VK_PRESENT_MODE_FIFO_KHR: return "FIFO (V-Sync)";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO relaxed";
+		case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+		case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+		default: return "Other";
+		}
 	}
 
 	VkExtent2D EngineSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities)
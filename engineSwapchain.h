@@ -11,23 +11,38 @@
 namespace gameEngine
 {
 
+	// Latency against power: Fifo waits for vblank and never tears, FifoRelaxed tears only frames that
+	// missed one, Mailbox never tears but renders as fast as it can and shows the newest frame, Immediate
+	// tears and has the least latency. Unsupported modes fall back to the closest one, Fifo always exists
+	enum class PresentPolicy
+	{
+		Fifo,
+		FifoRelaxed,
+		Mailbox,
+		Immediate,
+	};
+
+	// Recreated on resize without idling the device: the new swap chain is created from the old one, takes
+	// over its render pass when the formats match (so pipelines stay valid, with dynamic rendering there is
+	// none) and its frame slots. The old one stays alive until a frame presented from the new one completed,
+	// then retires its objects through the device's deletion queue
 	class EngineSwapChain
 	{
 	public:
 		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-		EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent);
-		EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, std::shared_ptr<EngineSwapChain> previous);
+		EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, PresentPolicy policy);
+		EngineSwapChain(EngineDevice& deviceRef, VkExtent2D extent, PresentPolicy policy, std::shared_ptr<EngineSwapChain> previous);
 		~EngineSwapChain();
 
 		EngineSwapChain(const EngineSwapChain&) = delete;
 		EngineSwapChain& operator=(const EngineSwapChain&) = delete;
 
-		VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-		VkRenderPass getRenderPass() { return renderPass; }
+		VkImage getImage(int index) { return swapChainImages[index]; }
 		VkImageView getImageView(int index) { return swapChainImageViews[index]; }
 		size_t imageCount() { return swapChainImages.size(); }
 		VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
+		VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
 		VkExtent2D getSwapChainExtent() { return swapChainExtent; }
 		uint32_t getWidth() { return swapChainExtent.width; }
 		uint32_t getHeight() { return swapChainExtent.height; }
@@ -38,6 +53,13 @@ namespace gameEngine
 		VkResult acquireNextImage(uint32_t* imageIndex);
 		VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
 
+		VkPresentModeKHR getPresentMode() const { return presentMode; }
+		static const char* getPresentModeName(VkPresentModeKHR mode);
+
+		// Id of the latest present, 0 without VK_KHR_present_wait. Ids start over with every swap chain
+		uint64_t getLastPresentId() const { return lastPresentId; }
+		VkResult waitForPresent(uint64_t presentId, uint64_t timeout) { return device.waitForPresent(swapChain, presentId, timeout); }
+
 		bool compareSwapFormats(const EngineSwapChain& swapChain) const
 		{
 			return swapChain.swapChainDepthFormat == swapChainDepthFormat && swapChain.swapChainImageFormat == swapChainImageFormat;
@@ -47,12 +69,7 @@ namespace gameEngine
 		VkFormat swapChainImageFormat;
 		VkFormat swapChainDepthFormat;
 		VkExtent2D swapChainExtent;
-		VkRenderPass renderPass;
 
-		std::vector<VkFramebuffer> swapChainFramebuffers;
-		std::vector<VkImage> depthImages;
-		std::vector<VkDeviceMemory> depthImageMemorys;
-		std::vector<VkImageView> depthImageViews;
 		std::vector<VkImage> swapChainImages;
 		std::vector<VkImageView> swapChainImageViews;
 
@@ -61,19 +78,21 @@ namespace gameEngine
 
 		VkSwapchainKHR swapChain;
 		std::shared_ptr<EngineSwapChain> oldSwapChain;
+		PresentPolicy presentPolicy;
+		VkPresentModeKHR presentMode;
+		uint64_t lastPresentId = 0;
 
 		std::vector<VkSemaphore> imageAvailableSemaphores;
 		std::vector<VkSemaphore> renderFinishedSemaphores;
-		std::vector<VkFence> inFlightFences;
-		std::vector<VkFence> imagesInFlight;
+		// Timeline values of the last submission per frame slot and per image, 0 when there was none
+		std::vector<uint64_t> inFlightValues;
+		std::vector<uint64_t> imagesInFlight;
+		uint64_t firstFrameValue = 0;	// releases oldSwapChain once complete
 
 		size_t currentFrame = 0;
 
 		void createSwapChain();
 		void createImageViews();
-		void createDepthResources();
-		void createRenderPass();
-		void createFramebuffers();
 		void createSyncObjects();
 		void init();
 
@@ -0,0 +1,521 @@
+#include "engineTexture.h"
+
+#include "engineKtx2.h"
+#include "engineTextureCompressor.h"
+#include "engineUtils.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	struct TextureFormatInfo
+	{
+		VkFormat format;
+		const char* name;
+		uint32_t blockBytes;
+		uint32_t blockDimension;
+		bool srgb;
+		bool decodable;
+		EngineTextureCompressor::BlockFormat blockFormat;
+	};
+
+	using BlockFormat = EngineTextureCompressor::BlockFormat;
+
+	static const TextureFormatInfo TEXTURE_FORMATS[] =
+	{
+		{ VK_FORMAT_R8G8B8A8_UNORM, "RGBA8", 4, 1, false, false, BlockFormat::BC1 },
+		{ VK_FORMAT_R8G8B8A8_SRGB, "RGBA8 sRGB", 4, 1, true, false, BlockFormat::BC1 },
+		{ VK_FORMAT_BC1_RGB_UNORM_BLOCK, "BC1", 8, 4, false, true, BlockFormat::BC1 },
+		{ VK_FORMAT_BC1_RGB_SRGB_BLOCK, "BC1 sRGB", 8, 4, true, true, BlockFormat::BC1 },
+		{ VK_FORMAT_BC1_RGBA_UNORM_BLOCK, "BC1 RGBA", 8, 4, false, true, BlockFormat::BC1 },
+		{ VK_FORMAT_BC1_RGBA_SRGB_BLOCK, "BC1 RGBA sRGB", 8, 4, true, true, BlockFormat::BC1 },
+		{ VK_FORMAT_BC5_UNORM_BLOCK, "BC5", 16, 4, false, true, BlockFormat::BC5 },
+		{ VK_FORMAT_BC7_UNORM_BLOCK, "BC7", 16, 4, false, true, BlockFormat::BC7 },
+		{ VK_FORMAT_BC7_SRGB_BLOCK, "BC7 sRGB", 16, 4, true, true, BlockFormat::BC7 },
+		{ VK_FORMAT_ASTC_4x4_UNORM_BLOCK, "ASTC 4x4", 16, 4, false, false, BlockFormat::BC1 },
+		{ VK_FORMAT_ASTC_4x4_SRGB_BLOCK, "ASTC 4x4 sRGB", 16, 4, true, false, BlockFormat::BC1 },
+	};
+
+	static const TextureFormatInfo& getFormatInfo(VkFormat format)
+	{
+		for (auto& info : TEXTURE_FORMATS)
+		{
+			if (info.format == format) return info;
+		}
+
+		throw std::runtime_error("unsupported texture format " + std::to_string(static_cast<int>(format)));
+	}
+
+	static bool isSampleable(EngineDevice& device, VkFormat format)
+	{
+		return (device.getFormatProperties(format).optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	}
+
+	EngineTexture::Pixels EngineTexture::Pixels::loadFromFile(const std::string& filepath, bool srgb)
+	{
+		if (filepath.size() >= 5 && filepath.compare(filepath.size() - 5, 5, ".ktx2") == 0)
+		{
+			return EngineKtx2::read(filepath);
+		}
+
+		int width, height, channels;
+		stbi_uc* data = stbi_load(filepath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+		if (data == nullptr)
+		{
+			throw std::runtime_error("failed to load texture " + filepath + ": " + stbi_failure_reason());
+		}
+
+		Pixels pixels{};
+		pixels.width = static_cast<uint32_t>(width);
+		pixels.height = static_cast<uint32_t>(height);
+		pixels.format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		pixels.data.assign(data, data + static_cast<size_t>(width) * height * 4);
+		pixels.levels.push_back({ 0, pixels.data.size() });
+
+		stbi_image_free(data);
+		return pixels;
+	}
+
+	EngineTexture::Pixels EngineTexture::Pixels::solid(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+	{
+		Pixels pixels{};
+		pixels.width = 1;
+		pixels.height = 1;
+		pixels.format = VK_FORMAT_R8G8B8A8_UNORM;
+		pixels.data = { r, g, b, a };
+		pixels.levels.push_back({ 0, 4 });
+		return pixels;
+	}
+
+	void EngineTexture::Pixels::decompressIfUnsupported(EngineDevice& device)
+	{
+		if (isSampleable(device, format))
+		{
+			return;
+		}
+
+		const TextureFormatInfo& info = getFormatInfo(format);
+
+		if (!info.decodable)
+		{
+			throw std::runtime_error(std::string("device can't sample ") + info.name + " textures");
+		}
+
+		std::vector<uint8_t> decoded;
+		std::vector<Level> decodedLevels;
+
+		for (uint32_t level = 0; level < levels.size(); level++)
+		{
+			std::vector<uint8_t> rgba = EngineTextureCompressor::decompress(info.blockFormat, data.data() + levels[level].offset,
+				getLevelWidth(level), getLevelHeight(level));
+
+			decodedLevels.push_back({ decoded.size(), rgba.size() });
+			decoded.insert(decoded.end(), rgba.begin(), rgba.end());
+		}
+
+		format = info.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		data = std::move(decoded);
+		levels = std::move(decodedLevels);
+	}
+
+	EngineTexture::Pixels EngineTexture::Pixels::encode(VkFormat targetFormat) const
+	{
+		assert(levels.size() == 1 && getBlockDimension(format) == 1 && "Only single level RGBA8 images can be encoded");
+
+		const TextureFormatInfo& info = getFormatInfo(targetFormat);
+		bool compressed = info.blockDimension > 1;
+
+		if (compressed && (!info.decodable || targetFormat == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || targetFormat == VK_FORMAT_BC1_RGBA_SRGB_BLOCK))
+		{
+			throw std::runtime_error(std::string("can't encode ") + info.name + " textures");
+		}
+
+		Pixels result{};
+		result.width = width;
+		result.height = height;
+		result.format = targetFormat;
+
+		std::vector<uint8_t> rgba = data;
+		uint32_t levelWidth = width;
+		uint32_t levelHeight = height;
+
+		for (uint32_t level = 0; level < getMipLevelCount(width, height); level++)
+		{
+			if (level > 0)
+			{
+				rgba = EngineTextureCompressor::downsample(rgba.data(), levelWidth, levelHeight, info.srgb, levelWidth, levelHeight);
+			}
+
+			std::vector<uint8_t> encoded = compressed ? EngineTextureCompressor::compress(info.blockFormat, rgba.data(), levelWidth, levelHeight) : rgba;
+
+			result.levels.push_back({ result.data.size(), encoded.size() });
+			result.data.insert(result.data.end(), encoded.begin(), encoded.end());
+		}
+
+		return result;
+	}
+
+	uint32_t EngineTexture::getBlockBytes(VkFormat format)
+	{
+		return getFormatInfo(format).blockBytes;
+	}
+
+	uint32_t EngineTexture::getBlockDimension(VkFormat format)
+	{
+		return getFormatInfo(format).blockDimension;
+	}
+
+	size_t EngineTexture::getLevelSize(VkFormat format, uint32_t width, uint32_t height)
+	{
+		const TextureFormatInfo& info = getFormatInfo(format);
+		size_t blocksX = (width + info.blockDimension - 1) / info.blockDimension;
+		size_t blocksY = (height + info.blockDimension - 1) / info.blockDimension;
+		return blocksX * blocksY * info.blockBytes;
+	}
+
+	bool EngineTexture::isSrgb(VkFormat format)
+	{
+		return getFormatInfo(format).srgb;
+	}
+
+	const char* EngineTexture::getFormatName(VkFormat format)
+	{
+		return getFormatInfo(format).name;
+	}
+
+	uint32_t EngineTexture::getMipLevelCount(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+
+		for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+		{
+			levels++;
+		}
+
+		return levels;
+	}
+
+	EngineTexture::EngineTexture(EngineDevice& device, const Pixels& pixels) : engDevice{ device }
+	{
+		std::vector<std::unique_ptr<EngineBuffer>> stagingBuffers;
+
+		VkCommandBuffer commandBuffer = engDevice.beginSingleTimeCommands();
+		recordUpload(pixels, commandBuffer, stagingBuffers);
+		engDevice.endSingleTimeCommands(commandBuffer);
+
+		setResident();
+	}
+
+	EngineTexture::EngineTexture(EngineDevice& device) : engDevice{ device }
+	{
+	}
+
+	EngineTexture::~EngineTexture()
+	{
+		if (imageView != VK_NULL_HANDLE)
+		{
+			engDevice.notifyImageViewDestroyed(imageView);
+		}
+
+		// Evicted while frames in flight still sample it
+		engDevice.deferDestruction([&device = engDevice, image = image, imageMemory = imageMemory, imageView = imageView]()
+			{
+				vkDestroyImageView(device.getDevice(), imageView, nullptr);
+				vkDestroyImage(device.getDevice(), image, nullptr);
+				device.freeMemory(imageMemory);
+			});
+	}
+
+	std::shared_ptr<EngineTexture> EngineTexture::createTextureFromFile(EngineDevice& device, const std::string& filepath, bool srgb)
+	{
+		auto texture = std::make_shared<EngineTexture>(device, Pixels::loadFromFile(filepath, srgb));
+		if (verboseOutput)
+		{
+			std::cout << filepath << ": " << texture->describe() << std::endl;
+		}
+
+		return texture;
+	}
+
+	void EngineTexture::recordUpload(const Pixels& pixels, VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<EngineBuffer>>& stagingBuffers)
+	{
+		assert(image == VK_NULL_HANDLE && "Texture was already uploaded");
+		assert(!pixels.levels.empty() && "Pixels need at least one level");
+
+		if (!isSampleable(engDevice, pixels.format))
+		{
+			Pixels decoded = pixels;
+			decoded.decompressIfUnsupported(engDevice);
+			recordUpload(decoded, commandBuffer, stagingBuffers);
+			return;
+		}
+
+		width = pixels.width;
+		height = pixels.height;
+		format = pixels.format;
+
+		// Levels that came with the image are copied as they are. Otherwise uncompressed images get the
+		// rest blitted, which needs linear filtering of the format; block compressed ones stay at one level
+		bool blockCompressed = getBlockDimension(format) > 1;
+		bool linearBlit = (engDevice.getFormatProperties(format).optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+		bool generateMips = pixels.levels.size() == 1 && !blockCompressed && linearBlit;
+		mipLevels = generateMips ? getMipLevelCount(width, height) : static_cast<uint32_t>(pixels.levels.size());
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { width, height, 1 };
+		imageInfo.mipLevels = mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (generateMips)
+		{
+			imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		}
+
+		engDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(engDevice.getDevice(), image, &memRequirements);
+		memorySize = memRequirements.size;
+
+		auto stagingBuffer = std::make_unique<EngineBuffer>(engDevice, 1, static_cast<uint32_t>(pixels.data.size()), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		stagingBuffer->map();
+		stagingBuffer->writeToBuffer(const_cast<uint8_t*>(pixels.data.data()));
+
+		// Every level starts out as a copy destination
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+
+		// Levels are packed back to back, their offsets stay multiples of the block size
+		std::vector<VkBufferImageCopy> regions(pixels.levels.size());
+
+		for (uint32_t level = 0; level < pixels.levels.size(); level++)
+		{
+			assert(pixels.levels[level].offset % getBlockBytes(format) == 0 && "Level offsets must be block aligned");
+
+			regions[level].bufferOffset = pixels.levels[level].offset;
+			regions[level].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			regions[level].imageExtent = { pixels.getLevelWidth(level), pixels.getLevelHeight(level), 1 };
+		}
+
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer->getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+		stagingBuffers.push_back(std::move(stagingBuffer));
+
+		if (generateMips)
+		{
+			recordMipChain(commandBuffer);
+		}
+		else
+		{
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		createImageView();
+	}
+
+	std::string EngineTexture::describe() const
+	{
+		VkDeviceSize rgbaSize = 0;
+
+		for (uint32_t level = 0; level < mipLevels; level++)
+		{
+			rgbaSize += getLevelSize(VK_FORMAT_R8G8B8A8_UNORM, std::max(width >> level, 1u), std::max(height >> level, 1u));
+		}
+
+		std::ostringstream stream;
+		stream << width << "x" << height << " " << getFormatName(format) << ", " << mipLevels << " mips, "
+			<< memorySize / 1024 << " KB (" << rgbaSize / 1024 << " KB as RGBA8)";
+		return stream.str();
+	}
+
+	void EngineTexture::recordMipChain(VkCommandBuffer commandBuffer)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		int32_t mipWidth = static_cast<int32_t>(width);
+		int32_t mipHeight = static_cast<int32_t>(height);
+
+		// Each level is read once it is complete, then handed to the fragment shader
+		for (uint32_t level = 1; level < mipLevels; level++)
+		{
+			barrier.subresourceRange.baseMipLevel = level - 1;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+
+			int32_t nextWidth = std::max(mipWidth / 2, 1);
+			int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+			VkImageBlit blit{};
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+
+			vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, VK_FILTER_LINEAR);
+
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+				0, nullptr, 0, nullptr, 1, &barrier);
+
+			mipWidth = nextWidth;
+			mipHeight = nextHeight;
+		}
+
+		// The last level was only ever written
+		barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	void EngineTexture::createImageView()
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = format;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+		if (vkCreateImageView(engDevice.getDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create texture image view!");
+		}
+	}
+
+	VkDescriptorImageInfo EngineTexture::descriptorInfo(VkSampler sampler) const
+	{
+		return VkDescriptorImageInfo{ sampler, imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+	}
+
+	bool EngineSamplerCache::Key::operator==(const Key& other) const
+	{
+		return std::memcmp(values, other.values, sizeof(values)) == 0;
+	}
+
+	size_t EngineSamplerCache::KeyHash::operator()(const Key& key) const
+	{
+		return static_cast<size_t>(hashBytes(key.values, sizeof(key.values)));
+	}
+
+	EngineSamplerCache::EngineSamplerCache(EngineDevice& device) : engDevice{ device }
+	{
+	}
+
+	EngineSamplerCache::~EngineSamplerCache()
+	{
+		samplers.forEach([this](const Key&, VkSampler& sampler) { vkDestroySampler(engDevice.getDevice(), sampler, nullptr); });
+	}
+
+	VkSampler EngineSamplerCache::get(const VkSamplerCreateInfo& createInfo)
+	{
+		assert(createInfo.pNext == nullptr && "Sampler create info chains aren't cached");
+
+		// Floats are compared bitwise, -0 and 0 only cost an extra sampler
+		auto bits = [](float value)
+			{
+				uint32_t result;
+				std::memcpy(&result, &value, sizeof(result));
+				return result;
+			};
+
+		Key key{ {
+			createInfo.flags, static_cast<uint32_t>(createInfo.magFilter), static_cast<uint32_t>(createInfo.minFilter),
+			static_cast<uint32_t>(createInfo.mipmapMode), static_cast<uint32_t>(createInfo.addressModeU),
+			static_cast<uint32_t>(createInfo.addressModeV), static_cast<uint32_t>(createInfo.addressModeW),
+			bits(createInfo.mipLodBias), createInfo.anisotropyEnable, bits(createInfo.maxAnisotropy),
+			createInfo.compareEnable, static_cast<uint32_t>(createInfo.compareOp), bits(createInfo.minLod), bits(createInfo.maxLod),
+			static_cast<uint32_t>(createInfo.borderColor), createInfo.unnormalizedCoordinates } };
+
+		if (VkSampler* cached = samplers.find(key))
+		{
+			return *cached;
+		}
+
+		VkSampler sampler;
+
+		if (vkCreateSampler(engDevice.getDevice(), &createInfo, nullptr, &sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create sampler!");
+		}
+
+		samplers.insert(key, sampler);
+		return sampler;
+	}
+
+	VkSampler EngineSamplerCache::getDefault()
+	{
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_LINEAR;
+		samplerInfo.minFilter = VK_FILTER_LINEAR;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		samplerInfo.anisotropyEnable = VK_TRUE;
+		samplerInfo.maxAnisotropy = engDevice.properties.limits.maxSamplerAnisotropy;
+		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+		samplerInfo.minLod = 0.f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+		samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+		return get(samplerInfo);
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "engineDevice.h"
+#include "engineBuffer.h"
+#include "engineFlatHashMap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Sampled 2D image with a full mip chain, RGBA8 or block compressed (BC1, BC5, BC7, ASTC 4x4). Images
+	// that come with their mips (KTX2 files, see EngineKtx2) have every level copied from a staging buffer.
+	// RGBA8 images with only level 0 get the rest blitted from the level above with a linear filter. All
+	// of it is recorded into one command buffer so uploads can be batched (see EngineAssetManager)
+	class EngineTexture
+	{
+	public:
+		// Image data, loaded on any thread
+		struct Pixels
+		{
+			struct Level
+			{
+				size_t offset = 0;
+				size_t size = 0;
+			};
+
+			uint32_t width = 0;
+			uint32_t height = 0;
+			VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+			std::vector<uint8_t> data{};	// every level, largest first
+			std::vector<Level> levels{};
+
+			// KTX2 files keep their own format and mips, srgb then only applies to other images
+			static Pixels loadFromFile(const std::string& filepath, bool srgb = true);
+			static Pixels solid(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
+
+			uint32_t getLevelWidth(uint32_t level) const { return std::max(width >> level, 1u); }
+			uint32_t getLevelHeight(uint32_t level) const { return std::max(height >> level, 1u); }
+			VkDeviceSize getUploadSize() const { return data.size(); }
+
+			// Block compressed data the device can't sample is decoded to RGBA8, level by level. Used
+			// where a transcoder would normally kick in
+			void decompressIfUnsupported(EngineDevice& device);
+
+			// Builds the mip chain of a single level RGBA8 image and encodes every level in format (RGBA8,
+			// BC1 RGB, BC5 or BC7), for offline import. Colors are filtered in linear space for sRGB formats
+			Pixels encode(VkFormat format) const;
+		};
+
+		static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+		// Texel block layout of a supported format, 1x1 blocks of 4 bytes for RGBA8. Throws for others
+		static uint32_t getBlockBytes(VkFormat format);
+		static uint32_t getBlockDimension(VkFormat format);
+		static size_t getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+		static bool isSrgb(VkFormat format);
+		static const char* getFormatName(VkFormat format);
+
+		// Uploads right away and waits for the copies to finish
+		EngineTexture(EngineDevice& device, const Pixels& pixels);
+
+		// An empty texture that isn't resident until pixels are uploaded into it, see EngineAssetManager
+		EngineTexture(EngineDevice& device);
+
+		~EngineTexture();
+
+		EngineTexture(const EngineTexture&) = delete;
+		EngineTexture& operator=(const EngineTexture&) = delete;
+
+		static std::shared_ptr<EngineTexture> createTextureFromFile(EngineDevice& device, const std::string& filepath, bool srgb = true);
+
+		// Creates the image, records the copy, the mip blits and the transition to shader reads. The staging
+		// buffer is appended to stagingBuffers and must live until commandBuffer completed, after which
+		// setResident is called
+		void recordUpload(const Pixels& pixels, VkCommandBuffer commandBuffer, std::vector<std::unique_ptr<EngineBuffer>>& stagingBuffers);
+		void setResident() { resident = true; }
+		bool isResident() const { return resident; }
+
+		VkDeviceSize getMemorySize() const { return memorySize; }
+		uint32_t getWidth() const { return width; }
+		uint32_t getHeight() const { return height; }
+		uint32_t getMipLevels() const { return mipLevels; }
+		VkFormat getFormat() const { return format; }
+		VkImageView getImageView() const { return imageView; }
+
+		// Size, format, mip count and memory against the same image in RGBA8, for load reports
+		std::string describe() const;
+
+		VkDescriptorImageInfo descriptorInfo(VkSampler sampler) const;
+
+	private:
+		EngineDevice& engDevice;
+
+		bool resident = false;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t mipLevels = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkDeviceSize memorySize = 0;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+
+		void recordMipChain(VkCommandBuffer commandBuffer);
+		void createImageView();
+	};
+
+	// Samplers are few and immutable, the cache hands out one per distinct create info and destroys them
+	// with itself. pNext chains aren't part of the key and must be null
+	class EngineSamplerCache
+	{
+	public:
+		EngineSamplerCache(EngineDevice& device);
+		~EngineSamplerCache();
+
+		EngineSamplerCache(const EngineSamplerCache&) = delete;
+		EngineSamplerCache& operator=(const EngineSamplerCache&) = delete;
+
+		VkSampler get(const VkSamplerCreateInfo& createInfo);
+
+		// Trilinear, repeating, with the device's maximum anisotropy
+		VkSampler getDefault();
+
+		size_t size() const { return samplers.size(); }
+
+	private:
+		// The create info minus sType and pNext, 4 byte fields only so it has no padding
+		struct Key
+		{
+			uint32_t values[16];
+
+			bool operator==(const Key& other) const;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		EngineDevice& engDevice;
+		EngineFlatHashMap<Key, VkSampler, KeyHash> samplers;
+	};
+} // namespace
\ No newline at end of file
@@ -0,0 +1,565 @@
+#include "engineTextureCompressor.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace gameEngine
+{
+	using Block = std::array<uint8_t, 64>;	// 16 texels, RGBA8
+
+	static constexpr uint8_t BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	static int square(int value) { return value * value; }
+
+	static void readBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+				uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+				std::memcpy(&block[(y * 4 + x) * 4], rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+			}
+		}
+	}
+
+	static void writeBlock(const Block& block, uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY)
+	{
+		for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+		{
+			for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+			{
+				std::memcpy(rgba + (static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4, &block[(y * 4 + x) * 4], 4);
+			}
+		}
+	}
+
+	// Endpoints along the principal axis of the block's colors, found by a few rounds of power iteration
+	// on their covariance. channels is 3 for RGB or 4 for RGBA
+	static void principalEndpoints(const Block& block, int channels, float low[4], float high[4])
+	{
+		float mean[4] = {};
+
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < channels; c++) mean[c] += block[i * 4 + c] / 16.f;
+		}
+
+		float covariance[4][4] = {};
+
+		for (int i = 0; i < 16; i++)
+		{
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = 0; b < channels; b++)
+				{
+					covariance[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+				}
+			}
+		}
+
+		float axis[4] = { 1.f, 1.f, 1.f, 1.f };
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.f;
+
+			for (int a = 0; a < channels; a++)
+			{
+				for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, std::abs(next[a]));
+			}
+
+			// Flat blocks have no axis, any direction gives the same single color
+			if (length < 1e-6f) break;
+
+			for (int c = 0; c < channels; c++) axis[c] = next[c] / length;
+		}
+
+		float minProjection = 0.f;
+		float maxProjection = 0.f;
+		float axisLength = 0.f;
+
+		for (int c = 0; c < channels; c++) axisLength += axis[c] * axis[c];
+
+		for (int i = 0; i < 16; i++)
+		{
+			float projection = 0.f;
+			for (int c = 0; c < channels; c++) projection += (block[i * 4 + c] - mean[c]) * axis[c];
+			projection /= axisLength;
+
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+
+		for (int c = 0; c < channels; c++)
+		{
+			low[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.f, 255.f);
+			high[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.f, 255.f);
+		}
+	}
+
+	static uint16_t packRgb565(const float color[3])
+	{
+		uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.f / 255.f));
+		uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.f / 255.f));
+		uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.f / 255.f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	static void unpackRgb565(uint16_t packed, uint8_t color[4])
+	{
+		uint32_t r = (packed >> 11) & 31;
+		uint32_t g = (packed >> 5) & 63;
+		uint32_t b = packed & 31;
+		color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+		color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+		color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+		color[3] = 255;
+	}
+
+	// color0 > color1 selects four colors, otherwise three plus transparent black. The encoder always
+	// writes the former
+	static void bc1Palette(uint16_t color0, uint16_t color1, uint8_t palette[4][4])
+	{
+		unpackRgb565(color0, palette[0]);
+		unpackRgb565(color1, palette[1]);
+
+		for (int c = 0; c < 4; c++)
+		{
+			palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+			palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+		}
+
+		if (color0 <= color1)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+				palette[3][c] = 0;
+			}
+		}
+	}
+
+	static void compressBc1(const Block& block, uint8_t* out)
+	{
+		float low[4], high[4];
+		principalEndpoints(block, 3, low, high);
+
+		uint16_t color0 = packRgb565(high);
+		uint16_t color1 = packRgb565(low);
+
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+
+		// Equal endpoints would select three color mode, every index 0 picks color0 either way
+		if (color0 != color1)
+		{
+			uint8_t palette[4][4];
+			bc1Palette(color0, color1, palette);
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+				int bestError = INT32_MAX;
+
+				for (int p = 0; p < 4; p++)
+				{
+					int error = square(block[i * 4] - palette[p][0]) + square(block[i * 4 + 1] - palette[p][1]) + square(block[i * 4 + 2] - palette[p][2]);
+
+					if (error < bestError)
+					{
+						best = p;
+						bestError = error;
+					}
+				}
+
+				indices |= static_cast<uint32_t>(best) << (i * 2);
+			}
+		}
+
+		std::memcpy(out, &color0, 2);
+		std::memcpy(out + 2, &color1, 2);
+		std::memcpy(out + 4, &indices, 4);
+	}
+
+	static void decompressBc1(const uint8_t* in, Block& block)
+	{
+		uint16_t color0, color1;
+		uint32_t indices;
+		std::memcpy(&color0, in, 2);
+		std::memcpy(&color1, in + 2, 2);
+		std::memcpy(&indices, in + 4, 4);
+
+		uint8_t palette[4][4];
+		bc1Palette(color0, color1, palette);
+
+		for (int i = 0; i < 16; i++)
+		{
+			std::memcpy(&block[i * 4], palette[(indices >> (i * 2)) & 3], 4);
+		}
+	}
+
+	static void bc4Palette(uint8_t value0, uint8_t value1, uint8_t palette[8])
+	{
+		palette[0] = value0;
+		palette[1] = value1;
+
+		if (value0 > value1)
+		{
+			for (int i = 1; i < 7; i++) palette[i + 1] = static_cast<uint8_t>(((7 - i) * value0 + i * value1 + 3) / 7);
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++) palette[i + 1] = static_cast<uint8_t>(((5 - i) * value0 + i * value1 + 2) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// One channel in 8 bytes: two endpoints and 3 bit indices into the eight values between them
+	static void compressBc4(const Block& block, int channel, uint8_t* out)
+	{
+		uint8_t minValue = 255;
+		uint8_t maxValue = 0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			minValue = std::min(minValue, block[i * 4 + channel]);
+			maxValue = std::max(maxValue, block[i * 4 + channel]);
+		}
+
+		uint64_t bits = static_cast<uint64_t>(maxValue) | (static_cast<uint64_t>(minValue) << 8);
+
+		if (maxValue > minValue)
+		{
+			uint8_t palette[8];
+			bc4Palette(maxValue, minValue, palette);
+
+			for (int i = 0; i < 16; i++)
+			{
+				int best = 0;
+
+				for (int p = 1; p < 8; p++)
+				{
+					if (std::abs(block[i * 4 + channel] - palette[p]) < std::abs(block[i * 4 + channel] - palette[best])) best = p;
+				}
+
+				bits |= static_cast<uint64_t>(best) << (16 + i * 3);
+			}
+		}
+
+		std::memcpy(out, &bits, 8);
+	}
+
+	static void decompressBc4(const uint8_t* in, int channel, Block& block)
+	{
+		uint64_t bits;
+		std::memcpy(&bits, in, 8);
+
+		uint8_t palette[8];
+		bc4Palette(static_cast<uint8_t>(bits), static_cast<uint8_t>(bits >> 8), palette);
+
+		for (int i = 0; i < 16; i++)
+		{
+			block[i * 4 + channel] = palette[(bits >> (16 + i * 3)) & 7];
+		}
+	}
+
+	// Appends count bits of value at bit position, least significant first
+	static void putBits(uint8_t* out, uint32_t& position, uint32_t value, uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; i++, position++)
+		{
+			out[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+		}
+	}
+
+	static uint32_t getBits(const uint8_t* in, uint32_t& position, uint32_t count)
+	{
+		uint32_t value = 0;
+
+		for (uint32_t i = 0; i < count; i++, position++)
+		{
+			value |= static_cast<uint32_t>((in[position / 8] >> (position % 8)) & 1) << i;
+		}
+
+		return value;
+	}
+
+	static void bc7Palette(const uint8_t endpoints[2][4], uint8_t palette[16][4])
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				palette[i][c] = static_cast<uint8_t>(((64 - BC7_WEIGHTS[i]) * endpoints[0][c] + BC7_WEIGHTS[i] * endpoints[1][c] + 32) >> 6);
+			}
+		}
+	}
+
+	// Mode 6: 7 bit RGBA endpoints sharing one extra low bit per endpoint, 4 bit indices
+	static void compressBc7(const Block& block, uint8_t* out)
+	{
+		float low[4], high[4];
+		principalEndpoints(block, 4, low, high);
+
+		uint8_t quantized[2][4];
+		uint8_t pBits[2];
+		uint8_t endpoints[2][4];
+
+		for (int e = 0; e < 2; e++)
+		{
+			const float* target = e == 0 ? low : high;
+			int bestError = INT32_MAX;
+
+			for (uint8_t p = 0; p < 2; p++)
+			{
+				int error = 0;
+				uint8_t candidate[4];
+
+				for (int c = 0; c < 4; c++)
+				{
+					candidate[c] = static_cast<uint8_t>(std::clamp(static_cast<int>(std::lround((target[c] - p) / 2.f)), 0, 127));
+					error += square(static_cast<int>(std::lround(target[c])) - ((candidate[c] << 1) | p));
+				}
+
+				if (error < bestError)
+				{
+					bestError = error;
+					pBits[e] = p;
+					std::memcpy(quantized[e], candidate, 4);
+				}
+			}
+
+			for (int c = 0; c < 4; c++) endpoints[e][c] = static_cast<uint8_t>((quantized[e][c] << 1) | pBits[e]);
+		}
+
+		uint8_t palette[16][4];
+		bc7Palette(endpoints, palette);
+
+		uint8_t indices[16];
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestError = INT32_MAX;
+
+			for (int p = 0; p < 16; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 4; c++) error += square(block[i * 4 + c] - palette[p][c]);
+
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = static_cast<uint8_t>(p);
+				}
+			}
+		}
+
+		// The first index is stored without its top bit, swapping the endpoints mirrors every index
+		if (indices[0] >= 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (auto& index : indices) index = static_cast<uint8_t>(15 - index);
+		}
+
+		std::memset(out, 0, 16);
+		uint32_t position = 0;
+
+		putBits(out, position, 1 << 6, 7);
+
+		for (int c = 0; c < 4; c++)
+		{
+			putBits(out, position, quantized[0][c], 7);
+			putBits(out, position, quantized[1][c], 7);
+		}
+
+		putBits(out, position, pBits[0], 1);
+		putBits(out, position, pBits[1], 1);
+
+		for (int i = 0; i < 16; i++)
+		{
+			putBits(out, position, indices[i], i == 0 ? 3 : 4);
+		}
+	}
+
+	static void decompressBc7(const uint8_t* in, Block& block)
+	{
+		// Mode is the number of zero bits before the first set one
+		if ((in[0] & 0x7f) != 1 << 6)
+		{
+			throw std::runtime_error("only mode 6 BC7 blocks can be decompressed");
+		}
+
+		uint32_t position = 7;
+		uint8_t quantized[2][4];
+
+		for (int c = 0; c < 4; c++)
+		{
+			quantized[0][c] = static_cast<uint8_t>(getBits(in, position, 7));
+			quantized[1][c] = static_cast<uint8_t>(getBits(in, position, 7));
+		}
+
+		uint8_t endpoints[2][4];
+
+		for (int e = 0; e < 2; e++)
+		{
+			uint32_t p = getBits(in, position, 1);
+			for (int c = 0; c < 4; c++) endpoints[e][c] = static_cast<uint8_t>((quantized[e][c] << 1) | p);
+		}
+
+		uint8_t palette[16][4];
+		bc7Palette(endpoints, palette);
+
+		for (int i = 0; i < 16; i++)
+		{
+			std::memcpy(&block[i * 4], palette[getBits(in, position, i == 0 ? 3 : 4)], 4);
+		}
+	}
+
+	uint32_t EngineTextureCompressor::getBlockBytes(BlockFormat format)
+	{
+		return format == BlockFormat::BC1 ? 8 : 16;
+	}
+
+	size_t EngineTextureCompressor::getCompressedSize(BlockFormat format, uint32_t width, uint32_t height)
+	{
+		size_t blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		size_t blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		return blocksX * blocksY * getBlockBytes(format);
+	}
+
+	std::vector<uint8_t> EngineTextureCompressor::compress(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> blocks(getCompressedSize(format, width, height));
+		uint32_t blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		uint32_t blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		uint8_t* out = blocks.data();
+		Block block;
+
+		for (uint32_t y = 0; y < blocksY; y++)
+		{
+			for (uint32_t x = 0; x < blocksX; x++, out += getBlockBytes(format))
+			{
+				readBlock(rgba, width, height, x, y, block);
+
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					compressBc1(block, out);
+					break;
+				case BlockFormat::BC5:
+					compressBc4(block, 0, out);
+					compressBc4(block, 1, out + 8);
+					break;
+				case BlockFormat::BC7:
+					compressBc7(block, out);
+					break;
+				}
+			}
+		}
+
+		return blocks;
+	}
+
+	std::vector<uint8_t> EngineTextureCompressor::decompress(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+		uint32_t blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		uint32_t blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+		const uint8_t* in = blocks;
+		Block block;
+
+		for (uint32_t y = 0; y < blocksY; y++)
+		{
+			for (uint32_t x = 0; x < blocksX; x++, in += getBlockBytes(format))
+			{
+				switch (format)
+				{
+				case BlockFormat::BC1:
+					decompressBc1(in, block);
+					break;
+				case BlockFormat::BC5:
+					for (int i = 0; i < 16; i++)
+					{
+						block[i * 4 + 2] = 0;
+						block[i * 4 + 3] = 255;
+					}
+
+					decompressBc4(in, 0, block);
+					decompressBc4(in + 8, 1, block);
+					break;
+				case BlockFormat::BC7:
+					decompressBc7(in, block);
+					break;
+				}
+
+				writeBlock(block, rgba.data(), width, height, x, y);
+			}
+		}
+
+		return rgba;
+	}
+
+	static float srgbToLinear(uint8_t value)
+	{
+		float v = value / 255.f;
+		return v <= .04045f ? v / 12.92f : std::pow((v + .055f) / 1.055f, 2.4f);
+	}
+
+	static uint8_t linearToSrgb(float value)
+	{
+		float v = value <= .0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - .055f;
+		return static_cast<uint8_t>(std::lround(std::clamp(v, 0.f, 1.f) * 255.f));
+	}
+
+	std::vector<uint8_t> EngineTextureCompressor::downsample(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, uint32_t& outWidth, uint32_t& outHeight)
+	{
+		outWidth = std::max(width / 2, 1u);
+		outHeight = std::max(height / 2, 1u);
+
+		std::vector<uint8_t> result(static_cast<size_t>(outWidth) * outHeight * 4);
+
+		for (uint32_t y = 0; y < outHeight; y++)
+		{
+			for (uint32_t x = 0; x < outWidth; x++)
+			{
+				// Odd sizes and 1 texel wide edges fold the missing texels onto the last ones
+				uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+				uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+				const uint8_t* texels[4] = {
+					rgba + (static_cast<size_t>(y0) * width + x0) * 4, rgba + (static_cast<size_t>(y0) * width + x1) * 4,
+					rgba + (static_cast<size_t>(y1) * width + x0) * 4, rgba + (static_cast<size_t>(y1) * width + x1) * 4 };
+
+				uint8_t* out = &result[(static_cast<size_t>(y) * outWidth + x) * 4];
+
+				for (int c = 0; c < 4; c++)
+				{
+					if (srgb && c < 3)
+					{
+						float sum = 0.f;
+						for (auto* texel : texels) sum += srgbToLinear(texel[c]);
+						out[c] = linearToSrgb(sum * .25f);
+					}
+					else
+					{
+						out[c] = static_cast<uint8_t>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+
+		return result;
+	}
+} // namespace
\ No newline at end of file
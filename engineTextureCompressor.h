@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Block compression of RGBA8 images into 4x4 texel blocks. BC1 keeps RGB in 8 bytes a block, BC5 keeps
+	// two independent channels (R and G, for normal maps) in 16 and BC7 keeps RGBA in 16. The BC7 encoder
+	// only writes mode 6 (one subset, RGBA endpoints, 4 bit indices), which is fast and good enough for
+	// most color textures; decompress handles the same modes and rejects other BC7 blocks.
+	// Images whose size isn't a multiple of 4 are padded by repeating the edge texels
+	class EngineTextureCompressor
+	{
+	public:
+		enum class BlockFormat
+		{
+			BC1,
+			BC5,
+			BC7,
+		};
+
+		static constexpr uint32_t BLOCK_DIMENSION = 4;
+
+		static uint32_t getBlockBytes(BlockFormat format);
+		static size_t getCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+
+		// rgba is width * height * 4 bytes, blocks come out row by row
+		static std::vector<uint8_t> compress(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height);
+		static std::vector<uint8_t> decompress(BlockFormat format, const uint8_t* blocks, uint32_t width, uint32_t height);
+
+		// Box filters rgba to half its size (at least 1x1). Color channels of sRGB images are averaged in
+		// linear space so mips don't darken
+		static std::vector<uint8_t> downsample(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb, uint32_t& outWidth, uint32_t& outHeight);
+	};
+} // namespace
\ No newline at end of file
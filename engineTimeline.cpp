@@ -0,0 +1,107 @@
+#include "engineTimeline.h"
+
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+namespace gameEngine
+{
+
+	EngineTimeline::EngineTimeline(VkDevice device, VkQueue queue) : device{ device }, queue{ queue }
+	{
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create timeline semaphore!");
+		}
+	}
+
+	EngineTimeline::~EngineTimeline()
+	{
+		// The semaphore can't be destroyed while submissions still signal it, errors don't matter here
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &submittedValue;
+		vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+
+		vkDestroySemaphore(device, semaphore, nullptr);
+	}
+
+	uint64_t EngineTimeline::submit(const VkSubmitInfo& submitInfo)
+	{
+		assert(submitInfo.pNext == nullptr && "Timeline submissions can't carry other structures");
+
+		uint64_t value = submittedValue + 1;
+
+		std::vector<VkSemaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+		signalSemaphores.push_back(semaphore);
+
+		// Values of binary semaphores are ignored but the arrays have to cover them
+		std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+		signalValues.back() = value;
+		std::vector<uint64_t> waitValues(submitInfo.waitSemaphoreCount, 0);
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+		timelineInfo.pWaitSemaphoreValues = waitValues.data();
+		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+		VkSubmitInfo timelineSubmit = submitInfo;
+		timelineSubmit.pNext = &timelineInfo;
+		timelineSubmit.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		timelineSubmit.pSignalSemaphores = signalSemaphores.data();
+
+		if (vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit command buffer!");
+		}
+
+		submittedValue = value;
+		return value;
+	}
+
+	uint64_t EngineTimeline::getCompletedValue()
+	{
+		vkGetSemaphoreCounterValue(device, semaphore, &completedValue);
+		return completedValue;
+	}
+
+	bool EngineTimeline::isComplete(uint64_t value)
+	{
+		// Values already seen complete don't need another query
+		return value <= completedValue || value <= getCompletedValue();
+	}
+
+	void EngineTimeline::wait(uint64_t value)
+	{
+		if (value <= completedValue)
+		{
+			return;
+		}
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore;
+		waitInfo.pValues = &value;
+
+		if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to wait for timeline semaphore!");
+		}
+
+		completedValue = value;
+	}
+} // namespace
\ No newline at end of file
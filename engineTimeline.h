@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+
+namespace gameEngine
+{
+
+	// A timeline semaphore that every submission to one queue signals with the next value. Signals wait
+	// for all work submitted before them, so a completed value means that submission and everything
+	// earlier on the queue finished: frames, uploads and compute share one counter, resources are
+	// retired by comparing the value of their last use against getCompletedValue and the CPU can wait
+	// on any point without idling the queue. Submissions go through the main thread only
+	class EngineTimeline
+	{
+	public:
+		EngineTimeline(VkDevice device, VkQueue queue);
+		~EngineTimeline();
+
+		EngineTimeline(const EngineTimeline&) = delete;
+		EngineTimeline& operator=(const EngineTimeline&) = delete;
+
+		// Submits the batch with a signal of the next value added to its semaphores and returns that
+		// value. The batch's other semaphores must be binary and its pNext null
+		uint64_t submit(const VkSubmitInfo& submitInfo);
+
+		// Value of the latest submission, the point after which nothing submitted so far can run
+		uint64_t getSubmittedValue() const { return submittedValue; }
+
+		uint64_t getCompletedValue();
+		bool isComplete(uint64_t value);
+		void wait(uint64_t value);
+
+		VkSemaphore getSemaphore() const { return semaphore; }
+
+	private:
+		VkDevice device;
+		VkQueue queue;
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+
+		uint64_t submittedValue = 0;
+		uint64_t completedValue = 0;
+	};
+} // namespace
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "engineTransformHierarchy.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace gameEngine
+{
+
+	EngineTransformHierarchy::NodeId EngineTransformHierarchy::createNode(const glm::mat4& local, NodeId parent)
+	{
+		if (parent != INVALID_NODE && (parent >= nodeIndices.size() || nodeIndices[parent] == NO_INDEX))
+		{
+			throw std::runtime_error("invalid parent transform node");
+		}
+
+		NodeId node;
+
+		if (!freeNodes.empty())
+		{
+			node = freeNodes.back();
+			freeNodes.pop_back();
+		}
+		else
+		{
+			node = static_cast<NodeId>(nodeIndices.size());
+			nodeIndices.push_back(NO_INDEX);
+		}
+
+		uint32_t index = static_cast<uint32_t>(nodeIds.size());
+		nodeIndices[node] = index;
+
+		nodeIds.push_back(node);
+		parents.push_back(parent == INVALID_NODE ? NO_INDEX : nodeIndices[parent]);
+		subtreeEnds.push_back(index + 1);
+		flags.push_back(0);
+		locals.push_back(local);
+		worlds.push_back(local);
+
+		// A root appended at the end is a range of its own, children have to be placed in their parent's
+		if (parent == INVALID_NODE)
+		{
+			roots.push_back(index);
+		}
+		else
+		{
+			orderStale = true;
+		}
+
+		markDirty(index);
+		return node;
+	}
+
+	void EngineTransformHierarchy::destroyNode(NodeId node)
+	{
+		uint32_t index = nodeIndices[node];
+
+		// The position stays as a hole until the next sort
+		for (uint32_t i = 0; i < parents.size(); i++)
+		{
+			if (parents[i] == index && nodeIds[i] != INVALID_NODE)
+			{
+				parents[i] = parents[index];
+				markDirty(i);
+			}
+		}
+
+		nodeIds[index] = INVALID_NODE;
+		nodeIndices[node] = NO_INDEX;
+		freeNodes.push_back(node);
+		orderStale = true;
+	}
+
+	void EngineTransformHierarchy::setParent(NodeId node, NodeId parent)
+	{
+		uint32_t index = nodeIndices[node];
+		uint32_t parentIndex = parent == INVALID_NODE ? NO_INDEX : nodeIndices[parent];
+
+		for (uint32_t ancestor = parentIndex; ancestor != NO_INDEX; ancestor = parents[ancestor])
+		{
+			if (ancestor == index)
+			{
+				throw std::runtime_error("transform node can't be parented to itself or its descendants");
+			}
+		}
+
+		parents[index] = parentIndex;
+		orderStale = true;
+		markDirty(index);
+	}
+
+	EngineTransformHierarchy::NodeId EngineTransformHierarchy::getParent(NodeId node) const
+	{
+		uint32_t parentIndex = parents[nodeIndices[node]];
+		return parentIndex == NO_INDEX ? INVALID_NODE : nodeIds[parentIndex];
+	}
+
+	void EngineTransformHierarchy::setLocal(NodeId node, const glm::mat4& local)
+	{
+		uint32_t index = nodeIndices[node];
+		locals[index] = local;
+		markDirty(index);
+	}
+
+	// Ancestors already flagged have theirs flagged too, so the walk stops at the first one
+	void EngineTransformHierarchy::markDirty(uint32_t index)
+	{
+		flags[index] |= DIRTY;
+
+		for (uint32_t ancestor = parents[index]; ancestor != NO_INDEX && !(flags[ancestor] & DIRTY_DESCENDANT); ancestor = parents[ancestor])
+		{
+			flags[ancestor] |= DIRTY_DESCENDANT;
+		}
+	}
+
+	void EngineTransformHierarchy::sort()
+	{
+		const uint32_t count = static_cast<uint32_t>(nodeIds.size());
+
+		// Children of every position, grouped by parent in position order (counting sort)
+		std::vector<uint32_t> childOffsets(count + 1, 0);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (nodeIds[i] != INVALID_NODE && parents[i] != NO_INDEX) childOffsets[parents[i] + 1]++;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			childOffsets[i + 1] += childOffsets[i];
+		}
+
+		std::vector<uint32_t> children(childOffsets[count]);
+		std::vector<uint32_t> cursors(childOffsets.begin(), childOffsets.end() - 1);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (nodeIds[i] != INVALID_NODE && parents[i] != NO_INDEX) children[cursors[parents[i]]++] = i;
+		}
+
+		// Depth first with an explicit stack, chains can be far deeper than the call stack allows
+		std::vector<uint32_t> order{};
+		std::vector<uint32_t> newIndices(count, NO_INDEX);
+		std::vector<uint32_t> stack{};
+		order.reserve(count);
+
+		for (uint32_t root = 0; root < count; root++)
+		{
+			if (nodeIds[root] == INVALID_NODE || parents[root] != NO_INDEX) continue;
+
+			stack.push_back(root);
+
+			while (!stack.empty())
+			{
+				uint32_t index = stack.back();
+				stack.pop_back();
+
+				newIndices[index] = static_cast<uint32_t>(order.size());
+				order.push_back(index);
+
+				for (uint32_t c = childOffsets[index + 1]; c > childOffsets[index]; c--)
+				{
+					stack.push_back(children[c - 1]);
+				}
+			}
+		}
+
+		const uint32_t liveCount = static_cast<uint32_t>(order.size());
+
+		std::vector<NodeId> sortedIds(liveCount);
+		std::vector<uint32_t> sortedParents(liveCount);
+		std::vector<uint32_t> sortedEnds(liveCount, 1);
+		std::vector<uint8_t> sortedFlags(liveCount);
+		std::vector<glm::mat4> sortedLocals(liveCount);
+		std::vector<glm::mat4> sortedWorlds(liveCount);
+		roots.clear();
+
+		for (uint32_t i = 0; i < liveCount; i++)
+		{
+			uint32_t index = order[i];
+
+			sortedIds[i] = nodeIds[index];
+			sortedParents[i] = parents[index] == NO_INDEX ? NO_INDEX : newIndices[parents[index]];
+			sortedFlags[i] = flags[index];
+			sortedLocals[i] = locals[index];
+			sortedWorlds[i] = worlds[index];
+			nodeIndices[sortedIds[i]] = i;
+
+			if (sortedParents[i] == NO_INDEX) roots.push_back(i);
+		}
+
+		// Subtree sizes summed from the back, children always come after their parent
+		for (uint32_t i = liveCount; i-- > 0;)
+		{
+			if (sortedParents[i] != NO_INDEX) sortedEnds[sortedParents[i]] += sortedEnds[i];
+		}
+
+		for (uint32_t i = 0; i < liveCount; i++)
+		{
+			sortedEnds[i] += i;
+		}
+
+		nodeIds = std::move(sortedIds);
+		parents = std::move(sortedParents);
+		subtreeEnds = std::move(sortedEnds);
+		flags = std::move(sortedFlags);
+		locals = std::move(sortedLocals);
+		worlds = std::move(sortedWorlds);
+	}
+
+	void EngineTransformHierarchy::propagate(uint32_t begin, uint32_t end, uint32_t& updatedCount, uint32_t& skippedCount)
+	{
+		uint32_t index = begin;
+
+		while (index < end)
+		{
+			uint8_t flag = flags[index];
+
+			if (flag & DIRTY)
+			{
+				// Every parent in the range is either before it or the already computed one of index
+				uint32_t subtreeEnd = subtreeEnds[index];
+
+				for (uint32_t i = index; i < subtreeEnd; i++)
+				{
+					worlds[i] = parents[i] == NO_INDEX ? locals[i] : worlds[parents[i]] * locals[i];
+					flags[i] = 0;
+				}
+
+				updatedCount += subtreeEnd - index;
+				index = subtreeEnd;
+			}
+			else if (flag & DIRTY_DESCENDANT)
+			{
+				flags[index] = 0;
+				index++;
+			}
+			else
+			{
+				skippedCount += subtreeEnds[index] - index;
+				index = subtreeEnds[index];
+			}
+		}
+	}
+
+	void EngineTransformHierarchy::update(uint32_t threadCount)
+	{
+		stats = Stats{};
+
+		if (orderStale)
+		{
+			sort();
+			orderStale = false;
+			stats.sorted = true;
+		}
+
+		const uint32_t count = static_cast<uint32_t>(nodeIds.size());
+		stats.nodeCount = count;
+		stats.rootCount = static_cast<uint32_t>(roots.size());
+
+		if (threadCount == 0)
+		{
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		threadCount = std::min(threadCount, std::max(1u, count / MIN_NODES_PER_TASK));
+
+		// Ranges of whole root subtrees with about the same number of nodes each
+		std::vector<uint32_t> bounds{ 0 };
+		size_t root = 0;
+
+		for (uint32_t t = 1; t < threadCount; t++)
+		{
+			uint64_t target = static_cast<uint64_t>(count) * t / threadCount;
+
+			while (root < roots.size() && roots[root] < target) root++;
+
+			uint32_t bound = root < roots.size() ? roots[root] : count;
+			if (bound > bounds.back() && bound < count) bounds.push_back(bound);
+		}
+
+		bounds.push_back(count);
+		stats.taskCount = static_cast<uint32_t>(bounds.size() - 1);
+
+		if (stats.taskCount == 1)
+		{
+			propagate(0, count, stats.updatedCount, stats.skippedCount);
+			return;
+		}
+
+		std::vector<uint32_t> updatedCounts(stats.taskCount, 0);
+		std::vector<uint32_t> skippedCounts(stats.taskCount, 0);
+		std::vector<std::future<void>> tasks{};
+
+		for (uint32_t t = 0; t < stats.taskCount; t++)
+		{
+			tasks.push_back(std::async(std::launch::async, [&, t]()
+				{
+					propagate(bounds[t], bounds[t + 1], updatedCounts[t], skippedCounts[t]);
+				}));
+		}
+
+		for (uint32_t t = 0; t < stats.taskCount; t++)
+		{
+			tasks[t].get();
+			stats.updatedCount += updatedCounts[t];
+			stats.skippedCount += skippedCounts[t];
+		}
+	}
+
+	void EngineTransformHierarchy::benchmark(uint32_t nodeCount, uint32_t iterations)
+	{
+		using Builder = std::function<void(EngineTransformHierarchy&, const std::vector<glm::mat4>&)>;
+
+		constexpr uint32_t CHAIN_COUNT = 64;
+		constexpr uint32_t FAN_COUNT = 1024;
+
+		const uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+		nodeCount = std::max(nodeCount, FAN_COUNT * 2);
+
+		// Each node is parented to the last one of its chain, or to its fan's root
+		auto chains = [nodeCount](uint32_t chainCount)
+		{
+			return [nodeCount, chainCount](EngineTransformHierarchy& hierarchy, const std::vector<glm::mat4>& locals)
+			{
+				std::vector<NodeId> tails(chainCount, INVALID_NODE);
+
+				for (uint32_t i = 0; i < nodeCount; i++)
+				{
+					NodeId& tail = tails[static_cast<uint64_t>(i) * chainCount / nodeCount];
+					tail = hierarchy.createNode(locals[i], tail);
+				}
+			};
+		};
+
+		auto fans = [nodeCount](uint32_t fanCount)
+		{
+			return [nodeCount, fanCount](EngineTransformHierarchy& hierarchy, const std::vector<glm::mat4>& locals)
+			{
+				std::vector<NodeId> fanRoots(fanCount, INVALID_NODE);
+
+				for (uint32_t i = 0; i < nodeCount; i++)
+				{
+					NodeId& fanRoot = fanRoots[static_cast<uint64_t>(i) * fanCount / nodeCount];
+					NodeId node = hierarchy.createNode(locals[i], fanRoot);
+					if (fanRoot == INVALID_NODE) fanRoot = node;
+				}
+			};
+		};
+
+		std::vector<std::pair<std::string, Builder>> shapes
+		{
+			{ "deep, 1 chain", chains(1) },
+			{ "deep, " + std::to_string(CHAIN_COUNT) + " chains", chains(CHAIN_COUNT) },
+			{ "wide, 1 root", fans(1) },
+			{ "wide, " + std::to_string(FAN_COUNT) + " roots", fans(FAN_COUNT) },
+		};
+
+		// Small rigid steps so a million of them in a row stay finite, fixed seed for comparable runs
+		std::mt19937 rng{ 42 };
+		std::uniform_real_distribution<float> offset{ -.01f, .01f };
+		std::uniform_real_distribution<float> angle{ -.01f, .01f };
+		std::vector<glm::mat4> locals(nodeCount);
+
+		for (auto& local : locals)
+		{
+			local = glm::rotate(glm::translate(glm::mat4{ 1.f }, { offset(rng), offset(rng), offset(rng) }), angle(rng), { 0.f, 1.f, 0.f });
+		}
+
+		// The same 1% of the nodes change in the sparse runs
+		std::vector<NodeId> sparseNodes(std::max(1u, nodeCount / 100));
+		std::uniform_int_distribution<NodeId> pick{ 0, nodeCount - 1 };
+
+		for (auto& node : sparseNodes)
+		{
+			node = pick(rng);
+		}
+
+		std::cout << "Transform hierarchy: " << nodeCount << " nodes, " << iterations << " iterations, " << hardwareThreads
+			<< " hardware threads" << std::endl;
+
+		for (auto& shape : shapes)
+		{
+			EngineTransformHierarchy hierarchy{};
+
+			auto start = std::chrono::high_resolution_clock::now();
+			shape.second(hierarchy, locals);
+			auto built = std::chrono::high_resolution_clock::now();
+			hierarchy.update(1);
+			auto sorted = std::chrono::high_resolution_clock::now();
+
+			std::vector<glm::mat4> reference = hierarchy.worlds;
+
+			// Best time of update alone, after marking either every root or the sparse nodes
+			auto timeUpdate = [&](uint32_t threadCount, bool sparse)
+			{
+				double bestSeconds = std::numeric_limits<double>::max();
+
+				for (uint32_t i = 0; i < std::max(1u, iterations); i++)
+				{
+					if (sparse)
+					{
+						for (NodeId node : sparseNodes) hierarchy.setLocal(node, hierarchy.getLocal(node));
+					}
+					else
+					{
+						for (uint32_t root : hierarchy.roots) hierarchy.flags[root] |= DIRTY;
+					}
+
+					auto updateStart = std::chrono::high_resolution_clock::now();
+					hierarchy.update(threadCount);
+					auto updateStop = std::chrono::high_resolution_clock::now();
+
+					bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(updateStop - updateStart).count());
+				}
+
+				return bestSeconds * 1000.0;
+			};
+
+			std::cout << "  " << shape.first << ": build " << std::chrono::duration<double, std::milli>(built - start).count()
+				<< " ms, sort and first update " << std::chrono::duration<double, std::milli>(sorted - built).count() << " ms" << std::endl;
+
+			for (bool sparse : { false, true })
+			{
+				double singleMilliseconds = timeUpdate(1, sparse);
+				Stats singleStats = hierarchy.getStats();
+				double parallelMilliseconds = timeUpdate(hardwareThreads, sparse);
+				Stats parallelStats = hierarchy.getStats();
+
+				std::cout << "    " << (sparse ? "1% dirty" : "all dirty") << ": 1 thread " << singleMilliseconds << " ms, "
+					<< parallelStats.taskCount << (parallelStats.taskCount == 1 ? " task " : " tasks ") << parallelMilliseconds << " ms, "
+					<< singleStats.updatedCount << " updated, " << singleStats.skippedCount << " skipped, "
+					<< nodeCount / (singleMilliseconds * 1000.0) << " M nodes/s on 1 thread"
+					<< (hierarchy.worlds == reference ? ", matches" : ", MISMATCH") << std::endl;
+			}
+		}
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Parent and child transforms kept as flat arrays in depth first order, so every parent comes before
+	// its children and every subtree is one contiguous range. update propagates world matrices in a single
+	// linear pass: a dirty node recomputes its whole range, a clean one without dirty descendants skips it.
+	// Root subtrees don't depend on each other and are split across threads.
+	//
+	// Nodes are referred to by ids that stay valid until destroyed. Structural changes (creating,
+	// destroying, reparenting) only mark the order stale, the next update sorts again in O(n). World
+	// matrices are those of the last update
+	class EngineTransformHierarchy
+	{
+	public:
+		using NodeId = uint32_t;
+
+		static constexpr NodeId INVALID_NODE = UINT32_MAX;
+
+		// Below this many nodes per thread update uses fewer threads
+		static constexpr uint32_t MIN_NODES_PER_TASK = 16384;
+
+		// Counters of the last update
+		struct Stats
+		{
+			uint32_t nodeCount = 0;
+			uint32_t rootCount = 0;
+			uint32_t updatedCount = 0;	// world matrices computed
+			uint32_t skippedCount = 0;	// nodes in clean subtrees that were jumped over
+			uint32_t taskCount = 0;
+			bool sorted = false;		// whether the order was rebuilt first
+		};
+
+		EngineTransformHierarchy() = default;
+
+		EngineTransformHierarchy(const EngineTransformHierarchy&) = delete;
+		EngineTransformHierarchy& operator=(const EngineTransformHierarchy&) = delete;
+
+		NodeId createNode(const glm::mat4& local = glm::mat4{ 1.f }, NodeId parent = INVALID_NODE);
+
+		// Children move up to the node's parent, keeping their local transforms
+		void destroyNode(NodeId node);
+
+		// INVALID_NODE makes it a root. Throws when parent is node or one of its descendants
+		void setParent(NodeId node, NodeId parent);
+		NodeId getParent(NodeId node) const;
+
+		// Relative to the parent, marks the node's subtree for the next update
+		void setLocal(NodeId node, const glm::mat4& local);
+		const glm::mat4& getLocal(NodeId node) const { return locals[nodeIndices[node]]; }
+		const glm::mat4& getWorld(NodeId node) const { return worlds[nodeIndices[node]]; }
+
+		// threadCount 0 uses every hardware thread
+		void update(uint32_t threadCount = 1);
+
+		size_t size() const { return nodeIds.size(); }
+		const Stats& getStats() const { return stats; }
+
+		// Largest axis scale of a world matrix, for bounding spheres
+		static float getMaxScale(const glm::mat4& world)
+		{
+			return glm::max(glm::length(glm::vec3(world[0])), glm::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+		}
+
+		// Builds hierarchies of nodeCount nodes, deep chains and wide fans, and times sorting, full
+		// updates and updates with a few dirty nodes, on one thread and on every hardware thread
+		static void benchmark(uint32_t nodeCount, uint32_t iterations);
+
+	private:
+		static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+		enum : uint8_t
+		{
+			DIRTY = 1,				// local changed, the whole subtree needs new world matrices
+			DIRTY_DESCENDANT = 2,	// somewhere below is a dirty node
+		};
+
+		// By node id, NO_INDEX for destroyed ones
+		std::vector<uint32_t> nodeIndices;
+		std::vector<NodeId> freeNodes;
+
+		// By position in depth first order, parents and subtree ends are positions too
+		std::vector<NodeId> nodeIds;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> subtreeEnds;
+		std::vector<uint8_t> flags;
+		std::vector<glm::mat4> locals;
+		std::vector<glm::mat4> worlds;
+
+		std::vector<uint32_t> roots;	// positions of the nodes without parent
+		bool orderStale = false;
+		Stats stats{};
+
+		void markDirty(uint32_t index);
+		void sort();
+		void propagate(uint32_t begin, uint32_t end, uint32_t& updatedCount, uint32_t& skippedCount);
+	};
+} // namespace
\ No newline at end of file
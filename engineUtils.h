@@ -1,8 +1,17 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
 namespace gameEngine
 {
 
+	// Set by --verbose. Per asset, per shader, per device and per pass diagnostics are printed only then,
+	// by default the output is the summary at exit
+	inline bool verboseOutput = false;
+
 	// from: https://stackoverflow.com/a/57595105
 	template <typename T, typename... Rest>
 	void hashCombine(std::size_t& seed, const T& v, const Rest&... rest)
@@ -10,4 +19,38 @@ namespace gameEngine
 		seed ^= std::hash<T>{}(v)+0x9e3779b9 + (seed << 6) + (seed >> 2);
 		(hashCombine(seed, rest), ...);
 	};
+
+	// Hash of raw bytes, 64 bit lanes mixed like xxHash64's rounds with a murmur3 finalizer. Meant for
+	// plain old data keys without padding
+	inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0)
+	{
+		constexpr uint64_t PRIME1 = 0x9e3779b185ebca87ull;
+		constexpr uint64_t PRIME2 = 0xc2b2ae3d27d4eb4full;
+
+		auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+
+		const auto* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed + PRIME1 + size;
+
+		for (; size >= 8; size -= 8, bytes += 8)
+		{
+			uint64_t lane;
+			std::memcpy(&lane, bytes, 8);
+			hash = rotl(hash ^ (rotl(lane * PRIME2, 31) * PRIME1), 27) * PRIME1 + PRIME2;
+		}
+
+		if (size > 0)
+		{
+			uint64_t lane = 0;
+			std::memcpy(&lane, bytes, size);
+			hash = rotl(hash ^ (rotl(lane * PRIME2, 31) * PRIME1), 27) * PRIME1 + PRIME2;
+		}
+
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		hash *= 0xc4ceb9fe1a85ec53ull;
+		hash ^= hash >> 33;
+		return hash;
+	}
 } // namespace
\ No newline at end of file
@@ -4,8 +4,12 @@
 #include "keyboardMovementController.h"
 #include "engineBuffer.h"
 #include "engineFrameInfo.h"
+#include "engineRingBuffer.h"
+#include "engineRenderGraph.h"
+#include "engineRenderQueue.h"
 #include "systems/simpleRenderSystem.h"
 #include "systems/pointLightSystem.h"
+#include "systems/shadowSystem.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -14,17 +18,26 @@
 
 #include <stdexcept>
 #include <chrono>
+#include <iostream>
 #include <cassert>
 #include <array>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
 
 namespace gameEngine
 {
 	FirstApp::FirstApp()
 	{
 		globalPool = EngineDescriptorPool::Builder(engDevice).setMaxSets(EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
 			.build();
 
+		descriptorCache = std::make_unique<EngineDescriptorSetCache>(engDevice);
+
 		loadGameObjects();
 	}
 
@@ -32,32 +45,319 @@ namespace gameEngine
 
 	void FirstApp::run()
 	{
-		std::vector<std::unique_ptr<EngineBuffer>> uboBuffers(EngineSwapChain::MAX_FRAMES_IN_FLIGHT);
-		for (int i = 0; i < uboBuffers.size(); i++)
+		mainLoop(nullptr);
+	}
+
+	void FirstApp::runLodBenchmark(uint32_t objectCount, uint32_t frameCount)
+	{
+		constexpr uint32_t WARMUP_FRAMES = 30;
+
+		auto vaseModel = EngineModel::createModelFromFile(engDevice, "models/smooth_vase.obj", EngineModel::VertexLayout::Compact, EngineModel::MAX_LODS);
+		float fieldSize = scatterObjects(vaseModel, objectCount);
+
+		struct PassResult
+		{
+			double seconds = 0.0;
+			uint64_t triangles = 0;
+			uint64_t draws = 0;
+			std::array<uint64_t, EngineModel::MAX_LODS> lodHistogram{};
+		};
+
+		std::array<PassResult, 2> results{};
+		uint32_t framesPerPass = WARMUP_FRAMES + frameCount;
+		uint32_t frame = 0;
+
+		mainLoop([&](float frameTime, GameObject& viewerObject, SimpleRenderSystem& simpleRenderSystem)
+			{
+				uint32_t pass = frame / framesPerPass;
+				uint32_t passFrame = frame % framesPerPass;
+
+				// Stats describe the frame rendered before this call
+				if (frame > 0)
+				{
+					uint32_t lastPass = (frame - 1) / framesPerPass;
+					uint32_t lastPassFrame = (frame - 1) % framesPerPass;
+
+					if (lastPassFrame >= WARMUP_FRAMES)
+					{
+						auto& stats = simpleRenderSystem.getStats();
+						auto& result = results[lastPass];
+
+						result.seconds += frameTime;
+						result.triangles += stats.triangleCount;
+						result.draws += stats.drawCount;
+
+						for (uint32_t i = 0; i < EngineModel::MAX_LODS; i++)
+						{
+							result.lodHistogram[i] += stats.lodHistogram[i];
+						}
+					}
+				}
+
+				if (pass >= results.size())
+				{
+					return false;
+				}
+
+				simpleRenderSystem.setLodEnabled(pass == 1);
+
+				// Orbit inside the field looking at its center, identical for both passes
+				float t = static_cast<float>(passFrame) / framesPerPass * glm::two_pi<float>();
+				float radius = fieldSize * .35f;
+				viewerObject.transform.translation = { radius * glm::cos(t), -2.f, radius * glm::sin(t) };
+				viewerObject.transform.rotation = { 0.f, glm::atan(-glm::cos(t), -glm::sin(t)), 0.f };
+
+				frame++;
+				return true;
+			});
+
+		const char* names[] = { "LOD off", "LOD on" };
+
+		std::cout << "LOD benchmark, " << objectCount << " objects, " << frameCount << " frames per pass" << std::endl;
+
+		for (size_t pass = 0; pass < results.size(); pass++)
 		{
-			uboBuffers[i] = std::make_unique<EngineBuffer>(engDevice, sizeof(GlobalUbo), 1,
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-			uboBuffers[i]->map();
+			auto& result = results[pass];
+			if (result.seconds <= 0.0) continue;
+
+			std::cout << "  " << names[pass] << ": " << result.seconds * 1000.0 / frameCount << " ms/frame, "
+				<< result.triangles / frameCount << " triangles/frame, "
+				<< result.triangles / result.seconds / 1e6 << " Mtris/s, " << result.draws / frameCount << " draws/frame" << std::endl;
 		}
 
-		auto globalSetLayout = EngineDescriptorSetLayout::Builder(engDevice)
-			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-			.build();
+		std::cout << "  LOD usage:";
+
+		for (uint32_t i = 0; i < EngineModel::MAX_LODS && i < vaseModel->getLodCount(); i++)
+		{
+			std::cout << " " << i << ": " << 100.0 * results[1].lodHistogram[i] / glm::max<uint64_t>(results[1].draws, 1) << "%";
+		}
+
+		std::cout << std::endl;
+	}
+
+	void FirstApp::runPrepassBenchmark(uint32_t objectCount, uint32_t frameCount)
+	{
+		constexpr uint32_t WARMUP_FRAMES = 30;
+
+		auto vaseModel = EngineModel::createModelFromFile(engDevice, "models/smooth_vase.obj", EngineModel::VertexLayout::Compact, EngineModel::MAX_LODS);
+		float fieldSize = scatterObjects(vaseModel, objectCount);
+
+		struct PassResult
+		{
+			double seconds = 0.0;
+			uint64_t draws = 0;
+			uint64_t prepassDraws = 0;
+			uint64_t fragmentInvocations = 0;
+			uint32_t queriedFrames = 0;
+		};
+
+		std::array<PassResult, 2> results{};
+		uint32_t framesPerPass = WARMUP_FRAMES + frameCount;
+		uint32_t frame = 0;
+		uint64_t startInvocations = 0;
+		uint32_t startQueriedFrames = 0;
+
+		mainLoop([&](float frameTime, GameObject& viewerObject, SimpleRenderSystem& simpleRenderSystem)
+			{
+				uint32_t pass = frame / framesPerPass;
+				uint32_t passFrame = frame % framesPerPass;
+
+				// Stats describe the frame rendered before this call
+				if (frame > 0 && (frame - 1) % framesPerPass >= WARMUP_FRAMES)
+				{
+					auto& stats = simpleRenderSystem.getStats();
+					auto& result = results[(frame - 1) / framesPerPass];
+
+					result.seconds += frameTime;
+					result.draws += stats.drawCount;
+					result.prepassDraws += stats.prepassDrawCount;
+				}
+
+				// Query results are read back a few frames late, the warmup frames absorb that lag at both ends
+				if (passFrame == WARMUP_FRAMES)
+				{
+					startInvocations = pipelineStatistics.getTotalFragmentInvocations();
+					startQueriedFrames = pipelineStatistics.getFrameCount();
+				}
+				else if (passFrame == 0 && pass > 0)
+				{
+					auto& result = results[pass - 1];
+					result.fragmentInvocations = pipelineStatistics.getTotalFragmentInvocations() - startInvocations;
+					result.queriedFrames = pipelineStatistics.getFrameCount() - startQueriedFrames;
+				}
+
+				if (pass >= results.size())
+				{
+					return false;
+				}
+
+				simpleRenderSystem.setDepthPrepassEnabled(pass == 1);
+
+				// Low inside the field, the nearest vases hide most of the others
+				float t = static_cast<float>(passFrame) / framesPerPass * glm::two_pi<float>();
+				float radius = fieldSize * .35f;
+				viewerObject.transform.translation = { radius * glm::cos(t), -2.f, radius * glm::sin(t) };
+				viewerObject.transform.rotation = { 0.f, glm::atan(-glm::cos(t), -glm::sin(t)), 0.f };
+
+				frame++;
+				return true;
+			});
+
+		const char* names[] = { "Prepass off", "Prepass on" };
+
+		std::cout << "Depth prepass benchmark, " << objectCount << " objects, " << frameCount << " frames per pass" << std::endl;
+
+		for (size_t pass = 0; pass < results.size(); pass++)
+		{
+			auto& result = results[pass];
+			if (result.seconds <= 0.0) continue;
+
+			std::cout << "  " << names[pass] << ": " << result.seconds * 1000.0 / frameCount << " ms/frame, "
+				<< result.draws / frameCount << " draws/frame, " << result.prepassDraws / frameCount << " prepass draws/frame";
+
+			if (result.queriedFrames > 0)
+			{
+				std::cout << ", " << result.fragmentInvocations / result.queriedFrames << " fragment shader invocations/frame";
+			}
+
+			std::cout << std::endl;
+		}
+
+		if (!pipelineStatistics.isSupported())
+		{
+			std::cout << "  Fragment shader invocations unavailable, the device has no pipeline statistics queries" << std::endl;
+		}
+		else if (results[0].queriedFrames > 0 && results[1].queriedFrames > 0 && results[0].fragmentInvocations > 0)
+		{
+			double before = static_cast<double>(results[0].fragmentInvocations) / results[0].queriedFrames;
+			double after = static_cast<double>(results[1].fragmentInvocations) / results[1].queriedFrames;
+
+			std::cout << "  Overdraw removed: " << 100.0 * (1.0 - after / before) << "% fewer fragment shader invocations" << std::endl;
+		}
+	}
+
+	void FirstApp::runResizeBenchmark(uint32_t resizeCount)
+	{
+		constexpr uint32_t WARMUP_FRAMES = 30;
+		constexpr uint32_t FRAMES_PER_SIZE = 20;
 
-		std::vector<VkDescriptorSet> globalDescriptorSets(EngineSwapChain::MAX_FRAMES_IN_FLIGHT);
+		// Back and forth between two sizes, like a window edge being dragged
+		const std::array<VkExtent2D, 2> sizes = { VkExtent2D{ WIDTH * 3 / 2, HEIGHT * 3 / 2 }, VkExtent2D{ WIDTH, HEIGHT } };
 
-		for (int i = 0; i < globalDescriptorSets.size(); i++)
+		std::vector<float> steadyFrames{};
+		std::vector<float> resizeFrames{};
+		EngineRenderer::RecreateStats before = engRenderer.getRecreateStats();
+		uint32_t lastRecreateCount = before.count;
+		uint32_t framesSinceRecreate = 2;
+		uint32_t frame = 0;
+
+		mainLoop([&](float frameTime, GameObject&, SimpleRenderSystem&)
+			{
+				// frameTime covers the frame before this call. It and the one after a recreation count as resize
+				// frames, the first frame of a new swap chain may still wait on the old one's
+				uint32_t recreateCount = engRenderer.getRecreateStats().count;
+				if (recreateCount != lastRecreateCount)
+				{
+					framesSinceRecreate = 0;
+				}
+				else if (framesSinceRecreate < 2)
+				{
+					framesSinceRecreate++;
+				}
+
+				lastRecreateCount = recreateCount;
+
+				if (frame > WARMUP_FRAMES)
+				{
+					(framesSinceRecreate < 2 ? resizeFrames : steadyFrames).push_back(frameTime * 1000.f);
+				}
+
+				if (frame >= WARMUP_FRAMES + resizeCount * FRAMES_PER_SIZE)
+				{
+					return false;
+				}
+
+				if (frame >= WARMUP_FRAMES && (frame - WARMUP_FRAMES) % FRAMES_PER_SIZE == 0)
+				{
+					const VkExtent2D& size = sizes[((frame - WARMUP_FRAMES) / FRAMES_PER_SIZE) % sizes.size()];
+					glfwSetWindowSize(window.getGLFWwindow(), static_cast<int>(size.width), static_cast<int>(size.height));
+				}
+
+				frame++;
+				return true;
+			});
+
+		auto printFrames = [](const char* name, const std::vector<float>& frames)
+			{
+				if (frames.empty()) return;
+
+				float total = 0.f;
+				for (float milliseconds : frames) total += milliseconds;
+
+				std::cout << "  " << name << ": " << frames.size() << " frames, " << total / frames.size() << " ms average, "
+					<< *std::max_element(frames.begin(), frames.end()) << " ms worst" << std::endl;
+			};
+
+		const EngineRenderer::RecreateStats& after = engRenderer.getRecreateStats();
+		uint32_t recreations = after.count - before.count;
+
+		std::cout << "Resize benchmark, " << resizeCount << " resizes, " << recreations << " swap chain recreations" << std::endl;
+		printFrames("Steady frames", steadyFrames);
+		printFrames("Resize frames", resizeFrames);
+
+		if (recreations > 0)
 		{
-			auto bufferInfo = uboBuffers[i]->descriptorInfo();
+			std::cout << "  Recreation: " << (after.totalMilliseconds - before.totalMilliseconds) / recreations << " ms average, "
+				<< after.maxMilliseconds << " ms worst" << std::endl;
+		}
+	}
 
-			EngineDescriptorWriter(*globalSetLayout, *globalPool)
-				.writeBuffer(0, &bufferInfo)
-				.build(globalDescriptorSets[i]);
+	void FirstApp::mainLoop(const FrameHook& frameHook)
+	{
+		// One persistently mapped buffer holds every frame's transient data, the global ubo included
+		EngineRingBuffer frameAllocator{ engDevice, FRAME_ALLOCATOR_SIZE, EngineSwapChain::MAX_FRAMES_IN_FLIGHT,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT };
+
+		// Meshlet culling reads the camera from compute and, when available, the task and mesh stages
+		VkShaderStageFlags globalStages = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+		if (engDevice.supportsMeshShaders())
+		{
+			globalStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
 		}
 
-		SimpleRenderSystem simpleRenderSystem{ engDevice, engRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
-		PointLightSystem pointLightSystem{ engDevice, engRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
+		auto globalSetLayout = EngineDescriptorSetLayout::Builder(engDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, globalStages)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build();
+
+		EngineRenderGraph renderGraph{ engDevice };
+		EngineRenderQueue renderQueue{};
+		ShadowSystem shadowSystem{ engDevice, shaderCompiler, samplerCache, renderGraph.getPipelineAttachments({}, ShadowSystem::ATLAS_FORMAT) };
+		shadowSystem.setUpdateBudget(shadowUpdateBudget);
+
+		// A dynamic offset selects the frame's ubo, so a single set serves every frame in flight. The
+		// shadow atlas lives as long as the set
+		VkDescriptorSet globalDescriptorSet;
+		auto bufferInfo = frameAllocator.descriptorInfo(sizeof(GlobalUbo));
+		auto shadowAtlasInfo = shadowSystem.descriptorInfo();
+
+		EngineDescriptorWriter(*globalSetLayout, *globalPool)
+			.writeBuffer(0, &bufferInfo)
+			.writeImage(1, &shadowAtlasInfo)
+			.build(globalDescriptorSet, *descriptorCache);
+
+		// Swap chain recreation keeps the formats (the renderer throws otherwise), so these pipelines outlive it
+		PipelineAttachments sceneAttachments = renderGraph.getPipelineAttachments({ engRenderer.getSwapChainImageFormat() }, engRenderer.getSwapChainDepthFormat());
+		SimpleRenderSystem simpleRenderSystem{ engDevice, shaderCompiler, samplerCache, sceneAttachments,
+			renderGraph.getPipelineAttachments({}, engRenderer.getSwapChainDepthFormat()), globalSetLayout->getDescriptorSetLayout() };
+		PointLightSystem pointLightSystem{ engDevice, shaderCompiler, sceneAttachments, globalSetLayout->getDescriptorSetLayout() };
 		EngineCamera camera{};
+
+		// The vases are open at the top, cone culling would hide their insides
+		simpleRenderSystem.setConeCullingEnabled(false);
+		simpleRenderSystem.setDepthPrepassEnabled(depthPrepassEnabled);
 		camera.setViewTarget(glm::vec3(-1.f, -2.5f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
 
 		auto viewerObject = GameObject::createGameObject();
@@ -65,61 +365,252 @@ namespace gameEngine
 		KeyboardMovementController cameraController{};
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
+		uint64_t frameNumber = 1;
 
 		while (!window.shouldClose())
 		{
-			glfwPollEvents();
+			// Input is sampled as late as the frame limit and latency mode allow
+			frameLimiter.wait();
+			engRenderer.syncInput();
+
+			// Nothing is drawn while minimized, streaming keeps going at a lower rate
+			if (engRenderer.isSwapChainOutOfDate())
+			{
+				glfwWaitEventsTimeout(MINIMIZED_WAIT_SECONDS);
+			}
+			else
+			{
+				glfwPollEvents();
+			}
+
+			// Rebuilds pipelines whose GLSL changed on disk
+			shaderCompiler.pollChanges();
 
 			auto newTime = std::chrono::high_resolution_clock::now();
 
 			float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
 			currentTime = newTime;
 
-			frameTime = glm::min(frameTime, MAX_FRAME_TIME);
+			if (frameHook)
+			{
+				if (!frameHook(frameTime, viewerObject, simpleRenderSystem)) break;
+			}
+			else
+			{
+				frameTime = glm::min(frameTime, MAX_FRAME_TIME);
+				cameraController.moveInPlaneXZ(window.getGLFWwindow(), frameTime, viewerObject);
+			}
 
-			cameraController.moveInPlaneXZ(window.getGLFWwindow(), frameTime, viewerObject);
 			camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
 			float aspect = engRenderer.getAspectRatio();
-			camera.setPerspectiveProjection(glm::radians(50.f), aspect, .1f, 100.f);
+			camera.setPerspectiveProjection(glm::radians(50.f), aspect, NEAR_PLANE, FAR_PLANE);
+
+			// Destroys what the frames that completed were the last to use
+			engDevice.collectGarbage();
+
+			// Finishes and starts model uploads, evicts what wasn't seen in a while when over budget or when
+			// the device reports memory pressure
+			engDevice.updateMemoryBudget();
+			assetManager.update(frameNumber);
+
+			// Streaming leaves holes in the buffer blocks, live model buffers are moved out of sparse ones
+			defragmenter.update(frameNumber);
 
 			if (auto commandBuffer = engRenderer.beginFrame())
 			{
 				int frameIndex = engRenderer.getFrameIndex();
 
+				// beginFrame waited on this slot's timeline value, so its transient data is free to reuse
+				frameAllocator.beginFrame(frameIndex);
+				auto uboAllocation = frameAllocator.allocate(sizeof(GlobalUbo));
+
+				// The lights orbit with the rig they hang from
+				auto& lightRig = gameObjects.at(lightRigId);
+				lightRig.transform.rotation.y = glm::mod(lightRig.transform.rotation.y - frameTime, glm::two_pi<float>());
+				transformHierarchy.setLocal(lightRig.transformNode, lightRig.transform.mat4());
+				transformHierarchy.update(0);
+
 				FrameInfo frameInfo
 				{
 					frameIndex,
 					frameTime,
 					commandBuffer,
 					camera,
-					globalDescriptorSets[frameIndex],
-					gameObjects
+					globalDescriptorSet,
+					gameObjects,
+					static_cast<uint32_t>(uboAllocation.offset),
+					frameAllocator,
+					engRenderer.getSwapChainExtent(),
+					frameNumber,
+					transformHierarchy
 				};
 
 				// update
 				GlobalUbo ubo{};
 				ubo.projection = camera.getProjection();
 				ubo.view = camera.getView();
+				ubo.inverseView = camera.getInverseView();
 				pointLightSystem.update(frameInfo, ubo);
-				uboBuffers[frameIndex]->writeToBuffer(&ubo);
-				uboBuffers[frameIndex]->flush();
-
-				// render
-				engRenderer.beginSwapChainRenderPass(commandBuffer);
-				simpleRenderSystem.renderGameObjects(frameInfo);
-				pointLightSystem.render(frameInfo);
-				engRenderer.endSwapChainRenderPass(commandBuffer);
+				shadowSystem.update(frameInfo, ubo);
+				memcpy(uboAllocation.mapped, &ubo, sizeof(GlobalUbo));
+
+				// render, culling and its compute barriers are recorded before the graph's passes
+				simpleRenderSystem.prepareFrame(frameInfo);
+
+				// Every system's draws in one sorted queue, passes record their part of it
+				renderQueue.reset(FAR_PLANE);
+				simpleRenderSystem.queueDraws(frameInfo, renderQueue);
+				pointLightSystem.queueDraws(frameInfo, renderQueue);
+				renderQueue.sort();
+
+				VkExtent2D extent = engRenderer.getSwapChainExtent();
+				renderGraph.reset();
+
+				// Acquiring waits at color output, the image's previous contents aren't needed
+				auto backbuffer = renderGraph.importImage("backbuffer", engRenderer.getSwapChainImage(), engRenderer.getSwapChainImageView(),
+					engRenderer.getSwapChainImageFormat(), extent, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+				auto depth = renderGraph.createImage("depth", engRenderer.getSwapChainDepthFormat(), extent);
+				auto shadowAtlas = shadowSystem.importAtlas(renderGraph);
+				bool depthPrepass = simpleRenderSystem.isDepthPrepassEnabled();
+
+				// Only when a light's map changes, the rest of the atlas is kept. Adding or dropping the pass
+				// plans the graph again, with moving lights it is there every frame
+				if (shadowSystem.hasPendingUpdates())
+				{
+					renderGraph.addPass("shadows",
+						[&](EngineRenderGraph::PassBuilder& builder)
+						{
+							builder.writeDepth(shadowAtlas);
+						},
+						[&](VkCommandBuffer)
+						{
+							shadowSystem.render(frameInfo);
+						});
+				}
+
+				if (depthPrepass)
+				{
+					renderGraph.addPass("depth prepass",
+						[&](EngineRenderGraph::PassBuilder& builder)
+						{
+							builder.clearDepth(depth, { 1.0f, 0 });
+						},
+						[&](VkCommandBuffer)
+						{
+							renderQueue.record(frameInfo, RenderQueuePass::DepthPrepass);
+						});
+				}
+
+				// Point lights still write depth after the prepass, so the forward pass keeps it writable
+				renderGraph.addPass("forward",
+					[&](EngineRenderGraph::PassBuilder& builder)
+					{
+						builder.clearColor(backbuffer, { 0.01f, 0.01f, 0.01f, 1.0f })
+							.sample(shadowAtlas);
+
+						if (depthPrepass)
+						{
+							builder.writeDepth(depth);
+						}
+						else
+						{
+							builder.clearDepth(depth, { 1.0f, 0 });
+						}
+					},
+					[&](VkCommandBuffer)
+					{
+						renderQueue.record(frameInfo, RenderQueuePass::Opaque);
+						renderQueue.record(frameInfo, RenderQueuePass::PointLights);
+					});
+
+				renderGraph.compile();
+
+				pipelineStatistics.begin(commandBuffer, frameIndex);
+				renderGraph.execute(commandBuffer);
+				pipelineStatistics.end(commandBuffer, frameIndex);
+
+				// One flush covers everything systems pushed this frame
+				frameAllocator.flush();
 				engRenderer.endFrame();
+				frameNumber++;
 			}
+		}
+
+		// The swap chain, its command buffers and layouts aren't queued for destruction, let the GPU finish first
+		vkDeviceWaitIdle(engDevice.getDevice());
+
+		std::cout << "Descriptor set cache: " << descriptorCache->getHitCount() << " hits, "
+			<< descriptorCache->getMissCount() << " misses" << std::endl;
+
+		const EngineRenderGraph::Stats& graphStats = renderGraph.getStats();
+		std::cout << "Render graph: " << graphStats.passCount - graphStats.culledPassCount << " of " << graphStats.passCount
+			<< " passes, " << graphStats.barrierBatchCount << " barrier batches (" << graphStats.barrierCount << " image barriers) against "
+			<< graphStats.naiveBarrierCount << " naive barriers, " << graphStats.transientBytes << " transient bytes against "
+			<< graphStats.naiveTransientBytes << " unaliased, planned " << graphStats.compileCount << " times" << std::endl;
+		std::cout << "Render pass objects: " << graphStats.renderPassObjectCount << ", framebuffers: " << graphStats.framebufferObjectCount
+			<< (engDevice.supportsDynamicRendering() ? " (dynamic rendering)" : " (render pass fallback)") << std::endl;
+
+		const EngineRenderQueue::Stats& queueStats = renderQueue.getStats();
+		std::cout << "Render queue, last frame: " << queueStats.drawCount << " draws, " << queueStats.pipelineBinds << " pipeline binds ("
+			<< queueStats.pipelineBindsSaved << " saved), " << queueStats.descriptorSetBinds << " descriptor set binds ("
+			<< queueStats.descriptorSetBindsSaved << " saved), " << queueStats.meshBinds << " mesh binds (" << queueStats.meshBindsSaved
+			<< " saved)" << std::endl;
 
-			vkDeviceWaitIdle(engDevice.getDevice());
+		const ShadowSystem::Stats& shadowStats = shadowSystem.getStats();
+		std::cout << "Shadow maps: " << shadowStats.shadowedLightCount << " lights shadowed, " << shadowSystem.getTotalUpdateCount()
+			<< " updates for " << shadowSystem.getTotalDirtyCount() << " out of date light frames (budget " << shadowUpdateBudget
+			<< " per frame)" << std::endl;
+
+		if (pipelineStatistics.getFrameCount() > 0)
+		{
+			std::cout << "Fragment shader invocations: " << pipelineStatistics.getTotalFragmentInvocations() / pipelineStatistics.getFrameCount()
+				<< " per frame" << (simpleRenderSystem.isDepthPrepassEnabled() ? " (depth prepass)" : "") << std::endl;
+		}
+
+		const EngineRenderer::LatencyStats& latency = engRenderer.getLatencyStats();
+		std::cout << "Input to present latency: " << latency.getAverageMilliseconds() << " ms average, " << latency.maxMilliseconds
+			<< " ms worst over " << latency.sampleCount << " frames, " << (latency.measured ? "measured" : "estimated from GPU completion")
+			<< std::endl;
+
+		// Current and peak usage per category, for capacity planning
+		std::ofstream memoryReport{ MEMORY_REPORT_PATH };
+		memoryReport << engDevice.getMemoryReport().toJson();
+		std::cout << "Memory report written to " << MEMORY_REPORT_PATH << std::endl;
+
+		// The global set layout dies with this scope, don't let its handle match anything later
+		descriptorCache->clear();
+	}
+
+	float FirstApp::scatterObjects(const std::shared_ptr<EngineModel>& model, uint32_t objectCount)
+	{
+		constexpr float SPACING = 1.f;
+
+		// Fixed seed so every run and every benchmark pass see the same scene
+		std::mt19937 rng{ 42 };
+		float fieldSize = glm::sqrt(static_cast<float>(objectCount)) * SPACING;
+		std::uniform_real_distribution<float> position{ -fieldSize * .5f, fieldSize * .5f };
+		std::uniform_real_distribution<float> angle{ 0.f, glm::two_pi<float>() };
+		std::uniform_real_distribution<float> scale{ 1.f, 3.f };
+
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			auto object = GameObject::createGameObject();
+			object.model = model;
+			object.transform.translation = { position(rng), .5f, position(rng) };
+			object.transform.rotation.y = angle(rng);
+			object.transform.scale = glm::vec3{ scale(rng) };
+
+			gameObjects.emplace(object.getId(), std::move(object));
 		}
+
+		return fieldSize;
 	}
 
 	void FirstApp::loadGameObjects()
 	{
-		std::shared_ptr<EngineModel> engModel = EngineModel::createModelFromFile(engDevice, "models/flat_vase.obj");
+		std::shared_ptr<EngineModel> engModel = assetManager.loadModel("models/flat_vase.obj", EngineModel::VertexLayout::Compact, 4, true);
 
 		auto flatVase = GameObject::createGameObject();
 		flatVase.model = engModel;
@@ -129,7 +620,7 @@ namespace gameEngine
 		gameObjects.emplace(flatVase.getId(), std::move(flatVase));
 
 
-		engModel = EngineModel::createModelFromFile(engDevice, "models/smooth_vase.obj");
+		engModel = assetManager.loadModel("models/smooth_vase.obj", EngineModel::VertexLayout::Compact, 4, true);
 
 		auto smoothVase = GameObject::createGameObject();
 		smoothVase.model = engModel;
@@ -139,12 +630,16 @@ namespace gameEngine
 		gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
 
 
-		engModel = EngineModel::createModelFromFile(engDevice, "models/quad.obj");
+		engModel = assetManager.loadModel("models/quad.obj", EngineModel::VertexLayout::Compact);
 
 		auto floor = GameObject::createGameObject();
 		floor.model = engModel;
 		floor.transform.translation = { 0.f, .5f, 0.f };
 		floor.transform.scale = glm::vec3{ 3.f, 1.f, 3.f };
+
+		// Seen at grazing angles, where the mip chain matters most
+		floor.texture = assetManager.loadTexture("textures/checker.png");
+		floorId = floor.getId();
 		gameObjects.emplace(floor.getId(), std::move(floor));
 
 		std::vector<glm::vec3> lightColors
@@ -157,16 +652,24 @@ namespace gameEngine
 			{ 1.f, 1.f, 1.f },
 		};
 
+		// Lights are placed relative to the rig, spinning it moves all of them
+		auto lightRig = GameObject::createGameObject();
+		lightRig.transformNode = transformHierarchy.createNode(lightRig.transform.mat4());
+		lightRigId = lightRig.getId();
+		EngineTransformHierarchy::NodeId rigNode = lightRig.transformNode;
+		gameObjects.emplace(lightRig.getId(), std::move(lightRig));
+
 		for (int i = 0; i < lightColors.size(); i++)
 		{
-			auto pointLight = GameObject::makePointLight(.2f);
-			pointLight.color = lightColors[i];
+			// Shadows reach past the floor's edges from anywhere on the rig
+			auto pointLight = GameObject::makePointLight(.2f, .1f, lightColors[i], 10.f);
 			auto rotateLight = glm::rotate(
 				glm::mat4(1.f),
 				(i * glm::two_pi<float>()) / lightColors.size(),
 				{ 0.f, -1.f, 0.f });
 
 			pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+			pointLight.transformNode = transformHierarchy.createNode(pointLight.transform.mat4(), rigNode);
 			gameObjects.emplace(pointLight.getId(), std::move(pointLight));
 		}
 	}
@@ -5,8 +5,19 @@
 #include "engineGameObject.h"
 #include "engineRenderer.h"
 #include "engineDescriptors.h"
+#include "engineAssetManager.h"
+#include "engineDefragmenter.h"
+#include "engineShaderCompiler.h"
+#include "engineTexture.h"
+#include "engineTransformHierarchy.h"
+#include "engineFrameLimiter.h"
+#include "enginePipelineStatistics.h"
+#include "systems/simpleRenderSystem.h"
+#include "systems/shadowSystem.h"
 
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace gameEngine
@@ -18,6 +29,11 @@ namespace gameEngine
 		static constexpr uint32_t WIDTH = 800;
 		static constexpr uint32_t HEIGHT = 600;
 		static constexpr float MAX_FRAME_TIME = 2.f;
+		static constexpr float NEAR_PLANE = .1f;
+		static constexpr float FAR_PLANE = 100.f;
+		static constexpr double MINIMIZED_WAIT_SECONDS = .1;
+		static constexpr VkDeviceSize FRAME_ALLOCATOR_SIZE = 256 * 1024;
+		static constexpr const char* MEMORY_REPORT_PATH = "memory_report.json";
 
 		FirstApp();
 		~FirstApp();
@@ -27,14 +43,60 @@ namespace gameEngine
 
 		void run();
 
+		// Presentation settings, they can also change while running
+		void setPresentPolicy(PresentPolicy policy) { engRenderer.setPresentPolicy(policy); }
+		void setLatencyMode(LatencyMode mode) { engRenderer.setLatencyMode(mode); }
+		void setFrameRateLimit(double framesPerSecond) { frameLimiter.setTargetFrameRate(framesPerSecond); }
+
+		// Lays down depth before shading, see SimpleRenderSystem::setDepthPrepassEnabled
+		void setDepthPrepassEnabled(bool enabled) { depthPrepassEnabled = enabled; }
+
+		// Streams filepath (PNG, JPEG or KTX2 from --import-texture) in place of the floor's checkerboard
+		void setFloorTexture(const std::string& filepath) { gameObjects.at(floorId).texture = assetManager.loadTexture(filepath); }
+
+		// Point light shadow maps re-rendered per frame at most, see ShadowSystem
+		void setShadowUpdateBudget(uint32_t lightsPerFrame) { shadowUpdateBudget = lightsPerFrame; }
+
+		// Scatters objectCount vases over a large field and flies a fixed camera path through it twice,
+		// with LOD selection off then on, printing frame time and triangle throughput of both runs
+		void runLodBenchmark(uint32_t objectCount, uint32_t frameCount);
+
+		// Resizes the window back and forth resizeCount times and compares the frames that recreated the
+		// swap chain against the others
+		void runResizeBenchmark(uint32_t resizeCount);
+
+		// Flies the LOD benchmark's path with the depth prepass off then on, printing frame time and the
+		// fragment shader invocations counted by pipeline statistics queries
+		void runPrepassBenchmark(uint32_t objectCount, uint32_t frameCount);
+
 	private:
+		// Runs before each frame with the previous frame's time, drives the camera instead of the keyboard
+		// when set. Returning false ends the loop
+		using FrameHook = std::function<bool(float frameTime, GameObject& viewerObject, SimpleRenderSystem& simpleRenderSystem)>;
+
 		EngineWindow window{ WIDTH, HEIGHT, "Vulkan" };
 		EngineDevice engDevice{ window };
 		EngineRenderer engRenderer{ window, engDevice };
+		EngineShaderCompiler shaderCompiler{};
+		EngineSamplerCache samplerCache{ engDevice };
+		EngineAssetManager assetManager{ engDevice };
+		EngineDefragmenter defragmenter{ engDevice };
+		EngineFrameLimiter frameLimiter{};
+		EnginePipelineStatistics pipelineStatistics{ engDevice, EngineSwapChain::MAX_FRAMES_IN_FLIGHT };
+		bool depthPrepassEnabled = false;
+		uint32_t shadowUpdateBudget = ShadowSystem::DEFAULT_UPDATE_BUDGET;
 
 		std::unique_ptr<EngineDescriptorPool> globalPool;
+		std::unique_ptr<EngineDescriptorSetCache> descriptorCache;
 		GameObject::Map gameObjects;
+		EngineTransformHierarchy transformHierarchy{};
+		GameObject::id_t lightRigId = 0;	// parent of the point lights
+		GameObject::id_t floorId = 0;
 
 		void loadGameObjects();
+
+		// Scatters objectCount copies of model over a square field around the origin, returns its size
+		float scatterObjects(const std::shared_ptr<EngineModel>& model, uint32_t objectCount);
+		void mainLoop(const FrameHook& frameHook);
 	};
 } // namespace
\ No newline at end of file
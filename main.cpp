@@ -1,16 +1,157 @@
 #include "firstApp.h"
+#include "engineObjParser.h"
+#include "engineFlatHashMap.h"
+#include "engineKtx2.h"
+#include "engineMeshSimplifier.h"
+#include "engineTransformHierarchy.h"
+#include "engineUtils.h"
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
-int main()
+int main(int argc, char* argv[])
 {
-	gameEngine::FirstApp app{};
-
 	try
 	{
-		app.run();
+		// --verbose anywhere, before the device is created since it reports its capabilities
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--verbose") == 0) gameEngine::verboseOutput = true;
+		}
+
+		// --benchmark-obj <file> [iterations], needs no window or device
+		if (argc > 2 && strcmp(argv[1], "--benchmark-obj") == 0)
+		{
+			uint32_t iterations = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 5;
+
+			gameEngine::EngineObjParser::benchmark(argv[2], iterations);
+			return EXIT_SUCCESS;
+		}
+
+		// --benchmark-weld [synthetic indices] [iterations]
+		if (argc > 1 && strcmp(argv[1], "--benchmark-weld") == 0)
+		{
+			size_t syntheticIndexCount = argc > 2 ? static_cast<size_t>(std::strtoull(argv[2], nullptr, 10)) : 10000000;
+			uint32_t iterations = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 3;
+
+			gameEngine::EngineObjParser::benchmarkWelding({ "models/smooth_vase.obj", "models/flat_vase.obj", "models/cube.obj",
+				"models/colored_cube.obj" }, syntheticIndexCount, iterations);
+			return EXIT_SUCCESS;
+		}
+
+		// --test-flat-hash-map [operations] [seed], needs no window or device
+		if (argc > 1 && strcmp(argv[1], "--test-flat-hash-map") == 0)
+		{
+			uint32_t operationCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000000;
+			uint32_t seed = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 1;
+
+			return gameEngine::testFlatHashMap(operationCount, seed) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		// --test-lod [files...], needs no window or device
+		if (argc > 1 && strcmp(argv[1], "--test-lod") == 0)
+		{
+			std::vector<std::string> filepaths{ "models/smooth_vase.obj", "models/flat_vase.obj" };
+			if (argc > 2) filepaths.assign(argv + 2, argv + argc);
+
+			return gameEngine::EngineMeshSimplifier::testLods(filepaths) ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		// --benchmark-hierarchy [nodes] [iterations], needs no window or device
+		if (argc > 1 && strcmp(argv[1], "--benchmark-hierarchy") == 0)
+		{
+			uint32_t nodeCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000000;
+			uint32_t iterations = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 5;
+
+			gameEngine::EngineTransformHierarchy::benchmark(nodeCount, iterations);
+			return EXIT_SUCCESS;
+		}
+
+		// --import-texture <source> <destination.ktx2> [bc7|bc5|bc1|rgba8] [--linear]
+		if (argc > 3 && strcmp(argv[1], "--import-texture") == 0)
+		{
+			const char* target = argc > 4 ? argv[4] : "bc7";
+			bool linear = argc > 5 && strcmp(argv[5], "--linear") == 0;
+			VkFormat format;
+
+			if (strcmp(target, "bc7") == 0) format = linear ? VK_FORMAT_BC7_UNORM_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+			else if (strcmp(target, "bc5") == 0) format = VK_FORMAT_BC5_UNORM_BLOCK;
+			else if (strcmp(target, "bc1") == 0) format = linear ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+			else if (strcmp(target, "rgba8") == 0) format = linear ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R8G8B8A8_SRGB;
+			else throw std::runtime_error(std::string("unknown texture format ") + target);
+
+			gameEngine::EngineKtx2::import(argv[2], argv[3], format);
+			return EXIT_SUCCESS;
+		}
+
+		gameEngine::FirstApp app{};
+
+		// Presentation options, after the mode and its arguments:
+		// --present-mode fifo|fifo-relaxed|mailbox|immediate, --fps-limit <fps>, --low-latency, --depth-prepass,
+		// --shadow-budget <lights per frame>, --texture <file> for the floor
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc)
+			{
+				const char* mode = argv[++i];
+
+				if (strcmp(mode, "fifo") == 0) app.setPresentPolicy(gameEngine::PresentPolicy::Fifo);
+				else if (strcmp(mode, "fifo-relaxed") == 0) app.setPresentPolicy(gameEngine::PresentPolicy::FifoRelaxed);
+				else if (strcmp(mode, "mailbox") == 0) app.setPresentPolicy(gameEngine::PresentPolicy::Mailbox);
+				else if (strcmp(mode, "immediate") == 0) app.setPresentPolicy(gameEngine::PresentPolicy::Immediate);
+				else throw std::runtime_error(std::string("unknown present mode ") + mode);
+			}
+			else if (strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc)
+			{
+				app.setFrameRateLimit(std::strtod(argv[++i], nullptr));
+			}
+			else if (strcmp(argv[i], "--low-latency") == 0)
+			{
+				app.setLatencyMode(gameEngine::LatencyMode::LowLatency);
+			}
+			else if (strcmp(argv[i], "--depth-prepass") == 0)
+			{
+				app.setDepthPrepassEnabled(true);
+			}
+			else if (strcmp(argv[i], "--shadow-budget") == 0 && i + 1 < argc)
+			{
+				app.setShadowUpdateBudget(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+			}
+			else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc)
+			{
+				app.setFloorTexture(argv[++i]);
+			}
+		}
+
+		// --benchmark-lod [objects] [frames]
+		if (argc > 1 && strcmp(argv[1], "--benchmark-lod") == 0)
+		{
+			uint32_t objectCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10000;
+			uint32_t frameCount = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 600;
+
+			app.runLodBenchmark(objectCount, frameCount);
+		}
+		// --benchmark-resize [resizes]
+		else if (argc > 1 && strcmp(argv[1], "--benchmark-resize") == 0)
+		{
+			uint32_t resizeCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 20;
+
+			app.runResizeBenchmark(resizeCount);
+		}
+		// --benchmark-prepass [objects] [frames]
+		else if (argc > 1 && strcmp(argv[1], "--benchmark-prepass") == 0)
+		{
+			uint32_t objectCount = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 10000;
+			uint32_t frameCount = argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 600;
+
+			app.runPrepassBenchmark(objectCount, frameCount);
+		}
+		else
+		{
+			app.run();
+		}
 	}
 	catch (const std::exception &e)
 	{
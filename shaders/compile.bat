@@ -1,7 +1,8 @@
 @echo off
+rem Offline build of the shaders, the engine compiles and caches them at runtime as well
+cd /d "%~dp0"
 
-F:\GameDev\Vulkan\SDK\Bin\glslc.exe shader.vert -o shader.vert.spv
-F:\GameDev\Vulkan\SDK\Bin\glslc.exe shader.frag -o shader.frag.spv
-F:\GameDev\Vulkan\SDK\Bin\glslc.exe pointLight.vert -o pointLight.vert.spv
-F:\GameDev\Vulkan\SDK\Bin\glslc.exe pointLight.frag -o pointLight.frag.spv
+for %%s in (*.vert *.frag *.comp *.task *.mesh) do (
+	"%VULKAN_SDK%\Bin\glslc.exe" --target-env=vulkan1.2 "%%s" -o "%%s.spv" || exit /b 1
+)
 pause
\ No newline at end of file
@@ -0,0 +1,7 @@
+#!/bin/sh
+# Offline build of the shaders, the engine compiles and caches them at runtime as well
+cd "$(dirname "$0")"
+
+for shader in *.vert *.frag *.comp *.task *.mesh; do
+	glslc --target-env=vulkan1.2 "$shader" -o "$shader.spv" || exit 1
+done
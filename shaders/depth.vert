@@ -0,0 +1,33 @@
+#version 450
+
+// Depth prepass, reads only the position attribute of either vertex layout. gl_Position has to match
+// shader.vert bit for bit, the main pass tests against this depth with EQUAL
+layout (location = 0) in vec3 position;
+
+invariant gl_Position;
+
+struct PointLight
+{
+    vec4 position;
+    vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  vec4 ambientLightColor; // w is intensity
+  PointLight pointLights[10];
+  int numLights;
+} ubo;
+
+layout (push_constant) uniform Push
+{
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+} push;
+
+void main()
+{
+	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+	gl_Position = ubo.projection * ubo.view * positionWorld;
+}
\ No newline at end of file
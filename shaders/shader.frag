@@ -3,6 +3,7 @@
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
 layout (location = 2) in vec3 fragNormalWorld;
+layout (location = 3) in vec2 fragUv;
 
 layout (location = 0) out vec4 outColor;
 
@@ -18,30 +19,98 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   vec4 ambientLightColor; // w is intensity
   PointLight pointLights[10];
   int numLights;
+  mat4 inverseView;
+  vec4 shadowParams[10]; // x: first atlas tile or -1 without a shadow map, y: near plane, z: radius
+  vec4 shadowOrigins[10]; // xyz: where the light was when its map was rendered
 } ubo;
 
+// Six faces per light, filled by ShadowSystem. Compared with LESS_OR_EQUAL
+layout(set = 0, binding = 1) uniform sampler2DShadow shadowAtlas;
+
+// Must match ShadowSystem
+const float SHADOW_FACE_SIZE = 512.0;
+const float SHADOW_ATLAS_SIZE = 4096.0;
+const int SHADOW_TILES_PER_ROW = 8;
+
+// Mipmapped, objects without a texture get a white pixel
+layout(set = 2, binding = 0) uniform sampler2D diffuseTexture;
+
+// Set per pipeline variant by SimpleRenderSystem
+layout (constant_id = 0) const int LIGHT_COUNT_CAP = 10;
+layout (constant_id = 1) const bool ENABLE_SPECULAR = false;
+
 layout (push_constant) uniform Push
 {
 	mat4 modelMatrix;
 	mat4 normalMatrix;
 } push;
 
+// Faces look along +x, -x, +y, -y, +z, -z with the two other axes, in order, as their x and y. Maps
+// of moving lights can be a few frames old, they are looked up from where they were rendered
+float pointShadow(int lightIndex, vec3 fragmentPosition)
+{
+	vec4 params = ubo.shadowParams[lightIndex];
+	if (params.x < 0.0) return 1.0;
+
+	vec3 lightToFragment = fragmentPosition - ubo.shadowOrigins[lightIndex].xyz;
+
+	vec3 distances = abs(lightToFragment);
+	int axis = distances.x >= distances.y && distances.x >= distances.z ? 0 : (distances.y >= distances.z ? 1 : 2);
+	float z = distances[axis];
+
+	// Nothing beyond the radius was rendered into the map
+	if (z >= params.z) return 1.0;
+
+	int face = axis * 2 + (lightToFragment[axis] < 0.0 ? 1 : 0);
+	vec2 ndc = vec2(lightToFragment[(axis + 1) % 3], lightToFragment[(axis + 2) % 3]) / z;
+
+	float near = params.y;
+	float far = params.z;
+	float depth = far / (far - near) - far * near / ((far - near) * z);
+
+	// Kept a texel inside the face so filtering never reads a neighbouring tile
+	int tile = int(params.x) + face;
+	vec2 texel = clamp((ndc * 0.5 + 0.5) * SHADOW_FACE_SIZE, vec2(1.0), vec2(SHADOW_FACE_SIZE - 1.0));
+	vec2 uv = (vec2(tile % SHADOW_TILES_PER_ROW, tile / SHADOW_TILES_PER_ROW) * SHADOW_FACE_SIZE + texel) / SHADOW_ATLAS_SIZE;
+
+	return texture(shadowAtlas, vec3(uv, depth));
+}
+
 void main()
 {
+	vec3 albedo = fragColor * texture(diffuseTexture, fragUv).rgb;
 	vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+	vec3 specularLight = vec3(0.0);
 	vec3 surfaceNormal = normalize(fragNormalWorld);
 
-	for(int i = 0; i < ubo.numLights; i++)
+	vec3 cameraPosWorld = ubo.inverseView[3].xyz;
+	vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
+
+	// Constant trip count, the break only matters when the scene has fewer lights than the cap
+	for(int i = 0; i < LIGHT_COUNT_CAP; i++)
 	{
+		if (i >= ubo.numLights) break;
+
 		PointLight light = ubo.pointLights[i];
 
 		vec3 directionToLight = light.position.xyz - fragPosWorld;
 		float attenuation = 1.0 / dot(directionToLight, directionToLight);
-		float cosAngIncidence = max(dot(surfaceNormal, normalize(directionToLight)), 0);
-		vec3 intensity = light.color.xyz * light.color.w * attenuation;
+		float shadow = pointShadow(i, fragPosWorld);
+		directionToLight = normalize(directionToLight);
+
+		float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
+		vec3 intensity = light.color.xyz * light.color.w * attenuation * shadow;
 
 		diffuseLight += intensity * cosAngIncidence;
+
+		if (ENABLE_SPECULAR)
+		{
+			vec3 halfAngle = normalize(directionToLight + viewDirection);
+			float blinnTerm = clamp(dot(surfaceNormal, halfAngle), 0, 1);
+			blinnTerm = pow(blinnTerm, 512.0);
+			specularLight += intensity * blinnTerm;
+		}
 	}
 
-	outColor = vec4(diffuseLight * fragColor, 1.0);
+	outColor = vec4(diffuseLight * albedo + specularLight * albedo, 1.0);
 }
\ No newline at end of file
@@ -1,13 +1,28 @@
 #version 450
 
+// VERTEX_LAYOUT_COMPACT: position is unorm inside the mesh bounds (the dequantize transform is folded
+// into modelMatrix) and the normal is octahedral encoded. Without VERTEX_HAS_COLOR there is no color stream
+#ifdef VERTEX_LAYOUT_COMPACT
+layout (location = 0) in vec3 position;
+#ifdef VERTEX_HAS_COLOR
+layout (location = 1) in vec3 color;
+#endif
+layout (location = 2) in vec2 normalOct;
+layout (location = 3) in vec2 uv;
+#else
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec2 uv;
+#endif
 
 layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragPosWorld;
 layout (location = 2) out vec3 fragNormalWorld;
+layout (location = 3) out vec2 fragUv;
+
+// The depth prepass (depth.vert) must produce the same depth
+invariant gl_Position;
 
 struct PointLight
 {
@@ -29,8 +44,25 @@ layout (push_constant) uniform Push
 	mat4 normalMatrix;
 } push;
 
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
 void main()
 {
+#ifdef VERTEX_LAYOUT_COMPACT
+	vec3 normal = octDecode(normalOct);
+#ifndef VERTEX_HAS_COLOR
+	vec3 color = vec3(1.0);
+#endif
+#endif
+
 	// Convert from model-space to world-space
 	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
 	gl_Position = ubo.projection * ubo.view * positionWorld;
@@ -38,4 +70,5 @@ void main()
 	fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
 	fragPosWorld = positionWorld.xyz;
 	fragColor = color;
+	fragUv = uv;
 }
\ No newline at end of file
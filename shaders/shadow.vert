@@ -0,0 +1,14 @@
+#version 450
+
+// One face of a point light's shadow cube, see ShadowSystem. Only the position attribute is read
+layout (location = 0) in vec3 position;
+
+layout (push_constant) uniform Push
+{
+	mat4 transform;	// face projection * face view * model, dequantization included
+} push;
+
+void main()
+{
+	gl_Position = push.transform * vec4(position, 1.0);
+}
\ No newline at end of file
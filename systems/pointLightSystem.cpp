@@ -18,11 +18,14 @@ namespace gameEngine
 		float radius;
 	};
 
-	PointLightSystem::PointLightSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+	PointLightSystem::PointLightSystem(EngineDevice& device, EngineShaderCompiler& compiler, const PipelineAttachments& attachments,
+		VkDescriptorSetLayout globalSetLayout)
 		: engDevice{ device }
 	{
 		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
+		createPipeline(compiler, attachments);
+
+		drawer.draw = [this](FrameInfo& frameInfo, uint32_t drawIndex) { recordDraw(frameInfo, drawIndex); };
 	}
 
 	PointLightSystem::~PointLightSystem()
@@ -52,27 +55,24 @@ namespace gameEngine
 		}
 	}
 
-	void PointLightSystem::createPipeline(VkRenderPass renderPass)
+	void PointLightSystem::createPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments)
 	{
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-		PipelineConfigInfo pipelineConfig{};
-		EngPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		VkPipelineLayout layout = pipelineLayout;
 
-		pipelineConfig.bindingDescriptions.clear();
-		pipelineConfig.attributeDescriptions.clear();
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		engPipeline = std::make_unique<EngPipeline>(engDevice, "shaders/pointLight.vert.spv", "shaders/pointLight.frag.spv", pipelineConfig);
+		pipelineVariants = std::make_unique<EnginePipelineVariants>(engDevice, compiler, "shaders/pointLight.vert", "shaders/pointLight.frag",
+			[attachments, layout](PipelineConfigInfo& pipelineConfig)
+			{
+				pipelineConfig.bindingDescriptions.clear();
+				pipelineConfig.attributeDescriptions.clear();
+				pipelineConfig.attachments = attachments;
+				pipelineConfig.pipelineLayout = layout;
+			});
 	}
 
 	void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
 	{
-		auto rotateLight = glm::rotate(
-			glm::mat4(1.f),
-			frameInfo.frameTime,
-			{ 0.f, -1.f, 0.f });
-
 		int lightIndex = 0;
 
 		// kv = key value
@@ -83,9 +83,7 @@ namespace gameEngine
 
 			assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum ammount");
 
-			obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
-
-			ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
+			ubo.pointLights[lightIndex].position = obj.worldMatrix(frameInfo.transforms)[3];
 			ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
 			lightIndex++;
 		}
@@ -93,12 +91,12 @@ namespace gameEngine
 		ubo.numLights = lightIndex;
 	}
 
-	void PointLightSystem::render(FrameInfo& frameInfo)
+	void PointLightSystem::queueDraws(FrameInfo& frameInfo, EngineRenderQueue& renderQueue)
 	{
-		engPipeline->bind(frameInfo.commandBuffer);
+		lights.clear();
 
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-			pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+		EngPipeline* pipeline = &pipelineVariants->get(ShaderVariant{});
+		glm::vec3 cameraPosition = frameInfo.camera.getPosition();
 
 		for (auto& kv : frameInfo.gameObject)
 		{
@@ -106,16 +104,35 @@ namespace gameEngine
 
 			if (obj.pointLight == nullptr) continue;
 
-			PointLightPushConstants push{};
-			push.position = glm::vec4(obj.transform.translation, 1.f);
-			push.color = glm::vec4(obj.color, 1.f);
-			push.radius = obj.transform.scale.x;
+			// Billboards without vertex buffers, nothing but the pipeline to share
+			EngineRenderQueue::Draw draw{};
+			draw.pass = RenderQueuePass::PointLights;
+			draw.pipeline = pipeline;
+			draw.pipelineLayout = pipelineLayout;
+			draw.depth = glm::length(glm::vec3(obj.worldMatrix(frameInfo.transforms)[3]) - cameraPosition);
+			draw.drawer = &drawer;
+			draw.drawIndex = static_cast<uint32_t>(lights.size());
+
+			renderQueue.submit(draw);
+			lights.push_back(&obj);
+		}
+	}
 
-			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0, sizeof(PointLightPushConstants), &push);
+	void PointLightSystem::recordDraw(FrameInfo& frameInfo, uint32_t drawIndex)
+	{
+		auto& obj = *lights[drawIndex];
+		glm::mat4 world = obj.worldMatrix(frameInfo.transforms);
 
-			vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
-		}
+		// The billboard's size is its scale along x, parents scale it too
+		PointLightPushConstants push{};
+		push.position = world[3];
+		push.color = glm::vec4(obj.color, 1.f);
+		push.radius = glm::length(glm::vec3(world[0]));
+
+		vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+			0, sizeof(PointLightPushConstants), &push);
+
+		vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
 	}
 } // namespace
\ No newline at end of file
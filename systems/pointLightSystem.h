@@ -2,9 +2,11 @@
 
 #include "../engineFrameInfo.h"
 #include "../engPipeline.h"
+#include "../enginePipelineVariants.h"
 #include "../engineDevice.h"
 #include "../engineGameObject.h"
 #include "../engineCamera.h"
+#include "../engineRenderQueue.h"
 
 #include <memory>
 #include <vector>
@@ -15,21 +17,30 @@ namespace gameEngine
 	class PointLightSystem
 	{
 	public:
-		PointLightSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		PointLightSystem(EngineDevice& device, EngineShaderCompiler& compiler, const PipelineAttachments& attachments,
+			VkDescriptorSetLayout globalSetLayout);
 		~PointLightSystem();
 
 		PointLightSystem(const PointLightSystem&) = delete;
 		PointLightSystem& operator=(const PointLightSystem&) = delete;
 
+		// Fills the ubo's lights from their world positions, lights that move are animated through their
+		// transforms (or their parents')
 		void update(FrameInfo& frameInfo, GlobalUbo& ubo);
-		void render(FrameInfo& frameInfo);
+		// Submits one billboard per light to the PointLights pass
+		void queueDraws(FrameInfo& frameInfo, EngineRenderQueue& renderQueue);
 
 	private:
 		EngineDevice& engDevice;
-		std::unique_ptr<EngPipeline> engPipeline;
+		std::unique_ptr<EnginePipelineVariants> pipelineVariants;
 		VkPipelineLayout pipelineLayout;
 
+		// Lights queued this frame, indexed by the render queue's drawIndex
+		std::vector<GameObject*> lights;
+		EngineRenderQueue::Drawer drawer;
+
 		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-		void createPipeline(VkRenderPass renderPass);
+		void createPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments);
+		void recordDraw(FrameInfo& frameInfo, uint32_t drawIndex);
 	};
 } // namespace
\ No newline at end of file
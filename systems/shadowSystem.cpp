@@ -0,0 +1,418 @@
+#include "shadowSystem.h"
+
+#include "../engineUtils.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <stdexcept>
+
+namespace gameEngine
+{
+
+	ShadowSystem::ShadowSystem(EngineDevice& device, EngineShaderCompiler& compiler, EngineSamplerCache& samplerCache, const PipelineAttachments& attachments)
+		: engDevice{ device }
+	{
+		createAtlas(samplerCache);
+		createPipelineLayout();
+		createPipeline(compiler, attachments);
+	}
+
+	ShadowSystem::~ShadowSystem()
+	{
+		vkDestroyPipelineLayout(engDevice.getDevice(), pipelineLayout, nullptr);
+
+		engDevice.notifyImageViewDestroyed(atlasView);
+
+		// Frames in flight may still sample it
+		engDevice.deferDestruction([&device = engDevice, image = atlasImage, allocation = atlasAllocation, view = atlasView]()
+			{
+				vkDestroyImageView(device.getDevice(), view, nullptr);
+				device.destroyImage(image, allocation, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+			});
+	}
+
+	void ShadowSystem::createAtlas(EngineSamplerCache& samplerCache)
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { ATLAS_SIZE, ATLAS_SIZE, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = ATLAS_FORMAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		engDevice.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, atlasImage, atlasAllocation);
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = atlasImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = ATLAS_FORMAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(engDevice.getDevice(), &viewInfo, nullptr, &atlasView) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create shadow atlas view!");
+		}
+
+		// Linear filtering of a compare sampler gives 2x2 PCF for free, where the format supports it
+		bool linear = (engDevice.getFormatProperties(ATLAS_FORMAT).optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
+
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+		samplerInfo.minFilter = samplerInfo.magFilter;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.compareEnable = VK_TRUE;
+		samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		samplerInfo.minLod = 0.f;
+		samplerInfo.maxLod = 0.f;
+		samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+		atlasSampler = samplerCache.get(samplerInfo);
+	}
+
+	void ShadowSystem::createPipelineLayout()
+	{
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(glm::mat4);
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = 0;
+		pipelineLayoutInfo.pSetLayouts = nullptr;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+		if (vkCreatePipelineLayout(engDevice.getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create pipeline layout!");
+		}
+	}
+
+	void ShadowSystem::createPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments)
+	{
+		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+		VkPipelineLayout layout = pipelineLayout;
+
+		for (uint32_t i = 0; i < EngineModel::VERTEX_LAYOUT_COUNT; i++)
+		{
+			auto vertexLayout = static_cast<EngineModel::VertexLayout>(i);
+
+			pipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler, std::vector<std::string>{ "shaders/shadow.vert" },
+				[attachments, layout, vertexLayout](PipelineConfigInfo& pipelineConfig)
+				{
+					pipelineConfig.attachments = attachments;
+					pipelineConfig.pipelineLayout = layout;
+					pipelineConfig.bindingDescriptions = EngineModel::getBindingDescriptions(vertexLayout);
+					pipelineConfig.attributeDescriptions.clear();
+
+					for (auto& attribute : EngineModel::getAttributeDescriptions(vertexLayout))
+					{
+						if (attribute.location == 0) pipelineConfig.attributeDescriptions.push_back(attribute);
+					}
+
+					pipelineConfig.colorBlendInfo.attachmentCount = 0;
+					pipelineConfig.colorBlendInfo.pAttachments = nullptr;
+
+					// Faces of the negative axes are mirrored, so nothing is culled. The bias grows with
+					// the slope, where a texel covers the most depth
+					pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+					pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+					pipelineConfig.rasterizationInfo.depthBiasConstantFactor = 1.25f;
+					pipelineConfig.rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+				});
+		}
+	}
+
+	VkDescriptorImageInfo ShadowSystem::descriptorInfo() const
+	{
+		return { atlasSampler, atlasView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+	}
+
+	EngineRenderGraph::ResourceId ShadowSystem::importAtlas(EngineRenderGraph& graph)
+	{
+		// Sampled last, in the read only layout the graph gives sampled depth
+		auto atlas = graph.importImage("shadow atlas", atlasImage, atlasView, ATLAS_FORMAT, { ATLAS_SIZE, ATLAS_SIZE }, atlasLayout,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+
+		atlasLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		return atlas;
+	}
+
+	void ShadowSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo)
+	{
+		stats = Stats{};
+		casters.clear();
+		pendingLights.clear();
+
+		for (auto& kv : frameInfo.gameObject)
+		{
+			auto& obj = kv.second;
+
+			// Bounds are known once the model was uploaded
+			if (obj.model == nullptr || !obj.model->isResident() || obj.model->getLodCount() == 0) continue;
+
+			Caster caster{};
+			caster.object = &obj;
+			caster.modelMatrix = obj.worldMatrix(frameInfo.transforms);
+			caster.center = glm::vec3(caster.modelMatrix * glm::vec4(obj.model->getBoundingCenter(), 1.f));
+			caster.radius = obj.model->getBoundingRadius() * EngineTransformHierarchy::getMaxScale(caster.modelMatrix);
+			caster.hash = hashBytes(&caster.modelMatrix, sizeof(glm::mat4), reinterpret_cast<uintptr_t>(obj.model.get()));
+
+			casters.push_back(caster);
+		}
+
+		struct Candidate
+		{
+			float priority;
+			GameObject::id_t id;
+			int lightIndex;
+			glm::vec3 position;
+			float radius;
+			uint64_t signature;
+		};
+
+		std::vector<Candidate> candidates;
+		glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+		int lightIndex = 0;
+
+		for (auto& kv : frameInfo.gameObject)
+		{
+			auto& obj = kv.second;
+			if (obj.pointLight == nullptr) continue;
+
+			assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum ammount");
+
+			auto& light = lights[kv.first];
+			light.lastSeenFrame = frameInfo.frameNumber;
+
+			if (light.slot < 0)
+			{
+				auto freeSlot = std::find(usedSlots.begin(), usedSlots.end(), false);
+
+				if (freeSlot != usedSlots.end())
+				{
+					*freeSlot = true;
+					light.slot = static_cast<int32_t>(freeSlot - usedSlots.begin());
+				}
+			}
+
+			glm::vec3 position = glm::vec3(obj.worldMatrix(frameInfo.transforms)[3]);
+			float radius = obj.pointLight->shadowRadius;
+			ubo.shadowParams[lightIndex] = { light.rendered ? light.slot * FACES_PER_LIGHT : -1.f, NEAR_PLANE, light.mapRadius, 0.f };
+			ubo.shadowOrigins[lightIndex] = glm::vec4(light.mapPosition, 1.f);
+
+			// Lights past the atlas's capacity go without shadows
+			if (light.slot >= 0)
+			{
+				// Summed over the casters in reach, independent of the order the object map lists them in
+				float lightState[] = { position.x, position.y, position.z, radius };
+				uint64_t signature = hashBytes(lightState, sizeof(lightState));
+
+				for (auto& caster : casters)
+				{
+					if (glm::length(caster.center - position) < radius + caster.radius) signature += caster.hash;
+				}
+
+				if (!light.rendered || signature != light.signature)
+				{
+					// What the light can reach on screen, lights without any map yet come first
+					float distance = glm::length(position - cameraPosition);
+					float coverage = distance <= radius ? 1.f : (radius / distance) * (radius / distance);
+					float priority = light.rendered ? obj.pointLight->lightIntensity * coverage : FLT_MAX;
+
+					candidates.push_back({ priority, kv.first, lightIndex, position, radius, signature });
+				}
+			}
+
+			lightIndex++;
+		}
+
+		for (int i = lightIndex; i < MAX_LIGHTS; i++)
+		{
+			ubo.shadowParams[i] = { -1.f, 0.f, 0.f, 0.f };
+			ubo.shadowOrigins[i] = glm::vec4{ 0.f };
+		}
+
+		// Lights that are gone give their slot back
+		for (auto it = lights.begin(); it != lights.end();)
+		{
+			if (it->second.lastSeenFrame == frameInfo.frameNumber)
+			{
+				++it;
+				continue;
+			}
+
+			if (it->second.slot >= 0) usedSlots[it->second.slot] = false;
+			it = lights.erase(it);
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+
+		uint32_t updateCount = std::min(updateBudget, static_cast<uint32_t>(candidates.size()));
+
+		for (uint32_t i = 0; i < updateCount; i++)
+		{
+			auto& candidate = candidates[i];
+			auto& light = lights[candidate.id];
+
+			light.rendered = true;
+			light.signature = candidate.signature;
+			light.mapPosition = candidate.position;
+			light.mapRadius = candidate.radius;
+
+			PendingLight pending{ candidate.position, candidate.radius, static_cast<uint32_t>(light.slot) * FACES_PER_LIGHT, {} };
+
+			for (uint32_t casterIndex = 0; casterIndex < casters.size(); casterIndex++)
+			{
+				auto& caster = casters[casterIndex];
+				if (glm::length(caster.center - candidate.position) < candidate.radius + caster.radius) pending.casters.push_back(casterIndex);
+			}
+
+			ubo.shadowParams[candidate.lightIndex] = { static_cast<float>(pending.firstTile), NEAR_PLANE, candidate.radius, 0.f };
+			ubo.shadowOrigins[candidate.lightIndex] = glm::vec4(candidate.position, 1.f);
+			pendingLights.push_back(std::move(pending));
+		}
+
+		for (int i = 0; i < lightIndex; i++)
+		{
+			if (ubo.shadowParams[i].x >= 0.f) stats.shadowedLightCount++;
+		}
+
+		stats.dirtyLightCount = static_cast<uint32_t>(candidates.size());
+		stats.updatedLightCount = updateCount;
+		totalDirtyCount += candidates.size();
+		totalUpdateCount += updateCount;
+	}
+
+	glm::mat4 ShadowSystem::getFaceTransform(uint32_t face, const glm::vec3& lightPosition, float radius)
+	{
+		uint32_t axis = face / 2;
+		float sign = face % 2 == 0 ? 1.f : -1.f;
+
+		// Looks along the face's axis with the two other axes, in order, as x and y. The faces of negative
+		// axes are mirrored, which shader.frag's lookup expects
+		glm::mat4 view{ 0.f };
+		view[(axis + 1) % 3][0] = 1.f;
+		view[(axis + 2) % 3][1] = 1.f;
+		view[axis][2] = sign;
+		view[3][3] = 1.f;
+		view = view * glm::translate(glm::mat4{ 1.f }, -lightPosition);
+
+		// 90 degree frustum, depth runs from zero at NEAR_PLANE to one at radius
+		glm::mat4 projection{ 0.f };
+		projection[0][0] = 1.f;
+		projection[1][1] = 1.f;
+		projection[2][2] = radius / (radius - NEAR_PLANE);
+		projection[2][3] = 1.f;
+		projection[3][2] = -radius * NEAR_PLANE / (radius - NEAR_PLANE);
+
+		return projection * view;
+	}
+
+	bool ShadowSystem::sphereInFace(uint32_t face, const glm::vec3& offset, float radius)
+	{
+		uint32_t axis = face / 2;
+		float z = face % 2 == 0 ? offset[axis] : -offset[axis];
+		float x = offset[(axis + 1) % 3];
+		float y = offset[(axis + 2) % 3];
+
+		// The four side planes are |x| = z and |y| = z, at 45 degrees
+		float limit = radius * glm::sqrt(2.f);
+
+		return z + radius > NEAR_PLANE && x - z < limit && -x - z < limit && y - z < limit && -y - z < limit;
+	}
+
+	void ShadowSystem::render(FrameInfo& frameInfo)
+	{
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+		EngPipeline* boundPipeline = nullptr;
+		EngineModel* boundModel = nullptr;
+
+		for (auto& light : pendingLights)
+		{
+			for (uint32_t face = 0; face < FACES_PER_LIGHT; face++)
+			{
+				uint32_t tile = light.firstTile + face;
+
+				VkRect2D rect{};
+				rect.offset = { static_cast<int32_t>(tile % TILES_PER_ROW * FACE_SIZE), static_cast<int32_t>(tile / TILES_PER_ROW * FACE_SIZE) };
+				rect.extent = { FACE_SIZE, FACE_SIZE };
+
+				VkViewport viewport{};
+				viewport.x = static_cast<float>(rect.offset.x);
+				viewport.y = static_cast<float>(rect.offset.y);
+				viewport.width = static_cast<float>(FACE_SIZE);
+				viewport.height = static_cast<float>(FACE_SIZE);
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+
+				vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+				vkCmdSetScissor(commandBuffer, 0, 1, &rect);
+
+				// The rest of the atlas holds cached maps, only this face is cleared
+				VkClearAttachment clear{};
+				clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				clear.clearValue.depthStencil = { 1.0f, 0 };
+
+				VkClearRect clearRect{};
+				clearRect.rect = rect;
+				clearRect.baseArrayLayer = 0;
+				clearRect.layerCount = 1;
+
+				vkCmdClearAttachments(commandBuffer, 1, &clear, 1, &clearRect);
+
+				glm::mat4 faceTransform = getFaceTransform(face, light.position, light.radius);
+
+				for (uint32_t casterIndex : light.casters)
+				{
+					auto& caster = casters[casterIndex];
+					if (!sphereInFace(face, caster.center - light.position, caster.radius)) continue;
+
+					EngineModel* model = caster.object->model.get();
+					EngPipeline* pipeline = &pipelineVariants[static_cast<uint32_t>(model->getVertexLayout())]->get(ShaderVariant{});
+
+					if (pipeline != boundPipeline)
+					{
+						pipeline->bind(commandBuffer);
+						boundPipeline = pipeline;
+					}
+
+					if (model != boundModel)
+					{
+						model->bind(commandBuffer);
+						boundModel = model;
+					}
+
+					// Compact positions are relative to the mesh bounds
+					glm::mat4 transform = faceTransform * caster.modelMatrix * model->getDequantizeMatrix();
+
+					vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &transform);
+					model->draw(commandBuffer, 0);
+					stats.casterDrawCount++;
+				}
+			}
+		}
+	}
+} // namespace
\ No newline at end of file
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../engineFrameInfo.h"
+#include "../engPipeline.h"
+#include "../enginePipelineVariants.h"
+#include "../engineDevice.h"
+#include "../engineGameObject.h"
+#include "../engineRenderGraph.h"
+#include "../engineTexture.h"
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace gameEngine
+{
+
+	// Cube shadow maps of point lights, all in one depth atlas of FACE_SIZE tiles where each light owns
+	// six consecutive ones. A light's map is kept as long as nothing it covers changes: it is rendered
+	// again only when the light or a caster within its radius moved, appeared or went away. Lights
+	// needing an update are ranked by how much of the screen they can light and only the first few per
+	// frame are rendered, the others keep their previous map until their turn comes. Shading looks maps up
+	// from the position they were rendered from, so a waiting map lags behind its light instead of
+	// being sampled against a position it doesn't match.
+	//
+	// Casters are drawn at full detail with positions only, without culling and with slope scaled bias
+	class ShadowSystem
+	{
+	public:
+		static constexpr VkFormat ATLAS_FORMAT = VK_FORMAT_D16_UNORM;	// sampled depth attachment support is mandatory
+		static constexpr uint32_t ATLAS_SIZE = 4096;
+		static constexpr uint32_t FACE_SIZE = 512;	// must match shader.frag
+		static constexpr uint32_t TILES_PER_ROW = ATLAS_SIZE / FACE_SIZE;
+		static constexpr uint32_t FACES_PER_LIGHT = 6;
+		static constexpr uint32_t SLOT_COUNT = TILES_PER_ROW * TILES_PER_ROW / FACES_PER_LIGHT;
+		static constexpr float NEAR_PLANE = .05f;
+		static constexpr uint32_t DEFAULT_UPDATE_BUDGET = 2;
+
+		// Of the last frame
+		struct Stats
+		{
+			uint32_t shadowedLightCount = 0;	// lights with a map to sample
+			uint32_t dirtyLightCount = 0;	// lights whose map is out of date, updated or not
+			uint32_t updatedLightCount = 0;
+			uint32_t casterDrawCount = 0;
+		};
+
+		// attachments are those of a pass writing only the atlas's depth
+		ShadowSystem(EngineDevice& device, EngineShaderCompiler& compiler, EngineSamplerCache& samplerCache, const PipelineAttachments& attachments);
+		~ShadowSystem();
+
+		ShadowSystem(const ShadowSystem&) = delete;
+		ShadowSystem& operator=(const ShadowSystem&) = delete;
+
+		// Picks the lights rendered this frame and writes every light's shadowParams and shadowOrigins, in the order
+		// PointLightSystem::update fills the lights of ubo. Call after model residency is known
+		void update(FrameInfo& frameInfo, GlobalUbo& ubo);
+
+		// Imports the atlas in the layout the previous frame left it, every frame
+		EngineRenderGraph::ResourceId importAtlas(EngineRenderGraph& graph);
+
+		// Whether update picked lights, render then needs a pass writing the atlas's depth
+		bool hasPendingUpdates() const { return !pendingLights.empty(); }
+		void render(FrameInfo& frameInfo);
+
+		// Compare sampler and the layout the atlas is left in
+		VkDescriptorImageInfo descriptorInfo() const;
+
+		// Lights whose maps are re-rendered per frame at most
+		void setUpdateBudget(uint32_t lightsPerFrame) { updateBudget = lightsPerFrame; }
+
+		const Stats& getStats() const { return stats; }
+		uint64_t getTotalUpdateCount() const { return totalUpdateCount; }
+		uint64_t getTotalDirtyCount() const { return totalDirtyCount; }
+
+	private:
+		struct LightShadow
+		{
+			int32_t slot = -1;
+			bool rendered = false;	// the slot holds a map of this light
+			uint64_t signature = 0;	// of the light and its casters when the map was rendered
+			glm::vec3 mapPosition{};	// the light's when the map was rendered
+			float mapRadius = 0.f;
+			uint64_t lastSeenFrame = 0;
+		};
+
+		struct Caster
+		{
+			GameObject* object;
+			glm::mat4 modelMatrix;
+			glm::vec3 center;
+			float radius;
+			uint64_t hash;	// of its model and world matrix
+		};
+
+		struct PendingLight
+		{
+			glm::vec3 position;
+			float radius;
+			uint32_t firstTile;
+			std::vector<uint32_t> casters;	// indices into casters
+		};
+
+		EngineDevice& engDevice;
+		VkImage atlasImage = VK_NULL_HANDLE;
+		EngineMemoryAllocator::Allocation atlasAllocation{};
+		VkImageView atlasView = VK_NULL_HANDLE;
+		VkSampler atlasSampler = VK_NULL_HANDLE;
+		VkImageLayout atlasLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkPipelineLayout pipelineLayout;
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> pipelineVariants;
+
+		std::unordered_map<GameObject::id_t, LightShadow> lights;
+		std::array<bool, SLOT_COUNT> usedSlots{};
+		std::vector<Caster> casters;
+		std::vector<PendingLight> pendingLights;
+		uint32_t updateBudget = DEFAULT_UPDATE_BUDGET;
+
+		Stats stats{};
+		uint64_t totalUpdateCount = 0;
+		uint64_t totalDirtyCount = 0;
+
+		void createAtlas(EngineSamplerCache& samplerCache);
+		void createPipelineLayout();
+		void createPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments);
+
+		static glm::mat4 getFaceTransform(uint32_t face, const glm::vec3& lightPosition, float radius);
+		static bool sphereInFace(uint32_t face, const glm::vec3& offset, float radius);
+	};
+} // namespace
\ No newline at end of file
@@ -18,26 +18,72 @@ namespace gameEngine
 		glm::mat4 normalMatrix{1.f};
 	};
 
-	SimpleRenderSystem::SimpleRenderSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-		: engDevice{ device }
+	// Must match the constant_id declarations in shader.frag and meshlet.task
+	enum SimpleShaderConstant : uint32_t
 	{
+		LIGHT_COUNT_CAP = 0,
+		ENABLE_SPECULAR = 1,
+		CONE_CULLING = 2,
+	};
+
+	// local_size_x of meshlet.task
+	static constexpr uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+
+	SimpleRenderSystem::SimpleRenderSystem(EngineDevice& device, EngineShaderCompiler& compiler, EngineSamplerCache& samplerCache, const PipelineAttachments& attachments,
+		const PipelineAttachments& depthAttachments, VkDescriptorSetLayout globalSetLayout)
+		: engDevice{ device }, textureSetCache{ device }
+	{
+		meshletCuller = std::make_unique<EngineMeshletCuller>(engDevice, compiler, globalSetLayout);
+
+		textureSetLayout = EngineDescriptorSetLayout::Builder(engDevice)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build();
+
+		texturePool = EngineDescriptorPool::Builder(engDevice)
+			.setMaxSets(MAX_TEXTURES)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES)
+			.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+			.build();
+
+		defaultTexture = std::make_unique<EngineTexture>(engDevice, EngineTexture::Pixels::solid(255, 255, 255));
+		sampler = samplerCache.getDefault();
+
+		drawer.bindMesh = [this](FrameInfo& frameInfo, uint32_t drawIndex) { bindMesh(frameInfo, drawIndex); };
+		drawer.draw = [this](FrameInfo& frameInfo, uint32_t drawIndex) { recordDraw(frameInfo, drawIndex); };
+
 		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
+		createPipeline(compiler, attachments, depthAttachments);
+
+		if (engDevice.supportsMeshShaders())
+		{
+			createMeshPipeline(compiler, attachments, depthAttachments);
+		}
 	}
 
 	SimpleRenderSystem::~SimpleRenderSystem()
 	{
+		// The layout dies with this object, don't leave its sets behind in the cache
+		textureSetCache.clear();
 		vkDestroyPipelineLayout(engDevice.getDevice(), pipelineLayout, nullptr);
 	}
 
 	void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout)
 	{
+		pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		if (engDevice.supportsMeshShaders())
+		{
+			pushConstantStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+		}
+
 		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.stageFlags = pushConstantStages;
 		pushConstantRange.offset = 0;
 		pushConstantRange.size = sizeof(SimplePushConstantData);
 
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+		// The vertex pipelines never touch set 1, sharing one layout keeps sets 0 and 2 bound across both paths
+		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, meshletCuller->getMeshletSetLayout(),
+			textureSetLayout->getDescriptorSetLayout() };
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -52,41 +98,406 @@ namespace gameEngine
 		}
 	}
 
-	void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
+	// After the depth prepass the depth image holds the nearest surface, only fragments matching it are shaded
+	static void configureEqualDepth(PipelineConfigInfo& pipelineConfig)
+	{
+		pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+		pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+	}
+
+	// No fragment shader and no color attachments, only depth is written
+	static void configureDepthOnly(PipelineConfigInfo& pipelineConfig)
+	{
+		pipelineConfig.colorBlendInfo.attachmentCount = 0;
+		pipelineConfig.colorBlendInfo.pAttachments = nullptr;
+	}
+
+	void SimpleRenderSystem::createPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments, const PipelineAttachments& depthAttachments)
 	{
 		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-		PipelineConfigInfo pipelineConfig{};
-		EngPipeline::defaultPipelineConfigInfo(pipelineConfig);
+		VkPipelineLayout layout = pipelineLayout;
+
+		for (uint32_t i = 0; i < EngineModel::VERTEX_LAYOUT_COUNT; i++)
+		{
+			auto vertexLayout = static_cast<EngineModel::VertexLayout>(i);
+
+			auto configure = [attachments, layout, vertexLayout](PipelineConfigInfo& pipelineConfig)
+				{
+					pipelineConfig.attachments = attachments;
+					pipelineConfig.pipelineLayout = layout;
+					pipelineConfig.bindingDescriptions = EngineModel::getBindingDescriptions(vertexLayout);
+					pipelineConfig.attributeDescriptions = EngineModel::getAttributeDescriptions(vertexLayout);
+				};
 
-		pipelineConfig.renderPass = renderPass;
-		pipelineConfig.pipelineLayout = pipelineLayout;
-		engPipeline = std::make_unique<EngPipeline>(engDevice, "shaders/shader.vert.spv", "shaders/shader.frag.spv", pipelineConfig);
+			pipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler, "shaders/shader.vert", "shaders/shader.frag", configure);
+
+			equalPipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler, "shaders/shader.vert", "shaders/shader.frag",
+				[configure](PipelineConfigInfo& pipelineConfig)
+				{
+					configure(pipelineConfig);
+					configureEqualDepth(pipelineConfig);
+				});
+
+			// Same vertex buffer binding, but only the position attribute is fetched
+			depthPipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler, std::vector<std::string>{ "shaders/depth.vert" },
+				[depthAttachments, layout, vertexLayout](PipelineConfigInfo& pipelineConfig)
+				{
+					pipelineConfig.attachments = depthAttachments;
+					pipelineConfig.pipelineLayout = layout;
+					pipelineConfig.bindingDescriptions = EngineModel::getBindingDescriptions(vertexLayout);
+					pipelineConfig.attributeDescriptions.clear();
+
+					for (auto& attribute : EngineModel::getAttributeDescriptions(vertexLayout))
+					{
+						if (attribute.location == 0) pipelineConfig.attributeDescriptions.push_back(attribute);
+					}
+
+					configureDepthOnly(pipelineConfig);
+				});
+		}
 	}
 
-	void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo)
+	void SimpleRenderSystem::createMeshPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments, const PipelineAttachments& depthAttachments)
 	{
-		engPipeline->bind(frameInfo.commandBuffer);
+		VkPipelineLayout layout = pipelineLayout;
 
-		vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-			pipelineLayout, 0, 1, &frameInfo.globalDescriptorSet, 0, nullptr);
+		for (uint32_t i = 0; i < EngineModel::VERTEX_LAYOUT_COUNT; i++)
+		{
+			meshPipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler,
+				std::vector<std::string>{ "shaders/meshlet.task", "shaders/meshlet.mesh", "shaders/shader.frag" },
+				[attachments, layout](PipelineConfigInfo& pipelineConfig)
+				{
+					pipelineConfig.attachments = attachments;
+					pipelineConfig.pipelineLayout = layout;
+				});
+
+			equalMeshPipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler,
+				std::vector<std::string>{ "shaders/meshlet.task", "shaders/meshlet.mesh", "shaders/shader.frag" },
+				[attachments, layout](PipelineConfigInfo& pipelineConfig)
+				{
+					pipelineConfig.attachments = attachments;
+					pipelineConfig.pipelineLayout = layout;
+					configureEqualDepth(pipelineConfig);
+				});
+
+			// The task stage has to cull exactly like the main pass, it runs with the same cone culling constant
+			depthMeshPipelineVariants[i] = std::make_unique<EnginePipelineVariants>(engDevice, compiler,
+				std::vector<std::string>{ "shaders/meshlet.task", "shaders/meshlet.mesh" },
+				[depthAttachments, layout](PipelineConfigInfo& pipelineConfig)
+				{
+					pipelineConfig.attachments = depthAttachments;
+					pipelineConfig.pipelineLayout = layout;
+					configureDepthOnly(pipelineConfig);
+				});
+		}
+	}
+
+	ShaderVariant SimpleRenderSystem::selectVariant(const FrameInfo& frameInfo, EngineModel::VertexLayout layout) const
+	{
+		int numLights = 0;
+
+		for (auto& kv : frameInfo.gameObject)
+		{
+			if (kv.second.pointLight != nullptr) numLights++;
+		}
+
+		// Round the light count up to a power of two so a handful of variants covers every scene, the
+		// shader's loop bound is then a constant it can unroll
+		int lightCountCap = 1;
+
+		while (lightCountCap < numLights)
+		{
+			lightCountCap *= 2;
+		}
+
+		lightCountCap = glm::min(lightCountCap, MAX_LIGHTS);
+
+		ShaderVariant variant{};
+		variant.set(LIGHT_COUNT_CAP, static_cast<int32_t>(numLights == 0 ? 0 : lightCountCap));
+		variant.set(ENABLE_SPECULAR, specularEnabled);
+		variant.set(CONE_CULLING, coneCullingEnabled);
+
+		for (auto& define : EngineModel::getShaderDefines(layout))
+		{
+			variant.define(define.first, define.second);
+		}
+
+		return variant;
+	}
+
+	ShaderVariant SimpleRenderSystem::selectDepthVariant(EngineModel::VertexLayout layout) const
+	{
+		// Lighting constants don't matter without a fragment shader, one variant per layout does
+		ShaderVariant variant{};
+		variant.set(CONE_CULLING, coneCullingEnabled);
+
+		for (auto& define : EngineModel::getShaderDefines(layout))
+		{
+			variant.define(define.first, define.second);
+		}
+
+		return variant;
+	}
+
+	uint32_t SimpleRenderSystem::selectLod(const FrameInfo& frameInfo, GameObject& obj, const glm::mat4& modelMatrix) const
+	{
+		if (!lodEnabled || obj.model->getLodCount() <= 1)
+		{
+			return 0;
+		}
+
+		// Distance to the bounding sphere, the error is measured at its nearest point
+		float maxScale = EngineTransformHierarchy::getMaxScale(modelMatrix);
+
+		glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(obj.model->getBoundingCenter(), 1.f));
+		float distance = glm::length(center - frameInfo.camera.getPosition()) - obj.model->getBoundingRadius() * maxScale;
+
+		if (distance <= 0.f)
+		{
+			return 0;
+		}
+
+		// projection[1][1] is cot(fovy / 2): world units at this distance to pixels
+		float pixelsPerUnit = frameInfo.camera.getProjection()[1][1] * .5f * frameInfo.extent.height / distance * maxScale;
+
+		return obj.model->selectLod(pixelsPerUnit, obj.lod, lodThresholdPixels, lodHysteresis);
+	}
+
+	// Planes from the rows of projection * view (Gribb and Hartmann), depth runs from zero to one
+	static bool sphereInFrustum(const glm::mat4& viewProjection, const glm::vec3& center, float radius)
+	{
+		glm::vec4 rows[4];
+
+		for (int i = 0; i < 4; i++)
+		{
+			rows[i] = glm::vec4{ viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i] };
+		}
+
+		glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+
+		for (auto& plane : planes)
+		{
+			float length = glm::length(glm::vec3(plane));
+
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius * length)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool SimpleRenderSystem::isVisible(const FrameInfo& frameInfo, GameObject& obj, const glm::mat4& modelMatrix) const
+	{
+		// Streamed models know their bounds only after their first upload
+		if (obj.model->getLodCount() == 0)
+		{
+			return true;
+		}
+
+		float maxScale = EngineTransformHierarchy::getMaxScale(modelMatrix);
+
+		glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(obj.model->getBoundingCenter(), 1.f));
+		glm::mat4 viewProjection = frameInfo.camera.getProjection() * frameInfo.camera.getView();
+
+		return sphereInFrustum(viewProjection, center, obj.model->getBoundingRadius() * maxScale);
+	}
+
+	bool SimpleRenderSystem::useMeshlets(GameObject& obj) const
+	{
+		return meshletsEnabled && obj.lod == 0 && obj.model->hasMeshlets();
+	}
+
+	VkDescriptorSet SimpleRenderSystem::getTextureSet(const EngineTexture& texture)
+	{
+		auto imageInfo = texture.descriptorInfo(sampler);
+		VkDescriptorSet set;
+
+		EngineDescriptorWriter(*textureSetLayout, *texturePool)
+			.writeImage(0, &imageInfo)
+			.build(set, textureSetCache);
+
+		return set;
+	}
+
+	void SimpleRenderSystem::prepareFrame(FrameInfo& frameInfo)
+	{
+		stats = RenderStats{};
+		meshletDraws.clear();
+		draws.clear();
+		bool culling = false;
+		glm::vec3 cameraPosition = frameInfo.camera.getPosition();
 
-		// kv = Key Value
 		for (auto& kv : frameInfo.gameObject)
 		{
 			auto& obj = kv.second;
 			if (obj.model == nullptr) continue;
 
-			SimplePushConstantData push{};
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.normalMatrix();
+			glm::mat4 modelMatrix = obj.worldMatrix(frameInfo.transforms);
+			obj.visible = isVisible(frameInfo, obj, modelMatrix);
+
+			// Streaming keeps what was seen recently resident and brings evicted models back
+			if (obj.visible)
+			{
+				obj.model->markVisible(frameInfo.frameNumber);
+			}
+
+			if (!obj.visible || !obj.model->isResident()) continue;
+
+			obj.lod = selectLod(frameInfo, obj, modelMatrix);
+
+			bool meshShading = useMeshlets(obj) && engDevice.supportsMeshShaders();
+			glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(obj.model->getBoundingCenter(), 1.f));
+			draws.push_back({ kv.first, &obj, meshShading, glm::length(center - cameraPosition) });
+
+			// Mesh shaders cull in their task stage, nothing to prepare
+			if (!useMeshlets(obj) || meshShading) continue;
+
+			if (!culling)
+			{
+				meshletCuller->begin(frameInfo);
+				culling = true;
+			}
+
+			uint32_t drawIndex;
+
+			if (meshletCuller->cull(frameInfo, *obj.model, modelMatrix, drawIndex))
+			{
+				meshletDraws[kv.first] = drawIndex;
+			}
+		}
+
+		if (culling)
+		{
+			meshletCuller->end(frameInfo);
+		}
+	}
+
+	void SimpleRenderSystem::queueDraws(FrameInfo& frameInfo, EngineRenderQueue& renderQueue)
+	{
+		// Variants only depend on the layout, not on the object
+		std::array<ShaderVariant, EngineModel::VERTEX_LAYOUT_COUNT> variants;
+		std::array<ShaderVariant, EngineModel::VERTEX_LAYOUT_COUNT> depthVariants;
+
+		for (uint32_t i = 0; i < EngineModel::VERTEX_LAYOUT_COUNT; i++)
+		{
+			auto vertexLayout = static_cast<EngineModel::VertexLayout>(i);
+			variants[i] = selectVariant(frameInfo, vertexLayout);
+			depthVariants[i] = selectDepthVariant(vertexLayout);
+		}
+
+		for (uint32_t drawIndex = 0; drawIndex < draws.size(); drawIndex++)
+		{
+			auto& draw = draws[drawIndex];
+			auto& obj = *draw.object;
+			uint32_t i = static_cast<uint32_t>(obj.model->getVertexLayout());
+			bool meshShading = draw.meshShading;
+
+			// Compute culled draws bind their own index buffer, so they don't share the model's binding
+			bool culledDraw = meshletDraws.find(draw.id) != meshletDraws.end();
+			const void* mesh = culledDraw ? nullptr : obj.model.get();
+
+			if (depthPrepassEnabled)
+			{
+				auto& family = meshShading ? depthMeshPipelineVariants[i] : depthPipelineVariants[i];
+
+				EngineRenderQueue::Draw depthDraw{};
+				depthDraw.pass = RenderQueuePass::DepthPrepass;
+				depthDraw.pipeline = &family->get(depthVariants[i]);
+				depthDraw.pipelineLayout = pipelineLayout;
+				depthDraw.mesh = mesh;
+				depthDraw.depth = draw.distance;
+				depthDraw.drawer = &drawer;
+				depthDraw.drawIndex = drawIndex;
+
+				renderQueue.submit(depthDraw);
+				stats.prepassDrawCount++;
+			}
+
+			auto& family = depthPrepassEnabled ? (meshShading ? equalMeshPipelineVariants[i] : equalPipelineVariants[i])
+				: (meshShading ? meshPipelineVariants[i] : pipelineVariants[i]);
+
+			// Textures still streaming in draw white until they are resident
+			const EngineTexture& texture = obj.texture != nullptr && obj.texture->isResident() ? *obj.texture : *defaultTexture;
+
+			EngineRenderQueue::Draw colorDraw{};
+			colorDraw.pass = RenderQueuePass::Opaque;
+			colorDraw.pipeline = &family->get(variants[i]);
+			colorDraw.pipelineLayout = pipelineLayout;
+			colorDraw.descriptorSet = getTextureSet(texture);
+			colorDraw.descriptorSetIndex = 2;
+			colorDraw.mesh = mesh;
+			colorDraw.depth = draw.distance;
+			colorDraw.drawer = &drawer;
+			colorDraw.drawIndex = drawIndex;
+
+			renderQueue.submit(colorDraw);
+
+			stats.drawCount++;
+			stats.triangleCount += obj.model->getTriangleCount(obj.lod);
+			stats.lodHistogram[obj.lod]++;
+
+			if (meshShading || culledDraw)
+			{
+				stats.meshletDrawCount++;
+			}
+		}
+	}
+
+	void SimpleRenderSystem::bindMesh(FrameInfo& frameInfo, uint32_t drawIndex)
+	{
+		auto& draw = draws[drawIndex];
+
+		if (draw.meshShading)
+		{
+			VkDescriptorSet meshletSet = meshletCuller->getMeshletSet(*draw.object->model);
+
+			vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				pipelineLayout, 1, 1, &meshletSet, 0, nullptr);
+		}
+		else
+		{
+			draw.object->model->bind(frameInfo.commandBuffer);
+		}
+	}
+
+	void SimpleRenderSystem::recordDraw(FrameInfo& frameInfo, uint32_t drawIndex)
+	{
+		auto& draw = draws[drawIndex];
+		auto& obj = *draw.object;
 
-			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
-				sizeof(SimplePushConstantData), &push);
+		// Compact positions are stored relative to the mesh bounds, the normal matrix is unaffected
+		// since the octahedral normals were encoded in model space. Mesh shaders dequantize on
+		// their own and cull with the plain model matrix
+		glm::mat4 modelMatrix = obj.worldMatrix(frameInfo.transforms);
 
+		SimplePushConstantData push{};
+		push.modelMatrix = draw.meshShading ? modelMatrix : modelMatrix * obj.model->getDequantizeMatrix();
+		push.normalMatrix = obj.worldNormalMatrix(frameInfo.transforms);
+
+		vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, pushConstantStages, 0,
+			sizeof(SimplePushConstantData), &push);
+
+		if (draw.meshShading)
+		{
+			uint32_t taskGroups = (obj.model->getMeshletCount() + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE;
+			engDevice.cmdDrawMeshTasks(frameInfo.commandBuffer, taskGroups, 1, 1);
+			return;
+		}
+
+		// The prepass draws the same culled index lists, depth must cover exactly what gets shaded
+		auto meshletDraw = meshletDraws.find(draw.id);
+
+		if (meshletDraw != meshletDraws.end())
+		{
 			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
+			meshletCuller->draw(frameInfo, meshletDraw->second);
+		}
+		else
+		{
+			obj.model->draw(frameInfo.commandBuffer, obj.lod);
 		}
 	}
 } // namespace
\ No newline at end of file
@@ -2,11 +2,18 @@
 
 #include "../engineFrameInfo.h"
 #include "../engPipeline.h"
+#include "../enginePipelineVariants.h"
+#include "../engineMeshletCuller.h"
 #include "../engineDevice.h"
 #include "../engineGameObject.h"
 #include "../engineCamera.h"
+#include "../engineDescriptors.h"
+#include "../engineTexture.h"
+#include "../engineRenderQueue.h"
 
+#include <array>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace gameEngine
@@ -15,20 +22,113 @@ namespace gameEngine
 	class SimpleRenderSystem
 	{
 	public:
-		SimpleRenderSystem(EngineDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		struct RenderStats
+		{
+			uint32_t drawCount = 0;
+			uint32_t prepassDrawCount = 0;
+			uint32_t meshletDrawCount = 0;	// draws culled per meshlet, their triangleCount is before culling
+			uint64_t triangleCount = 0;
+			std::array<uint32_t, EngineModel::MAX_LODS> lodHistogram{};	// draws per level of detail
+		};
+
+		static constexpr uint32_t MAX_TEXTURES = 256;
+
+		// depthAttachments are those of the depth prepass, a depth image and no color
+		SimpleRenderSystem(EngineDevice& device, EngineShaderCompiler& compiler, EngineSamplerCache& samplerCache, const PipelineAttachments& attachments,
+			const PipelineAttachments& depthAttachments, VkDescriptorSetLayout globalSetLayout);
 		~SimpleRenderSystem();
 
 		SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 		SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
-		void renderGameObjects(FrameInfo& frameInfo);
+		// Records work that has to happen outside the render pass: frustum culls every object, marks the
+		// visible models for streaming, picks LODs and, without mesh shaders, runs the meshlet culling
+		// compute pass. Call before queueDraws, which skips culled and non resident objects
+		void prepareFrame(FrameInfo& frameInfo);
+
+		// Submits the objects to the Opaque pass and, with the depth prepass enabled, to the DepthPrepass
+		// pass. The queue records them and must not outlive the frame
+		void queueDraws(FrameInfo& frameInfo, EngineRenderQueue& renderQueue);
+
+		// The prepass lays down depth with positions only and without a fragment shader. The Opaque pass
+		// then tests depth with EQUAL and doesn't write it, so every pixel is shaded once. Both passes
+		// must render into the same depth image
+		void setDepthPrepassEnabled(bool enabled) { depthPrepassEnabled = enabled; }
+		bool isDepthPrepassEnabled() const { return depthPrepassEnabled; }
+
+		void setSpecularEnabled(bool enabled) { specularEnabled = enabled; }
+
+		// LODs are picked so their simplification error covers at most thresholdPixels on screen
+		void setLodEnabled(bool enabled) { lodEnabled = enabled; }
+		void setLodThreshold(float thresholdPixels, float hysteresis) { lodThresholdPixels = thresholdPixels; lodHysteresis = hysteresis; }
+
+		// Full detail objects whose model has meshlets are drawn cluster culled, through mesh shaders when
+		// the device has them and compute compaction otherwise
+		void setMeshletsEnabled(bool enabled) { meshletsEnabled = enabled; }
+		void setConeCullingEnabled(bool enabled) { coneCullingEnabled = enabled; meshletCuller->setConeCullingEnabled(enabled); }
+
+		// Counters of the last frame
+		const RenderStats& getStats() const { return stats; }
 
 	private:
+		// Objects drawn this frame, visible and resident, indexed by the render queue's drawIndex
+		struct Draw
+		{
+			GameObject::id_t id;
+			GameObject* object;
+			bool meshShading;
+			float distance;
+		};
+
 		EngineDevice& engDevice;
-		std::unique_ptr<EngPipeline> engPipeline;
+		// One family per vertex layout, they differ in vertex input state and shader defines. The mesh
+		// shader families exist only when the device supports them. equal* shade after the depth prepass,
+		// depth* are the prepass itself
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> pipelineVariants;
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> meshPipelineVariants;
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> equalPipelineVariants;
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> equalMeshPipelineVariants;
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> depthPipelineVariants;
+		std::array<std::unique_ptr<EnginePipelineVariants>, EngineModel::VERTEX_LAYOUT_COUNT> depthMeshPipelineVariants;
+		std::unique_ptr<EngineMeshletCuller> meshletCuller;
+
+		// Set 2, the diffuse texture. Objects without a resident texture sample a white pixel
+		std::unique_ptr<EngineDescriptorSetLayout> textureSetLayout;
+		std::unique_ptr<EngineDescriptorPool> texturePool;
+		EngineDescriptorSetCache textureSetCache;
+		std::unique_ptr<EngineTexture> defaultTexture;
+		VkSampler sampler;
+
 		VkPipelineLayout pipelineLayout;
+		VkShaderStageFlags pushConstantStages;
+
+		bool meshletsEnabled = true;
+		bool coneCullingEnabled = true;
+
+		// Indirect draw of each object culled by meshletCuller this frame
+		std::unordered_map<GameObject::id_t, uint32_t> meshletDraws;
+		std::vector<Draw> draws;
+		EngineRenderQueue::Drawer drawer;
+		bool specularEnabled = true;
+		bool depthPrepassEnabled = false;
+
+		bool lodEnabled = true;
+		float lodThresholdPixels = 1.f;
+		float lodHysteresis = .25f;
+		RenderStats stats{};
+
+		uint32_t selectLod(const FrameInfo& frameInfo, GameObject& obj, const glm::mat4& modelMatrix) const;
+		bool isVisible(const FrameInfo& frameInfo, GameObject& obj, const glm::mat4& modelMatrix) const;
+
+		ShaderVariant selectVariant(const FrameInfo& frameInfo, EngineModel::VertexLayout layout) const;
+		ShaderVariant selectDepthVariant(EngineModel::VertexLayout layout) const;
+		bool useMeshlets(GameObject& obj) const;
+		VkDescriptorSet getTextureSet(const EngineTexture& texture);
+		void bindMesh(FrameInfo& frameInfo, uint32_t drawIndex);
+		void recordDraw(FrameInfo& frameInfo, uint32_t drawIndex);
 
 		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-		void createPipeline(VkRenderPass renderPass);
+		void createPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments, const PipelineAttachments& depthAttachments);
+		void createMeshPipeline(EngineShaderCompiler& compiler, const PipelineAttachments& attachments, const PipelineAttachments& depthAttachments);
 	};
 } // namespace
\ No newline at end of file